@@ -71,7 +71,7 @@ int main() {
   try {
     thread connect_thread(
       fabric_cache::cache_init, cache_name, kDefaultFabricHost,
-      kDefaultFabricPort, kDefaultFabricUser, kDefaultFabricPassword);
+      kDefaultFabricPort, kDefaultFabricUser, kDefaultFabricPassword, "");
     connect_thread.detach();
     std::this_thread::sleep_for(std::chrono::seconds(5));
   } catch (const fabric_cache::base_error &exc) {
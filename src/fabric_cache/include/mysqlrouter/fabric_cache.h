@@ -164,10 +164,13 @@ public:
  * @param port MySQL Fabric port (default 32275, MySQL-RPC)
  * @param user MySQL Fabric username
  * @param password MySQL Fabric password
+ * @param topology_cache_file file the groups are saved to and loaded from at
+ *                            start, empty to not save them
  */
 void FABRIC_CACHE_API cache_init(const string &cache_name, const string &host, const int port,
                 const string &user,
-                const string &password);
+                const string &password,
+                const string &topology_cache_file = "");
 void FABRIC_CACHE_API cache_stop(const string &cache_name);
 /** @brief Checks whether the given cache was initialized
  *
@@ -36,7 +36,8 @@ std::vector<string> g_fabric_cache_config_sections{};
 
 void cache_init(const string &cache_name, const string &host, const int port,
                 const string &user,
-                const string &password) {
+                const string &password,
+                const string &topology_cache_file) {
   if (g_fabric_caches.find(cache_name) != g_fabric_caches.end()) {
     return;
   }
@@ -47,7 +48,7 @@ void cache_init(const string &cache_name, const string &host, const int port,
     g_fabric_caches.emplace(std::make_pair(
         cache_name,
         std::unique_ptr<FabricCache>(
-            new FabricCache(host, port, user, password, 1, 1)))
+            new FabricCache(host, port, user, password, 1, 1, topology_cache_file)))
     );
   }
 
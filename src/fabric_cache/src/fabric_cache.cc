@@ -17,8 +17,10 @@
 
 #include "common.h"
 #include "fabric_cache.h"
+#include "topology_cache_file.h"
 #include "mysql/harness/logging/logging.h"
 
+#include <cmath>
 #include <list>
 #include <memory>
 
@@ -50,15 +52,87 @@ std::map<ManagedServer::Status, string> ManagedServer::StatusNames{
  *                                  fabric server should timeout.
  * @param connection_attempts The number of times a connection to fabric must be
  *                            attempted, when a connection attempt fails.
+ * @param topology_cache_file File the groups are saved to and loaded from at
+ *                            start, empty to not save them.
  */
 FabricCache::FabricCache(string host, int port, string user, string password,
-                         int connection_timeout, int connection_attempts) {
+                         int connection_timeout, int connection_attempts,
+                         const string &topology_cache_file) :
+  fabric_address_(host + ":" + std::to_string(port)),
+  topology_cache_file_(topology_cache_file),
+  metric_refresh_duration_(mysql_harness::metrics::MetricsRegistry::instance().histogram(
+      "mysqlrouter_fabric_cache_refresh_duration_seconds",
+      "time taken by fabric cache refreshes",
+      {{"fabric", host + ":" + std::to_string(port)}})),
+  metric_refresh_failures_(mysql_harness::metrics::MetricsRegistry::instance().counter(
+      "mysqlrouter_fabric_cache_refresh_failures_total",
+      "fabric cache refreshes that failed",
+      {{"fabric", host + ":" + std::to_string(port)}})),
+  metric_ttl_(mysql_harness::metrics::MetricsRegistry::instance().gauge(
+      "mysqlrouter_fabric_cache_ttl_seconds",
+      "TTL of the fabric cache as announced by fabric",
+      {{"fabric", host + ":" + std::to_string(port)}})),
+  metric_topology_stale_(mysql_harness::metrics::MetricsRegistry::instance().gauge(
+      "mysqlrouter_fabric_cache_topology_stale",
+      "1 while routing uses the groups loaded at start that fabric didn't confirm yet",
+      {{"fabric", host + ":" + std::to_string(port)}})) {
   fabric_meta_data_ = get_instance(host, port, user, password,
                                    connection_timeout, connection_attempts);
   ttl_= std::chrono::milliseconds(3000);
   terminate_ = false;
 
-  refresh();
+  load_topology_cache();
+  // with saved groups the cache is usable right away; the refresh thread
+  // asks fabric as soon as it starts
+  if (!topology_stale_) refresh();
+}
+
+void FabricCache::load_topology_cache() {
+  if (topology_cache_file_.empty()) return;
+
+  map<string, list<ManagedServer>> groups;
+  try {
+    groups = fabric_cache::load_topology_cache_file(topology_cache_file_, fabric_address_);
+  } catch (const std::runtime_error &exc) {
+    // no file yet on the first start
+    log_info("Not using the saved groups: %s", exc.what());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+    group_data_ = std::move(groups);
+  }
+  topology_stale_ = true;
+  metric_topology_stale_.set(1);
+  log_info("Loaded groups of Fabric %s from '%s', using them until Fabric confirms them",
+           fabric_address_.c_str(), topology_cache_file_.c_str());
+}
+
+void FabricCache::save_topology_cache() {
+  if (topology_cache_file_.empty()) return;
+
+  try {
+    fabric_cache::save_topology_cache_file(topology_cache_file_, fabric_address_, group_data_);
+  } catch (const std::runtime_error &exc) {
+    log_warning("Failed saving the groups: %s", exc.what());
+  }
+}
+
+static bool same_groups(const map<string, list<ManagedServer>> &a,
+                        const map<string, list<ManagedServer>> &b) {
+  if (a.size() != b.size()) return false;
+  for (auto ai = a.begin(), bi = b.begin(); ai != a.end(); ++ai, ++bi) {
+    if (ai->first != bi->first || ai->second.size() != bi->second.size())
+      return false;
+    for (auto as = ai->second.begin(), bs = bi->second.begin(); as != ai->second.end(); ++as, ++bs) {
+      if (as->server_uuid != bs->server_uuid || as->host != bs->host ||
+          as->port != bs->port || as->mode != bs->mode || as->status != bs->status ||
+          std::fabs(as->weight - bs->weight) >= 0.001f)
+        return false;
+    }
+  }
+  return true;
 }
 
 void* FabricCache::run_thread(void* context) {
@@ -108,14 +182,27 @@ list<ManagedServer> FabricCache::group_lookup(const string &group_id) {
 }
 
 void FabricCache::refresh() {
+  const auto refresh_start = std::chrono::steady_clock::now();
   try {
     fetch_data();
-    cache_refreshing_mutex_.lock();
-    group_data_ = group_data_temp_;
-    cache_refreshing_mutex_.unlock();
+    const bool changed = !same_groups(group_data_, group_data_temp_);
+    if (changed) {
+      std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+      group_data_ = group_data_temp_;
+    }
+    if (topology_stale_) {
+      topology_stale_ = false;
+      metric_topology_stale_.set(0);
+      log_info("Groups of Fabric %s confirmed", fabric_address_.c_str());
+    }
+    if (changed) save_topology_cache();
   } catch (const fabric_cache::base_error &exc) {
+    metric_refresh_failures_.increment();
     log_debug("Failed fetching data: %s", exc.what());
   }
+  metric_refresh_duration_.observe(std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - refresh_start).count());
+  metric_ttl_.set(std::chrono::duration_cast<std::chrono::seconds>(ttl_).count());
 }
 
 void FabricCache::fetch_data() {
@@ -31,6 +31,7 @@
 #include <thread>
 
 #include "mysql/harness/logging/logger.h"
+#include "mysql/harness/metrics.h"
 
 using std::string;
 using std::thread;
@@ -47,9 +48,15 @@ const int kDefaultTimeToLive = 10;
 class FabricCache {
 
 public:
-  /** @brief Constructor */
+  /** @brief Constructor
+   *
+   * @param topology_cache_file if not empty, the groups are saved to this
+   *        file after each change and loaded from it at start. If they
+   *        were loaded, the constructor leaves the first refresh to start()
+   */
   FabricCache(string host, int port, string user, string password,
-              int connection_timeout, int connection_attempts);
+              int connection_timeout, int connection_attempts,
+              const string &topology_cache_file = "");
 
   /** Starts the Fabric Cache
    *
@@ -83,6 +90,26 @@ private:
    */
   void refresh();
 
+  /** @brief Loads the groups from the topology cache file
+   *
+   * The groups are marked stale until the first successful refresh.
+   */
+  void load_topology_cache();
+
+  /** @brief Saves the groups to the topology cache file */
+  void save_topology_cache();
+
+  // host:port of the Fabric node
+  const string fabric_address_;
+
+  // File the groups are saved to, empty if not used.
+  const string topology_cache_file_;
+
+  // true while group_data_ holds the groups loaded from topology_cache_file_
+  // and Fabric didn't answer yet. Used by the refresh thread (and the
+  // constructor) only.
+  bool topology_stale_{false};
+
   map<string, list<ManagedServer>> group_data_;
   std::chrono::milliseconds ttl_;
 
@@ -95,6 +122,12 @@ private:
   mysql_harness::MySQLRouterThread refresh_thread_;
 
   std::mutex cache_refreshing_mutex_;
+
+  // Metrics exported to the metrics registry, labeled with the fabric address
+  mysql_harness::metrics::Histogram &metric_refresh_duration_;
+  mysql_harness::metrics::Counter &metric_refresh_failures_;
+  mysql_harness::metrics::Gauge &metric_ttl_;
+  mysql_harness::metrics::Gauge &metric_topology_stale_;
 };
 
 #endif // FABRIC_CACHE_FABRIC_CACHE_INCLUDED
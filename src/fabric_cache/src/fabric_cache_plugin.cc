@@ -135,6 +135,17 @@ static void init(PluginFuncEnv* env) {
   }
 }
 
+/**
+ * Returns the file the groups are saved to: a file named after the section in
+ * the data folder, or empty if it's not used.
+ */
+static string topology_cache_file(const ConfigSection *section, bool use_topology_cache) {
+  if (!use_topology_cache || !g_app_info || !g_app_info->data_folder) return "";
+
+  return mysqlrouter::get_topology_cache_file(g_app_info->data_folder, section->name,
+                                              section->key);
+}
+
 static void start(PluginFuncEnv* env) {
   const ConfigSection* section= get_config_section(env);
   string name_tag = string();
@@ -157,7 +168,8 @@ static void start(PluginFuncEnv* env) {
     if (found != fabric_cache_passwords.end()) {
       password = found->second;
     }
-    fabric_cache::cache_init(section->key, config.address.addr, port, config.user, password);
+    fabric_cache::cache_init(section->key, config.address.addr, port, config.user, password,
+                             topology_cache_file(section, config.use_topology_cache));
 
   } catch (const fabric_cache::base_error &exc) {
     // We continue and retry
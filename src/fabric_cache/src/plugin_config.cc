@@ -34,6 +34,7 @@ string FabricCachePluginConfig::get_default(const string &option) const {
 
   const std::map<string, string> defaults{
       {"address",  fabric_cache::kDefaultFabricAddress},
+      {"use_topology_cache", "1"},
   };
 
   auto it = defaults.find(option);
@@ -42,7 +42,8 @@ public:
   FabricCachePluginConfig(const mysql_harness::ConfigSection *section)
       : mysqlrouter::BasePluginConfig(section),
         address(get_option_tcp_address(section, "address", fabric_cache::kDefaultFabricPort)),
-        user(get_option_string(section, "user")) { }
+        user(get_option_string(section, "user")),
+        use_topology_cache(get_uint_option<uint32_t>(section, "use_topology_cache", 0, 1) == 1) { }
 
   string get_default(const string &option) const override;
   bool is_required(const string &option) const override;
@@ -51,6 +52,8 @@ public:
   const mysql_harness::TCPAddress address;
   /** @brief User used for authenticating with MySQL Fabric */
   const string user;
+  /** @brief save the groups in the data folder and load them at start */
+  const bool use_topology_cache;
 
 private:
   /** @brief Gets a TCP address using the given option
@@ -0,0 +1,155 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "topology_cache_file.h"
+
+#include "common.h"
+#include "mysqlrouter/json_utils.h"
+#include "mysqlrouter/utils.h"
+
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+using mysqlrouter::get_json_member;
+using mysqlrouter::get_json_string;
+
+namespace fabric_cache {
+
+namespace {
+
+int get_int(const rapidjson::Value &object, const char *name) {
+  const auto &value = get_json_member(object, name);
+  if (!value.IsInt())
+    throw std::runtime_error(string("'") + name + "' is not an integer");
+  return value.GetInt();
+}
+
+}  // namespace
+
+void save_topology_cache_file(const string &path, const string &fabric,
+                              const std::map<string, list<ManagedServer>> &groups) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+  writer.StartObject();
+  writer.Key("version");
+  writer.Uint(kTopologyCacheFileVersion);
+  writer.Key("fabric");
+  writer.String(fabric.c_str());
+  writer.Key("groups");
+  writer.StartArray();
+  for (const auto &group : groups) {
+    writer.StartObject();
+    writer.Key("group_id");
+    writer.String(group.first.c_str());
+    writer.Key("servers");
+    writer.StartArray();
+    for (const auto &server : group.second) {
+      writer.StartObject();
+      writer.Key("server_uuid");
+      writer.String(server.server_uuid.c_str());
+      writer.Key("host");
+      writer.String(server.host.c_str());
+      writer.Key("port");
+      writer.Int(server.port);
+      writer.Key("mode");
+      writer.Int(server.mode);
+      writer.Key("status");
+      writer.Int(server.status);
+      writer.Key("weight");
+      writer.Double(server.weight);
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  mysqlrouter::write_file_atomically(path, string(buffer.GetString(), buffer.GetSize()));
+}
+
+std::map<string, list<ManagedServer>> load_topology_cache_file(const string &path,
+                                                                const string &fabric) {
+  std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+  if (file.fail())
+    throw std::runtime_error("Could not open file '" + path + "': " +
+                             mysql_harness::get_strerror(errno));
+  std::stringstream content;
+  content << file.rdbuf();
+
+  rapidjson::Document doc;
+  if (doc.Parse(content.str().c_str()).HasParseError() || !doc.IsObject())
+    throw std::runtime_error("'" + path + "' is not a valid topology cache file");
+
+  std::map<string, list<ManagedServer>> result;
+  try {
+    const auto &version = get_json_member(doc, "version");
+    if (!version.IsUint() || version.GetUint() != kTopologyCacheFileVersion)
+      throw std::runtime_error("unsupported version");
+    const string written_for = get_json_string(doc, "fabric");
+    if (written_for != fabric)
+      throw std::runtime_error("written for Fabric '" + written_for + "'");
+
+    const auto &groups = get_json_member(doc, "groups");
+    if (!groups.IsArray())
+      throw std::runtime_error("'groups' is not an array");
+    for (const auto &group : groups.GetArray()) {
+      const string group_id = get_json_string(group, "group_id");
+      const auto &servers = get_json_member(group, "servers");
+      if (!servers.IsArray())
+        throw std::runtime_error("'servers' is not an array");
+
+      list<ManagedServer> group_servers;
+      for (const auto &s : servers.GetArray()) {
+        ManagedServer server;
+        server.server_uuid = get_json_string(s, "server_uuid");
+        server.group_id = group_id;
+        server.host = get_json_string(s, "host");
+        server.port = get_int(s, "port");
+        server.mode = get_int(s, "mode");
+        server.status = get_int(s, "status");
+        const auto &weight = get_json_member(s, "weight");
+        if (!weight.IsNumber())
+          throw std::runtime_error("'weight' is not a number");
+        server.weight = static_cast<float>(weight.GetDouble());
+        group_servers.push_back(server);
+      }
+      result.emplace(group_id, std::move(group_servers));
+    }
+  } catch (const std::runtime_error &e) {
+    throw std::runtime_error("Invalid topology cache file '" + path + "': " + e.what());
+  }
+
+  return result;
+}
+
+}  // namespace fabric_cache
@@ -0,0 +1,71 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef FABRIC_CACHE_TOPOLOGY_CACHE_FILE_INCLUDED
+#define FABRIC_CACHE_TOPOLOGY_CACHE_FILE_INCLUDED
+
+#include "mysqlrouter/fabric_cache.h"
+
+#include <list>
+#include <map>
+#include <string>
+
+namespace fabric_cache {
+
+/** @brief Version of the topology cache file format
+ *
+ * Files of another version are not loaded.
+ */
+constexpr unsigned int kTopologyCacheFileVersion = 1;
+
+/** @brief Writes the groups fetched from Fabric to a file
+ *
+ * The file is written next to the target and renamed over it, so that a
+ * router crashing halfway leaves the previous file in place.
+ *
+ * Throws std::runtime_error if the file can't be written.
+ *
+ * @param path file to write
+ * @param fabric address of the Fabric node the groups were fetched from
+ * @param groups servers of each group, keyed by group ID
+ */
+void save_topology_cache_file(const string &path, const string &fabric,
+                              const std::map<string, list<ManagedServer>> &groups);
+
+/** @brief Reads the groups written by save_topology_cache_file()
+ *
+ * Throws std::runtime_error if the file can't be read, is not valid, has
+ * another version or was written for another Fabric node.
+ *
+ * @param path file to read
+ * @param fabric address of the Fabric node
+ * @return servers of each group, keyed by group ID
+ */
+std::map<string, list<ManagedServer>> load_topology_cache_file(const string &path,
+                                                                const string &fabric);
+
+}  // namespace fabric_cache
+
+#endif // FABRIC_CACHE_TOPOLOGY_CACHE_FILE_INCLUDED
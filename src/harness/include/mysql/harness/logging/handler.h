@@ -28,8 +28,10 @@
 #include "mysql/harness/logging/logging.h"
 #include "harness_export.h"
 
+#include <cstdint>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <mutex>
 #include <string>
 
@@ -37,6 +39,28 @@ namespace mysql_harness {
 
 namespace logging {
 
+/**
+ * What an asynchronous handler does with a record when its queue is full.
+ */
+enum class OverflowPolicy {
+  /** drop the record and count it, the logging thread never waits */
+  kDrop,
+  /** wait until the writer thread made room */
+  kBlock,
+};
+
+/** Default number of records an asynchronous handler can queue. */
+constexpr size_t kDefaultAsyncQueueSize = 4096;
+
+/**
+ * Options of the asynchronous mode of a StreamHandler.
+ */
+struct AsyncOptions {
+  bool enabled = false;
+  size_t queue_size = kDefaultAsyncQueueSize;
+  OverflowPolicy overflow = OverflowPolicy::kDrop;
+};
+
 /**
  * Base class for log message handler.
  *
@@ -71,6 +95,17 @@ class HARNESS_EXPORT Handler {
  protected:
   std::string format(const Record& record) const;
 
+  /**
+   * Formats a record without allocating.
+   *
+   * @param record Record to format.
+   * @param[out] length length of the formatted record.
+   *
+   * @returns the formatted record, which stays valid until the calling
+   *          thread formats the next record.
+   */
+  const char* format_to_buffer(const Record& record, size_t& length) const;
+
   explicit Handler(bool format_messages, LogLevel level);
 
  private:
@@ -114,6 +149,35 @@ class HARNESS_EXPORT StreamHandler : public Handler {
   explicit StreamHandler(std::ostream& stream,
                          bool format_messages = true,
                          LogLevel level = LogLevel::kNotSet);
+  ~StreamHandler() override;
+
+  /**
+   * Switches to asynchronous mode.
+   *
+   * Records are formatted by the logging thread and put into a lock-free
+   * queue of `queue_size` fixed-size slots (unformatted records longer
+   * than a slot are copied to the heap). A writer thread writes them in
+   * batches and flushes the stream once per batch instead of once per
+   * record.
+   *
+   * Dropped records are counted and reported in the log by the writer
+   * thread.
+   *
+   * @throws std::invalid_argument if queue_size is 0
+   */
+  void enable_async(size_t queue_size, OverflowPolicy overflow);
+
+  /**
+   * Writes all queued records and stops the writer thread.
+   *
+   * Records logged afterwards are written synchronously.
+   */
+  void stop_async();
+
+  /** Number of records dropped because the queue was full. */
+  uint64_t get_dropped_records() const;
+
+  class AsyncWriter;
 
  protected:
   std::ostream& stream_;
@@ -121,6 +185,8 @@ class HARNESS_EXPORT StreamHandler : public Handler {
 
  private:
   void do_log(const Record& record) override;
+
+  std::unique_ptr<AsyncWriter> async_writer_;
 };
 
 /**
@@ -34,6 +34,7 @@
 #include "mysql/harness/filesystem.h"
 #include "harness_export.h"
 
+#include <atomic>
 #include <fstream>
 #include <mutex>
 #include <list>
@@ -83,6 +84,19 @@ const size_t kLogMessageMaxSize = 4096;
  * ^^^^^-------------------- kConfigOptionLogLevel
  */
 constexpr char kConfigOptionLogLevel[] = "level";
+
+/**
+ * Options of the [logger] section switching the main log handler to
+ * asynchronous mode, see StreamHandler::enable_async():
+ *
+ * [logger]
+ * async = 1
+ * async_queue_size = 4096
+ * async_overflow = drop|block
+ */
+constexpr char kConfigOptionAsync[] = "async";
+constexpr char kConfigOptionAsyncQueueSize[] = "async_queue_size";
+constexpr char kConfigOptionAsyncOverflow[] = "async_overflow";
 constexpr char kConfigSectionLogger[] = "logger";
 
 /**
@@ -135,6 +149,22 @@ enum class LogLevel {
   kNotSet  // Always higher than all other log messages
 };
 
+/**
+ * Least important log level any logger of the logging registry handles.
+ *
+ * Maintained by the Registry once it is ready, so that log_debug() and
+ * friends can drop messages nobody logs with a single load, before any
+ * formatting.
+ */
+HARNESS_EXPORT extern std::atomic<LogLevel> g_max_log_level;
+
+/**
+ * Whether any logger handles messages of the level.
+ */
+static inline bool log_level_is_handled(LogLevel level) {
+  return level <= g_max_log_level.load(std::memory_order_relaxed);
+}
+
 /**
  * Default log level used by the router.
  */
@@ -209,6 +239,8 @@ static inline void log_debug(const char *fmt, ...) ATTRIBUTE_GCC_FORMAT(printf,
 
 static inline void log_error(const char* fmt, ...) {
   extern void log_message(LogLevel level, const char* module, const char* fmt, va_list ap);
+  if (!log_level_is_handled(LogLevel::kError)) return;
+
   va_list ap;
   va_start(ap, fmt);
   log_message(LogLevel::kError, MYSQL_ROUTER_LOG_DOMAIN, fmt, ap);
@@ -217,6 +249,8 @@ static inline void log_error(const char* fmt, ...) {
 
 static inline void log_warning(const char* fmt, ...) {
   extern void log_message(LogLevel level, const char* module, const char* fmt, va_list ap);
+  if (!log_level_is_handled(LogLevel::kWarning)) return;
+
   va_list ap;
   va_start(ap, fmt);
   log_message(LogLevel::kWarning, MYSQL_ROUTER_LOG_DOMAIN, fmt, ap);
@@ -225,6 +259,8 @@ static inline void log_warning(const char* fmt, ...) {
 
 static inline void log_info(const char* fmt, ...) {
   extern void log_message(LogLevel level, const char* module, const char* fmt, va_list ap);
+  if (!log_level_is_handled(LogLevel::kInfo)) return;
+
   va_list ap;
   va_start(ap, fmt);
   log_message(LogLevel::kInfo, MYSQL_ROUTER_LOG_DOMAIN, fmt, ap);
@@ -233,6 +269,8 @@ static inline void log_info(const char* fmt, ...) {
 
 static inline void log_debug(const char* fmt, ...) {
   extern void log_message(LogLevel level, const char* module, const char* fmt, va_list ap);
+  if (!log_level_is_handled(LogLevel::kDebug)) return;
+
   va_list ap;
   va_start(ap, fmt);
   log_message(LogLevel::kDebug, MYSQL_ROUTER_LOG_DOMAIN, fmt, ap);
@@ -26,6 +26,7 @@
 #define MYSQL_HARNESS_LOGGER_REGISTRY_INCLUDED
 
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/logging/handler.h"
 #include "mysql/harness/logging/logger.h"
 #include "mysql/harness/filesystem.h"
 #include "mysql/harness/config_parser.h"
@@ -33,8 +34,10 @@
 
 #include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace mysql_harness {
 
@@ -51,11 +54,27 @@ class HARNESS_EXPORT Registry {
  public:
   const static std::map<std::string, LogLevel> kLogLevels;
 
+  /**
+   * A logger as seen by the logging threads: its level and the handlers it
+   * is attached to.
+   *
+   * The registry rebuilds the domains whenever a logger or handler changes;
+   * a published Domain is never modified, so it can be used without holding
+   * any lock.
+   */
+  struct HARNESS_EXPORT Domain {
+    LogLevel level;
+    std::vector<std::shared_ptr<Handler>> handlers;
+
+    /** Passes the record to the handlers whose level accepts it. */
+    void handle(const Record& record) const;
+  };
+
   Registry() = default;
   Registry(const Registry&) = delete;
   Registry& operator=(const Registry&) = delete;
 
-  ~Registry() = default;
+  ~Registry();
 
 //----[ logger CRUD ]-----------------------------------------------------------
 
@@ -92,6 +111,18 @@ class HARNESS_EXPORT Registry {
    */
   Logger get_logger(const std::string& name) const;
 
+  /**
+   * Return the domain of a logger
+   *
+   * Unlike get_logger() this doesn't copy the logger; the domain is shared
+   * with all threads logging to it.
+   *
+   * @param name Logger id (log domain it services)
+   *
+   * @returns the domain, or nullptr if no logger is registered for it
+   */
+  std::shared_ptr<const Domain> get_domain(const std::string& name) const;
+
   /**
    * Update logger for particular module
    *
@@ -155,7 +186,7 @@ class HARNESS_EXPORT Registry {
    * However, a logging function (i.e. log_message()) might want to query
    * this flag when called and do whatever it deems appropriate.
    */
-  void set_ready() noexcept { ready_ = true; }
+  void set_ready() noexcept;
 
   /**
    * Query if logging facility is ready to use
@@ -166,9 +197,22 @@ class HARNESS_EXPORT Registry {
   bool is_ready() const noexcept { return ready_; }
 
  private:
+  /**
+   * Publishes the least important level of the loggers to g_max_log_level
+   * if the registry is ready. mtx_ must be held.
+   */
+  void update_max_log_level() noexcept;
+
+  /**
+   * Rebuilds domains_ after loggers or handlers changed and bumps the
+   * generation of the logging configuration. mtx_ must be held.
+   */
+  void update_domains();
+
   mutable std::mutex mtx_;
   std::map<std::string, Logger> loggers_; // key = log domain
   std::map<std::string, std::shared_ptr<Handler>> handlers_; // key = handler id
+  std::map<std::string, std::shared_ptr<const Domain>> domains_; // key = log domain
   std::atomic<bool> ready_{false};
 
 }; // class Registry
@@ -277,6 +321,7 @@ class HARNESS_EXPORT Registry {
    * @param logging_folder logging_folder provided in configuration file
    * @param format_messages If set to true, log messages will be formatted
    *        (prefixed with log level, timestamp, etc) before logging
+   * @param async_options whether and how the handler writes asynchronously
    *
    * @throws std::runtime_error if opening log file fails
    */
@@ -284,7 +329,8 @@ class HARNESS_EXPORT Registry {
   void create_main_logfile_handler(Registry& registry,
                                    const std::string& program,
                                    const std::string& logging_folder,
-                                   bool format_messages);
+                                   bool format_messages,
+                                   const AsyncOptions& async_options = AsyncOptions());
 
 
 
@@ -0,0 +1,250 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef MYSQL_HARNESS_METRICS_INCLUDED
+#define MYSQL_HARNESS_METRICS_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "harness_export.h"
+#include "mysql/harness/sharded_counter.h"
+
+namespace mysql_harness {
+namespace metrics {
+
+/** @brief label names and values of a metric, in the order they are exported */
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+/** @brief bucket bounds (in seconds) used for latencies by default */
+HARNESS_EXPORT const std::vector<double> &default_latency_buckets();
+
+/**
+ * @brief HDR-style bucket bounds with a constant relative precision.
+ *
+ * Every decade from 10^min_exponent to 10^max_exponent is split into 9
+ * linear steps (1, 2, ..., 9 * 10^e), which keeps the error of any
+ * recorded value below one step of its decade while covering many
+ * orders of magnitude with few buckets.
+ *
+ * @throws std::invalid_argument if min_exponent >= max_exponent
+ */
+HARNESS_EXPORT std::vector<double> log_linear_buckets(int min_exponent,
+                                                      int max_exponent);
+
+/**
+ * @brief log_linear_buckets() from 10us to 100s, used for latencies that
+ * span from local connects to long running sessions.
+ */
+HARNESS_EXPORT const std::vector<double> &hdr_latency_buckets();
+
+/**
+ * @brief Monotonic counter.
+ *
+ * Updates are sharded per thread (see ShardedCounter) and don't take
+ * any lock.
+ */
+class HARNESS_EXPORT Counter {
+ public:
+  void increment() noexcept { value_.increment(); }
+
+  void add(uint64_t n) noexcept {
+    value_.add(static_cast<ShardedCounter<>::value_type>(n));
+  }
+
+  uint64_t value() const noexcept {
+    return static_cast<uint64_t>(value_.load());
+  }
+
+ private:
+  ShardedCounter<> value_;
+};
+
+/**
+ * @brief Value that may go up and down.
+ */
+class HARNESS_EXPORT Gauge {
+ public:
+  void set(int64_t v) noexcept { value_.store(v, std::memory_order_relaxed); }
+
+  void add(int64_t n) noexcept {
+    value_.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  int64_t value() const noexcept {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+/**
+ * @brief Histogram with fixed bucket bounds.
+ *
+ * Each thread records into its own shard of bucket counters; the
+ * shards are only summed up when the histogram is read. All shards live
+ * in one cache aligned buffer, each shard starting on its own cache line
+ * with its sum followed by its buckets.
+ */
+class HARNESS_EXPORT Histogram {
+ public:
+  /**
+   * @param bounds upper bounds of the buckets, strictly increasing. A
+   *               bucket for +Inf is always added.
+   *
+   * @throws std::invalid_argument if bounds are not increasing
+   */
+  explicit Histogram(std::vector<double> bounds);
+
+  Histogram(const Histogram &) = delete;
+  Histogram &operator=(const Histogram &) = delete;
+
+  /** @brief records one observation of `v` */
+  void observe(double v) noexcept;
+
+  struct Snapshot {
+    /** @brief number of observations per bucket, the last one is +Inf */
+    std::vector<uint64_t> buckets;
+    uint64_t count{0};
+    double sum{0};
+  };
+
+  /** @brief sums up all shards */
+  Snapshot snapshot() const;
+
+  const std::vector<double> &bounds() const noexcept { return bounds_; }
+
+ private:
+  static const size_t kNumShards = 16;
+
+  /** @brief bytes of a shard with `num_buckets`, rounded up to cache lines */
+  static size_t shard_stride(size_t num_buckets) noexcept;
+
+  std::atomic<double> &shard_sum(size_t shard) const noexcept;
+  std::atomic<uint64_t> *shard_buckets(size_t shard) const noexcept;
+
+  std::vector<double> bounds_;
+  size_t stride_;
+  CacheAlignedBuffer buffer_;
+};
+
+/**
+ * @brief Process-wide registry of metrics.
+ *
+ * Plugins fetch their metrics once (e.g. when a route starts) and keep
+ * the returned reference; registration takes a mutex, updating a
+ * metric doesn't. Metrics stay registered until the process exits, so
+ * references never dangle. Only callback gauges can be removed as
+ * their callback usually refers to an object with a shorter lifetime.
+ *
+ * A metric is identified by its name and its labels. Asking for the same
+ * name and labels again returns the same metric.
+ */
+class HARNESS_EXPORT MetricsRegistry {
+ public:
+  using GaugeCallback = std::function<double()>;
+
+  static MetricsRegistry &instance();
+
+  /**
+   * @throws std::invalid_argument if the name or a label name is invalid,
+   *         or the name is already registered as another type
+   */
+  Counter &counter(const std::string &name, const std::string &help,
+                   const Labels &labels = {});
+
+  /** @copydoc counter() */
+  Gauge &gauge(const std::string &name, const std::string &help,
+               const Labels &labels = {});
+
+  /** @copydoc counter() */
+  Histogram &histogram(const std::string &name, const std::string &help,
+                       const Labels &labels = {},
+                       const std::vector<double> &bounds =
+                           default_latency_buckets());
+
+  /**
+   * @brief registers a gauge whose value is fetched when exporting.
+   *
+   * An existing callback with the same name and labels is replaced.
+   * The callback is called with the registry locked and must not call
+   * back into the registry.
+   *
+   * @throws std::invalid_argument like counter()
+   */
+  void add_callback_gauge(const std::string &name, const std::string &help,
+                          const Labels &labels, GaugeCallback cb);
+
+  /**
+   * @brief removes a callback gauge.
+   *
+   * Once this returns the callback isn't called anymore.
+   */
+  void remove_callback_gauge(const std::string &name, const Labels &labels);
+
+  /**
+   * @brief exports all metrics in the Prometheus text exposition format
+   * (version 0.0.4).
+   */
+  std::string serialize() const;
+
+  /** @brief content-type of what serialize() returns */
+  static const char *content_type();
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  struct Metric {
+    std::unique_ptr<Counter> counter;
+    std::unique_ptr<Gauge> gauge;
+    std::unique_ptr<Histogram> histogram;
+    GaugeCallback callback;
+  };
+
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<Labels, Metric> metrics;
+  };
+
+  Metric &get_metric(const std::string &name, const std::string &help,
+                     const Labels &labels, Type type);
+
+  mutable std::mutex mtx_;
+  std::map<std::string, Family> families_;
+};
+
+}  // namespace metrics
+}  // namespace mysql_harness
+
+#endif  // MYSQL_HARNESS_METRICS_INCLUDED
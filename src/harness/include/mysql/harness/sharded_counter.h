@@ -0,0 +1,166 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MYSQL_HARNESS_SHARDED_COUNTER_INCLUDED
+#define MYSQL_HARNESS_SHARDED_COUNTER_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace mysql_harness {
+
+/** @brief size of a cache line we pad shards to */
+static const size_t kCacheLineSize = 64;
+
+/**
+ * @brief Heap buffer that starts on a cache line.
+ *
+ * Before C++17 operator new doesn't honour alignments beyond
+ * alignof(std::max_align_t), so the buffer is over-allocated and aligned
+ * by hand.
+ */
+class CacheAlignedBuffer {
+ public:
+  explicit CacheAlignedBuffer(size_t size)
+      : storage_(new char[size + kCacheLineSize]) {
+    void *p = storage_.get();
+    size_t space = size + kCacheLineSize;
+    data_ = std::align(kCacheLineSize, size, p, space);
+  }
+
+  CacheAlignedBuffer(const CacheAlignedBuffer &) = delete;
+  CacheAlignedBuffer &operator=(const CacheAlignedBuffer &) = delete;
+
+  void *data() const noexcept { return data_; }
+
+ private:
+  std::unique_ptr<char[]> storage_;
+  void *data_;
+};
+
+/**
+ * @brief Returns the shard index of the calling thread.
+ *
+ * Every thread gets a stable index the first time it asks for one.
+ * Indexes are handed out round-robin, so N threads spread evenly over
+ * the shards of any counter with at least N shards.
+ */
+inline size_t get_thread_shard_index() {
+  static std::atomic<size_t> next_index{0};
+  static thread_local size_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+/**
+ * @brief Counter that is cheap to update from many threads.
+ *
+ * The value is split into a number of shards, each one on its own
+ * cache line. Updates only touch the shard of the calling thread, so
+ * increments and decrements from different threads don't bounce the
+ * same cache line between CPUs. Reading the value sums all shards.
+ *
+ * An increment and its matching decrement may happen in different
+ * threads and therefore on different shards; single shards may become
+ * negative, the sum is always correct.
+ *
+ * @tparam NumShards number of shards, should be a power of 2
+ */
+template <size_t NumShards = 32>
+class ShardedCounter {
+ public:
+  using value_type = int64_t;
+
+  ShardedCounter()
+      : buffer_(sizeof(Shard) * NumShards),
+        shards_(static_cast<Shard *>(buffer_.data())) {
+    for (size_t i = 0; i < NumShards; ++i) {
+      new (&shards_[i]) Shard();
+      shards_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ShardedCounter(const ShardedCounter &) = delete;
+  ShardedCounter &operator=(const ShardedCounter &) = delete;
+
+  /** @brief adds `n` to the counter */
+  void add(value_type n) noexcept {
+    shards_[get_thread_shard_index() % NumShards].value.fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  void increment() noexcept { add(1); }
+
+  void decrement() noexcept { add(-1); }
+
+  ShardedCounter &operator++() noexcept {
+    increment();
+    return *this;
+  }
+
+  ShardedCounter &operator--() noexcept {
+    decrement();
+    return *this;
+  }
+
+  /**
+   * @brief Returns the current value of the counter.
+   *
+   * The value is the sum of all shards. As shards are read one after
+   * another, concurrent updates may or may not be included.
+   */
+  value_type load() const noexcept {
+    value_type result = 0;
+    for (size_t i = 0; i < NumShards; ++i) {
+      result += shards_[i].value.load(std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  /** @brief resets all shards to 0 */
+  void reset() noexcept {
+    for (size_t i = 0; i < NumShards; ++i) {
+      shards_[i].value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  struct alignas(kCacheLineSize) Shard {
+    std::atomic<value_type> value;
+  };
+  static_assert(sizeof(Shard) == kCacheLineSize,
+                "a shard must fill exactly one cache line");
+
+  // the counter itself may live anywhere, the shards are allocated
+  // aligned to a cache line. Shard is trivially destructible.
+  CacheAlignedBuffer buffer_;
+  Shard *shards_;
+};
+
+}  // namespace mysql_harness
+
+#endif  // MYSQL_HARNESS_SHARDED_COUNTER_INCLUDED
@@ -0,0 +1,174 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef MYSQL_HARNESS_TRACING_INCLUDED
+#define MYSQL_HARNESS_TRACING_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "harness_export.h"
+
+namespace mysql_harness {
+namespace tracing {
+
+using clock_type = std::chrono::steady_clock;
+
+/** @brief A finished span, see Tracer::record() */
+struct TraceEvent {
+  /** @brief name of the span, must be a string literal */
+  const char *name;
+  /** @brief trace the span belongs to */
+  uint64_t trace_id;
+  /** @brief start, microseconds since the tracer was created */
+  uint64_t start_us;
+  uint64_t duration_us;
+  /** @brief id of the recording thread, see Tracer::thread_id() */
+  uint32_t tid;
+};
+
+/**
+ * @brief Collects spans of sampled traces in per-thread ring buffers.
+ *
+ * A thread gets a ring buffer when it records its first span and returns
+ * it when it exits, the next thread reuses it. Memory is bounded by the
+ * number of threads recording at the same time, old spans are
+ * overwritten.
+ *
+ * Recording only locks the buffer of the calling thread, which is only
+ * contended while the trace is written.
+ */
+class HARNESS_EXPORT Tracer {
+ public:
+  /** @brief spans kept per ring buffer */
+  static const size_t kEventsPerBuffer = 1024;
+
+  static Tracer &instance();
+
+  /** @brief Returns a new trace id, never 0 */
+  uint64_t new_trace_id() noexcept {
+    return next_trace_id_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** @brief Adds a span to the ring buffer of the calling thread */
+  void record(const char *name, uint64_t trace_id, clock_type::time_point start,
+              clock_type::time_point end);
+
+  /** @brief Returns the recorded spans, oldest first per thread */
+  std::vector<TraceEvent> get_events() const;
+
+  /**
+   * @brief Writes the recorded spans in the Chrome trace-event format.
+   *
+   * The output can be opened by chrome://tracing and Perfetto.
+   */
+  void write_json(std::ostream &os) const;
+
+  /** @brief Removes all recorded spans */
+  void clear();
+
+  /** @brief id of the calling thread as used in TraceEvent::tid */
+  static uint32_t thread_id() noexcept;
+
+  class Buffer;
+
+ private:
+  Tracer();
+
+  Buffer *acquire_buffer();
+  void release_buffer(Buffer *buffer);
+
+  const clock_type::time_point epoch_;
+  std::atomic<uint64_t> next_trace_id_{1};
+
+  mutable std::mutex buffers_mtx_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+  std::vector<Buffer *> free_buffers_;
+
+  friend struct ThreadBufferSlot;
+};
+
+/** @brief trace the calling thread records for, 0 if none */
+HARNESS_EXPORT uint64_t current_trace_id() noexcept;
+
+/**
+ * @brief Sets the trace the calling thread records for while in scope.
+ *
+ * A trace id of 0 disables recording, which is how unsampled work
+ * avoids any overhead beyond a thread-local read.
+ */
+class HARNESS_EXPORT TraceScope {
+ public:
+  explicit TraceScope(uint64_t trace_id) noexcept;
+  ~TraceScope();
+
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+ private:
+  uint64_t previous_;
+};
+
+/**
+ * @brief Records a span from construction until destruction.
+ *
+ * Only records if the thread is in a TraceScope of a sampled trace.
+ */
+class HARNESS_EXPORT Span {
+ public:
+  /**
+   * @param name name of the span, must be a string literal
+   * @param enabled whether to record the span at all
+   */
+  explicit Span(const char *name, bool enabled = true) noexcept
+      : Span(name, clock_type::time_point(), enabled) {}
+
+  /**
+   * @param name name of the span, must be a string literal
+   * @param start start of the span, now if not set
+   * @param enabled whether to record the span at all
+   */
+  Span(const char *name, clock_type::time_point start, bool enabled = true) noexcept;
+
+  ~Span();
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+ private:
+  const char *name_;
+  uint64_t trace_id_;
+  clock_type::time_point start_;
+};
+
+}  // namespace tracing
+}  // namespace mysql_harness
+
+#endif  // MYSQL_HARNESS_TRACING_INCLUDED
@@ -64,6 +64,7 @@ class HARNESS_EXPORT SocketOperationsBase {
   virtual void freeaddrinfo(addrinfo *ai) = 0;
   virtual int getaddrinfo(const char *node, const char *service, const addrinfo *hints, addrinfo **res) = 0;
   virtual int bind(int fd, const struct sockaddr *addr, socklen_t len) = 0;
+  virtual int connect(int fd, const struct sockaddr *addr, socklen_t len) = 0;
   virtual int socket(int domain, int type, int protocol) = 0;
   virtual int setsockopt(int fd, int level, int optname,
                          const void *optval, socklen_t optlen) = 0;
@@ -143,6 +144,9 @@ class HARNESS_EXPORT SocketOperations : public SocketOperationsBase {
   /** @brief Thin wrapper around socket library bind() */
   int bind(int fd, const struct sockaddr *addr, socklen_t len) override;
 
+  /** @brief Thin wrapper around socket library connect() */
+  int connect(int fd, const struct sockaddr *addr, socklen_t len) override;
+
   /** @brief Thin wrapper around socket library socket() */
   int socket(int domain, int type, int protocol) override;
 
@@ -39,6 +39,7 @@ public:
     UNKNOWN = 0,
     IPV4 = 1,
     IPV6 = 2,
+    UNIX = 3,
     INVALID = 9,
   };
 
@@ -47,6 +48,16 @@ public:
     detect_family();
   }
 
+  /** @brief Creates the address of a Unix socket
+   *
+   * The path is stored as addr, port is 0.
+   *
+   * @param path path of the socket file
+   */
+  static TCPAddress make_unix_socket(const std::string &path) {
+    return TCPAddress(path, Family::UNIX);
+  }
+
   /** @brief Copy constructor */
   TCPAddress(const TCPAddress &other)
       : addr(other.addr), port(other.port), ip_family_(other.ip_family_) { }
@@ -87,9 +98,13 @@ public:
 
   /** @brief Compares two addresses for equality
    *
+   * A Unix socket path never equals a TCP host of the same name. The IP
+   * family is otherwise not compared: it is detected lazily and may still be
+   * Family::UNKNOWN on one side.
    */
   friend bool operator==(const TCPAddress &left, const TCPAddress &right) {
-    return (left.addr == right.addr) && (left.port == right.port);
+    return (left.addr == right.addr) && (left.port == right.port) &&
+           (left.is_unix_socket() == right.is_unix_socket());
   }
 
   /**
@@ -98,7 +113,8 @@ public:
   friend bool operator<(const TCPAddress& left, const TCPAddress& right) {
     if (left.addr < right.addr) return true;
     else if (left.addr > right.addr) return false;
-    return left.port < right.port;
+    if (left.port != right.port) return left.port < right.port;
+    return !left.is_unix_socket() && right.is_unix_socket();
   }
 
   /** @brief Returns whether the TCPAddress is valid
@@ -108,6 +124,11 @@ public:
    */
   bool is_valid() noexcept;
 
+  /** @brief Returns whether the address is a Unix socket */
+  bool is_unix_socket() const noexcept {
+    return ip_family_ == Family::UNIX;
+  }
+
   /** @brief Returns whether the TCPAddress is IPv4
    *
    * Returns true when the address is IPv4; false
@@ -137,6 +158,9 @@ public:
   const uint16_t port;
 
 private:
+  TCPAddress(const std::string &path, Family family)
+      : addr(path), port(0), ip_family_(family) { }
+
   /** @brief Initialize the address family */
   void detect_family() noexcept;
 
@@ -32,18 +32,27 @@
 #include "common.h"
 #include "mysql/harness/config_parser.h"
 #include "mysql/harness/filesystem.h"
+#include "mysql/harness/metrics.h"
 #include "mysql/harness/plugin.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 #ifndef _WIN32
 #  include <sys/types.h>
 #  include <unistd.h>
+#else
+#  define getpid GetCurrentProcessId
 #endif
 
 using mysql_harness::Path;
@@ -76,29 +85,62 @@ Handler::Handler(bool format_messages, LogLevel level) :
 // <date> <time> <plugin> <level> [<thread>] <message>
 
 std::string Handler::format(const Record& record) const {
+  size_t length;
+  const char* line = format_to_buffer(record, length);
+  return std::string(line, length);
+}
+
+// Formatting state of the logging thread: the timestamp only changes once
+// a second and the thread id never, so both are only printed when needed.
+static thread_local time_t tls_time_created = -1;
+static thread_local char tls_time_buf[20];
+static thread_local char tls_thread_id[32];
+static thread_local char tls_line_buf[512];
+
+static const char* format_time(time_t created) {
+  if (created != tls_time_created) {
+    struct tm created_tm;
+#ifdef _WIN32
+    localtime_s(&created_tm, &created);
+#else
+    localtime_r(&created, &created_tm);
+#endif
+    // Format the time (19 characters)
+    strftime(tls_time_buf, sizeof(tls_time_buf), "%Y-%m-%d %H:%M:%S",
+             &created_tm);
+    tls_time_created = created;
+  }
+  return tls_time_buf;
+}
+
+static const char* format_thread_id() {
+  if (tls_thread_id[0] == '\0') {
+    // Get the thread ID in a printable format
+    std::stringstream ss;
+    ss << std::hex << std::this_thread::get_id();
+    snprintf(tls_thread_id, sizeof(tls_thread_id), "%s", ss.str().c_str());
+  }
+  return tls_thread_id;
+}
+
+const char* Handler::format_to_buffer(const Record& record,
+                                      size_t& length) const {
   // Bypass formatting if disabled
-  if (!format_messages_)
-    return record.message;
-
-  // Format the time (19 characters)
-  char time_buf[20];
-  strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S",
-           localtime(&record.created));
-
-  // Get the thread ID in a printable format
-  std::stringstream ss;
-  ss << std::hex << std::this_thread::get_id();
-
-  // We ignore the return value from snprintf, which means that the
-  // output is truncated if the total length exceeds the buffer size.
-  char buffer[512];
-  snprintf(buffer, sizeof(buffer), "%-19s %s %s [%s] %s",
-           time_buf, record.domain.c_str(),
-           level_str[static_cast<int>(record.level)],
-           ss.str().c_str(), record.message.c_str());
-
-  // Note: This copies the buffer into an std::string
-  return buffer;
+  if (!format_messages_) {
+    length = record.message.size();
+    return record.message.c_str();
+  }
+
+  // snprintf truncates the output if the total length exceeds the buffer
+  // size, and returns the length it would have needed.
+  int res = snprintf(tls_line_buf, sizeof(tls_line_buf), "%-19s %s %s [%s] %s",
+                     format_time(record.created), record.domain.c_str(),
+                     level_str[static_cast<int>(record.level)],
+                     format_thread_id(), record.message.c_str());
+  if (res < 0) res = 0;
+  length = std::min(static_cast<size_t>(res), sizeof(tls_line_buf) - 1);
+
+  return tls_line_buf;
 }
 
 void Handler::handle(const Record& record) {
@@ -108,6 +150,228 @@ void Handler::handle(const Record& record) {
 // satisfy ODR
 constexpr const char* StreamHandler::kDefaultName;
 
+////////////////////////////////////////////////////////////////
+// class StreamHandler::AsyncWriter
+
+/**
+ * Bounded multi-producer, single-consumer queue of formatted records and
+ * the thread writing them.
+ *
+ * Producers claim a slot by advancing enqueue_pos_ with a CAS and
+ * publish it through the slot's sequence number (see Dmitry Vyukov's
+ * bounded MPMC queue); they never take a lock unless the writer sleeps
+ * and has to be woken up.
+ */
+class StreamHandler::AsyncWriter {
+ public:
+  /**
+   * size of the inline buffer of a slot. Formatted records are at most as
+   * long, longer unformatted ones are copied to the heap.
+   */
+  static constexpr size_t kMaxLineSize = 512;
+
+  AsyncWriter(StreamHandler& handler, size_t queue_size,
+              OverflowPolicy overflow)
+      : handler_(handler), overflow_(overflow),
+        dropped_metric_(metrics::MetricsRegistry::instance().counter(
+            "mysqlrouter_log_records_dropped_total",
+            "log records dropped because the log queue was full")) {
+    size_t capacity = 1;
+    while (capacity < queue_size) capacity <<= 1;
+
+    slots_.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask_ = capacity - 1;
+
+    writer_thread_ = std::thread(&AsyncWriter::run, this);
+  }
+
+  ~AsyncWriter() { stop(); }
+
+  /**
+   * queues a formatted record.
+   *
+   * @returns false if the writer is stopped and the caller has to write
+   *          the record itself
+   */
+  bool push(const char* line, size_t length) {
+    producers_.fetch_add(1, std::memory_order_seq_cst);
+    if (stopped_.load(std::memory_order_seq_cst)) {
+      producers_.fetch_sub(1, std::memory_order_release);
+      return false;
+    }
+
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[pos & mask_];
+      const uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+      const int64_t diff = static_cast<int64_t>(seq - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        // full
+        if (overflow_ == OverflowPolicy::kDrop) {
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          dropped_metric_.increment();
+          producers_.fetch_sub(1, std::memory_order_release);
+          return true;
+        }
+        wake_writer();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->length = length;
+    if (length <= kMaxLineSize) {
+      std::memcpy(slot->line, line, length);
+    } else {
+      slot->long_line.assign(line, length);
+    }
+    slot->sequence.store(pos + 1, std::memory_order_seq_cst);
+
+    if (writer_waiting_.load(std::memory_order_seq_cst)) wake_writer();
+
+    producers_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  /** writes all queued records and joins the writer thread */
+  void stop() {
+    if (stopped_.exchange(true)) return;
+
+    // records of producers that passed the check in push() must make it
+    // into the final batch
+    while (producers_.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+
+    wake_writer();
+    writer_thread_.join();
+  }
+
+  uint64_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    size_t length{0};
+    char line[kMaxLineSize];
+    /** records longer than line */
+    std::string long_line;
+  };
+
+  bool has_records() const {
+    const Slot& slot = slots_[dequeue_pos_ & mask_];
+    return slot.sequence.load(std::memory_order_seq_cst) == dequeue_pos_ + 1;
+  }
+
+  /** moves all published records into batch */
+  size_t drain(std::string& batch) {
+    size_t count = 0;
+    while (has_records()) {
+      Slot& slot = slots_[dequeue_pos_ & mask_];
+      if (slot.length <= kMaxLineSize) {
+        batch.append(slot.line, slot.length);
+      } else {
+        batch += slot.long_line;
+        std::string().swap(slot.long_line);
+      }
+      batch += '\n';
+      slot.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+      ++dequeue_pos_;
+      ++count;
+    }
+
+    return count;
+  }
+
+  void wake_writer() {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+
+  /** formats the notice about dropped records like any other record */
+  void append_dropped_notice(std::string& batch, uint64_t dropped) {
+    Record record{LogLevel::kWarning, getpid(), time(nullptr), kMainLogger,
+                  std::to_string(dropped) +
+                      " log records dropped: log queue full"};
+    size_t length;
+    const char* line = handler_.format_to_buffer(record, length);
+    batch.append(line, length);
+    batch += '\n';
+  }
+
+  void run() {
+    rename_thread("log_writer");
+
+    std::string batch;
+    uint64_t reported_dropped = 0;
+    for (;;) {
+      // read before draining, so that the last batch of a stopped writer
+      // contains all records
+      const bool stopping = stopped_.load(std::memory_order_seq_cst);
+
+      drain(batch);
+      const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+      if (dropped != reported_dropped) {
+        append_dropped_notice(batch, dropped - reported_dropped);
+        reported_dropped = dropped;
+      }
+
+      if (!batch.empty()) {
+        std::lock_guard<std::mutex> lock(handler_.stream_mutex_);
+        handler_.stream_ << batch;
+        handler_.stream_.flush();
+        batch.clear();
+        // a large batch may take a while to write, look for new records
+        // before sleeping
+        continue;
+      }
+
+      if (stopping) return;
+
+      std::unique_lock<std::mutex> lock(wait_mutex_);
+      writer_waiting_.store(true, std::memory_order_seq_cst);
+      if (!has_records() && !stopped_.load(std::memory_order_seq_cst)) {
+        // the timeout reports dropped records of a queue that stays full
+        wait_cond_.wait_for(lock, std::chrono::milliseconds(100));
+      }
+      writer_waiting_.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  StreamHandler& handler_;
+  const OverflowPolicy overflow_;
+  metrics::Counter& dropped_metric_;
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_{0};
+  std::atomic<uint64_t> enqueue_pos_{0};
+  /** only used by the writer thread */
+  uint64_t dequeue_pos_{0};
+
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> stopped_{false};
+  std::atomic<int> producers_{0};
+
+  std::atomic<bool> writer_waiting_{false};
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cond_;
+
+  std::thread writer_thread_;
+};
+
+constexpr size_t StreamHandler::AsyncWriter::kMaxLineSize;
+
 ////////////////////////////////////////////////////////////////
 // class StreamHandler
 
@@ -116,9 +380,34 @@ StreamHandler::StreamHandler(std::ostream& out,
                              LogLevel level)
     : Handler(format_messages, level), stream_(out) {}
 
+StreamHandler::~StreamHandler() {
+  stop_async();
+}
+
+void StreamHandler::enable_async(size_t queue_size, OverflowPolicy overflow) {
+  if (queue_size == 0)
+    throw std::invalid_argument("queue size of asynchronous logging must be > 0");
+
+  async_writer_.reset(new AsyncWriter(*this, queue_size, overflow));
+}
+
+void StreamHandler::stop_async() {
+  if (async_writer_) async_writer_->stop();
+}
+
+uint64_t StreamHandler::get_dropped_records() const {
+  return async_writer_ ? async_writer_->dropped() : 0;
+}
+
 void StreamHandler::do_log(const Record& record) {
+  size_t length;
+  const char* line = format_to_buffer(record, length);
+  if (async_writer_ && async_writer_->push(line, length))
+    return;
+
   std::lock_guard<std::mutex> lock(stream_mutex_);
-  stream_ << format(record) << std::endl;
+  stream_.write(line, static_cast<std::streamsize>(length));
+  stream_ << std::endl;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -151,7 +440,10 @@ FileHandler::FileHandler(const Path& path,
 // satisfy ODR
 constexpr const char* FileHandler::kDefaultName;
 
-FileHandler::~FileHandler() {}
+FileHandler::~FileHandler() {
+  // the writer thread uses fstream_, which is gone when ~StreamHandler() runs
+  stop_async();
+}
 
 } // namespace logging
 
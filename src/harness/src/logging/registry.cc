@@ -70,6 +70,63 @@ const std::map<std::string, LogLevel> Registry::kLogLevels{
 // set for exaplanation
 std::string g_HACK_default_log_level;
 
+// nothing is filtered until a ready registry says otherwise
+std::atomic<LogLevel> g_max_log_level{LogLevel::kNotSet};
+
+// bumped whenever the domains of any registry change, invalidates the
+// per-thread domain caches of log_message()
+static std::atomic<uint64_t> g_domains_generation{0};
+
+Registry::~Registry() {
+  // messages must not be dropped on behalf of a registry that is gone
+  if (ready_)
+    g_max_log_level.store(LogLevel::kNotSet, std::memory_order_relaxed);
+}
+
+void Registry::set_ready() noexcept {
+  std::lock_guard<std::mutex> lock(mtx_);
+  ready_ = true;
+  update_max_log_level();
+}
+
+void Registry::Domain::handle(const Record& record) const {
+  if (record.level > level)
+    return;
+
+  for (const auto& handler : handlers) {
+    if (record.level <= handler->get_level())
+      handler->handle(record);
+  }
+}
+
+void Registry::update_domains() {
+  std::map<std::string, std::shared_ptr<const Domain>> domains;
+  for (const auto& pair : loggers_) {
+    std::shared_ptr<Domain> domain = std::make_shared<Domain>();
+    domain->level = pair.second.get_level();
+    for (const std::string& handler_id : pair.second.get_handler_names()) {
+      auto it = handlers_.find(handler_id);
+      if (it != handlers_.end())
+        domain->handlers.push_back(it->second);
+    }
+    domains.emplace(pair.first, std::move(domain));
+  }
+
+  domains_.swap(domains);
+  g_domains_generation.fetch_add(1, std::memory_order_release);
+}
+
+void Registry::update_max_log_level() noexcept {
+  if (!ready_)
+    return;
+
+  LogLevel max_level = LogLevel::kFatal;
+  for (const auto& pair : loggers_)
+    max_level = std::max(max_level, pair.second.get_level());
+
+  g_max_log_level.store(max_level, std::memory_order_relaxed);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // logger CRUD
@@ -82,6 +139,9 @@ void Registry::create_logger(const std::string& name, LogLevel level) {
   auto result = loggers_.emplace(name, Logger(*this, level));
   if (result.second == false)
     throw std::logic_error("Duplicate logger '" + name + "'");
+
+  update_max_log_level();
+  update_domains();
 }
 
 // throws std::logic_error
@@ -89,6 +149,9 @@ void Registry::remove_logger(const std::string& name) {
   std::lock_guard<std::mutex> lock(mtx_);
   if (loggers_.erase(name) == 0)
     throw std::logic_error("Removing non-existant logger '" + name + "'");
+
+  update_max_log_level();
+  update_domains();
 }
 
 // throws std::logic_error
@@ -102,6 +165,16 @@ Logger Registry::get_logger(const std::string& name) const {
   return it->second;
 }
 
+std::shared_ptr<const Registry::Domain> Registry::get_domain(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  auto it = domains_.find(name);
+  if (it == domains_.end())
+    return nullptr;
+
+  return it->second;
+}
+
 // throws std::logic_error
 void Registry::update_logger(const std::string& name, const Logger& logger) {
 
@@ -122,6 +195,8 @@ void Registry::update_logger(const std::string& name, const Logger& logger) {
       throw std::logic_error(std::string("Attaching unknown handler '") + s + "'");
 
   it->second = logger;
+  update_max_log_level();
+  update_domains();
 }
 
 std::set<std::string> Registry::get_logger_names() const {
@@ -162,6 +237,7 @@ void Registry::remove_handler(std::string name) {
     pair.second.detach_handler(name, false);
 
   handlers_.erase(it);
+  update_domains();
 }
 
 // throws std::logic_error
@@ -226,21 +302,27 @@ std::ostream *get_default_logger_stream() {
 void create_main_logfile_handler(Registry& registry,
                                  const std::string& program,
                                  const std::string& logging_folder,
-                                 bool format_messages) {
+                                 bool format_messages,
+                                 const AsyncOptions& async_options) {
   // Register the console as the handler if the logging folder is
   // undefined. Otherwise, register a file handler.
   if (logging_folder.empty()) {
-    registry.add_handler(kMainConsoleHandler,
-                         std::make_shared<StreamHandler>(*get_default_logger_stream(),
-                                                         format_messages));
+    auto handler = std::make_shared<StreamHandler>(*get_default_logger_stream(),
+                                                   format_messages);
+    if (async_options.enabled)
+      handler->enable_async(async_options.queue_size, async_options.overflow);
+
+    registry.add_handler(kMainConsoleHandler, handler);
     attach_handler_to_all_loggers(registry, kMainConsoleHandler);
   } else {
     Path log_file = Path::make_path(logging_folder, program, "log");
 
     // throws std::runtime_error on failure to open file
-    registry.add_handler(kMainLogHandler,
-                         std::make_shared<FileHandler>(log_file, format_messages));
+    auto handler = std::make_shared<FileHandler>(log_file, format_messages);
+    if (async_options.enabled)
+      handler->enable_async(async_options.queue_size, async_options.overflow);
 
+    registry.add_handler(kMainLogHandler, handler);
     attach_handler_to_all_loggers(registry, kMainLogHandler);
   }
 }
@@ -356,6 +438,62 @@ extern "C" void LOGGER_API log_message(LogLevel level, const char* module, const
 #endif
   ;
 
+namespace {
+
+using mysql_harness::logging::Registry;
+
+/**
+ * Per-thread cache of the domains a thread logs to.
+ *
+ * An entry is valid as long as the domains of no registry changed since it
+ * was filled, which makes a hit one atomic load, a string compare and a
+ * weak_ptr lock: no mutex, no copy of the Logger.
+ */
+struct DomainCacheEntry {
+  uint64_t generation{0};
+  std::string name;
+  std::weak_ptr<const Registry::Domain> domain;
+};
+
+thread_local DomainCacheEntry tls_domain_cache[8];
+
+// returns nullptr if no logger is registered for the module
+std::shared_ptr<const Registry::Domain> get_cached_domain(const char* module) {
+  const uint64_t generation = mysql_harness::logging::g_domains_generation.load(std::memory_order_acquire);
+
+  // modules are few and their names short, a bad hash only costs a miss
+  size_t hash = 0;
+  for (const char* p = module; *p != '\0'; ++p)
+    hash = hash * 31 + static_cast<unsigned char>(*p);
+  DomainCacheEntry& entry = tls_domain_cache[hash % (sizeof(tls_domain_cache) / sizeof(tls_domain_cache[0]))];
+
+  if (entry.generation == generation && entry.name == module) {
+    std::shared_ptr<const Registry::Domain> domain = entry.domain.lock();
+    if (domain)
+      return domain;
+  }
+
+  mysql_harness::logging::Registry& registry = mysql_harness::DIM::instance().
+                                               get_LoggingRegistry();
+  harness_assert(registry.is_ready());
+
+  std::shared_ptr<const Registry::Domain> domain = registry.get_domain(module);
+  if (domain) {
+    // the generation was read before the lookup: if the domains changed
+    // meanwhile the entry is refreshed on the next call
+    entry.generation = generation;
+    entry.name = module;
+    entry.domain = domain;
+  }
+  return domain;
+}
+
+// depth of log_message() calls of this thread; a handler may log itself
+thread_local int tls_log_depth = 0;
+thread_local Record tls_record;
+
+}  // namespace
+
 extern "C" void log_message(LogLevel level, const char* module, const char* fmt, va_list ap) {
   harness_assert(level <= LogLevel::kDebug);
 
@@ -363,28 +501,16 @@ extern "C" void log_message(LogLevel level, const char* module, const char* fmt,
   time_t now;
   time(&now);
 
-  mysql_harness::logging::Registry& registry = mysql_harness::DIM::instance().
-                                               get_LoggingRegistry();
-  harness_assert(registry.is_ready());
-
-  // Find the logger for the module
-  // NOTE that we copy the logger. Even if some other thread removes this
-  //      logger from registry, our call will still be valid. As for the
-  //      case of handlers getting removed in the meantime, Logger::handle()
-  //      handles this properly.
-  Logger logger;
-  try {
-    logger = registry.get_logger(module);
-  } catch (std::logic_error&) {
+  // Find the logger for the module. The domain stays valid even if another
+  // thread removes the logger or its handlers in the meantime.
+  std::shared_ptr<const Registry::Domain> domain = get_cached_domain(module);
+  if (!domain) {
     // Logger is not registered for this module (log domain), so log as main
     // application domain instead (which should always be available)
     using mysql_harness::logging::g_main_app_log_domain;
     harness_assert(!g_main_app_log_domain.empty());
-    try {
-      logger = registry.get_logger(g_main_app_log_domain);
-    } catch (std::logic_error&) {
-      harness_assert(0);
-    }
+    domain = get_cached_domain(g_main_app_log_domain.c_str());
+    harness_assert(domain);
 
     // Complain that we're logging this elsewhere
     char msg[mysql_harness::logging::kLogMessageMaxSize];
@@ -392,23 +518,42 @@ extern "C" void log_message(LogLevel level, const char* module, const char* fmt,
              "Module '%s' not registered with logger - "
              "logging the following message as '%s' instead",
              module, g_main_app_log_domain.c_str());
-    logger.handle({LogLevel::kError, getpid(), now, g_main_app_log_domain, msg});
+    domain->handle({LogLevel::kError, getpid(), now, g_main_app_log_domain, msg});
 
     // And switch log domain to main application domain for the original
     // log message
     module = g_main_app_log_domain.c_str();
   }
 
+  // Don't bother formatting messages this logger drops anyway
+  if (level > domain->level)
+    return;
+
   // Build the message
   char message[mysql_harness::logging::kLogMessageMaxSize];
-  vsnprintf(message, sizeof(message), fmt, ap);
-
-  // Build the record for the handler.
-  Record record{level, getpid(), now, module, message};
+  const int res = vsnprintf(message, sizeof(message), fmt, ap);
+  const size_t length = res < 0 ? 0 : std::min(static_cast<size_t>(res), sizeof(message) - 1);
+
+  // Build the record for the handler. The thread's record keeps the
+  // capacity of its strings, so building it doesn't allocate once the
+  // thread logged a message of similar length; a handler logging itself
+  // gets a record of its own.
+  struct DepthGuard {
+    DepthGuard() { ++tls_log_depth; }
+    ~DepthGuard() { --tls_log_depth; }
+  } depth_guard;
+
+  Record local_record;
+  Record& record = tls_log_depth == 1 ? tls_record : local_record;
+  record.level = level;
+  record.process_id = getpid();
+  record.created = now;
+  record.domain.assign(module);
+  record.message.assign(message, length);
 
   // Pass the record to the correct logger. The record should be
   // passed to only one logger since otherwise the handler can get
   // multiple calls, resulting in multiple log records.
-  logger.handle(record);
+  domain->handle(record);
 }
 
@@ -0,0 +1,387 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysql/harness/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+namespace mysql_harness {
+namespace metrics {
+
+const std::vector<double> &default_latency_buckets() {
+  static const std::vector<double> buckets{
+      0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+      0.1,    0.25,  0.5,    1,     2.5,  5,     10};
+  return buckets;
+}
+
+std::vector<double> log_linear_buckets(int min_exponent, int max_exponent) {
+  if (min_exponent >= max_exponent) {
+    throw std::invalid_argument("min_exponent must be less than max_exponent");
+  }
+
+  std::vector<double> buckets;
+  buckets.reserve(static_cast<size_t>(max_exponent - min_exponent) * 9 + 1);
+  for (int e = min_exponent; e < max_exponent; ++e) {
+    const double base = std::pow(10.0, e);
+    for (int d = 1; d <= 9; ++d) {
+      buckets.push_back(d * base);
+    }
+  }
+  buckets.push_back(std::pow(10.0, max_exponent));
+
+  return buckets;
+}
+
+const std::vector<double> &hdr_latency_buckets() {
+  static const std::vector<double> buckets = log_linear_buckets(-5, 2);
+  return buckets;
+}
+
+// a shard is its sum followed by its buckets
+static_assert(sizeof(std::atomic<double>) % alignof(std::atomic<uint64_t>) == 0,
+              "buckets must be aligned after the sum");
+
+size_t Histogram::shard_stride(size_t num_buckets) noexcept {
+  const size_t size = sizeof(std::atomic<double>) +
+                      num_buckets * sizeof(std::atomic<uint64_t>);
+  return (size + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_(std::move(bounds)),
+      stride_(shard_stride(bounds_.size() + 1)),
+      buffer_(stride_ * kNumShards) {
+  for (size_t i = 1; i < bounds_.size(); ++i) {
+    if (!(bounds_[i - 1] < bounds_[i])) {
+      throw std::invalid_argument("histogram bounds must be increasing");
+    }
+  }
+
+  const size_t num_buckets = bounds_.size() + 1;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    new (&shard_sum(i)) std::atomic<double>(0);
+    std::atomic<uint64_t> *buckets = shard_buckets(i);
+    for (size_t b = 0; b < num_buckets; ++b) {
+      new (&buckets[b]) std::atomic<uint64_t>(0);
+    }
+  }
+}
+
+std::atomic<double> &Histogram::shard_sum(size_t shard) const noexcept {
+  char *p = static_cast<char *>(buffer_.data()) + shard * stride_;
+  return *reinterpret_cast<std::atomic<double> *>(p);
+}
+
+std::atomic<uint64_t> *Histogram::shard_buckets(size_t shard) const noexcept {
+  char *p = static_cast<char *>(buffer_.data()) + shard * stride_ +
+            sizeof(std::atomic<double>);
+  return reinterpret_cast<std::atomic<uint64_t> *>(p);
+}
+
+void Histogram::observe(double v) noexcept {
+  // first bucket whose upper bound is >= v; the +Inf bucket otherwise
+  const size_t ndx = static_cast<size_t>(
+      std::lower_bound(bounds_.begin(), bounds_.end(), v) - bounds_.begin());
+
+  const size_t shard = get_thread_shard_index() % kNumShards;
+  shard_buckets(shard)[ndx].fetch_add(1, std::memory_order_relaxed);
+
+  // there is no fetch_add() for atomic<double> in C++11. The shard is
+  // (mostly) only written by one thread, the loop rarely retries.
+  std::atomic<double> &sum = shard_sum(shard);
+  double cur = sum.load(std::memory_order_relaxed);
+  while (!sum.compare_exchange_weak(cur, cur + v, std::memory_order_relaxed)) {
+  }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  Snapshot snap;
+  snap.buckets.resize(bounds_.size() + 1);
+
+  for (size_t i = 0; i < kNumShards; ++i) {
+    const std::atomic<uint64_t> *buckets = shard_buckets(i);
+    for (size_t b = 0; b < snap.buckets.size(); ++b) {
+      snap.buckets[b] += buckets[b].load(std::memory_order_relaxed);
+    }
+    snap.sum += shard_sum(i).load(std::memory_order_relaxed);
+  }
+  for (auto n : snap.buckets) snap.count += n;
+
+  return snap;
+}
+
+static bool is_valid_name(const std::string &name, bool allow_colon) {
+  if (name.empty()) return false;
+
+  for (size_t i = 0; i < name.size(); ++i) {
+    const char c = name[i];
+    const bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    c == '_' || (allow_colon && c == ':') ||
+                    (i > 0 && c >= '0' && c <= '9');
+    if (!ok) return false;
+  }
+
+  return true;
+}
+
+static void validate(const std::string &name, const Labels &labels) {
+  if (!is_valid_name(name, true)) {
+    throw std::invalid_argument("invalid metric name: '" + name + "'");
+  }
+  for (const auto &label : labels) {
+    if (!is_valid_name(label.first, false) || label.first == "le") {
+      throw std::invalid_argument("invalid label name '" + label.first +
+                                  "' for metric '" + name + "'");
+    }
+  }
+}
+
+MetricsRegistry &MetricsRegistry::instance() {
+  static MetricsRegistry registry;
+  return registry;
+}
+
+MetricsRegistry::Metric &MetricsRegistry::get_metric(const std::string &name,
+                                                     const std::string &help,
+                                                     const Labels &labels,
+                                                     Type type) {
+  validate(name, labels);
+
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.emplace(name, Family{type, help, {}}).first;
+  } else if (it->second.type != type) {
+    throw std::invalid_argument("metric '" + name +
+                                "' is already registered with another type");
+  }
+
+  return it->second.metrics[labels];
+}
+
+Counter &MetricsRegistry::counter(const std::string &name,
+                                  const std::string &help,
+                                  const Labels &labels) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Metric &metric = get_metric(name, help, labels, Type::kCounter);
+  if (!metric.counter) metric.counter.reset(new Counter);
+
+  return *metric.counter;
+}
+
+Gauge &MetricsRegistry::gauge(const std::string &name,
+                              const std::string &help,
+                              const Labels &labels) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Metric &metric = get_metric(name, help, labels, Type::kGauge);
+  if (metric.callback) {
+    throw std::invalid_argument("metric '" + name +
+                                "' is already registered as callback gauge");
+  }
+  if (!metric.gauge) metric.gauge.reset(new Gauge);
+
+  return *metric.gauge;
+}
+
+Histogram &MetricsRegistry::histogram(const std::string &name,
+                                      const std::string &help,
+                                      const Labels &labels,
+                                      const std::vector<double> &bounds) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Metric &metric = get_metric(name, help, labels, Type::kHistogram);
+  if (!metric.histogram) metric.histogram.reset(new Histogram(bounds));
+
+  return *metric.histogram;
+}
+
+void MetricsRegistry::add_callback_gauge(const std::string &name,
+                                         const std::string &help,
+                                         const Labels &labels,
+                                         GaugeCallback cb) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  Metric &metric = get_metric(name, help, labels, Type::kGauge);
+  if (metric.gauge) {
+    throw std::invalid_argument("metric '" + name +
+                                "' is already registered as gauge");
+  }
+  metric.callback = std::move(cb);
+}
+
+void MetricsRegistry::remove_callback_gauge(const std::string &name,
+                                            const Labels &labels) {
+  std::lock_guard<std::mutex> lk(mtx_);
+  auto it = families_.find(name);
+  if (it == families_.end()) return;
+
+  auto metric_it = it->second.metrics.find(labels);
+  if (metric_it != it->second.metrics.end() && metric_it->second.callback) {
+    it->second.metrics.erase(metric_it);
+  }
+}
+
+const char *MetricsRegistry::content_type() {
+  return "text/plain; version=0.0.4; charset=utf-8";
+}
+
+static void append_escaped(std::string &out, const std::string &s,
+                           bool escape_quote) {
+  for (const char c : s) {
+    switch (c) {
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '"':
+        out += escape_quote ? "\\\"" : "\"";
+        break;
+      default:
+        out += c;
+    }
+  }
+}
+
+static void append_double(std::string &out, double v) {
+  if (std::isinf(v)) {
+    out += v > 0 ? "+Inf" : "-Inf";
+    return;
+  }
+  if (std::isnan(v)) {
+    out += "NaN";
+    return;
+  }
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*g", std::numeric_limits<double>::digits10,
+           v);
+  out += buf;
+}
+
+/**
+ * appends 'name{labels} ' with an optional extra 'le' label.
+ */
+static void append_sample_name(std::string &out, const std::string &name,
+                               const Labels &labels, const char *le = nullptr) {
+  out += name;
+  if (!labels.empty() || le != nullptr) {
+    out += '{';
+    bool first = true;
+    for (const auto &label : labels) {
+      if (!first) out += ',';
+      first = false;
+      out += label.first;
+      out += "=\"";
+      append_escaped(out, label.second, true);
+      out += '"';
+    }
+    if (le != nullptr) {
+      if (!first) out += ',';
+      out += "le=\"";
+      out += le;
+      out += '"';
+    }
+    out += '}';
+  }
+  out += ' ';
+}
+
+std::string MetricsRegistry::serialize() const {
+  std::string out;
+
+  std::lock_guard<std::mutex> lk(mtx_);
+  for (const auto &family_it : families_) {
+    const std::string &name = family_it.first;
+    const Family &family = family_it.second;
+
+    if (family.metrics.empty()) continue;
+
+    out += "# HELP " + name + " ";
+    append_escaped(out, family.help, false);
+    out += "\n# TYPE " + name + " ";
+    switch (family.type) {
+      case Type::kCounter:
+        out += "counter\n";
+        break;
+      case Type::kGauge:
+        out += "gauge\n";
+        break;
+      case Type::kHistogram:
+        out += "histogram\n";
+        break;
+    }
+
+    for (const auto &metric_it : family.metrics) {
+      const Labels &labels = metric_it.first;
+      const Metric &metric = metric_it.second;
+
+      if (metric.counter) {
+        append_sample_name(out, name, labels);
+        out += std::to_string(metric.counter->value());
+        out += '\n';
+      } else if (metric.gauge) {
+        append_sample_name(out, name, labels);
+        out += std::to_string(metric.gauge->value());
+        out += '\n';
+      } else if (metric.callback) {
+        append_sample_name(out, name, labels);
+        append_double(out, metric.callback());
+        out += '\n';
+      } else if (metric.histogram) {
+        const auto snap = metric.histogram->snapshot();
+        const auto &bounds = metric.histogram->bounds();
+
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < snap.buckets.size(); ++b) {
+          cumulative += snap.buckets[b];
+
+          std::string le;
+          append_double(le, b < bounds.size()
+                                ? bounds[b]
+                                : std::numeric_limits<double>::infinity());
+          append_sample_name(out, name + "_bucket", labels, le.c_str());
+          out += std::to_string(cumulative);
+          out += '\n';
+        }
+        append_sample_name(out, name + "_sum", labels);
+        append_double(out, snap.sum);
+        out += '\n';
+        append_sample_name(out, name + "_count", labels);
+        out += std::to_string(snap.count);
+        out += '\n';
+      }
+    }
+  }
+
+  return out;
+}
+
+}  // namespace metrics
+}  // namespace mysql_harness
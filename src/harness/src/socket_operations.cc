@@ -152,6 +152,10 @@ int SocketOperations::bind(int fd, const struct sockaddr *addr, socklen_t len) {
   return ::bind(fd, addr, len);
 }
 
+int SocketOperations::connect(int fd, const struct sockaddr *addr, socklen_t len) {
+  return ::connect(fd, addr, len);
+}
+
 int SocketOperations::socket(int domain, int type, int protocol) {
   return ::socket(domain, type, protocol);
 }
@@ -83,6 +83,8 @@ std::string TCPAddress::str() const {
 
   if (ip_family_ == Family::IPV6) {
     os << "[" << addr << "]";
+  } else if (ip_family_ == Family::UNIX) {
+    os << "unix:" << addr;
   } else {
     os << addr;
   }
@@ -98,6 +100,9 @@ bool TCPAddress::is_valid() noexcept {
   if (ip_family_ == Family::UNKNOWN) {
     detect_family();
   }
+  if (ip_family_ == Family::UNIX) {
+    return !addr.empty();
+  }
   return !(addr.empty() || port == 0 || ip_family_ == Family::INVALID);
 }
 
@@ -0,0 +1,197 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysql/harness/tracing.h"
+
+#include <algorithm>
+
+namespace mysql_harness {
+namespace tracing {
+
+const size_t Tracer::kEventsPerBuffer;
+
+class Tracer::Buffer {
+ public:
+  Buffer() : events_(kEventsPerBuffer) {}
+
+  void add(const TraceEvent &event) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    events_[next_ % events_.size()] = event;
+    ++next_;
+  }
+
+  void copy_to(std::vector<TraceEvent> &out) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    const size_t size = events_.size();
+    const size_t count = std::min<uint64_t>(next_, size);
+    for (uint64_t i = next_ - count; i < next_; ++i) {
+      out.push_back(events_[i % size]);
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    next_ = 0;
+  }
+
+ private:
+  mutable std::mutex mtx_;
+  std::vector<TraceEvent> events_;
+  uint64_t next_{0};
+};
+
+/**
+ * the ring buffer of a thread, returned to the tracer when the thread
+ * exits.
+ */
+struct ThreadBufferSlot {
+  ~ThreadBufferSlot() {
+    if (buffer) Tracer::instance().release_buffer(buffer);
+  }
+
+  Tracer::Buffer *buffer{nullptr};
+};
+
+static thread_local ThreadBufferSlot thread_buffer;
+static thread_local uint64_t thread_trace_id{0};
+static std::atomic<uint32_t> next_thread_id{1};
+
+Tracer::Tracer() : epoch_(clock_type::now()) {}
+
+Tracer &Tracer::instance() {
+  // never destroyed: threads may still return their buffers while static
+  // objects are destroyed
+  static Tracer *tracer = new Tracer();
+  return *tracer;
+}
+
+uint32_t Tracer::thread_id() noexcept {
+  static thread_local uint32_t tid = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return tid;
+}
+
+Tracer::Buffer *Tracer::acquire_buffer() {
+  std::lock_guard<std::mutex> lock(buffers_mtx_);
+  if (!free_buffers_.empty()) {
+    Buffer *buffer = free_buffers_.back();
+    free_buffers_.pop_back();
+    return buffer;
+  }
+
+  buffers_.emplace_back(new Buffer());
+  return buffers_.back().get();
+}
+
+void Tracer::release_buffer(Buffer *buffer) {
+  std::lock_guard<std::mutex> lock(buffers_mtx_);
+  free_buffers_.push_back(buffer);
+}
+
+void Tracer::record(const char *name, uint64_t trace_id, clock_type::time_point start,
+                    clock_type::time_point end) {
+  if (thread_buffer.buffer == nullptr) {
+    thread_buffer.buffer = acquire_buffer();
+  }
+
+  TraceEvent event;
+  event.name = name;
+  event.trace_id = trace_id;
+  event.start_us = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(start - epoch_).count());
+  event.duration_us = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+  event.tid = thread_id();
+
+  thread_buffer.buffer->add(event);
+}
+
+std::vector<TraceEvent> Tracer::get_events() const {
+  std::vector<TraceEvent> events;
+
+  std::lock_guard<std::mutex> lock(buffers_mtx_);
+  for (const auto &buffer: buffers_) {
+    buffer->copy_to(events);
+  }
+
+  return events;
+}
+
+void Tracer::write_json(std::ostream &os) const {
+  const auto events = get_events();
+
+  // names are string literals of the instrumented code, they need no
+  // escaping
+  os << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto &event: events) {
+    if (!first) os << ",";
+    first = false;
+
+    os << "{\"name\":\"" << event.name << "\",\"cat\":\"router\",\"ph\":\"X\""
+       << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+       << ",\"pid\":1,\"tid\":" << event.tid
+       << ",\"args\":{\"trace_id\":" << event.trace_id << "}}";
+  }
+  os << "],\"displayTimeUnit\":\"ms\"}";
+}
+
+void Tracer::clear() {
+  std::lock_guard<std::mutex> lock(buffers_mtx_);
+  for (auto &buffer: buffers_) {
+    buffer->clear();
+  }
+}
+
+uint64_t current_trace_id() noexcept {
+  return thread_trace_id;
+}
+
+TraceScope::TraceScope(uint64_t trace_id) noexcept : previous_(thread_trace_id) {
+  thread_trace_id = trace_id;
+}
+
+TraceScope::~TraceScope() {
+  thread_trace_id = previous_;
+}
+
+Span::Span(const char *name, clock_type::time_point start, bool enabled) noexcept
+    : name_(name), trace_id_(enabled ? thread_trace_id : 0) {
+  if (trace_id_ != 0) {
+    start_ = start == clock_type::time_point() ? clock_type::now() : start;
+  }
+}
+
+Span::~Span() {
+  if (trace_id_ == 0) return;
+
+  try {
+    Tracer::instance().record(name_, trace_id_, start_, clock_type::now());
+  } catch (...) {
+    // tracing must never break the traced code
+  }
+}
+
+}  // namespace tracing
+}  // namespace mysql_harness
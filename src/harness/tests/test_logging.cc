@@ -50,7 +50,11 @@ MYSQL_HARNESS_ENABLE_WARNINGS()
 
 ////////////////////////////////////////
 // Standard include files
+#include <condition_variable>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 #ifndef _WIN32
 #include <unistd.h> // unlink
@@ -58,13 +62,16 @@ MYSQL_HARNESS_ENABLE_WARNINGS()
 
 using mysql_harness::Path;
 using mysql_harness::logging::FileHandler;
+using mysql_harness::logging::g_max_log_level;
 using mysql_harness::logging::LogLevel;
+using mysql_harness::logging::OverflowPolicy;
 using mysql_harness::logging::Logger;
 using mysql_harness::logging::Record;
 using mysql_harness::logging::StreamHandler;
 using mysql_harness::logging::log_debug;
 using mysql_harness::logging::log_error;
 using mysql_harness::logging::log_info;
+using mysql_harness::logging::log_level_is_handled;
 using mysql_harness::logging::log_warning;
 
 
@@ -78,6 +85,7 @@ using testing::Eq;
 using testing::Ge;
 using testing::Gt;
 using testing::HasSubstr;
+using testing::Ne;
 using testing::Not;
 using testing::StartsWith;
 using testing::StrEq;
@@ -540,6 +548,147 @@ TEST_F(LoggingTest, HandlerWithDisabledFormatting) {
   g_registry->remove_handler("TestStreamHandler");
 }
 
+TEST_F(LoggingTest, AsyncStreamHandler) {
+  std::stringstream buffer;
+
+  auto handler = std::make_shared<StreamHandler>(buffer, false);
+  handler->enable_async(16, OverflowPolicy::kBlock);
+  g_registry->add_handler("TestStreamHandler", handler);
+  logger.attach_handler("TestStreamHandler");
+
+  const int kThreads = 4;
+  const int kRecords = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([this, t]() {
+      for (int i = 0; i < kRecords; ++i) {
+        logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module",
+                             std::to_string(t) + ":" + std::to_string(i)});
+      }
+    });
+  }
+  for (auto &thr: threads) thr.join();
+
+  // writes everything that is still queued
+  handler->stop_async();
+
+  const std::string log = buffer.str();
+  EXPECT_THAT(std::count(log.begin(), log.end(), '\n'), Eq(kThreads * kRecords));
+  EXPECT_THAT(log, HasSubstr("3:999\n"));
+  EXPECT_EQ(0u, handler->get_dropped_records());
+
+  // after stopping, records are written synchronously
+  logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", "after stop"});
+  EXPECT_THAT(buffer.str(), HasSubstr("after stop\n"));
+
+  // clean up
+  g_registry->remove_handler("TestStreamHandler");
+}
+
+TEST_F(LoggingTest, AsyncStreamHandlerLongRecord) {
+  std::stringstream buffer;
+
+  auto handler = std::make_shared<StreamHandler>(buffer, false);
+  handler->enable_async(4, OverflowPolicy::kBlock);
+  g_registry->add_handler("TestStreamHandler", handler);
+  logger.attach_handler("TestStreamHandler");
+
+  // longer than a slot of the queue
+  const std::string long_message(2000, 'x');
+  logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", long_message});
+  logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", "short"});
+  handler->stop_async();
+
+  EXPECT_THAT(buffer.str(), StrEq(long_message + "\nshort\n"));
+
+  // clean up
+  g_registry->remove_handler("TestStreamHandler");
+}
+
+/**
+ * streambuf that blocks writes until it is opened.
+ */
+class GatedStreamBuf : public std::stringbuf {
+ public:
+  void open() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    open_ = true;
+    cond_.notify_all();
+  }
+
+ protected:
+  std::streamsize xsputn(const char *s, std::streamsize n) override {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cond_.wait(lock, [this]() { return open_; });
+    lock.unlock();
+
+    return std::stringbuf::xsputn(s, n);
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  bool open_ = false;
+};
+
+TEST_F(LoggingTest, AsyncStreamHandlerDropsWhenFull) {
+  GatedStreamBuf streambuf;
+  std::ostream stream(&streambuf);
+
+  auto handler = std::make_shared<StreamHandler>(stream, true);
+  handler->enable_async(4, OverflowPolicy::kDrop);
+  g_registry->add_handler("TestStreamHandler", handler);
+  logger.attach_handler("TestStreamHandler");
+
+  // the writer blocks on the first batch, the queue fills up
+  for (int i = 0; i < 100; ++i) {
+    logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", "Message"});
+  }
+  EXPECT_THAT(handler->get_dropped_records(), Gt(0u));
+
+  streambuf.open();
+  handler->stop_async();
+
+  // the notice is formatted like any other record
+  const std::string log = streambuf.str();
+  EXPECT_THAT(log, HasSubstr(" main WARNING ["));
+  EXPECT_THAT(log, HasSubstr(" log records dropped: log queue full\n"));
+
+  uint64_t written = 0;
+  for (size_t pos = log.find("] Message\n"); pos != std::string::npos;
+       pos = log.find("] Message\n", pos + 1)) {
+    ++written;
+  }
+  EXPECT_THAT(written + handler->get_dropped_records(), Eq(100u));
+
+  // clean up
+  g_registry->remove_handler("TestStreamHandler");
+}
+
+TEST_F(LoggingTest, TimestampChangesBetweenRecords) {
+  std::stringstream buffer;
+
+  g_registry->add_handler("TestStreamHandler", std::make_shared<StreamHandler>(buffer));
+  logger.attach_handler("TestStreamHandler");
+
+  // the formatted timestamp is cached, it must still follow the records
+  logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", "First"});
+  logger.handle(Record{LogLevel::kInfo, getpid(), 0, "my_module", "Second"});
+  logger.handle(Record{LogLevel::kInfo, getpid(), 86400 * 2, "my_module", "Third"});
+
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(buffer, line))
+    lines.push_back(line);
+  ASSERT_THAT(lines.size(), Eq(3u));
+  EXPECT_THAT(lines[0].substr(0, 19), Eq(lines[1].substr(0, 19)));
+  EXPECT_THAT(lines[0].substr(0, 19), Ne(lines[2].substr(0, 19)));
+  EXPECT_THAT(lines[2], EndsWith("Third"));
+
+  // clean up
+  g_registry->remove_handler("TestStreamHandler");
+}
+
 TEST_F(LoggingTest, Messages) {
   std::stringstream buffer;
 
@@ -736,6 +885,54 @@ TEST(FunctionalTest, Handlers) {
 
 
 
+TEST(FunctionalTest, MaxLogLevel) {
+  ASSERT_NO_THROW(set_log_level_for_all_loggers(*g_registry, LogLevel::kWarning));
+  EXPECT_EQ(g_max_log_level.load(), LogLevel::kWarning);
+  EXPECT_TRUE(log_level_is_handled(LogLevel::kError));
+  EXPECT_TRUE(log_level_is_handled(LogLevel::kWarning));
+  EXPECT_FALSE(log_level_is_handled(LogLevel::kInfo));
+  EXPECT_FALSE(log_level_is_handled(LogLevel::kDebug));
+
+  // the least important level of all loggers counts
+  ASSERT_NO_THROW(g_registry->create_logger("verbose_logger", LogLevel::kDebug));
+  EXPECT_EQ(g_max_log_level.load(), LogLevel::kDebug);
+  EXPECT_TRUE(log_level_is_handled(LogLevel::kDebug));
+
+  ASSERT_NO_THROW(g_registry->remove_logger("verbose_logger"));
+  EXPECT_EQ(g_max_log_level.load(), LogLevel::kWarning);
+
+  // clean up
+  set_log_level_for_all_loggers(*g_registry, LogLevel::kNotSet);
+  EXPECT_EQ(g_max_log_level.load(), LogLevel::kNotSet);
+}
+
+TEST(FunctionalTest, DomainLevels) {
+  ASSERT_NO_THROW(set_log_level_for_all_loggers(*g_registry, LogLevel::kWarning));
+
+  std::stringstream buffer;
+  g_registry->add_handler("domain_levels", std::make_shared<StreamHandler>(buffer));
+  attach_handler_to_all_loggers(*g_registry, "domain_levels");
+
+  // another domain lets debug messages pass g_max_log_level ...
+  ASSERT_NO_THROW(g_registry->create_logger("verbose_logger", LogLevel::kDebug));
+  EXPECT_TRUE(log_level_is_handled(LogLevel::kDebug));
+
+  // ... but the level of our own domain still drops them
+  expect_no_log(log_debug, buffer);
+  expect_log(log_warning, buffer, "WARNING");
+
+  auto domain = g_registry->get_domain("verbose_logger");
+  ASSERT_TRUE(domain != nullptr);
+  EXPECT_EQ(LogLevel::kDebug, domain->level);
+  EXPECT_TRUE(domain->handlers.empty());
+  EXPECT_TRUE(g_registry->get_domain("no_such_logger") == nullptr);
+
+  // clean up
+  ASSERT_NO_THROW(g_registry->remove_logger("verbose_logger"));
+  g_registry->remove_handler("domain_levels");
+  set_log_level_for_all_loggers(*g_registry, LogLevel::kNotSet);
+}
+
 int main(int argc, char *argv[]) {
   g_here = Path(argv[0]).dirname();
   init_test_logger();
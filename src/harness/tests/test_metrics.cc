@@ -0,0 +1,174 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysql/harness/metrics.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using mysql_harness::metrics::Histogram;
+using mysql_harness::metrics::MetricsRegistry;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+TEST(MetricsTest, counter_is_shared_by_name_and_labels) {
+  auto &registry = MetricsRegistry::instance();
+
+  auto &c1 = registry.counter("test_shared_total", "help", {{"a", "1"}});
+  auto &c2 = registry.counter("test_shared_total", "help", {{"a", "1"}});
+  auto &c3 = registry.counter("test_shared_total", "help", {{"a", "2"}});
+
+  EXPECT_EQ(&c1, &c2);
+  EXPECT_NE(&c1, &c3);
+
+  c1.increment();
+  c2.add(2);
+  EXPECT_EQ(3u, c1.value());
+  EXPECT_EQ(0u, c3.value());
+}
+
+TEST(MetricsTest, type_mismatch) {
+  auto &registry = MetricsRegistry::instance();
+
+  registry.counter("test_mismatch", "help");
+  EXPECT_THROW(registry.gauge("test_mismatch", "help"), std::invalid_argument);
+}
+
+TEST(MetricsTest, invalid_names) {
+  auto &registry = MetricsRegistry::instance();
+
+  EXPECT_THROW(registry.counter("", "help"), std::invalid_argument);
+  EXPECT_THROW(registry.counter("1abc", "help"), std::invalid_argument);
+  EXPECT_THROW(registry.counter("a-b", "help"), std::invalid_argument);
+  EXPECT_THROW(registry.counter("test_label", "help", {{"a:b", "1"}}),
+               std::invalid_argument);
+  EXPECT_THROW(registry.histogram("test_label_le", "help", {{"le", "1"}}),
+               std::invalid_argument);
+}
+
+TEST(MetricsTest, histogram_buckets) {
+  Histogram hist({1, 2, 4});
+
+  hist.observe(0.5);
+  hist.observe(1);
+  hist.observe(3);
+  hist.observe(100);
+
+  auto snap = hist.snapshot();
+  ASSERT_EQ(4u, snap.buckets.size());
+  EXPECT_EQ(2u, snap.buckets[0]);
+  EXPECT_EQ(0u, snap.buckets[1]);
+  EXPECT_EQ(1u, snap.buckets[2]);
+  EXPECT_EQ(1u, snap.buckets[3]);
+  EXPECT_EQ(4u, snap.count);
+  EXPECT_DOUBLE_EQ(104.5, snap.sum);
+}
+
+TEST(MetricsTest, histogram_invalid_bounds) {
+  EXPECT_THROW(Histogram({2, 1}), std::invalid_argument);
+  EXPECT_THROW(Histogram({1, 1}), std::invalid_argument);
+}
+
+TEST(MetricsTest, log_linear_buckets) {
+  const auto buckets = mysql_harness::metrics::log_linear_buckets(-1, 1);
+
+  ASSERT_EQ(19u, buckets.size());
+  EXPECT_DOUBLE_EQ(0.1, buckets.front());
+  EXPECT_DOUBLE_EQ(0.9, buckets[8]);
+  EXPECT_DOUBLE_EQ(1, buckets[9]);
+  EXPECT_DOUBLE_EQ(10, buckets.back());
+
+  // usable as histogram bounds
+  Histogram hist(buckets);
+  hist.observe(0.25);
+  EXPECT_EQ(1u, hist.snapshot().buckets[2]);
+
+  EXPECT_THROW(mysql_harness::metrics::log_linear_buckets(1, 1),
+               std::invalid_argument);
+}
+
+TEST(MetricsTest, histogram_concurrent_observe) {
+  const int kThreads = 8;
+  const int kIterations = 10000;
+  Histogram hist({1});
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&hist]() {
+      for (int j = 0; j < kIterations; ++j) hist.observe(0.5);
+    });
+  }
+  for (auto &thr : threads) thr.join();
+
+  auto snap = hist.snapshot();
+  EXPECT_EQ(static_cast<uint64_t>(kThreads * kIterations), snap.count);
+  EXPECT_EQ(static_cast<uint64_t>(kThreads * kIterations), snap.buckets[0]);
+  EXPECT_DOUBLE_EQ(kThreads * kIterations * 0.5, snap.sum);
+}
+
+TEST(MetricsTest, serialize) {
+  auto &registry = MetricsRegistry::instance();
+
+  registry.counter("test_ser_total", "a \"counter\"\nwith newline",
+                   {{"route", "r\"1"}})
+      .add(5);
+  registry.gauge("test_ser_gauge", "a gauge").set(-3);
+  registry.histogram("test_ser_seconds", "a histogram", {{"x", "y"}}, {0.5, 1})
+      .observe(0.75);
+
+  const std::string out = registry.serialize();
+
+  EXPECT_THAT(out, HasSubstr("# HELP test_ser_total a \"counter\"\\nwith "
+                             "newline\n# TYPE test_ser_total counter\n"
+                             "test_ser_total{route=\"r\\\"1\"} 5\n"));
+  EXPECT_THAT(out, HasSubstr("# TYPE test_ser_gauge gauge\n"
+                             "test_ser_gauge -3\n"));
+  EXPECT_THAT(out, HasSubstr("# TYPE test_ser_seconds histogram\n"
+                             "test_ser_seconds_bucket{x=\"y\",le=\"0.5\"} 0\n"
+                             "test_ser_seconds_bucket{x=\"y\",le=\"1\"} 1\n"
+                             "test_ser_seconds_bucket{x=\"y\",le=\"+Inf\"} 1\n"
+                             "test_ser_seconds_sum{x=\"y\"} 0.75\n"
+                             "test_ser_seconds_count{x=\"y\"} 1\n"));
+}
+
+TEST(MetricsTest, callback_gauge) {
+  auto &registry = MetricsRegistry::instance();
+
+  int calls = 0;
+  registry.add_callback_gauge("test_cb_gauge", "cb", {{"route", "r1"}},
+                              [&calls]() { return ++calls * 1.5; });
+
+  EXPECT_THAT(registry.serialize(),
+              HasSubstr("test_cb_gauge{route=\"r1\"} 1.5\n"));
+  EXPECT_EQ(1, calls);
+
+  registry.remove_callback_gauge("test_cb_gauge", {{"route", "r1"}});
+  EXPECT_THAT(registry.serialize(), Not(HasSubstr("test_cb_gauge{")));
+  EXPECT_EQ(1, calls);
+}
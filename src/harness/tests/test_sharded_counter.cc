@@ -0,0 +1,89 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "mysql/harness/sharded_counter.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using mysql_harness::ShardedCounter;
+
+TEST(ShardedCounterTest, starts_at_zero) {
+  ShardedCounter<> counter;
+  EXPECT_EQ(0, counter.load());
+}
+
+TEST(ShardedCounterTest, increment_decrement) {
+  ShardedCounter<> counter;
+  ++counter;
+  ++counter;
+  counter.add(10);
+  EXPECT_EQ(12, counter.load());
+
+  --counter;
+  counter.decrement();
+  EXPECT_EQ(10, counter.load());
+
+  counter.reset();
+  EXPECT_EQ(0, counter.load());
+}
+
+TEST(ShardedCounterTest, concurrent_updates) {
+  const int kThreads = 16;
+  const int kIterations = 10000;
+  ShardedCounter<4> counter;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&counter]() {
+      for (int j = 0; j < kIterations; ++j) {
+        counter.increment();
+      }
+    });
+  }
+  for (auto &thr : threads) thr.join();
+
+  EXPECT_EQ(kThreads * kIterations, counter.load());
+}
+
+TEST(ShardedCounterTest, decrement_in_other_thread) {
+  ShardedCounter<> counter;
+
+  // increment and decrement of the same "connection" land on different
+  // shards, the total has to stay consistent anyway
+  std::thread([&counter]() { counter.increment(); }).join();
+  EXPECT_EQ(1, counter.load());
+  std::thread([&counter]() { counter.decrement(); }).join();
+  EXPECT_EQ(0, counter.load());
+}
+
+TEST(CacheAlignedBufferTest, starts_on_cache_line) {
+  for (size_t size : {1u, 8u, 64u, 100u, 4096u}) {
+    mysql_harness::CacheAlignedBuffer buffer(size);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) %
+                      mysql_harness::kCacheLineSize);
+  }
+}
@@ -0,0 +1,117 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysql/harness/tracing.h"
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using mysql_harness::tracing::Span;
+using mysql_harness::tracing::TraceEvent;
+using mysql_harness::tracing::TraceScope;
+using mysql_harness::tracing::Tracer;
+using ::testing::HasSubstr;
+
+class TracingTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Tracer::instance().clear(); }
+};
+
+TEST_F(TracingTest, spans_outside_of_trace_are_not_recorded) {
+  { Span span("unsampled"); }
+
+  EXPECT_TRUE(Tracer::instance().get_events().empty());
+  EXPECT_EQ(0u, mysql_harness::tracing::current_trace_id());
+}
+
+TEST_F(TracingTest, spans_of_trace_are_recorded) {
+  auto &tracer = Tracer::instance();
+  const uint64_t trace_id = tracer.new_trace_id();
+  {
+    TraceScope scope(trace_id);
+    EXPECT_EQ(trace_id, mysql_harness::tracing::current_trace_id());
+
+    Span outer("outer");
+    { Span inner("inner"); }
+    { Span disabled("disabled", false); }
+  }
+  EXPECT_EQ(0u, mysql_harness::tracing::current_trace_id());
+
+  const auto events = tracer.get_events();
+  ASSERT_EQ(2u, events.size());
+  EXPECT_STREQ("inner", events[0].name);
+  EXPECT_STREQ("outer", events[1].name);
+  EXPECT_EQ(trace_id, events[0].trace_id);
+  EXPECT_EQ(Tracer::thread_id(), events[0].tid);
+  EXPECT_LE(events[1].start_us, events[0].start_us);
+  EXPECT_GE(events[1].duration_us, events[0].duration_us);
+}
+
+TEST_F(TracingTest, ring_buffer_keeps_latest_spans) {
+  TraceScope scope(Tracer::instance().new_trace_id());
+  for (size_t i = 0; i < Tracer::kEventsPerBuffer + 10; ++i) {
+    Span span(i < 10 ? "old" : "new");
+  }
+
+  const auto events = Tracer::instance().get_events();
+  ASSERT_EQ(Tracer::kEventsPerBuffer, events.size());
+  for (const auto &event: events) {
+    EXPECT_STREQ("new", event.name);
+  }
+}
+
+TEST_F(TracingTest, buffers_of_exited_threads_are_kept) {
+  const uint64_t trace_id = Tracer::instance().new_trace_id();
+  uint32_t tid = 0;
+
+  std::thread thr([trace_id, &tid]() {
+    TraceScope scope(trace_id);
+    Span span("thread");
+    tid = Tracer::thread_id();
+  });
+  thr.join();
+
+  const auto events = Tracer::instance().get_events();
+  ASSERT_EQ(1u, events.size());
+  EXPECT_EQ(tid, events[0].tid);
+  EXPECT_NE(Tracer::thread_id(), tid);
+}
+
+TEST_F(TracingTest, write_json) {
+  {
+    TraceScope scope(Tracer::instance().new_trace_id());
+    Span span("connect");
+  }
+
+  std::ostringstream os;
+  Tracer::instance().write_json(os);
+
+  EXPECT_THAT(os.str(), HasSubstr("{\"traceEvents\":[{\"name\":\"connect\",\"cat\":\"router\",\"ph\":\"X\""));
+  EXPECT_THAT(os.str(), HasSubstr("],\"displayTimeUnit\":\"ms\"}"));
+}
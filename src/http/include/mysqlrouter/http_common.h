@@ -207,6 +207,11 @@ public:
    * get path part of the URI.
    */
   std::string get_path() const;
+
+  /**
+   * get query part of the URI, empty if there is none.
+   */
+  std::string get_query() const;
 private:
   struct impl;
 
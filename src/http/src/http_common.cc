@@ -64,6 +64,12 @@ std::string HttpUri::get_path() const {
   return evhttp_uri_get_path(pImpl_->uri.get());
 }
 
+std::string HttpUri::get_query() const {
+  const char *q = evhttp_uri_get_query(pImpl_->uri.get());
+
+  return q ? q : "";
+}
+
 
 // wrap evbuffer
 
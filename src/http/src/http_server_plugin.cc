@@ -41,6 +41,7 @@
 // Harness interface include files
 #include "mysql/harness/config_parser.h"
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/metrics.h"
 #include "mysql/harness/plugin.h"
 
 #include "mysqlrouter/plugin_config.h"
@@ -103,6 +104,27 @@ void HttpRequestRouter::clear_default_route() {
 
 
 void HttpRequestRouter::route(HttpRequest req) {
+  using mysql_harness::metrics::MetricsRegistry;
+
+  static auto &requests_total = MetricsRegistry::instance().counter(
+      "mysqlrouter_http_requests_total", "HTTP requests received");
+  static auto &request_duration = MetricsRegistry::instance().histogram(
+      "mysqlrouter_http_request_duration_seconds",
+      "time spent handling HTTP requests");
+
+  requests_total.increment();
+
+  const auto started = std::chrono::steady_clock::now();
+  struct DurationGuard {
+    ~DurationGuard() {
+      hist.observe(std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - started)
+                       .count());
+    }
+    mysql_harness::metrics::Histogram &hist;
+    std::chrono::steady_clock::time_point started;
+  } duration_guard{request_duration, started};
+
   std::lock_guard<std::mutex> lock(route_mtx_);
 
   auto uri = req.get_uri();
@@ -289,6 +311,11 @@ static void init(PluginFuncEnv* env) {
       auto srv = http_servers.at(section->name);
       HttpServerComponent::getInstance().init(srv);
 
+      srv->add_route("^/metrics$",
+          std::unique_ptr<HttpMetricsHandler>(new HttpMetricsHandler()));
+      srv->add_route("^/trace$",
+          std::unique_ptr<HttpTraceHandler>(new HttpTraceHandler()));
+
       if (!config.static_basedir.empty()) {
         srv->add_route("",
             std::unique_ptr<HttpStaticFolderHandler>(
@@ -143,4 +143,20 @@ private:
   std::string static_basedir_;
 };
 
+/**
+ * exports the metrics registry in Prometheus text format
+ */
+class HttpMetricsHandler: public BaseRequestHandler {
+public:
+  void handle_request(HttpRequest &req) override;
+};
+
+/**
+ * exports the sampled traces in Chrome trace-event format
+ */
+class HttpTraceHandler: public BaseRequestHandler {
+public:
+  void handle_request(HttpRequest &req) override;
+};
+
 #endif
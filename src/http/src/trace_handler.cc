@@ -0,0 +1,53 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <sstream>
+#include <string>
+
+#include "mysql/harness/tracing.h"
+#include "mysqlrouter/http_server_component.h"
+#include "http_server_plugin.h"
+
+void HttpTraceHandler::handle_request(HttpRequest &req) {
+  using mysql_harness::tracing::Tracer;
+
+  if (!(HttpMethod::Get & req.get_method())) {
+    req.get_output_headers().add("Allow", "GET");
+    req.send_reply(HttpStatusCode::MethodNotAllowed);
+    return;
+  }
+
+  std::ostringstream os;
+  Tracer::instance().write_json(os);
+  const std::string body = os.str();
+
+  req.get_output_headers().add("Content-Type", "application/json");
+
+  auto chunk = req.get_output_buffer();
+  chunk.add(body.data(), body.size());
+  req.send_reply(HttpStatusCode::Ok,
+                 HttpStatusCode::get_default_status_text(HttpStatusCode::Ok),
+                 chunk);
+}
@@ -31,6 +31,7 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <memory>
 #include <string>
 
 #include "mysqlrouter/utils.h"
@@ -59,6 +60,7 @@ extern const std::string kDefaultMetadataAddress;
 extern const std::string kDefaultMetadataUser;
 extern const std::string kDefaultMetadataPassword;
 extern const std::chrono::milliseconds kDefaultMetadataTTL;
+extern const std::chrono::milliseconds kDefaultEmergencyRefreshInterval;
 extern const std::string kDefaultMetadataCluster;
 extern const unsigned int kDefaultConnectTimeout;
 extern const unsigned int kDefaultReadTimeout;
@@ -170,11 +172,69 @@ public:
   const std::vector<metadata_cache::ManagedInstance> instance_vector;
 };
 
+/** @class ReplicasetSnapshot
+ *
+ * Immutable view of a replicaset as seen by one metadata refresh.
+ *
+ * Snapshots are built by the refresh thread and published by swapping a
+ * shared pointer; readers never see a snapshot being modified. Besides the
+ * full member list, the HA members are pre-filtered by mode so that routing
+ * does not have to walk the member list on every new connection.
+ */
+class METADATA_API ReplicasetSnapshot {
+public:
+  /** @brief Constructor, pre-filters the members by mode */
+  explicit ReplicasetSnapshot(std::vector<ManagedInstance> members_);
+
+  /** @brief List of all members, in metadata order */
+  const std::vector<ManagedInstance> members;
+  /** @brief HA members in ReadWrite mode, in metadata order */
+  const std::vector<ManagedInstance> primaries;
+  /** @brief HA members in ReadOnly mode, in metadata order */
+  const std::vector<ManagedInstance> secondaries;
+  /** @brief HA members in ReadWrite or ReadOnly mode, in metadata order */
+  const std::vector<ManagedInstance> available;
+};
+
+/** @class ReplicasetChanges
+ * @brief Difference between two states of a replicaset
+ *
+ * Members are matched by their mysql_server_uuid.
+ */
+class METADATA_API ReplicasetChanges {
+public:
+  /** @brief A member present in both states, with different attributes */
+  struct Changed {
+    ManagedInstance before;
+    ManagedInstance after;
+  };
+
+  /** @brief Members that were not in the replicaset before */
+  std::vector<ManagedInstance> added;
+  /** @brief Members that are not in the replicaset anymore */
+  std::vector<ManagedInstance> removed;
+  /** @brief Members whose mode, role, address etc. changed */
+  std::vector<Changed> changed;
+
+  /** @brief true if both states have the same members */
+  bool empty() const {
+    return added.empty() && removed.empty() && changed.empty();
+  }
+
+  /** @brief Computes the changes between two member lists
+   *
+   * @param before members of the old state
+   * @param after members of the new state
+   */
+  static ReplicasetChanges diff(const std::vector<ManagedInstance> &before,
+                                const std::vector<ManagedInstance> &after);
+};
+
 /**
  * @brief Abstract class that provides interface for listener on
  *        replicaset status changes.
  *
- *        When state of replicaset is changed, notify function is called.
+ *        When state of replicaset is changed, notify_changes function is called.
  */
 class METADATA_API ReplicasetStateListenerInterface {
 public:
@@ -186,6 +246,23 @@ public:
    * @param md_servers_reachable true if metadata changed, false if metadata unavailable
    */
   virtual void notify(const LookupResult& instances, const bool md_servers_reachable) noexcept = 0;
+
+  /**
+   * @brief Callback function that is called when state of replicaset is changed.
+   *
+   * Called instead of notify() by the metadata cache, only for replicasets
+   * whose members changed (or when the metadata became unavailable). The
+   * default implementation passes the new member list to notify().
+   *
+   * @param before snapshot of the replicaset before the change
+   * @param after snapshot of the replicaset after the change
+   * @param changes members that were added, removed or changed
+   * @param md_servers_reachable true if metadata changed, false if metadata unavailable
+   */
+  virtual void notify_changes(const ReplicasetSnapshot &before,
+                              const ReplicasetSnapshot &after,
+                              const ReplicasetChanges &changes,
+                              const bool md_servers_reachable) noexcept;
   virtual ~ReplicasetStateListenerInterface();
 };
 
@@ -193,7 +270,7 @@ public:
  * @brief Abstract class that provides interface for adding and removing
  *        observers on replicaset status changes.
  *
- *        When state of replicaset is changed, then ReplicasetStateListenerInterface::notify
+ *        When state of replicaset is changed, then ReplicasetStateListenerInterface::notify_changes
  *        function is called for every registered observer.
  */
 class METADATA_API ReplicasetStateNotifierInterface {
@@ -252,13 +329,30 @@ METADATA_API class MetadataCacheAPIBase : public ReplicasetStateNotifierInterfac
    * @param read_timeout The time in seconds after which read from metadata
    *                     server should time out.
    * @param thread_stack_size memory in kilobytes allocated for thread's stack
+   * @param use_gr_notifications if true, listen for group replication
+   *                             notifications (X protocol) of the cluster
+   *                             members and refresh as soon as one arrives
+   * @param emergency_refresh_interval time between the first refreshes in
+   *                                   emergency mode, doubled after each one
+   * @param topology_cache_file file the topology is saved to and loaded from
+   *                            at start, empty to not save it
+   * @param gr_status_interval time between the checks of the group
+   *                           replication status of the known members done
+   *                           between two metadata refreshes (every ttl);
+   *                           0 to not check
    */
   virtual void cache_init(const std::vector<mysql_harness::TCPAddress> &bootstrap_servers,
                           const std::string &user, const std::string &password,
                           std::chrono::milliseconds ttl, const mysqlrouter::SSLOptions &ssl_options,
                           const std::string &cluster_name,
                           int connect_timeout, int read_timeout,
-                          size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes) = 0;
+                          size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes,
+                          bool use_gr_notifications = false,
+                          std::chrono::milliseconds emergency_refresh_interval =
+                              kDefaultEmergencyRefreshInterval,
+                          const std::string &topology_cache_file = "",
+                          std::chrono::milliseconds gr_status_interval =
+                              std::chrono::milliseconds(0)) = 0;
 
   /**
    * @brief Teardown the metadata cache
@@ -274,12 +368,36 @@ METADATA_API class MetadataCacheAPIBase : public ReplicasetStateNotifierInterfac
    */
   virtual LookupResult lookup_replicaset(const std::string &replicaset_name) = 0;
 
+  /** @brief Returns the current snapshot of a HA replicaset
+   *
+   * Unlike lookup_replicaset() the returned snapshot is shared with the
+   * metadata cache and other readers: as long as the topology does not
+   * change, repeated calls return the same object and do not copy the
+   * member list. A changed topology is published as a new snapshot, so
+   * callers may cache data derived from a snapshot and compare pointers to
+   * detect changes.
+   *
+   * The default implementation builds a new snapshot from
+   * lookup_replicaset() on each call.
+   *
+   * @param replicaset_name ID of the HA replicaset
+   * @return snapshot of the replicaset (empty if the replicaset is unknown)
+   */
+  virtual std::shared_ptr<const ReplicasetSnapshot> lookup_replicaset_snapshot(
+      const std::string &replicaset_name);
+
+  /** @brief Refresh the cache right away
+   *
+   * Wakes up the refresh thread instead of waiting for the TTL to expire.
+   * Returns without waiting for the refresh to finish.
+   */
+  virtual void request_refresh() = 0;
 
   /** @brief Update the status of the instance
    *
    * Called when an instance from a replicaset cannot be reached for one reason
    * or another. When an instance becomes unreachable, an emergency mode is set
-   * (the rate of refresh of the metadata cache increases to once per second)
+   * (the cache refreshes right away and then with a short, growing interval)
    * and lasts until disabled after a suitable change in the metadata cache is
    * discovered.
    *
@@ -329,12 +447,21 @@ METADATA_API class MetadataCacheAPI: public MetadataCacheAPIBase {
                   const std::string &user, const std::string &password,
                   std::chrono::milliseconds ttl, const mysqlrouter::SSLOptions &ssl_options,
                   const std::string &cluster_name,
-                  int connect_timeout, int read_timeout, size_t thread_stack_size) override;
+                  int connect_timeout, int read_timeout, size_t thread_stack_size,
+                  bool use_gr_notifications,
+                  std::chrono::milliseconds emergency_refresh_interval,
+                  const std::string &topology_cache_file,
+                  std::chrono::milliseconds gr_status_interval) override;
 
   void cache_stop() noexcept override;
 
   LookupResult lookup_replicaset(const std::string &replicaset_name) override;
 
+  std::shared_ptr<const ReplicasetSnapshot> lookup_replicaset_snapshot(
+      const std::string &replicaset_name) override;
+
+  void request_refresh() override;
+
   void mark_instance_reachability(const std::string &instance_id,
                                   InstanceStatus status)  override;
 
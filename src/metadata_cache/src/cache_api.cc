@@ -27,6 +27,7 @@
 #include "metadata_factory.h"
 
 #include "cluster_metadata.h"
+#include "gr_notifications_listener.h"
 
 #include <map>
 #include <memory>
@@ -34,12 +35,15 @@
 // routing's destination_* and the metadata-cache plugin itself
 // may work on the cache in parallel.
 static std::mutex g_metadata_cache_m;
-static std::unique_ptr<MetadataCache> g_metadata_cache(nullptr);
+// Replaced with std::atomic_store() under g_metadata_cache_m, so that
+// lookup_replicaset_snapshot() can std::atomic_load() it without the mutex.
+static std::shared_ptr<MetadataCache> g_metadata_cache(nullptr);
 
 namespace metadata_cache {
 
 const uint16_t kDefaultMetadataPort = 32275;
 const std::chrono::milliseconds kDefaultMetadataTTL = std::chrono::milliseconds(500);
+const std::chrono::milliseconds kDefaultEmergencyRefreshInterval = std::chrono::milliseconds(100);
 const std::string kDefaultMetadataAddress{"127.0.0.1:" + mysqlrouter::to_string(
     kDefaultMetadataPort)};
 const std::string kDefaultMetadataUser = "";
@@ -48,6 +52,66 @@ const std::string kDefaultMetadataCluster = ""; // blank cluster name means pick
 const unsigned int kDefaultConnectTimeout = 30;
 const unsigned int kDefaultReadTimeout = 30;
 
+static std::vector<ManagedInstance> filter_ha_members(
+    const std::vector<ManagedInstance> &members, bool read_write, bool read_only) {
+  std::vector<ManagedInstance> result;
+  for (const auto &member: members) {
+    if (member.role != "HA") continue;
+    if ((read_write && member.mode == ServerMode::ReadWrite) ||
+        (read_only && member.mode == ServerMode::ReadOnly)) {
+      result.push_back(member);
+    }
+  }
+  return result;
+}
+
+ReplicasetSnapshot::ReplicasetSnapshot(std::vector<ManagedInstance> members_) :
+  members(std::move(members_)),
+  primaries(filter_ha_members(members, true, false)),
+  secondaries(filter_ha_members(members, false, true)),
+  available(filter_ha_members(members, true, true)) { }
+
+std::shared_ptr<const ReplicasetSnapshot> MetadataCacheAPIBase::lookup_replicaset_snapshot(
+    const std::string &replicaset_name) {
+  return std::make_shared<const ReplicasetSnapshot>(
+      lookup_replicaset(replicaset_name).instance_vector);
+}
+
+ReplicasetChanges ReplicasetChanges::diff(const std::vector<ManagedInstance> &before,
+                                          const std::vector<ManagedInstance> &after) {
+  ReplicasetChanges result;
+
+  std::map<std::string, const ManagedInstance*> before_by_uuid;
+  for (const auto &member : before)
+    before_by_uuid.emplace(member.mysql_server_uuid, &member);
+
+  for (const auto &member : after) {
+    auto it = before_by_uuid.find(member.mysql_server_uuid);
+    if (it == before_by_uuid.end()) {
+      result.added.push_back(member);
+      continue;
+    }
+    if (!(*it->second == member))
+      result.changed.push_back(Changed{*it->second, member});
+    before_by_uuid.erase(it);
+  }
+
+  // keep the metadata order of the removed members
+  for (const auto &member : before) {
+    if (before_by_uuid.count(member.mysql_server_uuid))
+      result.removed.push_back(member);
+  }
+
+  return result;
+}
+
+void ReplicasetStateListenerInterface::notify_changes(const ReplicasetSnapshot &,
+                                                      const ReplicasetSnapshot &after,
+                                                      const ReplicasetChanges &,
+                                                      const bool md_servers_reachable) noexcept {
+  notify(after.members, md_servers_reachable);
+}
+
 ReplicasetStateListenerInterface::~ReplicasetStateListenerInterface() = default;
 ReplicasetStateNotifierInterface::~ReplicasetStateNotifierInterface() = default;
 
@@ -78,6 +142,14 @@ MetadataCacheAPIBase* MetadataCacheAPI::instance() {
  * @param read_timeout The time in seconds after which read from metadata
  *                     server should timeout.
  * @param thread_stack_size memory in kilobytes allocated for thread's stack
+ * @param use_gr_notifications if true, listen for group replication
+ *                             notifications of the cluster members
+ * @param emergency_refresh_interval time between the first refreshes in
+ *                                   emergency mode
+ * @param topology_cache_file file the topology is saved to and loaded from
+ *                            at start, empty to not save it
+ * @param gr_status_interval time between the group replication status checks
+ *                           done between two metadata refreshes, 0 to not check
  */
 void MetadataCacheAPI::cache_init(const std::vector<mysql_harness::TCPAddress> &bootstrap_servers,
                   const std::string &user,
@@ -87,12 +159,24 @@ void MetadataCacheAPI::cache_init(const std::vector<mysql_harness::TCPAddress> &
                   const std::string &cluster_name,
                   int connect_timeout,
                   int read_timeout,
-                  size_t thread_stack_size) {
+                  size_t thread_stack_size,
+                  bool use_gr_notifications,
+                  std::chrono::milliseconds emergency_refresh_interval,
+                  const std::string &topology_cache_file,
+                  std::chrono::milliseconds gr_status_interval) {
   std::lock_guard<std::mutex> lock(g_metadata_cache_m);
 
-  g_metadata_cache.reset(new MetadataCache(bootstrap_servers,
+  std::shared_ptr<GRNotificationListener> gr_notifications_listener;
+  if (use_gr_notifications) {
+    gr_notifications_listener = GRNotificationListener::create(
+        ssl_options.mode, user, password, std::chrono::seconds(connect_timeout),
+        std::chrono::seconds(read_timeout), thread_stack_size);
+  }
+
+  std::atomic_store(&g_metadata_cache, std::make_shared<MetadataCache>(bootstrap_servers,
     get_instance(user, password, connect_timeout, read_timeout, 1, ttl, ssl_options), ttl,
-                 ssl_options, cluster_name, thread_stack_size));
+                 ssl_options, cluster_name, thread_stack_size, gr_notifications_listener,
+                 emergency_refresh_interval, topology_cache_file, gr_status_interval));
   g_metadata_cache->start();
 }
 
@@ -121,6 +205,31 @@ LookupResult MetadataCacheAPI::lookup_replicaset(const std::string &replicaset_n
   return LookupResult(g_metadata_cache->replicaset_lookup(replicaset_name));
 }
 
+/**
+ * Get the current snapshot of the given replicaset.
+ *
+ * Doesn't take the metadata cache's locks: the hot path of routing calls
+ * this for every new client connection.
+ *
+ * @param replicaset_name The name of the replicaset.
+ *
+ * @return shared, immutable snapshot of the replicaset
+ */
+std::shared_ptr<const ReplicasetSnapshot> MetadataCacheAPI::lookup_replicaset_snapshot(
+    const std::string &replicaset_name) {
+  auto metadata_cache = std::atomic_load(&g_metadata_cache);
+  if (metadata_cache == nullptr) {
+    throw std::runtime_error("Metadata Cache not initialized");
+  }
+
+  return metadata_cache->replicaset_snapshot(replicaset_name);
+}
+
+void MetadataCacheAPI::request_refresh() {
+  LOCK_METADATA_AND_CHECK_INITIALIZED();
+
+  g_metadata_cache->request_refresh();
+}
 
 void MetadataCacheAPI::mark_instance_reachability(const std::string &instance_id,
                                 InstanceStatus status) {
@@ -129,10 +238,19 @@ void MetadataCacheAPI::mark_instance_reachability(const std::string &instance_id
   g_metadata_cache->mark_instance_reachability(instance_id, status);
 }
 
+/**
+ * Wait for a new primary of the given replicaset.
+ *
+ * Many connections may wait at once, and cache_stop() must be able to wake
+ * them up: the wait doesn't hold g_metadata_cache_m.
+ */
 bool MetadataCacheAPI::wait_primary_failover(const std::string &replicaset_name, int timeout) {
-  LOCK_METADATA_AND_CHECK_INITIALIZED();
+  auto metadata_cache = std::atomic_load(&g_metadata_cache);
+  if (metadata_cache == nullptr) {
+    throw std::runtime_error("Metadata Cache not initialized");
+  }
 
-  return g_metadata_cache->wait_primary_failover(replicaset_name, timeout);
+  return metadata_cache->wait_primary_failover(replicaset_name, timeout);
 }
 
 void MetadataCacheAPI::add_listener(const std::string& replicaset_name, ReplicasetStateListenerInterface* listener) {
@@ -26,6 +26,7 @@
 #include "dim.h"
 #include "group_replication_metadata.h"
 #include "mysql/harness/logging/logging.h"
+#include "mysql_router_thread.h"
 #include "mysqlrouter/mysql_session.h"
 #include "mysqlrouter/uri.h"
 #include "mysqlrouter/utils.h"
@@ -34,7 +35,13 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <set>
 #include <vector>
 #include <sstream>
 #include <stdio.h>
@@ -93,6 +100,7 @@ ClusterMetadata::ClusterMetadata(const std::string &user,
     }
   }
   ssl_options_ = ssl_options;
+  member_sessions_ = std::make_shared<MemberSessionPool>();
 }
 
 /** @brief Destructor
@@ -100,27 +108,277 @@ ClusterMetadata::ClusterMetadata(const std::string &user,
  * Disconnect and release the connection to the metadata node.
  * (RAII will close the connection in metadata_connection_)
  */
-ClusterMetadata::~ClusterMetadata() {}
+ClusterMetadata::~ClusterMetadata() {
+  join_probe_threads(false);
+}
 
-bool ClusterMetadata::do_connect(MySQLSession& connection, const metadata_cache::ManagedInstance &mi) {
+void ClusterMetadata::stop() noexcept {
+  terminate_ = true;
+}
+
+void ClusterMetadata::join_probe_threads(bool finished_only) {
+  std::vector<ProbeThread> to_join;
+  {
+    std::lock_guard<std::mutex> lock(probe_threads_mtx_);
+    auto running = std::partition(probe_threads_.begin(), probe_threads_.end(),
+        [finished_only](const ProbeThread &probe_thread) {
+      return finished_only && !*probe_thread.finished;
+    });
+    std::move(running, probe_threads_.end(), std::back_inserter(to_join));
+    probe_threads_.erase(running, probe_threads_.end());
+  }
+  for (auto &probe_thread : to_join) {
+    probe_thread.thread->join();
+  }
+}
+
+/** @class MemberSessionPool
+ *
+ * Sessions to replicaset members kept open across metadata refreshes, so
+ * that only sessions that actually failed are re-established.
+ *
+ * A session is taken out of the pool while a GR status probe uses it and
+ * is put back only if the probe succeeded. Members that could not be
+ * connected to are backed off exponentially: they are asked only after
+ * all other members.
+ */
+class MemberSessionPool {
+ public:
+  /** Takes the idle session to a member out of the pool
+   *
+   * @return the session, nullptr if there is none (or it got disconnected)
+   */
+  std::shared_ptr<MySQLSession> acquire(const std::string &address) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = idle_.find(address);
+    if (it == idle_.end()) return nullptr;
+
+    std::shared_ptr<MySQLSession> session(std::move(it->second));
+    idle_.erase(it);
+    if (!session->is_connected()) return nullptr;
+    return session;
+  }
+
+  /** Puts a healthy session back into the pool */
+  void release(const std::string &address, std::shared_ptr<MySQLSession> session) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    // one idle session per member is enough, drop the surplus one
+    idle_.emplace(address, std::move(session));
+  }
 
+  /** Whether connecting to the member failed recently */
+  bool in_backoff(const std::string &address) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = backoff_.find(address);
+    return it != backoff_.end() &&
+           std::chrono::steady_clock::now() < it->second.retry_after;
+  }
+
+  void connect_failed(const std::string &address) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Backoff &backoff = backoff_[address];
+    if (backoff.failures < kMaxBackoffShift) ++backoff.failures;
+    backoff.retry_after = std::chrono::steady_clock::now() +
+        std::min(kMaxBackoff, kMinBackoff * (1 << (backoff.failures - 1)));
+  }
+
+  void connect_succeeded(const std::string &address) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    backoff_.erase(address);
+  }
+
+  /** Drops the sessions and backoffs of members not in `addresses` */
+  void retain(const std::set<std::string> &addresses) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto it = idle_.begin(); it != idle_.end();) {
+      if (addresses.count(it->first) == 0)
+        it = idle_.erase(it);
+      else
+        ++it;
+    }
+    for (auto it = backoff_.begin(); it != backoff_.end();) {
+      if (addresses.count(it->first) == 0)
+        it = backoff_.erase(it);
+      else
+        ++it;
+    }
+  }
+
+ private:
+  struct Backoff {
+    unsigned failures{0};
+    std::chrono::steady_clock::time_point retry_after;
+  };
+
+  static constexpr unsigned kMaxBackoffShift = 16;
+  static constexpr std::chrono::seconds kMinBackoff{1};
+  static constexpr std::chrono::seconds kMaxBackoff{30};
+
+  mutable std::mutex mtx_;
+  std::map<std::string, std::shared_ptr<MySQLSession>> idle_;
+  std::map<std::string, Backoff> backoff_;
+};
+
+constexpr std::chrono::seconds MemberSessionPool::kMinBackoff;
+constexpr std::chrono::seconds MemberSessionPool::kMaxBackoff;
+constexpr unsigned ClusterMetadata::kMaxSkippedFetches;
+
+namespace {
+
+/** Credentials and options used for connecting to replicaset members */
+struct ConnectOptions {
+  std::string user;
+  std::string password;
+  mysql_ssl_mode ssl_mode;
+  mysqlrouter::SSLOptions ssl_options;
+  int connect_timeout;
+  int read_timeout;
+};
+
+bool connect_to_instance(MySQLSession& connection, const metadata_cache::ManagedInstance &mi,
+                         const ConnectOptions &options) {
   std::string host = (mi.host == "localhost" ? "127.0.0.1" : mi.host);
   try {
-    connection.set_ssl_options(ssl_mode_,
-                               ssl_options_.tls_version,
-                               ssl_options_.cipher,
-                               ssl_options_.ca, ssl_options_.capath,
-                               ssl_options_.crl, ssl_options_.crlpath);
-    connection.connect(host, static_cast<unsigned int>(mi.port), user_, password_,
-        "" /* unix-socket */, "" /* default-schema */, connect_timeout_, read_timeout_);
+    connection.set_ssl_options(options.ssl_mode,
+                               options.ssl_options.tls_version,
+                               options.ssl_options.cipher,
+                               options.ssl_options.ca, options.ssl_options.capath,
+                               options.ssl_options.crl, options.ssl_options.crlpath);
+    connection.connect(host, static_cast<unsigned int>(mi.port), options.user, options.password,
+        "" /* unix-socket */, "" /* default-schema */, options.connect_timeout, options.read_timeout);
     return true;
   } catch (const MySQLSession::Error& e) {
     return false; // error is logged in calling function
   }
 }
 
+/** Answer of one replicaset member to the GR status query */
+struct GRStatusProbe {
+  // position of the member in ManagedReplicaSet::members
+  size_t member_index;
+  // host:port of the member
+  std::string address;
+  std::shared_ptr<MySQLSession> connection;
+  bool connected;
+  // connection was taken from the MemberSessionPool
+  bool reused;
+  bool single_primary_mode;
+  std::map<std::string, GroupReplicationMember> member_status;
+  // set if the status query failed
+  std::string error;
+};
+
+/** Queue of GR status probes that have finished
+ *
+ * Shared between update_replicaset_status() and the probe threads: once a
+ * member reported a quorum the remaining probes are not waited for, they
+ * drop their answers (and connections) here when they finish.
+ */
+class GRStatusProbes {
+ public:
+  void push(std::unique_ptr<GRStatusProbe> probe) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      finished_.push_back(std::move(probe));
+    }
+    cond_.notify_one();
+  }
+
+  /** Waits for the next finished probe, returns nullptr on timeout */
+  std::unique_ptr<GRStatusProbe> pop(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!cond_.wait_for(lock, timeout, [this] { return !finished_.empty(); }))
+      return nullptr;
+    std::unique_ptr<GRStatusProbe> probe(std::move(finished_.front()));
+    finished_.pop_front();
+    return probe;
+  }
+
+ private:
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  std::deque<std::unique_ptr<GRStatusProbe>> finished_;
+};
+
+// Connects to the member (unless already connected) and runs the GR status
+// query. If a pool is given, a working connection is returned to it.
+void run_gr_status_probe(GRStatusProbe &probe,
+                         const metadata_cache::ManagedInstance &mi,
+                         const ConnectOptions &options,
+                         MemberSessionPool *pool) noexcept {
+  if (!probe.connected) {
+    probe.connected = connect_to_instance(*probe.connection, mi, options);
+    if (pool) {
+      if (probe.connected)
+        pool->connect_succeeded(probe.address);
+      else
+        pool->connect_failed(probe.address);
+    }
+    if (!probe.connected) return;
+  }
+
+  try {
+    probe.member_status = fetch_group_replication_members(*probe.connection,
+        probe.single_primary_mode);  // throws metadata_cache::metadata_error
+  } catch (const metadata_cache::metadata_error& e) {
+    probe.error = e.what();
+  } catch (...) {
+    assert(0);  // unexpected exception
+    probe.error = "unexpected exception";
+  }
+
+  // a session that failed a query is dropped and re-established when needed
+  if (pool && probe.error.empty()) {
+    pool->release(probe.address, std::move(probe.connection));
+  }
+}
+
+struct GRStatusProbeTask {
+  std::shared_ptr<GRStatusProbes> probes;
+  std::unique_ptr<GRStatusProbe> probe;
+  metadata_cache::ManagedInstance instance;
+  // copies, as the task may outlive the update_replicaset_status() that
+  // started it
+  ConnectOptions options;
+  std::shared_ptr<MemberSessionPool> pool;
+  std::shared_ptr<std::atomic<bool>> finished;
+};
+
+void* gr_status_probe_thread(void *context) {
+  std::unique_ptr<GRStatusProbeTask> task(static_cast<GRStatusProbeTask*>(context));
+  run_gr_status_probe(*task->probe, task->instance, task->options, task->pool.get());
+  task->probes->push(std::move(task->probe));
+  *task->finished = true;
+  return nullptr;
+}
+
+// How long a member may take to answer before the next member is asked too
+const std::chrono::milliseconds kGRStatusProbeHedgeDelay{250};
+
+// How often waiting on probes that are all started checks for stop(); the
+// probes give up on their own after the connect and read timeouts
+const std::chrono::milliseconds kGRStatusProbeWaitSlice{100};
+
+} // namespace
+
+bool ClusterMetadata::do_connect(MySQLSession& connection, const metadata_cache::ManagedInstance &mi) {
+  return connect_to_instance(connection, mi,
+      ConnectOptions{user_, password_, ssl_mode_, ssl_options_, connect_timeout_, read_timeout_});
+}
+
 bool ClusterMetadata::connect(const metadata_cache::ManagedInstance &metadata_server) noexcept {
 
+  // Keep using the connection established by an earlier refresh, unless
+  // a query on it failed since.
+  std::string addr = (metadata_server.host == "localhost" ? "127.0.0.1" : metadata_server.host) +
+                     ":" + std::to_string(metadata_server.port);
+  if (metadata_connection_ && !metadata_connection_failed_ &&
+      metadata_connection_->is_connected() &&
+      metadata_connection_->get_address() == addr) {
+    return true;
+  }
+  metadata_connection_failed_ = false;
+
   // Get a clean metadata server connection object
   // (RAII will close the old one if needed).
   try {
@@ -150,84 +408,164 @@ void ClusterMetadata::update_replicaset_status(const std::string &name,
     metadata_cache::ManagedReplicaSet &replicaset) { // throws metadata_cache::metadata_error
   log_debug("Updating replicaset status from GR for '%s'", name.c_str());
 
-  // iterate over all cadidate nodes until we find the node that is part of quorum
-  bool found_quorum = false;
-  std::shared_ptr<MySQLSession> gr_member_connection;
-  for (const metadata_cache::ManagedInstance& mi : replicaset.members) {
+  // fetch_member_status() gets here without connect(); the metadata server
+  // connection is only shared if it is still open
+  std::string md_address;
+  {
+    std::lock_guard<std::mutex> lock(metadata_connection_mtx_);
+    if (metadata_connection_ && metadata_connection_->is_connected())
+      md_address = metadata_connection_->get_address();
+  }
+
+  // Ask the members in order until one of them reports a quorum. A member
+  // that doesn't answer within kGRStatusProbeHedgeDelay (typically: it is
+  // down and the connect is running into its timeout) doesn't block the
+  // search: the next member is asked in parallel and the first answer
+  // with a quorum wins.
+  const ConnectOptions options{user_, password_, ssl_mode_, ssl_options_,
+                               connect_timeout_, read_timeout_};
+  std::shared_ptr<GRStatusProbes> probes = std::make_shared<GRStatusProbes>();
+  size_t next_member = 0;
+  size_t pending_probes = 0;
+
+  // the probes not waited for are joined by a later update
+  std::vector<ProbeThread> started_probes;
+  std::shared_ptr<void> probes_guard(nullptr, [&](void *){
+    std::lock_guard<std::mutex> lock(probe_threads_mtx_);
+    std::move(started_probes.begin(), started_probes.end(),
+              std::back_inserter(probe_threads_));
+  });
+
+  // members that couldn't be connected to recently are asked last
+  std::vector<size_t> probe_order;
+  std::vector<size_t> backed_off;
+  for (size_t i = 0; i < replicaset.members.size(); ++i) {
+    const metadata_cache::ManagedInstance& mi = replicaset.members[i];
     std::string mi_addr = (mi.host == "localhost" ? "127.0.0.1" : mi.host) + ":" + std::to_string(mi.port);
+    (member_sessions_->in_backoff(mi_addr) ? backed_off : probe_order).push_back(i);
+  }
+  probe_order.insert(probe_order.end(), backed_off.begin(), backed_off.end());
 
-    // this function could test these in an if() instead of assert(),
-    // but so far the logic that calls this function ensures this
-    assert(metadata_connection_->is_connected());
+  bool found_quorum = false;
+  while (!found_quorum) {
+    if (next_member < probe_order.size()) {
+      const metadata_cache::ManagedInstance& mi = replicaset.members[probe_order[next_member]];
+      std::string mi_addr = (mi.host == "localhost" ? "127.0.0.1" : mi.host) + ":" + std::to_string(mi.port);
+
+      std::unique_ptr<GRStatusProbe> probe(new GRStatusProbe{
+          probe_order[next_member], mi_addr, nullptr, false, false, true, {}, {}});
+      ++next_member;
+      ++pending_probes;
+
+      if (mi_addr == md_address) {                          // optimisation: if node is the same as metadata server,
+        // replicasets are updated in parallel, one query at a time on the
+        // shared connection
+        std::lock_guard<std::mutex> lock(metadata_connection_mtx_);
+        probe->connection = metadata_connection_;           //               share the established connection
+        probe->connected = true;
+
+        run_gr_status_probe(*probe, mi, options, nullptr);
+        if (!probe->error.empty()) {
+          // reconnect to the metadata server on the next refresh
+          metadata_connection_failed_ = true;
+        }
+        probes->push(std::move(probe));
+      } else {
+        probe->connection = member_sessions_->acquire(mi_addr);
+        if (probe->connection) {
+          probe->connected = true;
+          probe->reused = true;
+        } else {
+          try {
+            probe->connection = mysql_harness::DIM::instance().new_MySQLSession();
+          } catch (const std::logic_error& e) {
+            // defensive programming, shouldn't really happen. If it does, there's nothing we can do really, we give up
+            log_error("While updating metadata, could not initialise MySQL connetion structure");
+            throw metadata_cache::metadata_error(e.what());
+          }
+        }
 
-    // connect to node
-    if (mi_addr == metadata_connection_->get_address()) { // optimisation: if node is the same as metadata server,
-      gr_member_connection = metadata_connection_;        //               share the established connection
-    } else {
-      try {
-        gr_member_connection = mysql_harness::DIM::instance().new_MySQLSession();
-      } catch (const std::logic_error& e) {
-        // defensive programming, shouldn't really happen. If it does, there's nothing we can do really, we give up
-        log_error("While updating metadata, could not initialise MySQL connetion structure");
-        throw metadata_cache::metadata_error(e.what());
+        std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+        std::unique_ptr<GRStatusProbeTask> task(new GRStatusProbeTask{
+            probes, std::move(probe), mi, options, member_sessions_, finished});
+        try {
+          std::unique_ptr<mysql_harness::MySQLRouterThread> probe_thread(
+              new mysql_harness::MySQLRouterThread());
+          probe_thread->run(&gr_status_probe_thread, task.get());
+          task.release(); // owned by the thread now
+          started_probes.push_back(ProbeThread{std::move(probe_thread), finished});
+        } catch (const std::runtime_error &e) {
+          // no thread, ask the member ourselves
+          log_warning("While updating metadata, could not start a thread for %s: %s",
+                      mi_addr.c_str(), e.what());
+          gr_status_probe_thread(task.release());
+        }
       }
+    } else if (pending_probes == 0) {
+      break;  // all members asked, none has a quorum
+    }
 
-      if (!do_connect(*gr_member_connection, mi)) {
-        log_warning("While updating metadata, could not establish a connection to replicaset '%s' through %s",
-                  name.c_str(), mi_addr.c_str());
-        continue; // server down, next!
-      }
+    // while there are members left, don't wait long for a slow one
+    std::unique_ptr<GRStatusProbe> probe = probes->pop(
+        next_member < probe_order.size() ? kGRStatusProbeHedgeDelay : kGRStatusProbeWaitSlice);
+    if (!probe) {
+      if (terminate_)
+        throw metadata_cache::metadata_error("Updating replicaset '" + name + "' stopped");
+      continue;  // no answer yet, ask the next member too
     }
+    --pending_probes;
 
-    assert(gr_member_connection->is_connected());
-    log_info("Connected to replicaset '%s' through %s", name.c_str(), mi_addr.c_str());
+    const metadata_cache::ManagedInstance& mi = replicaset.members[probe->member_index];
+    std::string mi_addr = (mi.host == "localhost" ? "127.0.0.1" : mi.host) + ":" + std::to_string(mi.port);
 
-    try {
-      bool single_primary_mode = true;
-
-      // this node's perspective: give status of all nodes you see
-      std::map<std::string, GroupReplicationMember> member_status =
-          fetch_group_replication_members(*gr_member_connection,
-                                          single_primary_mode); // throws metadata_cache::metadata_error
-      log_debug("Replicaset '%s' has %lu members in metadata, %lu in status table",
-                name.c_str(), static_cast<unsigned long>(replicaset.members.size()),
-                static_cast<unsigned long>(member_status.size()));  // 32bit Linux requires cast
-
-      // check status of all nodes; updates instances ------------------vvvvvvvvvvvvvvvvvv
-      metadata_cache::ReplicasetStatus status = check_replicaset_status(replicaset.members, member_status);
-      switch (status) {
-        case metadata_cache::ReplicasetStatus::AvailableWritable: // we have quorum, good!
-          found_quorum = true;
-          break;
-        case metadata_cache::ReplicasetStatus::AvailableReadOnly: // have quorum, but only RO
-          found_quorum = true;
-          break;
-        case metadata_cache::ReplicasetStatus::UnavailableRecovering:  // have quorum, but only with recovering nodes (cornercase)
-          log_warning("quorum for replicaset '%s' consists only of recovering nodes!", name.c_str());
-          found_quorum = true;  // no point in futher search
-          break;
-        case metadata_cache::ReplicasetStatus::Unavailable:       // we have nothing
-          log_warning("%s is not part of quorum for replicaset '%s'", mi_addr.c_str(), name.c_str());
-          continue;   // this server is no good, next!
-      }
+    if (!probe->connected) {
+      log_warning("While updating metadata, could not establish a connection to replicaset '%s' through %s",
+                name.c_str(), mi_addr.c_str());
+      continue; // server down, next!
+    }
 
-      if (found_quorum) {
-        replicaset.single_primary_mode = single_primary_mode;
-        break; // break out of the member iteration loop
-      }
+    log_info("Connected to replicaset '%s' through %s", name.c_str(), mi_addr.c_str());
+
+    if (!probe->error.empty() && probe->reused) {
+      // the session kept from an earlier refresh went stale, ask the member
+      // once more through a new one
+      log_info("Connection to %s of replicaset '%s' failed, reconnecting: %s",
+               mi_addr.c_str(), name.c_str(), probe->error.c_str());
+      probe_order.insert(probe_order.begin() + static_cast<std::ptrdiff_t>(next_member),
+                         probe->member_index);
+      continue;
+    }
 
-    } catch (const metadata_cache::metadata_error& e) {
+    if (!probe->error.empty()) {
       log_warning("Unable to fetch live group_replication member data from %s from replicaset '%s': %s",
-                  mi_addr.c_str(), name.c_str(), e.what());
-      continue; // faulty server, next!
-    } catch (...) {
-      assert(0);  // unexpected exception
-      log_warning("Unable to fetch live group_replication member data from %s from replicaset '%s'",
-                  mi_addr.c_str(), name.c_str());
+                  mi_addr.c_str(), name.c_str(), probe->error.c_str());
       continue; // faulty server, next!
     }
 
-  } // for (const metadata_cache::ManagedInstance& mi : instances)
+    log_debug("Replicaset '%s' has %lu members in metadata, %lu in status table",
+              name.c_str(), static_cast<unsigned long>(replicaset.members.size()),
+              static_cast<unsigned long>(probe->member_status.size()));  // 32bit Linux requires cast
+
+    // check status of all nodes; updates instances ------------------vvvvvvvvvvvvvvvvvv
+    metadata_cache::ReplicasetStatus status = check_replicaset_status(replicaset.members, probe->member_status);
+    switch (status) {
+      case metadata_cache::ReplicasetStatus::AvailableWritable: // we have quorum, good!
+        found_quorum = true;
+        break;
+      case metadata_cache::ReplicasetStatus::AvailableReadOnly: // have quorum, but only RO
+        found_quorum = true;
+        break;
+      case metadata_cache::ReplicasetStatus::UnavailableRecovering:  // have quorum, but only with recovering nodes (cornercase)
+        log_warning("quorum for replicaset '%s' consists only of recovering nodes!", name.c_str());
+        found_quorum = true;  // no point in futher search
+        break;
+      case metadata_cache::ReplicasetStatus::Unavailable:       // we have nothing
+        log_warning("%s is not part of quorum for replicaset '%s'", mi_addr.c_str(), name.c_str());
+        continue;   // this server is no good, next!
+    }
+
+    replicaset.single_primary_mode = probe->single_primary_mode;
+  } // while (!found_quorum)
   log_debug("End updating replicaset for '%s'", name.c_str());
 
   if (!found_quorum) {
@@ -347,21 +685,196 @@ ClusterMetadata::ReplicaSetsByName ClusterMetadata::fetch_instances(
 
   assert(metadata_connection_->is_connected());
 
+  // the fingerprint taken by topology_unchanged() right before this fetch
+  // describes its result, unless the fetch fails
+  const std::string fingerprint = std::move(pending_fingerprint_);
+  pending_fingerprint_.clear();
+  fingerprint_.clear();
+  fingerprint_usable_ = false;
+
   // fetch existing replicasets in the cluster from the metadata server (this is the topology that was configured,
   // it will be compared later against current topology reported by (a server in) replicaset)
-  ReplicaSetsByName replicasets(fetch_instances_from_metadata_server(cluster_name)); // throws metadata_cache::metadata_error
+  ReplicaSetsByName replicasets;
+  try {
+    replicasets = fetch_instances_from_metadata_server(cluster_name); // throws metadata_cache::metadata_error
+  } catch (const metadata_cache::metadata_error &) {
+    // reconnect to the metadata server on the next refresh
+    metadata_connection_failed_ = true;
+    throw;
+  }
   if (replicasets.empty())
     log_warning("No replicasets defined for cluster '%s'", cluster_name.c_str());
+  configured_replicasets_ = replicasets;
+  configured_cluster_name_ = cluster_name;
+  has_configured_replicasets_ = true;
+
+  // members that left the cluster are not asked again
+  std::set<std::string> member_addresses;
+  for (const auto &rs : replicasets) {
+    for (const auto &mi : rs.second.members) {
+      member_addresses.insert((mi.host == "localhost" ? "127.0.0.1" : mi.host) + ":" + std::to_string(mi.port));
+    }
+  }
+  member_sessions_->retain(member_addresses);
 
   // now connect to each replicaset and query it for the list and status of its members.
   // (more precisely, foreach replicaset: search and connect to a member which is part of quorum to retrieve this data)
-  for (auto &&rs : replicasets) {
-    update_replicaset_status(rs.first, rs.second);  // throws metadata_cache::metadata_error
+  update_replicasets_status(replicasets);  // throws metadata_cache::metadata_error
+
+  if (replicasets.size() <= 1) {
+    // the metadata server's view of GR can only vouch for the replicaset if
+    // it is an available member of it
+    const std::string md_address = metadata_connection_->get_address();
+    fingerprint_usable_ = replicasets.size() == 1 &&
+        std::any_of(replicasets.begin()->second.members.begin(),
+                    replicasets.begin()->second.members.end(),
+                    [&md_address](const metadata_cache::ManagedInstance &mi) {
+      return mi.mode != metadata_cache::ServerMode::Unavailable &&
+             (mi.host == "localhost" ? "127.0.0.1" : mi.host) + ":" + std::to_string(mi.port) == md_address;
+    });
+    fingerprint_ = fingerprint;
+    fingerprint_address_ = md_address;
+    skipped_fetches_ = 0;
   }
 
   return replicasets;
 }
 
+ClusterMetadata::ReplicaSetsByName ClusterMetadata::fetch_member_status(
+    const std::string &cluster_name) {
+  if (!has_configured_replicasets_ || configured_cluster_name_ != cluster_name)
+    throw metadata_cache::metadata_error("No metadata fetched for cluster '" + cluster_name + "' yet");
+
+  log_debug("Updating member status for cluster '%s'", cluster_name.c_str());
+
+  // start over from the configured members: a replicaset found without a
+  // quorum has no members left in the last result
+  ReplicaSetsByName replicasets = configured_replicasets_;
+  update_replicasets_status(replicasets);  // throws metadata_cache::metadata_error
+  return replicasets;
+}
+
+void ClusterMetadata::update_replicasets_status(ReplicaSetsByName &replicasets) {
+  join_probe_threads(true);
+
+  if (replicasets.size() <= 1) {
+    for (auto &&rs : replicasets) {
+      update_replicaset_status(rs.first, rs.second);  // throws metadata_cache::metadata_error
+    }
+    return;
+  }
+
+  // the replicasets are independent of each other, query them in parallel
+  std::vector<ReplicasetStatusUpdate> updates;
+  updates.reserve(replicasets.size());
+  for (auto &&rs : replicasets) {
+    updates.push_back(ReplicasetStatusUpdate{this, &rs.first, &rs.second, nullptr});
+  }
+  {
+    std::vector<std::unique_ptr<mysql_harness::MySQLRouterThread>> threads;
+    for (auto &update : updates) {
+      std::unique_ptr<mysql_harness::MySQLRouterThread> thread(new mysql_harness::MySQLRouterThread());
+      try {
+        thread->run(&update_replicaset_status_thread, &update);
+        threads.push_back(std::move(thread));
+      } catch (const std::runtime_error &) {
+        update_replicaset_status_thread(&update);  // no thread, update it ourselves
+      }
+    }
+    for (auto &thread : threads) {
+      thread->join();
+    }
+  }
+  for (auto &update : updates) {
+    if (update.error) std::rethrow_exception(update.error);  // throws metadata_cache::metadata_error
+  }
+}
+
+bool ClusterMetadata::topology_unchanged(const std::string &cluster_name) {
+  pending_fingerprint_.clear();
+  if (!fingerprint_usable_ || !metadata_connection_ || !metadata_connection_->is_connected())
+    return false;
+
+  std::string fingerprint;
+  try {
+    fingerprint = fetch_topology_fingerprint(cluster_name);  // throws metadata_cache::metadata_error
+  } catch (const metadata_cache::metadata_error &e) {
+    // let the full fetch find out what's wrong
+    log_debug("Checking for topology changes of cluster '%s' failed: %s",
+              cluster_name.c_str(), e.what());
+    return false;
+  }
+
+  if (fingerprint == fingerprint_ &&
+      metadata_connection_->get_address() == fingerprint_address_ &&
+      skipped_fetches_ < kMaxSkippedFetches) {
+    ++skipped_fetches_;
+    return true;
+  }
+
+  pending_fingerprint_ = fingerprint;
+  return false;
+}
+
+// throws metadata_cache::metadata_error
+std::string ClusterMetadata::fetch_topology_fingerprint(const std::string &cluster_name) {
+  // One row with checksums of the rows fetch_instances_from_metadata_server()
+  // and fetch_group_replication_members() would return, plus the primary
+  // member and mode. BIT_XOR() doesn't depend on the order of the rows and
+  // isn't truncated like GROUP_CONCAT().
+  std::string query("SELECT "
+                    "(SELECT CONCAT(COUNT(*), '-', BIT_XOR(CRC32(CONCAT_WS(',', "
+                    "R.replicaset_name, I.mysql_server_uuid, I.role, IFNULL(I.weight, ''), "
+                    "IFNULL(I.version_token, ''), H.location, I.addresses)))) "
+                    "FROM "
+                    "mysql_innodb_cluster_metadata.clusters AS F "
+                    "JOIN mysql_innodb_cluster_metadata.replicasets AS R "
+                    "ON F.cluster_id = R.cluster_id "
+                    "JOIN mysql_innodb_cluster_metadata.instances AS I "
+                    "ON R.replicaset_id = I.replicaset_id "
+                    "JOIN mysql_innodb_cluster_metadata.hosts AS H "
+                    "ON I.host_id = H.host_id "
+                    "WHERE F.cluster_name = " + metadata_connection_->quote(cluster_name) + "), "
+                    "(SELECT CONCAT(COUNT(*), '-', BIT_XOR(CRC32(CONCAT_WS(',', "
+                    "member_id, member_host, member_port, member_state)))) "
+                    "FROM performance_schema.replication_group_members "
+                    "WHERE channel_name = 'group_replication_applier'), "
+                    "(SELECT VARIABLE_VALUE FROM performance_schema.global_status "
+                    "WHERE VARIABLE_NAME = 'group_replication_primary_member'), "
+                    "@@group_replication_single_primary_mode;");
+
+  std::string fingerprint;
+  auto result_processor = [&fingerprint](const MySQLSession::Row& row) -> bool {
+    if (row.size() != 4) {
+      throw metadata_cache::metadata_error("Unexpected number of fields in the resultset. "
+                                           "Expected = 4, got = " + std::to_string(row.size()));
+    }
+    for (const char *field : row) {
+      fingerprint += field ? field : "NULL";
+      fingerprint += '|';
+    }
+    return false;  // false = I don't want more rows
+  };
+
+  try {
+    metadata_connection_->query(query, result_processor);
+  } catch (const MySQLSession::Error& e) {
+    throw metadata_cache::metadata_error(e.what());
+  }
+
+  return fingerprint;
+}
+
+void* ClusterMetadata::update_replicaset_status_thread(void *context) {
+  ReplicasetStatusUpdate *update = static_cast<ReplicasetStatusUpdate*>(context);
+  try {
+    update->metadata->update_replicaset_status(*update->name, *update->replicaset);
+  } catch (...) {
+    update->error = std::current_exception();
+  }
+  return nullptr;
+}
+
 // throws metadata_cache::metadata_error
 ClusterMetadata::ReplicaSetsByName ClusterMetadata::fetch_instances_from_metadata_server(
     const std::string &cluster_name) {
@@ -29,15 +29,20 @@
 #include "mysqlrouter/mysql_session.h"
 #include "metadata.h"
 #include "tcp_address.h"
+#include "mysql_router_thread.h"
 
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <vector>
 #include <memory>
 #include <map>
+#include <mutex>
 #include <string>
 #include <string.h>
 
 struct GroupReplicationMember;
+class MemberSessionPool;
 
 namespace mysqlrouter { class MySQLSession; }
 
@@ -70,7 +75,9 @@ class METADATA_API ClusterMetadata : public MetaData {
 
   /** @brief Destructor
    *
-   * Disconnect and release the connection to the metadata node.
+   * Disconnect and release the connection to the metadata node. Waits for
+   * the GR status probes still running, which give up after the connect
+   * and read timeouts.
    */
   virtual ~ClusterMetadata();
 
@@ -86,6 +93,38 @@ class METADATA_API ClusterMetadata : public MetaData {
    */
   ReplicaSetsByName fetch_instances(const std::string &cluster_name) override; // throws metadata_cache::metadata_error
 
+  /** @brief Checks if the topology changed since the last fetch_instances()
+   *
+   * Runs a single query on the metadata server which returns a fingerprint
+   * of the cluster's metadata and of the GR members as seen by the metadata
+   * server, and compares it with the fingerprint taken before the last
+   * fetch_instances(). As it relies on the metadata server's view of GR, it
+   * is only used if the last fetch found exactly one replicaset with the
+   * metadata server as one of its available members. A full fetch is forced
+   * every kMaxSkippedFetches calls nevertheless.
+   *
+   * @param cluster_name the name of the cluster to query
+   * @return true if the topology is unchanged
+   */
+  bool topology_unchanged(const std::string &cluster_name) override;
+
+  /** number of consecutive topology_unchanged() hits before a full fetch is forced */
+  static constexpr unsigned kMaxSkippedFetches = 10;
+
+  /** @brief Updates the member states of the last fetch_instances() result
+   *
+   * Queries the GR status tables of the replicasets found by the last
+   * successful fetch_instances(), through the sessions kept open to their
+   * members, but not the metadata schema. The metadata server connection
+   * isn't needed, it is reused if still open though.
+   *
+   * @param cluster_name the name of the cluster to query
+   * @return Map of replicaset ID, server list pairs.
+   * @throws metadata_cache::metadata_error if there was no successful
+   *         fetch_instances() for the cluster yet
+   */
+  ReplicaSetsByName fetch_member_status(const std::string &cluster_name) override; // throws metadata_cache::metadata_error
+
 #if 0 // not used so far
   /** @brief Returns the refresh interval provided by the metadata server.
    *
@@ -113,6 +152,12 @@ class METADATA_API ClusterMetadata : public MetaData {
    */
   void disconnect() noexcept override {}
 
+  /** @brief Makes a running fetch stop waiting for replicaset members
+   *
+   * The fetch throws metadata_cache::metadata_error instead.
+   */
+  void stop() noexcept override;
+
  private:
   /** Connects a MYSQL connection to the given instance
    */
@@ -123,6 +168,11 @@ class METADATA_API ClusterMetadata : public MetaData {
    */
   ReplicaSetsByName fetch_instances_from_metadata_server(const std::string &cluster_name);
 
+  /** @brief Queries the metadata server for the fingerprint of the cluster's
+   * topology used by topology_unchanged()
+   */
+  std::string fetch_topology_fingerprint(const std::string &cluster_name); // throws metadata_cache::metadata_error
+
   /** Query the GR performance_schema tables for live information about a replicaset.
    *
    * update_replicaset_status() calls check_replicaset_status() for some of its processing.
@@ -136,6 +186,35 @@ class METADATA_API ClusterMetadata : public MetaData {
   void update_replicaset_status(const std::string &name,
       metadata_cache::ManagedReplicaSet &replicaset); // throws metadata_cache::metadata_error
 
+  /** A replicaset whose status is updated in a thread of its own */
+  struct ReplicasetStatusUpdate {
+    ClusterMetadata *metadata;
+    const std::string *name;
+    metadata_cache::ManagedReplicaSet *replicaset;
+    // set if update_replicaset_status() threw
+    std::exception_ptr error;
+  };
+
+  /** Runs update_replicaset_status() for a ReplicasetStatusUpdate */
+  static void* update_replicaset_status_thread(void *context);
+
+  /** Runs update_replicaset_status() for all replicasets, in parallel if
+   * there is more than one */
+  void update_replicasets_status(ReplicaSetsByName &replicasets); // throws metadata_cache::metadata_error
+
+  /** A GR status probe that update_replicaset_status() didn't wait for */
+  struct ProbeThread {
+    std::unique_ptr<mysql_harness::MySQLRouterThread> thread;
+    // set by the thread once it is done
+    std::shared_ptr<std::atomic<bool>> finished;
+  };
+
+  /** Joins the probe threads left by earlier updates
+   *
+   * @param finished_only only join threads that are done already
+   */
+  void join_probe_threads(bool finished_only);
+
   /** @brief Hard to summarise, please read the full description
    *
    * Does two things based on `member_status` provided:
@@ -180,6 +259,45 @@ class METADATA_API ClusterMetadata : public MetaData {
   // connection to metadata server (it may also be shared with GR status queries for optimisation purposes)
   std::shared_ptr<mysqlrouter::MySQLSession> metadata_connection_;
 
+  // serialises the GR status queries of replicasets updated in parallel
+  // on metadata_connection_
+  std::mutex metadata_connection_mtx_;
+
+  // set when a query on metadata_connection_ failed; connect() then
+  // establishes a new connection instead of reusing it
+  std::atomic<bool> metadata_connection_failed_{false};
+
+  // sessions to replicaset members kept between refreshes. Shared with
+  // GR status probes, which may still run after update_replicaset_status()
+  // returned.
+  std::shared_ptr<MemberSessionPool> member_sessions_;
+
+  // probes still running after their update_replicaset_status() found a
+  // quorum; joined by later updates and the destructor
+  std::mutex probe_threads_mtx_;
+  std::vector<ProbeThread> probe_threads_;
+
+  // set by stop()
+  std::atomic<bool> terminate_{false};
+
+  // topology_unchanged() state, all used by the refresh thread only:
+  // fingerprint taken before the last successful fetch_instances(), and
+  // the metadata server it was taken on
+  std::string fingerprint_;
+  std::string fingerprint_address_;
+  // fingerprint taken by the last topology_unchanged() that found a change
+  std::string pending_fingerprint_;
+  // set if the last fetch_instances() allows to rely on the fingerprint
+  bool fingerprint_usable_{false};
+  unsigned skipped_fetches_{0};
+
+  // replicasets as configured in the metadata (before the GR status got
+  // applied) found by the last successful fetch_instances(), used by
+  // fetch_member_status(); refresh thread only
+  ReplicaSetsByName configured_replicasets_;
+  std::string configured_cluster_name_;
+  bool has_configured_replicasets_{false};
+
 #if 0 // not used so far
   // How many times we tried to reconnected (for logging purposes)
   size_t reconnect_tries_;
@@ -199,6 +317,11 @@ class METADATA_API ClusterMetadata : public MetaData {
   FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_Status_FailQueryOnNode1);
   FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_Status_FailQueryOnAllNodes);
   FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_SimpleSunnyDayScenario);
+  FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_SlowMemberDoesNotBlock);
+  FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_StopAbortsWait);
+  FRIEND_TEST(MetadataTest, UpdateReplicasetStatus_ReusesSessions);
+  FRIEND_TEST(MetadataTest, TopologyUnchanged);
+  FRIEND_TEST(MetadataTest, FetchMemberStatus);
   FRIEND_TEST(MetadataTest, CheckReplicasetStatus_Recovering);
   FRIEND_TEST(MetadataTest, CheckReplicasetStatus_ErrorAndOther);
   FRIEND_TEST(MetadataTest, CheckReplicasetStatus_Cornercase2of5Alive);
@@ -0,0 +1,678 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifdef _WIN32
+#define NOMINMAX
+#endif
+
+#include "gr_notifications_listener.h"
+#include "common.h"
+#include "mysql/harness/logging/logging.h"
+#include "mysqlrouter/mysql_session.h"
+#include "mysqlrouter/sha1.h"
+#include "mysqlrouter/utils.h"
+
+#ifdef __GNUC__
+// disable -Wconversion for protobuf 2.6.
+// this can be removed with protobuf 3.0.x and later
+#pragma GCC diagnostic push
+#pragma GCC diagnostic warning "-Wconversion"
+#endif
+#include "mysqlx.pb.h"
+#include "mysqlx_datatypes.pb.h"
+#include "mysqlx_notice.pb.h"
+#include "mysqlx_session.pb.h"
+#include "mysqlx_sql.pb.h"
+#include <google/protobuf/io/coded_stream.h>
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+IMPORT_LOG_FUNCTIONS()
+
+constexpr std::chrono::seconds GRNotificationListener::kReconnectInterval;
+constexpr std::chrono::seconds GRNotificationListener::kKeepaliveInterval;
+
+namespace {
+
+// 4 bytes message size (type byte included) followed by the message type
+constexpr size_t kMessageHeaderSize = 5;
+
+// a session only ever receives notices and replies to pings, anything bigger
+// than this is garbage
+constexpr uint32_t kMaxMessageSize = 64 * 1024;
+
+// how long the listener thread waits for data before it checks if it has to
+// stop or (re)connect members
+constexpr std::chrono::milliseconds kPollInterval{500};
+
+// how often connecting to a member and waiting for its replies check if the
+// listener has to stop
+constexpr std::chrono::milliseconds kStopCheckInterval{100};
+
+// notices sent on changes of the group membership, of the role of a member
+// (primary election) and of the state of a member
+const char *const kGRNotices[] = {
+  "group_replication/membership/quorum_loss",
+  "group_replication/membership/view",
+  "group_replication/status/role_change",
+  "group_replication/status/state_change",
+};
+
+std::string to_address_key(const mysql_harness::TCPAddress &address) {
+  return address.addr + ":" + mysqlrouter::to_string(address.port);
+}
+
+const char *gr_notice_type_name(uint32_t type) {
+  switch (type) {
+    case Mysqlx::Notice::GroupReplicationStateChanged::MEMBERSHIP_QUORUM_LOSS:
+      return "quorum loss";
+    case Mysqlx::Notice::GroupReplicationStateChanged::MEMBERSHIP_VIEW_CHANGE:
+      return "view change";
+    case Mysqlx::Notice::GroupReplicationStateChanged::MEMBER_ROLE_CHANGE:
+      return "role change";
+    case Mysqlx::Notice::GroupReplicationStateChanged::MEMBER_STATE_CHANGE:
+      return "state change";
+    default:
+      return "unknown";
+  }
+}
+
+std::string serialize(const google::protobuf::Message &msg) {
+  std::string payload;
+  if (!msg.SerializeToString(&payload)) {
+    throw std::runtime_error("failed serializing " + msg.GetTypeName());
+  }
+  return payload;
+}
+
+void set_non_blocking(int sock) {
+#ifdef _WIN32
+  u_long mode = 1;
+  ioctlsocket(sock, FIONBIO, &mode);
+#else
+  int flags = fcntl(sock, F_GETFL, 0);
+  fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+bool would_block(int err) {
+#ifdef _WIN32
+  return err == WSAEWOULDBLOCK;
+#else
+  return err == EAGAIN || err == EWOULDBLOCK;
+#endif
+}
+
+}  // namespace
+
+GRNotificationListener::GRNotificationListener(
+    const std::string &user, const std::string &password,
+    std::chrono::milliseconds connect_timeout,
+    std::chrono::milliseconds read_timeout, size_t thread_stack_size,
+    mysql_harness::SocketOperationsBase *sock_ops)
+    : user_(user),
+      password_(password),
+      connect_timeout_(connect_timeout),
+      read_timeout_(read_timeout),
+      sock_ops_(sock_ops),
+      listener_thread_(thread_stack_size) {}
+
+GRNotificationListener::~GRNotificationListener() {
+  stop();
+}
+
+std::shared_ptr<GRNotificationListener> GRNotificationListener::create(
+    const std::string &ssl_mode, const std::string &user,
+    const std::string &password, std::chrono::milliseconds connect_timeout,
+    std::chrono::milliseconds read_timeout, size_t thread_stack_size,
+    mysql_harness::SocketOperationsBase *sock_ops) {
+  using mysqlrouter::MySQLSession;
+
+  std::string mode{ssl_mode};
+  std::transform(mode.begin(), mode.end(), mode.begin(), ::toupper);
+  if (mode == MySQLSession::kSslModeRequired ||
+      mode == MySQLSession::kSslModeVerifyCa ||
+      mode == MySQLSession::kSslModeVerifyIdentity) {
+    log_warning(
+        "Not listening for group replication notifications: ssl_mode=%s "
+        "requires TLS, which the notification sessions don't support. "
+        "The metadata cache only refreshes every TTL.",
+        mode.c_str());
+    return nullptr;
+  }
+
+  return std::make_shared<GRNotificationListener>(
+      user, password, connect_timeout, read_timeout, thread_stack_size,
+      sock_ops);
+}
+
+void GRNotificationListener::start(const NotificationCallback &callback) {
+  callback_ = callback;
+  terminate_ = false;
+  listener_thread_.run(&run_thread, this);
+  started_ = true;
+}
+
+void GRNotificationListener::stop() noexcept {
+  if (!started_) return;
+
+  {
+    std::lock_guard<std::mutex> lock(members_mtx_);
+    terminate_ = true;
+  }
+  members_cond_.notify_all();
+  listener_thread_.join();
+  started_ = false;
+}
+
+void GRNotificationListener::set_members(
+    const std::vector<metadata_cache::ManagedInstance> &members) {
+  std::map<std::string, mysql_harness::TCPAddress> addresses;
+  for (const auto &member : members) {
+    if (member.xport == 0) continue;
+    mysql_harness::TCPAddress address(member.host,
+                                      static_cast<uint16_t>(member.xport));
+    addresses.emplace(to_address_key(address), address);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(members_mtx_);
+    if (addresses.size() == members_.size() &&
+        std::equal(addresses.begin(), addresses.end(), members_.begin(),
+                   [](const std::pair<const std::string, mysql_harness::TCPAddress> &a,
+                      const std::pair<const std::string, mysql_harness::TCPAddress> &b) {
+                     return a.first == b.first;
+                   })) {
+      return;
+    }
+    members_ = std::move(addresses);
+    members_changed_ = true;
+  }
+  members_cond_.notify_all();
+}
+
+void *GRNotificationListener::run_thread(void *context) {
+  static_cast<GRNotificationListener *>(context)->listener_thread();
+  return nullptr;
+}
+
+void GRNotificationListener::listener_thread() {
+  mysql_harness::rename_thread("MDC GR Notices");
+
+  while (!terminate_) {
+    const auto now = std::chrono::steady_clock::now();
+    update_sessions(now);
+
+    if (sessions_.empty()) {
+      // nothing to listen on, wait until there are members to connect to
+      std::unique_lock<std::mutex> lock(members_mtx_);
+      members_cond_.wait_for(lock, kPollInterval, [this] {
+        return terminate_ || members_changed_;
+      });
+      continue;
+    }
+
+    std::vector<struct pollfd> fds;
+    std::vector<std::string> addresses;
+    for (auto &session : sessions_) {
+      // the notices are the only thing that is sent to us, keep the session
+      // from being closed by the server's mysqlx_wait_timeout
+      if (now - session.second.last_write >= kKeepaliveInterval) {
+        Mysqlx::Sql::StmtExecute ping;
+        ping.set_namespace_("mysqlx");
+        ping.set_stmt("ping");
+        if (!write_message(session.second.fd,
+                           Mysqlx::ClientMessages::SQL_STMT_EXECUTE,
+                           serialize(ping))) {
+          log_debug("Failed pinging %s, reconnecting", session.first.c_str());
+          addresses.push_back(session.first);
+          continue;
+        }
+        session.second.last_write = now;
+      }
+
+      struct pollfd fd;
+      fd.fd = session.second.fd;
+      fd.events = POLLIN;
+      fd.revents = 0;
+      fds.push_back(fd);
+    }
+    for (const auto &address : addresses) close_session(address);
+    addresses.clear();
+
+    for (const auto &session : sessions_) addresses.push_back(session.first);
+
+    int res = sock_ops_->poll(fds.data(), static_cast<nfds_t>(fds.size()),
+                              kPollInterval);
+    if (res <= 0) continue;
+
+    bool notified = false;
+    for (size_t i = 0; i < fds.size(); ++i) {
+      if (fds[i].revents == 0) continue;
+
+      auto session = sessions_.find(addresses[i]);
+      if (session == sessions_.end()) continue;
+
+      try {
+        if (!read_session(addresses[i], session->second)) {
+          close_session(addresses[i]);
+          continue;
+        }
+        size_t notices = consume_gr_notices(session->second.buffer);
+        if (notices > 0) {
+          log_debug("Received %zu group replication notice(s) from %s",
+                    notices, addresses[i].c_str());
+          notified = true;
+        }
+      } catch (const std::exception &exc) {
+        log_warning("Closing group replication notices session to %s: %s",
+                    addresses[i].c_str(), exc.what());
+        close_session(addresses[i]);
+      }
+    }
+
+    // several members send a notice for the same change; one refresh is
+    // enough to pick it up
+    if (notified && callback_) callback_();
+  }
+
+  while (!sessions_.empty()) close_session(sessions_.begin()->first);
+}
+
+void GRNotificationListener::update_sessions(
+    std::chrono::steady_clock::time_point now) {
+  std::map<std::string, mysql_harness::TCPAddress> members;
+  {
+    std::lock_guard<std::mutex> lock(members_mtx_);
+    members = members_;
+    members_changed_ = false;
+  }
+
+  for (auto it = sessions_.begin(); it != sessions_.end();) {
+    auto current = it++;
+    if (members.count(current->first) == 0) close_session(current->first);
+  }
+  for (auto it = retry_at_.begin(); it != retry_at_.end();) {
+    if (members.count(it->first) == 0)
+      it = retry_at_.erase(it);
+    else
+      ++it;
+  }
+
+  for (const auto &member : members) {
+    if (terminate_) return;
+    if (sessions_.count(member.first) > 0) continue;
+
+    auto retry = retry_at_.find(member.first);
+    if (retry != retry_at_.end() && now < retry->second) continue;
+
+    int fd = open_session(member.second);
+    if (fd < 0) {
+      retry_at_[member.first] = now + kReconnectInterval;
+      continue;
+    }
+    log_info("Listening for group replication notices from %s",
+             member.first.c_str());
+    retry_at_.erase(member.first);
+
+    Session session;
+    session.fd = fd;
+    session.last_write = std::chrono::steady_clock::now();
+    sessions_.emplace(member.first, std::move(session));
+  }
+}
+
+int GRNotificationListener::open_session(
+    const mysql_harness::TCPAddress &address) {
+  const std::string address_str = to_address_key(address);
+  int fd = connect_socket(address);
+  if (fd < 0) return -1;
+
+  try {
+    uint8_t type;
+    std::string payload;
+
+    // the server answers each of our messages with one final message;
+    // notices (like the session id it assigns) can come before it
+    auto read_reply = [&]() {
+      do {
+        if (!read_message(fd, type, payload)) {
+          throw std::runtime_error("no reply");
+        }
+      } while (type == Mysqlx::ServerMessages::NOTICE);
+
+      if (type == Mysqlx::ServerMessages::ERROR) {
+        Mysqlx::Error error;
+        if (error.ParseFromString(payload))
+          throw std::runtime_error(error.msg());
+        throw std::runtime_error("error reply");
+      }
+    };
+
+    Mysqlx::Session::AuthenticateStart auth_start;
+    auth_start.set_mech_name("MYSQL41");
+    if (!write_message(fd, Mysqlx::ClientMessages::SESS_AUTHENTICATE_START,
+                       serialize(auth_start))) {
+      throw std::runtime_error("write failed");
+    }
+    read_reply();
+    Mysqlx::Session::AuthenticateContinue challenge;
+    if (type != Mysqlx::ServerMessages::SESS_AUTHENTICATE_CONTINUE ||
+        !challenge.ParseFromString(payload)) {
+      throw std::runtime_error("unexpected reply to AuthenticateStart");
+    }
+
+    Mysqlx::Session::AuthenticateContinue auth_continue;
+    auth_continue.set_auth_data(
+        mysql41_auth_data(user_, password_, challenge.auth_data()));
+    if (!write_message(fd, Mysqlx::ClientMessages::SESS_AUTHENTICATE_CONTINUE,
+                       serialize(auth_continue))) {
+      throw std::runtime_error("write failed");
+    }
+    read_reply();
+    if (type != Mysqlx::ServerMessages::SESS_AUTHENTICATE_OK) {
+      throw std::runtime_error("unexpected reply to AuthenticateContinue");
+    }
+
+    // enable_notices({"notice": [...]})
+    Mysqlx::Sql::StmtExecute enable_notices;
+    enable_notices.set_namespace_("mysqlx");
+    enable_notices.set_stmt("enable_notices");
+    auto arg = enable_notices.add_args();
+    arg->set_type(Mysqlx::Datatypes::Any::OBJECT);
+    auto field = arg->mutable_obj()->add_fld();
+    field->set_key("notice");
+    field->mutable_value()->set_type(Mysqlx::Datatypes::Any::ARRAY);
+    for (const char *notice : kGRNotices) {
+      auto value = field->mutable_value()->mutable_array()->add_value();
+      value->set_type(Mysqlx::Datatypes::Any::SCALAR);
+      value->mutable_scalar()->set_type(Mysqlx::Datatypes::Scalar::V_STRING);
+      value->mutable_scalar()->mutable_v_string()->set_value(notice);
+    }
+    if (!write_message(fd, Mysqlx::ClientMessages::SQL_STMT_EXECUTE,
+                       serialize(enable_notices))) {
+      throw std::runtime_error("write failed");
+    }
+    read_reply();
+    if (type != Mysqlx::ServerMessages::SQL_STMT_EXECUTE_OK) {
+      throw std::runtime_error("unexpected reply to enable_notices");
+    }
+  } catch (const std::exception &exc) {
+    log_warning("Failed enabling group replication notices on %s: %s",
+                address_str.c_str(), exc.what());
+    sock_ops_->close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+int GRNotificationListener::connect_socket(
+    const mysql_harness::TCPAddress &address) {
+  struct addrinfo hints, *servinfo = nullptr;
+  std::memset(&hints, 0, sizeof hints);
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  const std::string port = mysqlrouter::to_string(address.port);
+  int err = sock_ops_->getaddrinfo(address.addr.c_str(), port.c_str(), &hints,
+                                   &servinfo);
+  if (err != 0) {
+    log_debug("Failed getting address information for '%s'",
+              address.addr.c_str());
+    return -1;
+  }
+  std::shared_ptr<void> exit_guard(nullptr, [&](void *) {
+    if (servinfo) sock_ops_->freeaddrinfo(servinfo);
+  });
+
+  for (auto info = servinfo; info != nullptr; info = info->ai_next) {
+    int sock = sock_ops_->socket(info->ai_family, info->ai_socktype,
+                                 info->ai_protocol);
+    if (sock < 0) continue;
+
+    set_non_blocking(sock);
+
+    if (sock_ops_->connect(sock, info->ai_addr, info->ai_addrlen) == 0) {
+      return sock;
+    }
+
+    const int connect_errno = sock_ops_->get_errno();
+#ifdef _WIN32
+    const bool in_progress = connect_errno == WSAEINPROGRESS ||
+                             connect_errno == WSAEWOULDBLOCK;
+#else
+    const bool in_progress = connect_errno == EINPROGRESS;
+#endif
+    int so_error = 0;
+    if (in_progress && connect_wait(sock) &&
+        sock_ops_->connect_non_blocking_status(sock, so_error) == 0) {
+      return sock;
+    }
+
+    log_debug("Failed connecting to %s: %s", to_address_key(address).c_str(),
+              mysql_harness::get_strerror(so_error ? so_error : connect_errno).c_str());
+    sock_ops_->close(sock);
+  }
+
+  return -1;
+}
+
+bool GRNotificationListener::connect_wait(int sock) {
+  const auto deadline = std::chrono::steady_clock::now() + connect_timeout_;
+  while (!terminate_) {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) return false;
+
+    const auto wait = std::min(kStopCheckInterval,
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now));
+    if (sock_ops_->connect_non_blocking_wait(sock, wait) == 0) return true;
+    if (sock_ops_->get_errno() != ETIMEDOUT) return false;
+  }
+  return false;
+}
+
+bool GRNotificationListener::read_message(int fd, uint8_t &type,
+                                          std::string &payload) {
+  const auto deadline = std::chrono::steady_clock::now() + read_timeout_;
+  std::string buffer;
+  size_t wanted = kMessageHeaderSize;
+
+  while (buffer.size() < wanted) {
+    char buf[4096];
+    const size_t to_read = std::min(sizeof(buf), wanted - buffer.size());
+    ssize_t res = sock_ops_->read(fd, buf, to_read);
+    if (res > 0) {
+      buffer.append(buf, static_cast<size_t>(res));
+      if (buffer.size() == kMessageHeaderSize && wanted == kMessageHeaderSize) {
+        uint32_t size;
+        google::protobuf::io::CodedInputStream::ReadLittleEndian32FromArray(
+            reinterpret_cast<const uint8_t *>(buffer.data()), &size);
+        if (size == 0 || size > kMaxMessageSize) return false;
+        wanted = kMessageHeaderSize - 1 + size;
+      }
+      continue;
+    }
+    if (res == 0 || !would_block(sock_ops_->get_errno())) return false;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline || terminate_) return false;
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    // no data yet (0) reads again and checks the deadline and terminate_
+    if (sock_ops_->poll(&pfd, 1, std::min(kStopCheckInterval,
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now))) < 0) {
+      return false;
+    }
+  }
+
+  type = static_cast<uint8_t>(buffer[kMessageHeaderSize - 1]);
+  payload = buffer.substr(kMessageHeaderSize);
+  return true;
+}
+
+bool GRNotificationListener::write_message(int fd, uint8_t type,
+                                           const std::string &payload) {
+  std::string buffer(kMessageHeaderSize, '\0');
+  google::protobuf::io::CodedOutputStream::WriteLittleEndian32ToArray(
+      static_cast<uint32_t>(payload.size() + 1),
+      reinterpret_cast<uint8_t *>(&buffer[0]));
+  buffer[kMessageHeaderSize - 1] = static_cast<char>(type);
+  buffer += payload;
+
+  return sock_ops_->write_all(fd, &buffer[0], buffer.size()) >= 0;
+}
+
+bool GRNotificationListener::read_session(const std::string &address,
+                                          Session &session) {
+  char buf[4096];
+  while (true) {
+    ssize_t res = sock_ops_->read(session.fd, buf, sizeof(buf));
+    if (res > 0) {
+      session.buffer.append(buf, static_cast<size_t>(res));
+      continue;
+    }
+    if (res < 0 && would_block(sock_ops_->get_errno())) return true;
+
+    if (res == 0)
+      log_info("Group replication notices session to %s closed by the server",
+               address.c_str());
+    else
+      log_warning("Failed reading group replication notices from %s: %s",
+                  address.c_str(),
+                  mysql_harness::get_strerror(sock_ops_->get_errno()).c_str());
+    return false;
+  }
+}
+
+void GRNotificationListener::close_session(const std::string &address) {
+  auto session = sessions_.find(address);
+  if (session == sessions_.end()) return;
+
+  sock_ops_->shutdown(session->second.fd);
+  sock_ops_->close(session->second.fd);
+  sessions_.erase(session);
+  // reconnect right away if it is still a member; the retry interval only
+  // kicks in if that fails
+  retry_at_.erase(address);
+}
+
+size_t GRNotificationListener::consume_gr_notices(std::string &buffer) {
+  size_t notices = 0;
+  size_t offset = 0;
+
+  while (buffer.size() - offset >= kMessageHeaderSize) {
+    uint32_t size;
+    google::protobuf::io::CodedInputStream::ReadLittleEndian32FromArray(
+        reinterpret_cast<const uint8_t *>(buffer.data() + offset), &size);
+    if (size == 0 || size > kMaxMessageSize) {
+      throw std::runtime_error("invalid message size " +
+                               mysqlrouter::to_string(size));
+    }
+    if (buffer.size() - offset < kMessageHeaderSize - 1 + size) break;
+
+    const uint8_t type =
+        static_cast<uint8_t>(buffer[offset + kMessageHeaderSize - 1]);
+    const char *payload = buffer.data() + offset + kMessageHeaderSize;
+    const int payload_size = static_cast<int>(size - 1);
+    offset += kMessageHeaderSize - 1 + size;
+
+    if (type == Mysqlx::ServerMessages::ERROR) {
+      Mysqlx::Error error;
+      if (error.ParseFromArray(payload, payload_size) &&
+          error.severity() == Mysqlx::Error::FATAL) {
+        throw std::runtime_error(error.msg());
+      }
+      continue;
+    }
+    // everything else but notices are replies to our pings
+    if (type != Mysqlx::ServerMessages::NOTICE) continue;
+
+    Mysqlx::Notice::Frame frame;
+    if (!frame.ParseFromArray(payload, payload_size)) {
+      throw std::runtime_error("invalid notice");
+    }
+    if (frame.type() != Mysqlx::Notice::Frame::GROUP_REPLICATION_STATE_CHANGED)
+      continue;
+
+    Mysqlx::Notice::GroupReplicationStateChanged change;
+    if (change.ParseFromString(frame.payload())) {
+      log_debug("Group replication %s (view %s)",
+                gr_notice_type_name(change.type()), change.view_id().c_str());
+    }
+    ++notices;
+  }
+
+  buffer.erase(0, offset);
+  return notices;
+}
+
+std::string GRNotificationListener::mysql41_auth_data(
+    const std::string &user, const std::string &password,
+    const std::string &salt) {
+  // schema \0 user \0 scramble, schema left empty
+  std::string auth_data;
+  auth_data.push_back('\0');
+  auth_data += user;
+  auth_data.push_back('\0');
+
+  if (password.empty()) return auth_data;
+
+  // SHA1(password) XOR SHA1(salt + SHA1(SHA1(password)))
+  uint8_t hash_stage1[SHA1_HASH_SIZE];
+  uint8_t hash_stage2[SHA1_HASH_SIZE];
+  uint8_t scramble[SHA1_HASH_SIZE];
+  my_sha1::compute_sha1_hash(hash_stage1, password.c_str(), password.length());
+  my_sha1::compute_sha1_hash(hash_stage2, reinterpret_cast<const char *>(hash_stage1),
+                             SHA1_HASH_SIZE);
+  // the server sends the 20 bytes nonce, possibly \0 terminated
+  my_sha1::compute_sha1_hash_multi(
+      scramble, salt.data(),
+      static_cast<int>(std::min<size_t>(salt.size(), SHA1_HASH_SIZE)),
+      reinterpret_cast<const char *>(hash_stage2), SHA1_HASH_SIZE);
+
+  static const char kHexDigits[] = "0123456789ABCDEF";
+  auth_data.push_back('*');
+  for (size_t i = 0; i < SHA1_HASH_SIZE; ++i) {
+    const uint8_t c = static_cast<uint8_t>(scramble[i] ^ hash_stage1[i]);
+    auth_data.push_back(kHexDigits[c >> 4]);
+    auth_data.push_back(kHexDigits[c & 0x0f]);
+  }
+  return auth_data;
+}
@@ -0,0 +1,198 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef METADATA_CACHE_GR_NOTIFICATIONS_LISTENER_INCLUDED
+#define METADATA_CACHE_GR_NOTIFICATIONS_LISTENER_INCLUDED
+
+#include "mysqlrouter/metadata_cache.h"
+#include "mysql_router_thread.h"
+#include "socket_operations.h"
+#include "tcp_address.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** @class GRNotificationListener
+ *
+ * Keeps X protocol sessions open to the members of the cluster and calls
+ * back whenever one of them sends a GROUP_REPLICATION_STATE_CHANGED notice,
+ * so that the metadata cache can refresh right away instead of waiting for
+ * the TTL to expire.
+ *
+ * The sessions are handled by a thread of their own. A member that can't be
+ * reached (or rejects the session) is retried every kReconnectInterval; in the
+ * meantime the TTL based refresh is all we have for it.
+ *
+ * The sessions don't use TLS, see create().
+ */
+class METADATA_API GRNotificationListener {
+ public:
+  using NotificationCallback = std::function<void()>;
+
+  /**
+   * @param user user to authenticate the X protocol sessions with
+   * @param password password of the user
+   * @param connect_timeout time after which connecting to a member times out
+   * @param read_timeout time after which waiting for a member to reply to the
+   *                     session setup times out
+   * @param thread_stack_size memory in kilobytes allocated for the thread's stack
+   * @param sock_ops socket operations implementation to use
+   */
+  GRNotificationListener(const std::string &user, const std::string &password,
+                         std::chrono::milliseconds connect_timeout,
+                         std::chrono::milliseconds read_timeout,
+                         size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes,
+                         mysql_harness::SocketOperationsBase *sock_ops =
+                             mysql_harness::SocketOperations::instance());
+
+  ~GRNotificationListener();
+
+  /** @brief Creates a listener if the sessions may be opened without TLS
+   *
+   * The sessions authenticate with MYSQL41 over a plain TCP connection. If
+   * the ssl_mode of the metadata cache requires TLS (REQUIRED, VERIFY_CA or
+   * VERIFY_IDENTITY), no listener is created and a warning is logged; the
+   * metadata cache then only refreshes on its TTL.
+   *
+   * @param ssl_mode ssl_mode of the metadata cache
+   * @return the listener, nullptr if ssl_mode requires TLS
+   *
+   * The other parameters are the ones of the constructor.
+   */
+  static std::shared_ptr<GRNotificationListener> create(
+      const std::string &ssl_mode, const std::string &user,
+      const std::string &password, std::chrono::milliseconds connect_timeout,
+      std::chrono::milliseconds read_timeout,
+      size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes,
+      mysql_harness::SocketOperationsBase *sock_ops =
+          mysql_harness::SocketOperations::instance());
+
+  /** @brief Starts the listener thread
+   *
+   * @param callback called (from the listener thread) each time a member
+   *                 reports a change in the group replication state
+   */
+  void start(const NotificationCallback &callback);
+
+  /** @brief Stops the listener thread and closes all sessions */
+  void stop() noexcept;
+
+  /** @brief Sets the members to keep sessions open to
+   *
+   * Sessions to members that are not in the list anymore get closed, new
+   * members get connected by the listener thread.
+   *
+   * @param members cluster members, connected to on their X protocol port
+   */
+  void set_members(const std::vector<metadata_cache::ManagedInstance> &members);
+
+  /** @brief Consumes the complete X protocol messages at the front of a buffer
+   *
+   * Incomplete messages are left in the buffer. Throws std::runtime_error if
+   * the buffer doesn't hold a valid message stream.
+   *
+   * @param buffer data read from the session
+   * @return number of GROUP_REPLICATION_STATE_CHANGED notices consumed
+   */
+  static size_t consume_gr_notices(std::string &buffer);
+
+  /** @brief Builds the MYSQL41 authentication data sent to the server
+   *
+   * @param user user to authenticate
+   * @param password password of the user
+   * @param salt the salt (nonce) the server sent
+   * @return the content of the AuthenticateContinue message
+   */
+  static std::string mysql41_auth_data(const std::string &user,
+                                       const std::string &password,
+                                       const std::string &salt);
+
+  /** @brief How often an unreachable member is retried */
+  static constexpr std::chrono::seconds kReconnectInterval{5};
+
+  /** @brief How often an idle session is pinged to keep it open */
+  static constexpr std::chrono::seconds kKeepaliveInterval{60};
+
+ private:
+  struct Session {
+    int fd{-1};
+    std::string buffer;
+    std::chrono::steady_clock::time_point last_write;
+  };
+
+  static void *run_thread(void *context);
+  void listener_thread();
+
+  // connects new members and drops the sessions to removed ones
+  void update_sessions(std::chrono::steady_clock::time_point now);
+
+  // connects, authenticates and enables the notices; returns the socket or
+  // -1 on error
+  int open_session(const mysql_harness::TCPAddress &address);
+  int connect_socket(const mysql_harness::TCPAddress &address);
+  // waits for a non-blocking connect to finish, gives up after the connect
+  // timeout or when the listener is stopped
+  bool connect_wait(int sock);
+
+  // reads one message, gives up after the read timeout or when the listener
+  // is stopped
+  bool read_message(int fd, uint8_t &type, std::string &payload);
+  bool write_message(int fd, uint8_t type, const std::string &payload);
+
+  // returns false if the session got closed
+  bool read_session(const std::string &address, Session &session);
+  void close_session(const std::string &address);
+
+  const std::string user_;
+  const std::string password_;
+  const std::chrono::milliseconds connect_timeout_;
+  const std::chrono::milliseconds read_timeout_;
+  mysql_harness::SocketOperationsBase *sock_ops_;
+
+  NotificationCallback callback_;
+
+  // members to keep a session open to, keyed by "host:xport"; guarded by
+  // members_mtx_
+  std::map<std::string, mysql_harness::TCPAddress> members_;
+  bool members_changed_{false};
+  std::mutex members_mtx_;
+  std::condition_variable members_cond_;
+
+  // used by the listener thread only
+  std::map<std::string, Session> sessions_;
+  std::map<std::string, std::chrono::steady_clock::time_point> retry_at_;
+
+  std::atomic<bool> terminate_{false};
+  mysql_harness::MySQLRouterThread listener_thread_;
+  bool started_{false};
+};
+
+#endif // METADATA_CACHE_GR_NOTIFICATIONS_LISTENER_INCLUDED
@@ -40,8 +40,36 @@ public:
   using ReplicaSetsByName = std::map<std::string, metadata_cache::ManagedReplicaSet>;
   virtual ReplicaSetsByName fetch_instances(const std::string &cluster_name) = 0;
 
+  /** @brief Cheaply checks if the last fetch_instances() result is still valid
+   *
+   * Returns true only if it is known that fetch_instances() would return
+   * the same as it did the last time, false if it may have changed or if it
+   * can't be told.
+   */
+  virtual bool topology_unchanged(const std::string &/*cluster_name*/) { return false; }
+
+  /** @brief Updates the member states of the last fetch_instances() result
+   *
+   * Asks the replicasets for the group replication state of their members
+   * without querying the metadata schema: the instances and replicasets are
+   * the ones the last successful fetch_instances() found. Throws
+   * metadata_cache::metadata_error if that is not possible, in which case
+   * fetch_instances() has to be called.
+   */
+  virtual ReplicaSetsByName fetch_member_status(const std::string &/*cluster_name*/) {
+    throw metadata_cache::metadata_error("Updating only the member status is not supported");
+  }
+
   virtual bool connect(const metadata_cache::ManagedInstance &metadata_server) = 0;
   virtual void disconnect() = 0;
+
+  /** @brief Makes a running fetch stop waiting for replicaset members
+   *
+   * May be called from any thread. The fetch throws
+   * metadata_cache::metadata_error instead of waiting further.
+   */
+  virtual void stop() noexcept {}
+
   virtual ~MetaData() { }
 };
 
@@ -102,15 +102,54 @@
  *
  *
  *
+ * ## Saved topology
+ * Unless disabled with `use_topology_cache=0`, MDC writes the topology to a
+ * file in the data folder after each refresh that changed it (written to a
+ * temporary file first and renamed over the old one). The constructor loads
+ * that file before its first refresh, so routing works right after a restart
+ * even if no MD server is reachable at that time. The loaded topology is
+ * marked stale (see the `mysqlrouter_metadata_cache_topology_stale` metric)
+ * and, unlike a fetched one, not cleared when all MD servers fail; the first
+ * successful refresh replaces it.
+ *
+ *
+ *
+ *
+ *
  * ## Refresh trigger
  * `MetadataCache::refresh_thread()` call to `MetadataCache::refresh()` can be
- * triggered in 2 ways:
+ * triggered in 3 ways:
  * - `<TTL>` seconds passed since last refresh
  * - emergency mode (replicaset is flagged to have at least one node unreachable).
+ * - a GR member notified a change (only with `use_gr_notifications` enabled).
+ *
+ * It's implemented by waiting on a condition variable between refreshes, for
+ * `<TTL>` or less in emergency mode. A GR notification interrupts the wait
+ * right away.
+ *
  *
- * It's implemented by running a sleep loop between refreshes. The loop sleeps 1
- * second at a time, until `<TTL>` iterations have gone or emergency mode is
- * enabled.
+ *
+ * ### Member status checks
+ * The topology in MD changes rarely, the state of the GR members (primary,
+ * ONLINE, RECOVERING) changes on each failover. With `gr_status_interval` set
+ * (and shorter than `<TTL>`), the refresh thread checks only the GR status of
+ * the known members that often between two refreshes, see
+ * `MetaData::fetch_member_status()`. This reuses the sessions kept open to
+ * the members and doesn't query MD, so it can run much more often than a
+ * refresh. A refresh (which fetches MD) still runs every `<TTL>`, on emergency
+ * mode and on GR notifications, and instead of a check that failed.
+ * `mysqlrouter_metadata_cache_refresh_duration_seconds` times the refreshes,
+ * `mysqlrouter_metadata_cache_member_status_duration_seconds` the checks.
+ *
+ *
+ *
+ * ### GR notifications
+ * With `use_gr_notifications` enabled, `GRNotificationListener` keeps an X
+ * protocol session open to each member of the cluster and enables the
+ * `group_replication` notices on it. The members send a notice whenever the
+ * group view, the role or the state of a member changes, which wakes up the
+ * refresh thread. The TTL based refresh keeps running as a safety net for
+ * members that can't be listened to (X plugin not loaded, session lost).
  *
  *
  *
@@ -118,8 +157,10 @@
  * Emergency mode is entered, when Routing Plugin discovers that it's unable to
  * connect to a node that's declared by MDC as routable (node that is labelled
  * as writable or readonly). In such situation, it will flag the replicaset as
- * missing a node, and MDC will react by increasing refresh rate to 1/s (if it
- * is currently lower).
+ * missing a node, and MDC will react by refreshing right away and then
+ * increasing the refresh rate: the first refreshes are `emergency_refresh_interval`
+ * (100ms by default) apart, the interval doubles after each one until it
+ * reaches 1s (or the TTL, if lower).
  *
  * This emergency mode will stay enabled, until routing table resulting from
  * most recent MD and GR query is different from the one before it _AND_ the
@@ -150,6 +191,14 @@
  *
  * In subsequent sections each stage is described in more detail
  *
+ * @note
+ * Between Stage 1.1 and 1.2, `ClusterMetadata::topology_unchanged()` runs a
+ * single query returning checksums of the MD rows and of the GR members as
+ * seen by the MD server. If they match the ones taken before the previous
+ * refresh, the rest of the refresh is skipped. This is only done when the MD
+ * server was an available member of the (only) replicaset, outside emergency
+ * mode, and at most 10 times in a row.
+ *
  *
  *
  *
@@ -183,8 +232,10 @@
  * Iteration always starting from 1st server on the list might also change [02].
  *
  * @note
- * New connection is always established and old one closed off, even if old one
- * is still alive and usable.
+ * The connection is kept across refreshes: as long as the same server is
+ * tried first and the connection is still open, it is used again. It is closed
+ * and a new one established when fetching the MD (Stage 1.2) or the GR status
+ * over it (Stage 2.2) failed during an earlier refresh.
  *
  *
  *
@@ -238,8 +289,17 @@
  *
  * Implemented in: `ClusterMetadata::update_replicaset_status()`
  *
- * New connection to GR node is established (on failure, Stage 2 progresses to
- * next iteration).
+ * The session to the GR node is taken from the member session pool
+ * (`MemberSessionPool`), which keeps one open session per member across
+ * refreshes. Only if there is none, a new connection is established (on
+ * failure, Stage 2 progresses to next iteration and the member is backed off:
+ * it is asked after all other members until its retry time has passed).
+ *
+ * A session is put back into the pool only after it answered the GR status
+ * queries. It is dropped, so that the next refresh reconnects, when:
+ *   - a query on it failed,
+ *   - the server closed it while it was idle in the pool,
+ *   - the member is no longer part of the replicaset in the MD.
  *
  * @note
  * Since connection to MD server in Stage 1.1 is not closed after that stage
@@ -476,7 +536,9 @@
 #endif
 
 #include "common.h"
+#include "gr_notifications_listener.h"
 #include "metadata_cache.h"
+#include "topology_cache_file.h"
 #include "mysql/harness/logging/logging.h"
 
 #include <cassert>
@@ -486,13 +548,49 @@
 
 IMPORT_LOG_FUNCTIONS()
 
+constexpr std::chrono::milliseconds MetadataCache::kMaxEmergencyRefreshInterval;
+
 MetadataCache::MetadataCache(
   const std::vector<mysql_harness::TCPAddress> &bootstrap_servers,
   std::shared_ptr<MetaData> cluster_metadata, // this could be changed to UniquePtr
   std::chrono::milliseconds ttl,
   const mysqlrouter::SSLOptions &ssl_options,
   const std::string &cluster,
-  size_t thread_stack_size) : refresh_thread_(thread_stack_size) {
+  size_t thread_stack_size,
+  std::shared_ptr<GRNotificationListener> gr_notifications_listener,
+  std::chrono::milliseconds emergency_refresh_interval,
+  const std::string &topology_cache_file,
+  std::chrono::milliseconds gr_status_interval)
+  : emergency_refresh_interval_(emergency_refresh_interval),
+  gr_status_interval_(gr_status_interval),
+  topology_cache_file_(topology_cache_file),
+  refresh_thread_(thread_stack_size),
+  gr_notifications_listener_(gr_notifications_listener),
+  metric_refresh_duration_(mysql_harness::metrics::MetricsRegistry::instance().histogram(
+      "mysqlrouter_metadata_cache_refresh_duration_seconds",
+      "time taken by metadata refreshes", {{"cluster", cluster}})),
+  metric_refresh_failures_(mysql_harness::metrics::MetricsRegistry::instance().counter(
+      "mysqlrouter_metadata_cache_refresh_failures_total",
+      "metadata refreshes that failed on all metadata servers", {{"cluster", cluster}})),
+  metric_refresh_unchanged_(mysql_harness::metrics::MetricsRegistry::instance().counter(
+      "mysqlrouter_metadata_cache_refresh_unchanged_total",
+      "metadata refreshes skipped as the topology was found unchanged", {{"cluster", cluster}})),
+  metric_emergency_mode_(mysql_harness::metrics::MetricsRegistry::instance().gauge(
+      "mysqlrouter_metadata_cache_emergency_mode",
+      "1 if some replicaset has unreachable nodes and the cache refreshes faster",
+      {{"cluster", cluster}})),
+  metric_topology_stale_(mysql_harness::metrics::MetricsRegistry::instance().gauge(
+      "mysqlrouter_metadata_cache_topology_stale",
+      "1 while routing uses the topology loaded at start that no metadata server confirmed yet",
+      {{"cluster", cluster}})),
+  metric_member_status_duration_(mysql_harness::metrics::MetricsRegistry::instance().histogram(
+      "mysqlrouter_metadata_cache_member_status_duration_seconds",
+      "time taken by the group replication status checks between metadata refreshes",
+      {{"cluster", cluster}})),
+  metric_member_status_failures_(mysql_harness::metrics::MetricsRegistry::instance().counter(
+      "mysqlrouter_metadata_cache_member_status_failures_total",
+      "group replication status checks that failed and fell back to a metadata refresh",
+      {{"cluster", cluster}})) {
   std::string host;
   for (auto s : bootstrap_servers) {
     metadata_cache::ManagedInstance bootstrap_server_instance;
@@ -506,7 +604,51 @@ MetadataCache::MetadataCache(
   terminate_ = false;
   meta_data_ = cluster_metadata;
   ssl_options_ = ssl_options;
-  refresh();
+  load_topology_cache();
+  // with a saved topology the cache is usable right away; the refresh
+  // thread asks the metadata servers as soon as it starts
+  if (!topology_stale_) refresh();
+}
+
+void MetadataCache::load_topology_cache() {
+  if (topology_cache_file_.empty()) return;
+
+  std::map<std::string, metadata_cache::ManagedReplicaSet> replicasets;
+  try {
+    replicasets = metadata_cache::load_topology_cache_file(topology_cache_file_, cluster_name_);
+  } catch (const std::runtime_error &exc) {
+    // no file yet on the first start
+    log_info("Not using the saved topology: %s", exc.what());
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+    replicaset_data_ = std::move(replicasets);
+    publish_snapshots();
+  }
+  topology_stale_ = true;
+  metric_topology_stale_.set(1);
+  log_info("Loaded topology of cluster '%s' from '%s', using it until a metadata server confirms it",
+           cluster_name_.c_str(), topology_cache_file_.c_str());
+}
+
+void MetadataCache::save_topology_cache() {
+  if (topology_cache_file_.empty()) return;
+
+  try {
+    metadata_cache::save_topology_cache_file(topology_cache_file_, cluster_name_, replicaset_data_);
+  } catch (const std::runtime_error &exc) {
+    log_warning("Failed saving the topology: %s", exc.what());
+  }
+}
+
+static std::vector<metadata_cache::ManagedInstance> all_members(
+    const std::map<std::string, metadata_cache::ManagedReplicaSet> &replicasets) {
+  std::vector<metadata_cache::ManagedInstance> members;
+  for (const auto &rs : replicasets)
+    members.insert(members.end(), rs.second.members.begin(), rs.second.members.end());
+  return members;
 }
 
 void* MetadataCache::run_thread(void* context) {
@@ -518,30 +660,58 @@ void* MetadataCache::run_thread(void* context) {
 void MetadataCache::refresh_thread() {
   mysql_harness::rename_thread("MDC Refresh");
 
-  // this will be only useful if the TTL is set to some value that is more than 1 second
-  const std::chrono::milliseconds kTerminateOrForcedRefreshCheckInterval = std::chrono::seconds(1);
+  // interval to the next refresh in "emergency mode", doubled after each one
+  auto emergency_interval = emergency_refresh_interval_;
+
+  // between two refreshes (every TTL), only the member status is checked
+  // every gr_status_interval_
+  const bool check_member_status =
+      gr_status_interval_ > std::chrono::milliseconds(0) && gr_status_interval_ < ttl_;
+  auto next_refresh = std::chrono::steady_clock::now();
+  bool full_refresh = true;
 
   while (!terminate_) {
-    refresh();
+    // the member status check needs a topology a metadata server confirmed;
+    // replicaset_data_ is only modified by this thread
+    if (!full_refresh && (topology_stale_ || replicaset_data_.empty()))
+      full_refresh = true;
+    if (!full_refresh && !refresh_member_status())
+      full_refresh = true;  // the metadata may tell what went wrong
+    if (full_refresh) {
+      refresh();
+      next_refresh = std::chrono::steady_clock::now() + ttl_;
+    }
 
-    auto ttl_left = ttl_;
-    // wait for up to TTL until next refresh, unless some replicaset loses an
+    // wait for the TTL until next refresh, unless some replicaset loses an
     // online (primary or secondary) server - in that case, "emergency mode" is
-    // enabled and we refresh every 1s until "emergency mode" is called off.
-    while (ttl_left > std::chrono::milliseconds(0)) {
-      if (terminate_) return;
-
-      auto sleep_for = std::min(ttl_left, kTerminateOrForcedRefreshCheckInterval);
-      std::this_thread::sleep_for(sleep_for);
-      ttl_left -= sleep_for;
-
-      {
-        std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
+    // enabled and we refresh faster until "emergency mode" is called off.
+    auto wait_for = std::max(std::chrono::milliseconds(0),
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            next_refresh - std::chrono::steady_clock::now()));
+    full_refresh = !check_member_status || wait_for <= gr_status_interval_;
+    if (!full_refresh) wait_for = gr_status_interval_;
+    {
+      std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
 
-        if (!replicasets_with_unreachable_nodes_.empty())
-          break; // we're in "emergency mode", don't wait until TTL expires
+      const bool emergency_mode = !replicasets_with_unreachable_nodes_.empty();
+      metric_emergency_mode_.set(emergency_mode ? 1 : 0);
+      if (emergency_mode) {
+        full_refresh = true;
+        wait_for = std::min(wait_for, emergency_interval);
+        emergency_interval = std::min(emergency_interval * 2, kMaxEmergencyRefreshInterval);
+      } else {
+        emergency_interval = emergency_refresh_interval_;
       }
     }
+
+    // cut short by request_refresh(): a member notified a change in the group
+    // replication, a replicaset entered "emergency mode", or an admin asked
+    std::unique_lock<std::mutex> lock(refresh_requested_mtx_);
+    refresh_requested_cond_.wait_for(lock, wait_for, [this] {
+      return terminate_ || refresh_requested_;
+    });
+    if (refresh_requested_) full_refresh = true;
+    refresh_requested_ = false;
   }
 }
 
@@ -550,6 +720,15 @@ void MetadataCache::refresh_thread() {
  * cache.
  */
 void MetadataCache::start() {
+  if (gr_notifications_listener_) {
+    std::vector<metadata_cache::ManagedInstance> members;
+    {
+      std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+      members = all_members(replicaset_data_);
+    }
+    gr_notifications_listener_->set_members(members);
+    gr_notifications_listener_->start([this]() { request_refresh(); });
+  }
   refresh_thread_.run(&run_thread, this);
 }
 
@@ -557,10 +736,31 @@ void MetadataCache::start() {
  * Stop the refresh thread.
  */
 void MetadataCache::stop() noexcept {
-  terminate_ = true;
+  if (gr_notifications_listener_)
+    gr_notifications_listener_->stop();
+  // don't let a refresh wait for members that don't answer
+  if (meta_data_) meta_data_->stop();
+  {
+    std::lock_guard<std::mutex> lock(refresh_requested_mtx_);
+    terminate_ = true;
+  }
+  refresh_requested_cond_.notify_all();
+  {
+    // don't let the failover waiters sleep through the shutdown
+    std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
+  }
+  replicasets_with_unreachable_nodes_cond_.notify_all();
   refresh_thread_.join();
 }
 
+void MetadataCache::request_refresh() {
+  {
+    std::lock_guard<std::mutex> lock(refresh_requested_mtx_);
+    refresh_requested_ = true;
+  }
+  refresh_requested_cond_.notify_all();
+}
+
 /**
  * Return a list of servers that are part of a replicaset.
  *
@@ -568,14 +768,42 @@ void MetadataCache::stop() noexcept {
  */
 std::vector<metadata_cache::ManagedInstance> MetadataCache::replicaset_lookup(
   const std::string &replicaset_name) {
-  std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
-  auto replicaset = replicaset_data_.find(replicaset_name);
+  return replicaset_snapshot(replicaset_name)->members;
+}
 
-  if (replicaset == replicaset_data_.end()) {
+std::shared_ptr<const metadata_cache::ReplicasetSnapshot>
+MetadataCache::replicaset_snapshot(const std::string &replicaset_name) {
+  auto snapshots = std::atomic_load(&snapshots_);
+  auto replicaset = snapshots->find(replicaset_name);
+
+  if (replicaset == snapshots->end()) {
     log_warning("Replicaset '%s' not available", replicaset_name.c_str());
-    return {};
+    return empty_snapshot_;
   }
-  return replicaset_data_[replicaset_name].members;
+  return replicaset->second;
+}
+
+std::shared_ptr<const MetadataCache::ReplicasetSnapshots> MetadataCache::publish_snapshots() {
+  auto old_snapshots = std::atomic_load(&snapshots_);
+  std::shared_ptr<ReplicasetSnapshots> snapshots =
+      std::make_shared<ReplicasetSnapshots>();
+
+  for (const auto &rs : replicaset_data_) {
+    // keep the snapshot of an unchanged replicaset so that readers caching
+    // data derived from it don't have to rebuild it
+    auto old = old_snapshots->find(rs.first);
+    if (old != old_snapshots->end() && old->second->members == rs.second.members) {
+      snapshots->emplace(rs.first, old->second);
+    } else {
+      snapshots->emplace(rs.first,
+          std::make_shared<const metadata_cache::ReplicasetSnapshot>(rs.second.members));
+    }
+  }
+
+  std::atomic_store(&snapshots_,
+      std::shared_ptr<const ReplicasetSnapshots>(std::move(snapshots)));
+
+  return old_snapshots;
 }
 
 bool metadata_cache::ManagedInstance::operator==(const ManagedInstance& other) const {
@@ -623,92 +851,78 @@ static const char *str_mode(metadata_cache::ServerMode mode) {
  * Refresh the metadata information in the cache.
  */
 void MetadataCache::refresh() {
+  const auto refresh_start = std::chrono::steady_clock::now();
+  std::shared_ptr<void> duration_guard(nullptr, [&](void *){
+    metric_refresh_duration_.observe(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - refresh_start).count());
+  });
+
   // fetch metadata
   for (auto &metadata_server: metadata_servers_) {
+    // a fetch aborted by stop() is not a failure of the metadata servers
+    if (terminate_) return;
     if (!meta_data_->connect(metadata_server)) {
       log_error("Failed to connect to metadata server %s", metadata_server.mysql_server_uuid.c_str());
       continue;
      }
      bool result = fetch_metadata_from_connected_instance();
-     if (result) return; // successfully updated metadata
+     if (result) { // successfully updated metadata
+       if (topology_stale_) {
+         topology_stale_ = false;
+         metric_topology_stale_.set(0);
+         log_info("Topology of cluster '%s' confirmed by a metadata server", cluster_name_.c_str());
+       }
+       return;
+     }
   }
 
+  if (terminate_) return;
+
   // we failed to fetch metadata from any of the metadata servers
+  metric_refresh_failures_.increment();
   log_error("Failed connecting with any of the metadata servers");
+  // a topology loaded at start is all we have until a metadata server
+  // answers; clearing it would defeat the purpose of saving it
+  if (topology_stale_) {
+    log_warning("... routing with the saved topology of cluster '%s'", cluster_name_.c_str());
+    return;
+  }
   // clearing metadata
   {
-    bool clearing;
+    std::shared_ptr<const ReplicasetSnapshots> old_snapshots;
     {
       std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
-      clearing = !replicaset_data_.empty();
-      if (clearing)
+      if (!replicaset_data_.empty()) {
         replicaset_data_.clear();
+        old_snapshots = publish_snapshots();
+      }
     }
-    if (clearing) {
+    if (old_snapshots) {
       log_info("... cleared current routing table as a precaution");
-      on_instances_changed(/*md_servers_reachable=*/false);
+      on_instances_changed(/*md_servers_reachable=*/false, *old_snapshots);
     }
   }
 }
 
 bool MetadataCache::fetch_metadata_from_connected_instance() {
   try {
-    // Fetch the metadata and store it in a temporary variable.
-    std::map<std::string, metadata_cache::ManagedReplicaSet>
-      replicaset_data_temp = meta_data_->fetch_instances(cluster_name_);
-    bool changed = false;
-
+    // Skip the full fetch if a cheap check finds nothing changed. Not in
+    // emergency mode though: routing saw something the check may not show
+    // yet. And not if the last refresh failed, the routing table was
+    // cleared then.
+    bool emergency_mode;
     {
-      // Ensure that the refresh does not result in an inconsistency during the
-      // lookup.
-      std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
-      if (!compare_instance_lists(replicaset_data_, replicaset_data_temp)) {
-        replicaset_data_ = replicaset_data_temp;
-        changed = true;
-      }
+      std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
+      emergency_mode = !replicasets_with_unreachable_nodes_.empty();
     }
-
-    // we want to trigger those actions not only if the metadata has really changed
-    // but also when something external (like unsuccessful client connection)
-    // triggered the refresh so that we werified if this wasn't false alarm
-    // and turn it off if it was
-    if (changed) {
-      log_info("Potential changes detected in cluster '%s' after metadata refresh",
-          cluster_name_.c_str());
-      // dump some informational/debugging information about the replicasets
-      if (replicaset_data_.empty())
-        log_error("Metadata for cluster '%s' is empty!", cluster_name_.c_str());
-      else {
-        log_info("Metadata for cluster '%s' has %i replicasets:",
-          cluster_name_.c_str(), (int)replicaset_data_.size());
-        for (auto &rs : replicaset_data_) {
-          log_info("'%s' (%i members, %s)", rs.first.c_str(),
-                    (int)rs.second.members.size(),
-                    rs.second.single_primary_mode ? "single-master" : "multi-master");
-          for (auto &mi : rs.second.members) {
-            log_info("    %s:%i / %i - role=%s mode=%s", mi.host.c_str(),
-                mi.port, mi.xport, mi.role.c_str(), str_mode(mi.mode));
-
-            if (mi.mode == metadata_cache::ServerMode::ReadWrite) {
-              // If we were running with a primary or secondary node gone
-              // missing before (in so-called "emergency mode"), we trust that
-              // the update fixed the problem. This is wrong behavior that
-              // should be fixed, see notes [05] and [06] in Notes section of
-              // Metadata Cache module in Doxygen.
-              std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
-              auto rs_with_unreachable_node = replicasets_with_unreachable_nodes_.find(rs.first);
-              if (rs_with_unreachable_node != replicasets_with_unreachable_nodes_.end()) {
-                // disable "emergency mode" for this replicaset
-                replicasets_with_unreachable_nodes_.erase(rs_with_unreachable_node);
-              }
-            }
-          }
-        }
-      }
-
-      on_instances_changed(/*md_servers_reachable=*/true);
+    if (!emergency_mode && !replicaset_data_.empty() &&
+        meta_data_->topology_unchanged(cluster_name_)) {
+      metric_refresh_unchanged_.increment();
+      return true;
     }
 
+    update_replicaset_data(meta_data_->fetch_instances(cluster_name_));
+
     /* Not sure about this, the metadata server could be stored elsewhere
 
     // Fetch the set of servers in the primary replicaset. These servers
@@ -730,15 +944,115 @@ bool MetadataCache::fetch_metadata_from_connected_instance() {
   return true;
 }
 
-void MetadataCache::on_instances_changed(const bool md_servers_reachable) {
+bool MetadataCache::refresh_member_status() {
+  const auto check_start = std::chrono::steady_clock::now();
+  std::shared_ptr<void> duration_guard(nullptr, [&](void *){
+    metric_member_status_duration_.observe(std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - check_start).count());
+  });
+
+  try {
+    update_replicaset_data(meta_data_->fetch_member_status(cluster_name_));
+  } catch (const std::runtime_error &exc) {
+    metric_member_status_failures_.increment();
+    log_warning("Failed checking the member status of cluster '%s': %s",
+                cluster_name_.c_str(), exc.what());
+    return false;
+  }
+  return true;
+}
+
+void MetadataCache::update_replicaset_data(
+    const std::map<std::string, metadata_cache::ManagedReplicaSet> &replicaset_data_temp) {
+  std::shared_ptr<const ReplicasetSnapshots> old_snapshots;
+  std::vector<metadata_cache::ManagedInstance> members;
+
+  {
+    // Ensure that the refresh does not result in an inconsistency during the
+    // lookup.
+    std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+    if (!compare_instance_lists(replicaset_data_, replicaset_data_temp)) {
+      replicaset_data_ = replicaset_data_temp;
+      old_snapshots = publish_snapshots();
+      if (gr_notifications_listener_)
+        members = all_members(replicaset_data_);
+    }
+  }
+
+  // follow the members that joined or left the cluster
+  if (old_snapshots && gr_notifications_listener_)
+    gr_notifications_listener_->set_members(members);
+
+  // we want to trigger those actions not only if the metadata has really changed
+  // but also when something external (like unsuccessful client connection)
+  // triggered the refresh so that we werified if this wasn't false alarm
+  // and turn it off if it was
+  if (old_snapshots) {
+    log_info("Potential changes detected in cluster '%s' after metadata refresh",
+        cluster_name_.c_str());
+    // dump some informational/debugging information about the replicasets
+    if (replicaset_data_.empty())
+      log_error("Metadata for cluster '%s' is empty!", cluster_name_.c_str());
+    else {
+      log_info("Metadata for cluster '%s' has %i replicasets:",
+        cluster_name_.c_str(), (int)replicaset_data_.size());
+      for (auto &rs : replicaset_data_) {
+        log_info("'%s' (%i members, %s)", rs.first.c_str(),
+                  (int)rs.second.members.size(),
+                  rs.second.single_primary_mode ? "single-master" : "multi-master");
+        for (auto &mi : rs.second.members) {
+          log_info("    %s:%i / %i - role=%s mode=%s", mi.host.c_str(),
+              mi.port, mi.xport, mi.role.c_str(), str_mode(mi.mode));
+
+          if (mi.mode == metadata_cache::ServerMode::ReadWrite) {
+            // If we were running with a primary or secondary node gone
+            // missing before (in so-called "emergency mode"), we trust that
+            // the update fixed the problem. This is wrong behavior that
+            // should be fixed, see notes [05] and [06] in Notes section of
+            // Metadata Cache module in Doxygen.
+            std::lock_guard<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
+            auto rs_with_unreachable_node = replicasets_with_unreachable_nodes_.find(rs.first);
+            if (rs_with_unreachable_node != replicasets_with_unreachable_nodes_.end()) {
+              // disable "emergency mode" for this replicaset and let the
+              // connections waiting for the failover retry
+              replicasets_with_unreachable_nodes_.erase(rs_with_unreachable_node);
+              replicasets_with_unreachable_nodes_cond_.notify_all();
+            }
+          }
+        }
+      }
+    }
+
+    on_instances_changed(/*md_servers_reachable=*/true, *old_snapshots);
+    save_topology_cache();
+  }
+}
+
+void MetadataCache::on_instances_changed(const bool md_servers_reachable,
+                                         const ReplicasetSnapshots &old_snapshots) {
+  auto snapshots = std::atomic_load(&snapshots_);
+  auto find_snapshot = [this](const ReplicasetSnapshots &in, const std::string &name) {
+    auto it = in.find(name);
+    return it == in.end() ? empty_snapshot_ : it->second;
+  };
+
   std::lock_guard<std::mutex> lock(replicaset_instances_change_callbacks_mtx_);
 
   for (auto& replicaset_clb: listeners_) {
-    const std::string replicaset_name = replicaset_clb.first;
-    auto res = replicaset_lookup(replicaset_name);
+    const auto before = find_snapshot(old_snapshots, replicaset_clb.first);
+    const auto after = find_snapshot(*snapshots, replicaset_clb.first);
+
+    // publish_snapshots() keeps the snapshot of an unchanged replicaset. If
+    // the metadata became unavailable the listeners are told regardless, they
+    // may want to drop the connections.
+    if (before == after && md_servers_reachable) continue;
+
+    const auto changes = metadata_cache::ReplicasetChanges::diff(
+        before->members, after->members);
+    if (changes.empty() && md_servers_reachable) continue;
 
-    for(auto each : listeners_[replicaset_name]) {
-      each->notify(res, md_servers_reachable);
+    for (auto each : replicaset_clb.second) {
+      each->notify_changes(*before, *after, changes, md_servers_reachable);
     }
   }
 }
@@ -746,13 +1060,14 @@ void MetadataCache::on_instances_changed(const bool md_servers_reachable) {
 void MetadataCache::mark_instance_reachability(const std::string &instance_id,
                                 metadata_cache::InstanceStatus status) {
   // If the status is that the primary or secondary instance is physically
-  // unreachable, we enable "emergency mode" (temporarily increase the refresh
-  // rate to 1/s if currently lower) until the replicaset routing table
+  // unreachable, we enable "emergency mode" (refresh right away, then
+  // temporarily increase the refresh rate) until the replicaset routing table
   // reflects this reality (or at least that is the the intent; in practice
   // this mechanism is buggy - see Metadata Cache module documentation in
   // Doxygen, section "Emergency mode")
 
-  std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
+  bool entered_emergency_mode = false;
+  std::unique_lock<std::mutex> lock(cache_refreshing_mutex_);
   // the replicaset that the given instance belongs to
   metadata_cache::ManagedInstance *instance = nullptr;
   metadata_cache::ManagedReplicaSet *replicaset = nullptr;
@@ -779,35 +1094,38 @@ void MetadataCache::mark_instance_reachability(const std::string &instance_id,
         log_warning("Instance '%s:%i' [%s] of replicaset '%s' is invalid. Increasing metadata cache refresh frequency.",
                     instance->host.c_str(), instance->port, instance_id.c_str(),
                     replicaset->name.c_str());
-        replicasets_with_unreachable_nodes_.insert(replicaset->name);
+        entered_emergency_mode = replicasets_with_unreachable_nodes_.insert(replicaset->name).second;
         break;
       case metadata_cache::InstanceStatus::Unreachable:
         log_warning("Instance '%s:%i' [%s] of replicaset '%s' is unreachable. Increasing metadata cache refresh frequency.",
                     instance->host.c_str(), instance->port, instance_id.c_str(),
                     replicaset->name.c_str());
-        replicasets_with_unreachable_nodes_.insert(replicaset->name);
+        entered_emergency_mode = replicasets_with_unreachable_nodes_.insert(replicaset->name).second;
         break;
       case metadata_cache::InstanceStatus::Unusable:
         break;
     }
   }
+  lock.unlock();
+
+  // don't wait for the refresh thread to notice, later calls for the same
+  // replicaset leave the cadence to the emergency mode's backoff
+  if (entered_emergency_mode)
+    request_refresh();
 }
 
 bool MetadataCache::wait_primary_failover(const std::string &replicaset_name,
                                           int timeout) {
   log_debug("Waiting for failover to happen in '%s' for %is",
             replicaset_name.c_str(), timeout);
-  time_t stime = std::time(NULL);
-  while (std::time(NULL) - stime <= timeout) {
-    {
-      std::lock_guard<std::mutex> lock(cache_refreshing_mutex_);
-      if (replicasets_with_unreachable_nodes_.count(replicaset_name) == 0) {
-        return true;
-      }
-    }
-    std::this_thread::sleep_for(metadata_cache::kDefaultMetadataTTL);
-  }
-  return false;
+  // woken up by the refresh thread as soon as it calls off the emergency
+  // mode of a replicaset, and by stop()
+  std::unique_lock<std::mutex> lock(replicasets_with_unreachable_nodes_mtx_);
+  replicasets_with_unreachable_nodes_cond_.wait_for(lock, std::chrono::seconds(timeout),
+      [this, &replicaset_name] {
+    return terminate_ || replicasets_with_unreachable_nodes_.count(replicaset_name) == 0;
+  });
+  return replicasets_with_unreachable_nodes_.count(replicaset_name) == 0;
 }
 
 void MetadataCache::add_listener(const std::string& replicaset_name, metadata_cache::ReplicasetStateListenerInterface* listener) {
@@ -31,6 +31,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>
 #include <memory>
 #include <mutex>
@@ -40,8 +41,10 @@
 #include <atomic>
 
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/metrics.h"
 
 class ClusterMetadata;
+class GRNotificationListener;
 
 /** @class MetadataCache
  *
@@ -62,12 +65,31 @@ public:
    * @param ssl_options SSL related options for connection
    * @param cluster_name The name of the desired cluster in the metadata server
    * @param thread_stack_size The maximum memory allocated for thread's stack
+   * @param gr_notifications_listener if not null, refreshes also when one of
+   *        the cluster members notifies a change in the group replication
+   * @param emergency_refresh_interval time between the first refreshes in
+   *        emergency mode
+   * @param topology_cache_file if not empty, the topology is saved to this
+   *        file after each change and loaded from it at start, so that routing
+   *        works before (or without) a metadata server answering. If it was
+   *        loaded, the constructor leaves the first refresh to start()
+   * @param gr_status_interval if shorter than the TTL (and not 0), the group
+   *        replication status of the known members is checked this often
+   *        between two metadata refreshes
    */
   MetadataCache(const std::vector<mysql_harness::TCPAddress> &bootstrap_servers,
                 std::shared_ptr<MetaData> cluster_metadata,
                 std::chrono::milliseconds ttl, const mysqlrouter::SSLOptions &ssl_options,
                 const std::string &cluster_name,
-                size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes);
+                size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes,
+                std::shared_ptr<GRNotificationListener> gr_notifications_listener = nullptr,
+                std::chrono::milliseconds emergency_refresh_interval =
+                    metadata_cache::kDefaultEmergencyRefreshInterval,
+                const std::string &topology_cache_file = "",
+                std::chrono::milliseconds gr_status_interval = std::chrono::milliseconds(0));
+
+  /** @brief Longest time between two refreshes in emergency mode */
+  static constexpr std::chrono::milliseconds kMaxEmergencyRefreshInterval{1000};
 
   /** @brief Starts the Metadata Cache
    *
@@ -91,13 +113,29 @@ public:
   std::vector<metadata_cache::ManagedInstance> replicaset_lookup(
     const std::string &replicaset_name);
 
+  /** @brief Returns the published snapshot of a replicaset
+   *
+   * Does not take any of the cache's mutexes and does not copy the member
+   * list; the snapshot is replaced (not modified) when a refresh detects a
+   * change in the replicaset.
+   *
+   * @param replicaset_name The ID of the replicaset being looked up
+   * @return snapshot of the replicaset, empty if the replicaset is unknown
+   */
+  std::shared_ptr<const metadata_cache::ReplicasetSnapshot> replicaset_snapshot(
+    const std::string &replicaset_name);
+
+  /** @brief Wakes up the refresh thread to refresh right away */
+  void request_refresh();
+
   /** @brief Update the status of the instance
    *
    * Called when an instance from a replicaset cannot be reached for one reason
    * or another. When an instance becomes unreachable, an emergency mode is set
-   * (the rate of refresh of the metadata cache increases to once per second if
-   * currently lower) and lasts until disabled after a suitable change in the
-   * metadata cache is discovered.
+   * (the cache refreshes right away, then every emergency_refresh_interval_,
+   * doubled after each refresh up to kMaxEmergencyRefreshInterval) and lasts
+   * until disabled after a suitable change in the metadata cache is
+   * discovered.
    *
    * @param instance_id - the mysql_server_uuid that identifies the server instance
    * @param status - the status of the instance
@@ -108,7 +146,8 @@ public:
   /** @brief Wait until there's a primary member in the replicaset
    *
    * To be called when the master of a single-master replicaset is down and
-   * we want to wait until one becomes elected.
+   * we want to wait until one becomes elected. Returns as soon as the refresh
+   * thread sees the new primary, or when the cache is stopped.
    *
    * @param replicaset_name name of the replicaset
    * @param timeout - amount of time to wait for a failover, in seconds
@@ -153,14 +192,56 @@ private:
    */
   bool fetch_metadata_from_connected_instance();
 
+  /** @brief Updates the member status of the known replicasets
+   *
+   * Only asks group replication, see MetaData::fetch_member_status().
+   *
+   * @return false if that failed and refresh() is needed
+   */
+  bool refresh_member_status();
+
+  /** @brief Replaces replicaset_data_ if the fetched replicasets differ,
+   * notifying the listeners. Called by the refresh thread only.
+   */
+  void update_replicaset_data(
+      const std::map<std::string, metadata_cache::ManagedReplicaSet> &replicaset_data);
+
+  using ReplicasetSnapshots = std::map<std::string,
+        std::shared_ptr<const metadata_cache::ReplicasetSnapshot>>;
+
   // Called each time the metadata has changed and we need to notify
-  // the subscribed observers
-  void on_instances_changed(const bool md_servers_reachable);
+  // the subscribed observers. Only the observers of the replicasets that
+  // differ from old_snapshots are notified, with the members that changed.
+  void on_instances_changed(const bool md_servers_reachable,
+                            const ReplicasetSnapshots &old_snapshots);
+
+  // Loads replicaset_data_ from topology_cache_file_, marking it stale until
+  // a metadata server is reached.
+  void load_topology_cache();
+
+  // Saves replicaset_data_ to topology_cache_file_. Called by the refresh
+  // thread only.
+  void save_topology_cache();
+
+  // Rebuilds snapshots_ from replicaset_data_, reusing the snapshots of the
+  // replicasets that did not change. cache_refreshing_mutex_ must be held.
+  // Returns the snapshots that got replaced.
+  std::shared_ptr<const ReplicasetSnapshots> publish_snapshots();
 
   // Stores the list replicasets and their server instances.
   // Keyed by replicaset name
   std::map<std::string, metadata_cache::ManagedReplicaSet> replicaset_data_;
 
+  // Read-only view of replicaset_data_ for lookups. Only ever replaced as a
+  // whole (with std::atomic_store), so readers load it without locking.
+  std::shared_ptr<const ReplicasetSnapshots> snapshots_{
+      std::make_shared<const ReplicasetSnapshots>()};
+
+  // Returned for unknown replicasets
+  const std::shared_ptr<const metadata_cache::ReplicasetSnapshot> empty_snapshot_{
+      std::make_shared<const metadata_cache::ReplicasetSnapshot>(
+          std::vector<metadata_cache::ManagedInstance>{})};
+
   // The name of the cluster in the topology.
   std::string cluster_name_;
 
@@ -171,6 +252,21 @@ private:
   // The time to live of the metadata cache.
   std::chrono::milliseconds ttl_;
 
+  // Time between the first two refreshes in emergency mode.
+  std::chrono::milliseconds emergency_refresh_interval_;
+
+  // Time between the member status checks between two refreshes, not
+  // checked if 0 or not shorter than ttl_.
+  std::chrono::milliseconds gr_status_interval_;
+
+  // File the topology is saved to, empty if not used.
+  const std::string topology_cache_file_;
+
+  // true while replicaset_data_ holds the topology loaded from
+  // topology_cache_file_ and no metadata server answered yet. Used by the
+  // refresh thread (and the constructor) only.
+  bool topology_stale_{false};
+
   // SSL options for MySQL connections
   mysqlrouter::SSLOptions ssl_options_;
 
@@ -182,6 +278,25 @@ private:
   /** @brief refresh thread facade */
   mysql_harness::MySQLRouterThread refresh_thread_;
 
+  // Listens for group replication changes pushed by the cluster members,
+  // null unless enabled with use_gr_notifications
+  std::shared_ptr<GRNotificationListener> gr_notifications_listener_;
+
+  // The refresh thread waits on refresh_requested_cond_ between refreshes;
+  // refresh_requested_ (guarded by refresh_requested_mtx_) cuts the wait short
+  std::mutex refresh_requested_mtx_;
+  std::condition_variable refresh_requested_cond_;
+  bool refresh_requested_{false};
+
+  // Metrics exported to the metrics registry, labeled with the cluster name
+  mysql_harness::metrics::Histogram &metric_refresh_duration_;
+  mysql_harness::metrics::Counter &metric_refresh_failures_;
+  mysql_harness::metrics::Counter &metric_refresh_unchanged_;
+  mysql_harness::metrics::Gauge &metric_emergency_mode_;
+  mysql_harness::metrics::Gauge &metric_topology_stale_;
+  mysql_harness::metrics::Histogram &metric_member_status_duration_;
+  mysql_harness::metrics::Counter &metric_member_status_failures_;
+
   // This mutex is used to ensure that a lookup of the metadata is consistent
   // with the changes in the metadata due to a cache refresh.
   std::mutex cache_refreshing_mutex_;
@@ -198,6 +313,10 @@ private:
 
   std::mutex replicasets_with_unreachable_nodes_mtx_;
 
+  // Signalled whenever a replicaset is removed from
+  // replicasets_with_unreachable_nodes_, wakes up wait_primary_failover()
+  std::condition_variable replicasets_with_unreachable_nodes_cond_;
+
   // Flag used to terminate the refresh thread.
   std::atomic_bool terminate_;
 
@@ -210,8 +329,12 @@ private:
 #ifdef FRIEND_TEST
   FRIEND_TEST(FailoverTest, basics);
   FRIEND_TEST(FailoverTest, primary_failover);
+  FRIEND_TEST(FailoverTest, wait_primary_failover_wakes_up_on_refresh);
   FRIEND_TEST(MetadataCacheTest2, basic_test);
   FRIEND_TEST(MetadataCacheTest2, metadata_server_connection_failures);
+  FRIEND_TEST(MetadataCacheTest2, snapshots);
+  FRIEND_TEST(MetadataCacheTest2, listeners_get_changes);
+  FRIEND_TEST(MetadataCacheTest2, warm_start_from_saved_topology);
 #endif
 };
 
@@ -86,6 +86,18 @@ static mysqlrouter::SSLOptions make_ssl_options(
   return options;
 }
 
+/**
+ * Returns the file the topology of the cluster is saved to: a file named
+ * after the section in the data folder, or empty if it's not used.
+ */
+static std::string topology_cache_file(const mysql_harness::ConfigSection *section,
+                                       bool use_topology_cache) {
+  if (!use_topology_cache || !g_app_info || !g_app_info->data_folder) return "";
+
+  return mysqlrouter::get_topology_cache_file(g_app_info->data_folder, section->name,
+                                              section->key);
+}
+
 /**
  * Initialize the metadata cache for fetching the information from the
  * metadata servers.
@@ -125,7 +137,11 @@ static void start(mysql_harness::PluginFuncEnv* env) {
                                metadata_cluster,
                                config.connect_timeout,
                                config.read_timeout,
-                               config.thread_stack_size);
+                               config.thread_stack_size,
+                               config.use_gr_notifications,
+                               config.emergency_refresh_interval,
+                               topology_cache_file(section, config.use_topology_cache),
+                               config.gr_status_interval);
   } catch (const std::runtime_error &exc) { // metadata_cache::metadata_error inherits from runtime_error
     log_error("%s", exc.what());  // TODO remove after Loader starts logging
     set_error(env, mysql_harness::kRuntimeError, "%s", exc.what());
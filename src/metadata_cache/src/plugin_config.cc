@@ -48,7 +48,11 @@ std::string MetadataCachePluginConfig::get_default(const std::string &option) co
       {"ttl", ms_to_seconds_string(metadata_cache::kDefaultMetadataTTL)},
       {"connect_timeout", to_string(metadata_cache::kDefaultConnectTimeout)},
       {"read_timeout", to_string(metadata_cache::kDefaultReadTimeout)},
-      {"thread_stack_size", to_string(mysql_harness::kDefaultStackSizeInKiloBytes)}
+      {"thread_stack_size", to_string(mysql_harness::kDefaultStackSizeInKiloBytes)},
+      {"use_gr_notifications", "0"},
+      {"emergency_refresh_interval", ms_to_seconds_string(metadata_cache::kDefaultEmergencyRefreshInterval)},
+      {"use_topology_cache", "1"},
+      {"gr_status_interval", "0"}
   };
   auto it = defaults.find(option);
   if (it == defaults.end()) {
@@ -59,7 +59,11 @@ public:
         metadata_cluster(get_option_string(section, "metadata_cluster")),
         connect_timeout(get_uint_option<uint16_t>(section, "connect_timeout", 1)),
         read_timeout(get_uint_option<uint16_t>(section, "read_timeout", 1)),
-        thread_stack_size(get_uint_option<uint32_t>(section, "thread_stack_size", 1, 65535))
+        thread_stack_size(get_uint_option<uint32_t>(section, "thread_stack_size", 1, 65535)),
+        use_gr_notifications(get_uint_option<uint32_t>(section, "use_gr_notifications", 0, 1) == 1),
+        emergency_refresh_interval(get_option_milliseconds(section, "emergency_refresh_interval", 0.001, 3600.0)),
+        use_topology_cache(get_uint_option<uint32_t>(section, "use_topology_cache", 0, 1) == 1),
+        gr_status_interval(get_option_milliseconds(section, "gr_status_interval", 0.0, 3600.0))
   { }
 
   /**
@@ -84,6 +88,17 @@ public:
   const unsigned int read_timeout;
   /** @brief memory in kilobytes allocated for thread's stack */
   const unsigned int thread_stack_size;
+  /** @brief refresh as soon as a cluster member notifies a change in the
+   * group replication (needs the X plugin on the members) */
+  const bool use_gr_notifications;
+  /** @brief time between the first refreshes after a member of the routing
+   * table was found unreachable, doubled after each refresh */
+  const std::chrono::milliseconds emergency_refresh_interval;
+  /** @brief save the topology in the data folder and load it at start */
+  const bool use_topology_cache;
+  /** @brief time between the group replication status checks done between
+   * two metadata refreshes (which happen every ttl), 0 to not check */
+  const std::chrono::milliseconds gr_status_interval;
 
 private:
   /** @brief Gets a list of metadata servers.
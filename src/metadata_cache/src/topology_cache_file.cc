@@ -0,0 +1,185 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "topology_cache_file.h"
+
+#include "common.h"
+#include "mysqlrouter/json_utils.h"
+#include "mysqlrouter/utils.h"
+
+#include <cerrno>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+using mysqlrouter::get_json_member;
+using mysqlrouter::get_json_string;
+
+namespace metadata_cache {
+
+namespace {
+
+const char *mode_name(ServerMode mode) {
+  switch (mode) {
+    case ServerMode::ReadWrite: return "ReadWrite";
+    case ServerMode::ReadOnly: return "ReadOnly";
+    default: return "Unavailable";
+  }
+}
+
+ServerMode mode_from_name(const std::string &name) {
+  if (name == "ReadWrite") return ServerMode::ReadWrite;
+  if (name == "ReadOnly") return ServerMode::ReadOnly;
+  if (name == "Unavailable") return ServerMode::Unavailable;
+  throw std::runtime_error("unknown server mode '" + name + "'");
+}
+
+unsigned int get_uint(const rapidjson::Value &object, const char *name) {
+  const auto &value = get_json_member(object, name);
+  if (!value.IsUint())
+    throw std::runtime_error(std::string("'") + name + "' is not an unsigned integer");
+  return value.GetUint();
+}
+
+}  // namespace
+
+void save_topology_cache_file(const std::string &path, const std::string &cluster_name,
+                              const std::map<std::string, ManagedReplicaSet> &replicasets) {
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+  writer.StartObject();
+  writer.Key("version");
+  writer.Uint(kTopologyCacheFileVersion);
+  writer.Key("cluster");
+  writer.String(cluster_name.c_str());
+  writer.Key("replicasets");
+  writer.StartArray();
+  for (const auto &rs : replicasets) {
+    writer.StartObject();
+    writer.Key("name");
+    writer.String(rs.first.c_str());
+    writer.Key("single_primary_mode");
+    writer.Bool(rs.second.single_primary_mode);
+    writer.Key("members");
+    writer.StartArray();
+    for (const auto &member : rs.second.members) {
+      writer.StartObject();
+      writer.Key("mysql_server_uuid");
+      writer.String(member.mysql_server_uuid.c_str());
+      writer.Key("role");
+      writer.String(member.role.c_str());
+      writer.Key("mode");
+      writer.String(mode_name(member.mode));
+      writer.Key("weight");
+      writer.Double(member.weight);
+      writer.Key("version_token");
+      writer.Uint(member.version_token);
+      writer.Key("location");
+      writer.String(member.location.c_str());
+      writer.Key("host");
+      writer.String(member.host.c_str());
+      writer.Key("port");
+      writer.Uint(member.port);
+      writer.Key("xport");
+      writer.Uint(member.xport);
+      writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+
+  mysqlrouter::write_file_atomically(path, std::string(buffer.GetString(), buffer.GetSize()));
+}
+
+std::map<std::string, ManagedReplicaSet> load_topology_cache_file(
+    const std::string &path, const std::string &cluster_name) {
+  std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+  if (file.fail())
+    throw std::runtime_error("Could not open file '" + path + "': " +
+                             mysql_harness::get_strerror(errno));
+  std::stringstream content;
+  content << file.rdbuf();
+
+  rapidjson::Document doc;
+  if (doc.Parse(content.str().c_str()).HasParseError() || !doc.IsObject())
+    throw std::runtime_error("'" + path + "' is not a valid topology cache file");
+
+  std::map<std::string, ManagedReplicaSet> result;
+  try {
+    const unsigned int version = get_uint(doc, "version");
+    if (version != kTopologyCacheFileVersion)
+      throw std::runtime_error("unsupported version " + std::to_string(version));
+    const std::string cluster = get_json_string(doc, "cluster");
+    if (cluster != cluster_name)
+      throw std::runtime_error("written for cluster '" + cluster + "'");
+
+    const auto &replicasets = get_json_member(doc, "replicasets");
+    if (!replicasets.IsArray())
+      throw std::runtime_error("'replicasets' is not an array");
+    for (const auto &rs : replicasets.GetArray()) {
+      ManagedReplicaSet replicaset;
+      replicaset.name = get_json_string(rs, "name");
+      const auto &single_primary_mode = get_json_member(rs, "single_primary_mode");
+      if (!single_primary_mode.IsBool())
+        throw std::runtime_error("'single_primary_mode' is not a boolean");
+      replicaset.single_primary_mode = single_primary_mode.GetBool();
+
+      const auto &members = get_json_member(rs, "members");
+      if (!members.IsArray())
+        throw std::runtime_error("'members' is not an array");
+      for (const auto &m : members.GetArray()) {
+        ManagedInstance member;
+        member.replicaset_name = replicaset.name;
+        member.mysql_server_uuid = get_json_string(m, "mysql_server_uuid");
+        member.role = get_json_string(m, "role");
+        member.mode = mode_from_name(get_json_string(m, "mode"));
+        const auto &weight = get_json_member(m, "weight");
+        if (!weight.IsNumber())
+          throw std::runtime_error("'weight' is not a number");
+        member.weight = static_cast<float>(weight.GetDouble());
+        member.version_token = get_uint(m, "version_token");
+        member.location = get_json_string(m, "location");
+        member.host = get_json_string(m, "host");
+        member.port = get_uint(m, "port");
+        member.xport = get_uint(m, "xport");
+        replicaset.members.push_back(member);
+      }
+      result.emplace(replicaset.name, std::move(replicaset));
+    }
+  } catch (const std::runtime_error &e) {
+    throw std::runtime_error("Invalid topology cache file '" + path + "': " + e.what());
+  }
+
+  return result;
+}
+
+}  // namespace metadata_cache
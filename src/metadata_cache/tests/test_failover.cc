@@ -36,6 +36,8 @@
 
 #include "gmock/gmock.h"
 
+#include <future>
+
 using namespace metadata_cache;
 
 class FailoverTest : public ::testing::Test {
@@ -251,6 +253,55 @@ TEST_F(FailoverTest, primary_failover) {
   EXPECT_EQ(ServerMode::ReadOnly, instances[2].mode);
 }
 
+TEST_F(FailoverTest, wait_primary_failover_wakes_up_on_refresh) {
+  expect_metadata_1();
+  expect_group_members_1();
+  init_cache();
+
+  cache->mark_instance_reachability("uuid-server1",
+                                    metadata_cache::InstanceStatus::Unreachable);
+
+  // a connection waits for the new primary ...
+  auto waiter = std::async(std::launch::async, [this]() {
+    return cache->wait_primary_failover("default", 10);
+  });
+  EXPECT_EQ(std::future_status::timeout,
+            waiter.wait_for(std::chrono::milliseconds(100)));
+
+  // ... and resumes as soon as the refresh finds it, not when the timeout or
+  // the next check is due
+  expect_metadata_1();
+  expect_group_members_1_primary_fail(nullptr, "uuid-server2");
+  cache->refresh();
+
+  ASSERT_EQ(std::future_status::ready,
+            waiter.wait_for(std::chrono::milliseconds(500)));
+  EXPECT_TRUE(waiter.get());
+
+  ASSERT_FALSE(session->print_expected());
+}
+
+TEST_F(FailoverTest, wait_primary_failover_wakes_up_on_stop) {
+  expect_metadata_1();
+  expect_group_members_1();
+  init_cache();
+
+  cache->mark_instance_reachability("uuid-server1",
+                                    metadata_cache::InstanceStatus::Unreachable);
+
+  auto waiter = std::async(std::launch::async, [this]() {
+    return cache->wait_primary_failover("default", 10);
+  });
+  EXPECT_EQ(std::future_status::timeout,
+            waiter.wait_for(std::chrono::milliseconds(100)));
+
+  cache->stop();
+
+  ASSERT_EQ(std::future_status::ready,
+            waiter.wait_for(std::chrono::milliseconds(500)));
+  EXPECT_FALSE(waiter.get());
+}
+
 int main(int argc, char *argv[]) {
   init_test_logger();
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,352 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/**
+ * Test the listener of the group replication notices.
+ */
+
+#include "gr_notifications_listener.h"
+#include "test/helpers.h"
+
+#include "mysqlrouter/xprotocol.h"
+#include "mysqlx.pb.h"
+#include "mysqlx_notice.pb.h"
+#include "mysqlx_session.pb.h"
+#include "mysqlx_sql.pb.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+#ifndef _WIN32
+#  include <arpa/inet.h>
+#  include <netinet/in.h>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#include "gmock/gmock.h"
+
+namespace {
+
+std::string x_message(uint8_t type, const google::protobuf::Message &msg) {
+  std::string payload = msg.SerializeAsString();
+  const uint32_t size = static_cast<uint32_t>(payload.size() + 1);
+  std::string buffer;
+  for (int i = 0; i < 4; ++i)
+    buffer.push_back(static_cast<char>((size >> (8 * i)) & 0xff));
+  buffer.push_back(static_cast<char>(type));
+  return buffer + payload;
+}
+
+std::string gr_notice(Mysqlx::Notice::GroupReplicationStateChanged::Type type) {
+  Mysqlx::Notice::GroupReplicationStateChanged change;
+  change.set_type(type);
+  change.set_view_id("15432:7");
+
+  Mysqlx::Notice::Frame frame;
+  frame.set_type(Mysqlx::Notice::Frame::GROUP_REPLICATION_STATE_CHANGED);
+  frame.set_scope(Mysqlx::Notice::Frame::GLOBAL);
+  frame.set_payload(change.SerializeAsString());
+  return x_message(Mysqlx::ServerMessages::NOTICE, frame);
+}
+
+std::string session_state_notice() {
+  Mysqlx::Notice::SessionStateChanged change;
+  change.set_param(Mysqlx::Notice::SessionStateChanged::CLIENT_ID_ASSIGNED);
+
+  Mysqlx::Notice::Frame frame;
+  frame.set_type(Mysqlx::Notice::Frame::SESSION_STATE_CHANGED);
+  frame.set_scope(Mysqlx::Notice::Frame::LOCAL);
+  frame.set_payload(change.SerializeAsString());
+  return x_message(Mysqlx::ServerMessages::NOTICE, frame);
+}
+
+}  // namespace
+
+TEST(GRNotificationListenerTest, consume_gr_notices) {
+  std::string stream =
+      session_state_notice() +
+      x_message(Mysqlx::ServerMessages::SQL_STMT_EXECUTE_OK, Mysqlx::Sql::StmtExecuteOk()) +
+      gr_notice(Mysqlx::Notice::GroupReplicationStateChanged::MEMBERSHIP_VIEW_CHANGE) +
+      gr_notice(Mysqlx::Notice::GroupReplicationStateChanged::MEMBER_ROLE_CHANGE);
+  const std::string last = gr_notice(
+      Mysqlx::Notice::GroupReplicationStateChanged::MEMBER_STATE_CHANGE);
+
+  // last message arrives in two parts
+  std::string buffer = stream + last.substr(0, 7);
+  EXPECT_EQ(2u, GRNotificationListener::consume_gr_notices(buffer));
+  EXPECT_EQ(last.substr(0, 7), buffer);
+
+  buffer += last.substr(7);
+  EXPECT_EQ(1u, GRNotificationListener::consume_gr_notices(buffer));
+  EXPECT_TRUE(buffer.empty());
+
+  // nothing complete yet
+  buffer = last.substr(0, 3);
+  EXPECT_EQ(0u, GRNotificationListener::consume_gr_notices(buffer));
+  EXPECT_EQ(3u, buffer.size());
+}
+
+TEST(GRNotificationListenerTest, consume_gr_notices_invalid) {
+  // size 0 is never valid, the type byte counts
+  std::string buffer("\0\0\0\0\x0b", 5);
+  EXPECT_THROW(GRNotificationListener::consume_gr_notices(buffer),
+               std::runtime_error);
+
+  // notice that isn't a Frame
+  buffer = std::string("\x03\0\0\0\x0b\xff\xff", 7);
+  EXPECT_THROW(GRNotificationListener::consume_gr_notices(buffer),
+               std::runtime_error);
+
+  Mysqlx::Error error;
+  error.set_severity(Mysqlx::Error::FATAL);
+  error.set_code(1810);
+  error.set_sql_state("HY000");
+  error.set_msg("IO Read error");
+  buffer = x_message(Mysqlx::ServerMessages::ERROR, error);
+  EXPECT_THROW(GRNotificationListener::consume_gr_notices(buffer),
+               std::runtime_error);
+}
+
+TEST(GRNotificationListenerTest, mysql41_auth_data) {
+  EXPECT_EQ(std::string("\0root\0", 6),
+            GRNotificationListener::mysql41_auth_data("root", "", "abcdefghijklmnopqrst"));
+
+  // the server may send the nonce \0 terminated
+  for (const std::string &salt : {std::string("abcdefghijklmnopqrst"),
+                                 std::string("abcdefghijklmnopqrst\0", 21)}) {
+    EXPECT_EQ(std::string("\0root\0*8817C50FA779DAEF010EE7577825B0847DF9842E", 47),
+              GRNotificationListener::mysql41_auth_data("root", "secret", salt));
+  }
+}
+
+// the notices sessions don't support TLS, they must not be opened when
+// the metadata cache requires it
+TEST(GRNotificationListenerTest, create_refuses_tls_ssl_modes) {
+  for (const char *ssl_mode : {"REQUIRED", "VERIFY_CA", "VERIFY_IDENTITY",
+                               "verify_identity"}) {
+    EXPECT_EQ(nullptr, GRNotificationListener::create(
+                           ssl_mode, "root", "secret", std::chrono::seconds(1),
+                           std::chrono::seconds(1)))
+        << ssl_mode;
+  }
+
+  for (const char *ssl_mode : {"DISABLED", "PREFERRED", ""}) {
+    EXPECT_NE(nullptr, GRNotificationListener::create(
+                           ssl_mode, "root", "secret", std::chrono::seconds(1),
+                           std::chrono::seconds(1)))
+        << ssl_mode;
+  }
+}
+
+#ifndef _WIN32
+namespace {
+
+bool read_x_message(int fd, uint8_t &type, std::string &payload) {
+  char header[5];
+  size_t got = 0;
+  while (got < sizeof(header)) {
+    ssize_t res = ::read(fd, header + got, sizeof(header) - got);
+    if (res <= 0) return false;
+    got += static_cast<size_t>(res);
+  }
+  uint32_t size = 0;
+  for (int i = 3; i >= 0; --i)
+    size = (size << 8) | static_cast<uint8_t>(header[i]);
+  type = static_cast<uint8_t>(header[4]);
+
+  payload.resize(size - 1);
+  got = 0;
+  while (got < payload.size()) {
+    ssize_t res = ::read(fd, &payload[got], payload.size() - got);
+    if (res <= 0) return false;
+    got += static_cast<size_t>(res);
+  }
+  return true;
+}
+
+void write_x_message(int fd, const std::string &msg) {
+  ASSERT_EQ(static_cast<ssize_t>(msg.size()), ::write(fd, msg.data(), msg.size()));
+}
+
+}  // namespace
+
+/**
+ * @test a member that accepts the session and sends a notice afterwards
+ *       triggers the callback
+ */
+TEST(GRNotificationListenerTest, notifies_on_gr_notice) {
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listen_fd, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  ASSERT_EQ(0, ::bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)));
+  ASSERT_EQ(0, ::listen(listen_fd, 1));
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(0, ::getsockname(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), &addr_len));
+
+  std::promise<std::string> auth_data;
+  std::promise<std::string> enabled_notices;
+  std::promise<void> notified;
+  std::promise<void> done;
+  std::shared_future<void> done_future = done.get_future().share();
+
+  // plays the X plugin of a member
+  std::thread server([&]() {
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) return;
+
+    uint8_t type;
+    std::string payload;
+    if (!read_x_message(fd, type, payload) ||
+        type != Mysqlx::ClientMessages::SESS_AUTHENTICATE_START) {
+      ::close(fd);
+      return;
+    }
+    Mysqlx::Session::AuthenticateContinue challenge;
+    challenge.set_auth_data("abcdefghijklmnopqrst");
+    write_x_message(fd, x_message(Mysqlx::ServerMessages::SESS_AUTHENTICATE_CONTINUE, challenge));
+
+    Mysqlx::Session::AuthenticateContinue response;
+    if (read_x_message(fd, type, payload) && response.ParseFromString(payload))
+      auth_data.set_value(response.auth_data());
+    write_x_message(fd, session_state_notice());
+    write_x_message(fd, x_message(Mysqlx::ServerMessages::SESS_AUTHENTICATE_OK,
+                                  Mysqlx::Session::AuthenticateOk()));
+
+    Mysqlx::Sql::StmtExecute stmt;
+    if (read_x_message(fd, type, payload) && stmt.ParseFromString(payload))
+      enabled_notices.set_value(stmt.namespace_() + "." + stmt.stmt() + " " +
+                                stmt.args(0).obj().fld(0).key());
+    write_x_message(fd, x_message(Mysqlx::ServerMessages::SQL_STMT_EXECUTE_OK,
+                                  Mysqlx::Sql::StmtExecuteOk()));
+
+    write_x_message(fd, gr_notice(
+        Mysqlx::Notice::GroupReplicationStateChanged::MEMBER_ROLE_CHANGE));
+
+    done_future.wait();
+    ::close(fd);
+  });
+  std::shared_ptr<void> exit_guard(nullptr, [&](void *) {
+    done.set_value();
+    ::shutdown(listen_fd, SHUT_RDWR);  // in case accept() still waits
+    server.join();
+    ::close(listen_fd);
+  });
+
+  metadata_cache::ManagedInstance member;
+  member.host = "127.0.0.1";
+  member.port = 3306;
+  member.xport = ntohs(addr.sin_port);
+
+  {
+    GRNotificationListener listener("root", "secret", std::chrono::seconds(1),
+                                    std::chrono::seconds(1));
+    listener.set_members({member});
+    bool called = false;
+    listener.start([&]() {
+      if (!called) notified.set_value();
+      called = true;
+    });
+
+    auto auth_future = auth_data.get_future();
+    ASSERT_EQ(std::future_status::ready, auth_future.wait_for(std::chrono::seconds(5)));
+    EXPECT_EQ(std::string("\0root\0*8817C50FA779DAEF010EE7577825B0847DF9842E", 47),
+              auth_future.get());
+
+    auto notices_future = enabled_notices.get_future();
+    ASSERT_EQ(std::future_status::ready, notices_future.wait_for(std::chrono::seconds(5)));
+    EXPECT_EQ("mysqlx.enable_notices notice", notices_future.get());
+
+    EXPECT_EQ(std::future_status::ready,
+              notified.get_future().wait_for(std::chrono::seconds(5)));
+
+    listener.stop();
+  }
+}
+
+/**
+ * @test stop() doesn't wait for the read timeout of a member that accepted
+ *       the connection but doesn't answer
+ */
+TEST(GRNotificationListenerTest, stop_while_member_does_not_answer) {
+  int listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(listen_fd, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  ASSERT_EQ(0, ::bind(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)));
+  ASSERT_EQ(0, ::listen(listen_fd, 1));
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(0, ::getsockname(listen_fd, reinterpret_cast<struct sockaddr *>(&addr), &addr_len));
+
+  std::promise<void> accepted;
+  std::promise<void> done;
+  std::shared_future<void> done_future = done.get_future().share();
+
+  // accepts the session and never answers
+  std::thread server([&]() {
+    int fd = ::accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) return;
+    accepted.set_value();
+    done_future.wait();
+    ::close(fd);
+  });
+  std::shared_ptr<void> exit_guard(nullptr, [&](void *) {
+    done.set_value();
+    ::shutdown(listen_fd, SHUT_RDWR);  // in case accept() still waits
+    server.join();
+    ::close(listen_fd);
+  });
+
+  metadata_cache::ManagedInstance member;
+  member.host = "127.0.0.1";
+  member.port = 3306;
+  member.xport = ntohs(addr.sin_port);
+
+  GRNotificationListener listener("root", "secret", std::chrono::seconds(30),
+                                  std::chrono::seconds(30));
+  listener.set_members({member});
+  listener.start([]() {});
+
+  ASSERT_EQ(std::future_status::ready,
+            accepted.get_future().wait_for(std::chrono::seconds(5)));
+
+  auto start = std::chrono::steady_clock::now();
+  listener.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+#endif
+
+int main(int argc, char *argv[]) {
+  init_test_logger();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
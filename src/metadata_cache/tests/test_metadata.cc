@@ -36,7 +36,9 @@
 #include <map>
 #include <cmath>
 #include <algorithm>
+#include <future>
 #include <set>
+#include <thread>
 
 //ignore GMock warnings
 #ifdef __clang__
@@ -1621,6 +1623,138 @@ TEST_F(MetadataTest, UpdateReplicasetStatus_SimpleSunnyDayScenario) {
 }
 
 
+/**
+ * @test
+ * Verify `ClusterMetadata::update_replicaset_status()` doesn't wait for a
+ * member that is slow to answer before asking the next one.
+ *
+ *     Scenario details:
+ *     iteration 1 (instance-1): query_primary_member FAILS
+ *     iteration 2 (instance-2): connect HANGS for a while (and then fails)
+ *     iteration 3 (instance-3): query_primary_member OK, query_status OK
+ */
+TEST_F(MetadataTest, UpdateReplicasetStatus_SlowMemberDoesNotBlock) {
+
+  connect_to_first_metadata_server();
+
+  unsigned session = 0;
+
+  // 1st query_primary_member should go to existing connection (shared with metadata server) -> make the query fail
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(1)
+    .WillOnce(Invoke(query_primary_member_fail(session)));
+
+  // connecting to instance-2 takes longer than instance-3 needs to answer
+  std::promise<void> slow_connect_done;
+  std::future<void> slow_connect_finished = slow_connect_done.get_future();
+  EXPECT_CALL(session_factory.get(++session), flag_fail(_, 3320)).Times(1)
+    .WillOnce(InvokeWithoutArgs([&slow_connect_done]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+      slow_connect_done.set_value();
+    }));
+
+  // meanwhile, instance-3 is asked too
+  enable_connection(++session, 3330);
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(1)
+    .WillOnce(Invoke(query_primary_member_ok(session)));
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_status), _)).Times(1)
+    .WillOnce(Invoke(query_status_ok(session)));
+
+  ManagedReplicaSet replicaset = typical_replicaset;
+  auto start = std::chrono::steady_clock::now();
+  metadata.update_replicaset_status("replicaset-1", replicaset);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+
+  EXPECT_EQ(3u, replicaset.members.size());
+  EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-1", "", ServerMode::ReadWrite, 0, 0, "", "localhost", 3310, 33100}, replicaset.members.at(0)));
+  EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-2", "", ServerMode::ReadOnly,  0, 0, "", "localhost", 3320, 33200}, replicaset.members.at(1)));
+  EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-3", "", ServerMode::ReadOnly,  0, 0, "", "localhost", 3330, 33300}, replicaset.members.at(2)));
+
+  EXPECT_EQ(3, session_factory.create_cnt());          // +2 from new connections to localhost:3320 and :3330
+
+  // the abandoned connect to instance-2 still uses the session, it is
+  // joined by the next update or the destructor
+  EXPECT_EQ(std::future_status::timeout, slow_connect_finished.wait_for(std::chrono::seconds(0)));
+  metadata.join_probe_threads(false);
+  EXPECT_EQ(std::future_status::ready, slow_connect_finished.wait_for(std::chrono::seconds(0)));
+}
+
+/**
+ * @test
+ * Verify that stop() makes update_replicaset_status() give up waiting for
+ * members that don't answer.
+ *
+ *     Scenario details:
+ *     instance-1 query FAILS, connecting to instance-2 HANGS
+ *     stop() was called: the update throws without waiting for the connect
+ */
+TEST_F(MetadataTest, UpdateReplicasetStatus_StopAbortsWait) {
+
+  connect_to_first_metadata_server();
+
+  unsigned session = 0;
+
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(1)
+    .WillOnce(Invoke(query_primary_member_fail(session)));
+
+  EXPECT_CALL(session_factory.get(++session), flag_fail(_, 3320)).Times(1)
+    .WillOnce(InvokeWithoutArgs([]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    }));
+
+  // the update gives up before instance-3 is asked
+  EXPECT_CALL(session_factory.get(++session), flag_fail(_, 3330)).Times(0);
+
+  metadata.stop();
+
+  ManagedReplicaSet replicaset = typical_replicaset;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_THROW(metadata.update_replicaset_status("replicaset-1", replicaset),
+               metadata_cache::metadata_error);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(1000));
+
+  metadata.join_probe_threads(false);
+}
+
+/**
+ * @test
+ * Verify that sessions are kept between refreshes and only failed ones are
+ * re-established.
+ *
+ *     Scenario details:
+ *     connect() to the metadata server twice: connects once
+ *     refresh 1: instance-1 query FAILS, instance-2 CAN'T CONNECT, instance-3 OK
+ *     refresh 2: instance-1 query FAILS, instance-3 OK through the kept session,
+ *                instance-2 is backed off and not asked
+ */
+TEST_F(MetadataTest, UpdateReplicasetStatus_ReusesSessions) {
+
+  connect_to_first_metadata_server();
+  EXPECT_TRUE(metadata.connect(ManagedInstance{"replicaset-1", "instance-1", "", ServerMode::ReadWrite, 0, 0, "", "localhost", 3310, 33100}));
+  EXPECT_EQ(1, session_factory.create_cnt());
+
+  unsigned session = 0;
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(2)
+    .WillRepeatedly(Invoke(query_primary_member_fail(session)));
+
+  EXPECT_CALL(session_factory.get(++session), flag_fail(_, 3320)).Times(1);
+
+  enable_connection(++session, 3330);
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(2)
+    .WillRepeatedly(Invoke(query_primary_member_ok(session)));
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_status), _)).Times(2)
+    .WillRepeatedly(Invoke(query_status_ok(session)));
+
+  ManagedReplicaSet replicaset = typical_replicaset;
+  metadata.update_replicaset_status("replicaset-1", replicaset);
+  EXPECT_EQ(3u, replicaset.members.size());
+  EXPECT_EQ(3, session_factory.create_cnt());
+
+  replicaset = typical_replicaset;
+  metadata.update_replicaset_status("replicaset-1", replicaset);
+  EXPECT_EQ(3u, replicaset.members.size());
+  EXPECT_EQ(3, session_factory.create_cnt());          // no new connections
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -1667,6 +1801,65 @@ TEST_F(MetadataTest, FetchInstances_1Replicaset_ok) {
   EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-3", "", ServerMode::ReadOnly, 0, 0, "", "localhost", 3330, 33300}, rs.at("replicaset-1").members.at(2)));
 }
 
+/**
+ * @test
+ * Verify that sessions to members that left the cluster are dropped.
+ *
+ *     Scenario details:
+ *     fetch 1: instance-1 query FAILS, instance-2 OK (session is kept)
+ *     fetch 2: instance-2 left the cluster, instance-1 OK
+ *     fetch 3: instance-2 is back, instance-1 query FAILS, instance-2 OK
+ *              through a new session
+ */
+TEST_F(MetadataTest, FetchInstances_DropsSessionsOfLeftMembers) {
+
+  connect_to_first_metadata_server();
+
+  unsigned session = 0;
+
+  auto resultset_metadata = [this](bool with_instance_2) {
+    return [this, with_instance_2](const std::string&, const MySQLSession::RowProcessor& processor) {
+      if (with_instance_2) {
+        session_factory.get(0).query_impl(processor, {
+          {"replicaset-1", "instance-1", "HA", NULL, NULL, "blabla", "localhost:3310", NULL},
+          {"replicaset-1", "instance-2", "HA", NULL, NULL, "blabla", "localhost:3320", NULL},
+        });
+      } else {
+        session_factory.get(0).query_impl(processor, {
+          {"replicaset-1", "instance-1", "HA", NULL, NULL, "blabla", "localhost:3310", NULL},
+        });
+      }
+    };
+  };
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_metadata), _)).Times(3)
+    .WillOnce(Invoke(resultset_metadata(true)))
+    .WillOnce(Invoke(resultset_metadata(false)))
+    .WillOnce(Invoke(resultset_metadata(true)));
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(3)
+    .WillOnce(Invoke(query_primary_member_fail(session)))
+    .WillOnce(Invoke(query_primary_member_ok(session)))
+    .WillOnce(Invoke(query_primary_member_fail(session)));
+  EXPECT_CALL(session_factory.get(session), query(StartsWith(query_status), _)).Times(1)
+    .WillOnce(Invoke(query_status_ok(session)));
+
+  for (int i = 0; i < 2; ++i) {
+    enable_connection(++session, 3320);
+    EXPECT_CALL(session_factory.get(session), query(StartsWith(query_primary_member), _)).Times(1)
+      .WillOnce(Invoke(query_primary_member_ok(session)));
+    EXPECT_CALL(session_factory.get(session), query(StartsWith(query_status), _)).Times(1)
+      .WillOnce(Invoke(query_status_ok(session)));
+  }
+
+  EXPECT_EQ(2u, metadata.fetch_instances("replicaset-1").at("replicaset-1").members.size());
+  EXPECT_EQ(2, session_factory.create_cnt());
+
+  metadata.fetch_instances("replicaset-1");
+  EXPECT_EQ(2, session_factory.create_cnt());
+
+  EXPECT_EQ(2u, metadata.fetch_instances("replicaset-1").at("replicaset-1").members.size());
+  EXPECT_EQ(3, session_factory.create_cnt());          // the session to instance-2 was dropped
+}
+
 /**
  * @test
  * Verify `ClusterMetadata::fetch_instances()` will handle correctly when
@@ -1702,6 +1895,104 @@ TEST_F(MetadataTest, FetchInstances_1Replicaset_fail) {
   EXPECT_EQ(0u, rs.at("replicaset-1").members.size());
 }
 
+/**
+ * @test
+ * Verify `ClusterMetadata::topology_unchanged()` only reports "no change" when
+ * the fingerprint matches the one taken right before the last successful
+ * `fetch_instances()`, and forces a full fetch every kMaxSkippedFetches.
+ */
+TEST_F(MetadataTest, TopologyUnchanged) {
+
+  connect_to_first_metadata_server();
+
+  // nothing fetched yet, nothing to compare with
+  EXPECT_FALSE(metadata.topology_unchanged("cluster-1"));
+
+  std::string fingerprint_checksum = "3-1234567";
+  auto resultset_fingerprint = [this, &fingerprint_checksum](const std::string&, const MySQLSession::RowProcessor& processor) {
+    session_factory.get(0).query_impl(processor, {
+      {fingerprint_checksum.c_str(), "3-7654321", "instance-1", "1"},
+    });
+  };
+  auto resultset_metadata = [this](const std::string&, const MySQLSession::RowProcessor& processor) {
+    session_factory.get(0).query_impl(processor, {
+      {"replicaset-1", "instance-1", "HA", NULL, NULL, "blabla", "localhost:3310", NULL},
+      {"replicaset-1", "instance-2", "HA", NULL, NULL, "blabla", "localhost:3320", NULL},
+      {"replicaset-1", "instance-3", "HA", NULL, NULL, "blabla", "localhost:3330", NULL},
+    });
+  };
+  EXPECT_CALL(session_factory.get(0), query(StartsWith("SELECT (SELECT CONCAT(COUNT(*)"), _))
+    .WillRepeatedly(Invoke(resultset_fingerprint));
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_metadata), _))
+    .WillRepeatedly(Invoke(resultset_metadata));
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_primary_member), _))
+    .WillRepeatedly(Invoke(query_primary_member_ok(0)));
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_status), _))
+    .WillRepeatedly(Invoke(query_status_ok(0)));
+
+  // the first fetch wasn't preceded by a fingerprint
+  EXPECT_EQ(1u, metadata.fetch_instances("cluster-1").size());
+  EXPECT_FALSE(metadata.topology_unchanged("cluster-1"));
+
+  // this one was
+  EXPECT_EQ(1u, metadata.fetch_instances("cluster-1").size());
+  for (unsigned i = 0; i < ClusterMetadata::kMaxSkippedFetches; ++i)
+    EXPECT_TRUE(metadata.topology_unchanged("cluster-1"));
+
+  // too many fetches skipped in a row
+  EXPECT_FALSE(metadata.topology_unchanged("cluster-1"));
+  EXPECT_EQ(1u, metadata.fetch_instances("cluster-1").size());
+  EXPECT_TRUE(metadata.topology_unchanged("cluster-1"));
+
+  // the topology changed
+  fingerprint_checksum = "2-1234567";
+  EXPECT_FALSE(metadata.topology_unchanged("cluster-1"));
+  EXPECT_EQ(1u, metadata.fetch_instances("cluster-1").size());
+  EXPECT_TRUE(metadata.topology_unchanged("cluster-1"));
+}
+
+/**
+ * @test
+ * Verify `ClusterMetadata::fetch_member_status()` asks GR about the members
+ * found by the last `fetch_instances()` without querying the metadata again.
+ */
+TEST_F(MetadataTest, FetchMemberStatus) {
+
+  connect_to_first_metadata_server();
+
+  // nothing fetched yet, no members to ask
+  EXPECT_THROW(metadata.fetch_member_status("replicaset-1"), metadata_cache::metadata_error);
+
+  auto resultset_metadata = [this](const std::string&, const MySQLSession::RowProcessor& processor) {
+    session_factory.get(0).query_impl(processor, {
+      {"replicaset-1", "instance-1", "HA", NULL, NULL, "blabla", "localhost:3310", NULL},
+      {"replicaset-1", "instance-2", "HA", NULL, NULL, "blabla", "localhost:3320", NULL},
+      {"replicaset-1", "instance-3", "HA", NULL, NULL, "blabla", "localhost:3330", NULL},
+    });
+  };
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_metadata), _)).Times(1)
+    .WillOnce(Invoke(resultset_metadata));
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_primary_member), _)).Times(3)
+    .WillRepeatedly(Invoke(query_primary_member_ok(0)));
+  EXPECT_CALL(session_factory.get(0), query(StartsWith(query_status), _)).Times(3)
+    .WillRepeatedly(Invoke(query_status_ok(0)));
+
+  EXPECT_EQ(3u, metadata.fetch_instances("replicaset-1").at("replicaset-1").members.size());
+
+  // GR is asked through the metadata server connection, the metadata isn't
+  for (int i = 0; i < 2; ++i) {
+    ClusterMetadata::ReplicaSetsByName rs = metadata.fetch_member_status("replicaset-1");
+    EXPECT_EQ(1u, rs.size());
+    EXPECT_EQ(3u, rs.at("replicaset-1").members.size());
+    EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-1", "", ServerMode::ReadWrite, 0, 0, "", "localhost", 3310, 33100}, rs.at("replicaset-1").members.at(0)));
+    EXPECT_TRUE(cmp_mi_FI(ManagedInstance{"replicaset-1", "instance-2", "", ServerMode::ReadOnly, 0, 0, "", "localhost", 3320, 33200}, rs.at("replicaset-1").members.at(1)));
+  }
+  EXPECT_EQ(1, session_factory.create_cnt());
+
+  // the members of another cluster are unknown
+  EXPECT_THROW(metadata.fetch_member_status("replicaset-2"), metadata_cache::metadata_error);
+}
+
 int main(int argc, char *argv[]) {
   init_test_logger();
   ::testing::InitGoogleTest(&argc, argv);
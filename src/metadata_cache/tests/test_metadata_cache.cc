@@ -35,9 +35,16 @@
 #include "metadata_factory.h"
 #include "mock_metadata.h"
 #include "mysql_session_replayer.h"
+#include "mysql/harness/filesystem.h"
 #include "tcp_address.h"
 #include "test/helpers.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
 using metadata_cache::ManagedInstance;
 using mysql_harness::TCPAddress;
 
@@ -85,6 +92,143 @@ TEST_F(MetadataCacheTest, InvalidReplicasetTest) {
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * MockNG that counts (and signals) the refreshes of the metadata cache.
+ */
+class RefreshCountingMetadata : public MockNG {
+public:
+  using MockNG::MockNG;
+
+  ReplicaSetsByName fetch_instances(const std::string &farm_name) override {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      ++fetches_;
+      fetch_times_.push_back(std::chrono::steady_clock::now());
+    }
+    cond_.notify_all();
+    return MockNG::fetch_instances(farm_name);
+  }
+
+  ReplicaSetsByName fetch_member_status(const std::string &farm_name) override {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      ++status_checks_;
+    }
+    cond_.notify_all();
+    if (fail_status_checks)
+      throw metadata_cache::metadata_error("member status check failed");
+    return MockNG::fetch_instances(farm_name);
+  }
+
+  unsigned fetches() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return fetches_;
+  }
+
+  // when the refreshes started, in order
+  std::vector<std::chrono::steady_clock::time_point> fetch_times() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return fetch_times_;
+  }
+
+  // returns false if there weren't `count` member status checks in `timeout`
+  bool wait_for_status_checks(unsigned count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    return cond_.wait_for(lock, timeout, [this, count] { return status_checks_ >= count; });
+  }
+
+  std::atomic<bool> fail_status_checks{false};
+
+  // returns false if there weren't `count` refreshes in `timeout`
+  bool wait_for_fetches(unsigned count, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    return cond_.wait_for(lock, timeout, [this, count] { return fetches_ >= count; });
+  }
+
+private:
+  std::mutex mtx_;
+  std::condition_variable cond_;
+  unsigned fetches_{0};
+  unsigned status_checks_{0};
+  std::vector<std::chrono::steady_clock::time_point> fetch_times_;
+};
+
+class MetadataCacheRefreshTest : public ::testing::Test {
+public:
+  std::shared_ptr<RefreshCountingMetadata> metadata{
+      std::make_shared<RefreshCountingMetadata>("admin", "admin", 1, 1, 1, std::chrono::seconds(10))};
+  MetadataCache cache{{TCPAddress("localhost", 32275)}, metadata,
+                      std::chrono::seconds(10), mysqlrouter::SSLOptions(), "replicaset-1",
+                      mysql_harness::kDefaultStackSizeInKiloBytes, nullptr,
+                      std::chrono::milliseconds(50)};
+
+  void TearDown() override {
+    cache.stop();
+  }
+};
+
+/**
+ * Test that request_refresh() doesn't wait for the TTL.
+ */
+TEST_F(MetadataCacheRefreshTest, request_refresh) {
+  // one refresh by the constructor, one when the thread starts
+  cache.start();
+  ASSERT_TRUE(metadata->wait_for_fetches(2, std::chrono::seconds(5)));
+
+  cache.request_refresh();
+  EXPECT_TRUE(metadata->wait_for_fetches(3, std::chrono::milliseconds(500)));
+}
+
+/**
+ * Test that an unreachable instance triggers a refresh right away, followed
+ * by refreshes with a growing interval.
+ */
+TEST_F(MetadataCacheRefreshTest, emergency_mode_backoff) {
+  cache.start();
+  ASSERT_TRUE(metadata->wait_for_fetches(2, std::chrono::seconds(5)));
+
+  cache.mark_instance_reachability(metadata->ms1.mysql_server_uuid,
+                                   metadata_cache::InstanceStatus::Unreachable);
+  ASSERT_TRUE(metadata->wait_for_fetches(3, std::chrono::seconds(5)));
+
+  // the topology doesn't change, the emergency mode stays on: the refreshes
+  // follow each other after (at least) 50, 100, 200, 400ms. How much later
+  // depends on the load of the machine, so only the lower bounds are checked.
+  ASSERT_TRUE(metadata->wait_for_fetches(7, std::chrono::seconds(10)));
+  const auto fetch_times = metadata->fetch_times();
+  std::chrono::milliseconds backoff{50};
+  for (size_t i = 3; i < 7; ++i, backoff *= 2) {
+    // a few ms of slack for timer granularity
+    EXPECT_GE(fetch_times[i] - fetch_times[i - 1], backoff - std::chrono::milliseconds(5))
+        << "interval before refresh " << i + 1;
+  }
+}
+
+/**
+ * Test that between two refreshes only the member status is checked, every
+ * gr_status_interval, and that a failed check falls back to a refresh.
+ */
+TEST_F(MetadataCacheRefreshTest, member_status_between_refreshes) {
+  MetadataCache fast_cache{{TCPAddress("localhost", 32275)}, metadata,
+                           std::chrono::seconds(10), mysqlrouter::SSLOptions(), "replicaset-1",
+                           mysql_harness::kDefaultStackSizeInKiloBytes, nullptr,
+                           std::chrono::milliseconds(50), "", std::chrono::milliseconds(20)};
+  std::shared_ptr<void> exit_guard(nullptr, [&](void *) { fast_cache.stop(); });
+
+  // one refresh by each constructor, one when the thread starts
+  fast_cache.start();
+  ASSERT_TRUE(metadata->wait_for_fetches(3, std::chrono::seconds(5)));
+  EXPECT_TRUE(metadata->wait_for_status_checks(5, std::chrono::seconds(5)));
+  EXPECT_EQ(3u, metadata->fetches());
+
+  // a refresh is still made on request
+  fast_cache.request_refresh();
+  EXPECT_TRUE(metadata->wait_for_fetches(4, std::chrono::milliseconds(500)));
+
+  metadata->fail_status_checks = true;
+  EXPECT_TRUE(metadata->wait_for_fetches(5, std::chrono::milliseconds(500)));
+}
+
 class MetadataCacheTest2 : public ::testing::Test {
  public:
   // per-test setup
@@ -179,6 +323,148 @@ TEST_F(MetadataCacheTest2, basic_test) {
   expect_cluster_routable(mc);  // repeated queries should not change anything
 }
 
+TEST_F(MetadataCacheTest2, snapshots) {
+
+  expect_sql_metadata();
+  expect_sql_members();
+  MetadataCache mc(metadata_servers, cmeta, std::chrono::seconds(10), mysqlrouter::SSLOptions(), "cluster-1");
+
+  // members are pre-filtered by mode
+  auto snapshot = mc.replicaset_snapshot("cluster-1");
+  ASSERT_EQ(3U, snapshot->members.size());
+  ASSERT_EQ(1U, snapshot->primaries.size());
+  EXPECT_EQ("uuid-server1", snapshot->primaries[0].mysql_server_uuid);
+  ASSERT_EQ(2U, snapshot->secondaries.size());
+  EXPECT_EQ("uuid-server2", snapshot->secondaries[0].mysql_server_uuid);
+  EXPECT_EQ("uuid-server3", snapshot->secondaries[1].mysql_server_uuid);
+  EXPECT_EQ(3U, snapshot->available.size());
+
+  // lookups share the published snapshot
+  EXPECT_EQ(snapshot, mc.replicaset_snapshot("cluster-1"));
+
+  // a refresh that doesn't change anything keeps the snapshot
+  expect_sql_metadata();
+  expect_sql_members();
+  mc.refresh();
+  EXPECT_EQ(snapshot, mc.replicaset_snapshot("cluster-1"));
+
+  // unknown replicasets are empty
+  EXPECT_TRUE(mc.replicaset_snapshot("cluster-2")->members.empty());
+}
+
+namespace {
+
+ManagedInstance member(const std::string &uuid, metadata_cache::ServerMode mode,
+                       unsigned int port) {
+  ManagedInstance result;
+  result.replicaset_name = "cluster-1";
+  result.mysql_server_uuid = uuid;
+  result.role = "HA";
+  result.mode = mode;
+  result.host = "localhost";
+  result.port = port;
+  return result;
+}
+
+class RecordingListener : public metadata_cache::ReplicasetStateListenerInterface {
+ public:
+  void notify(const metadata_cache::LookupResult&, const bool) noexcept override {
+    ++full_notifications;
+  }
+
+  void notify_changes(const metadata_cache::ReplicasetSnapshot&,
+                      const metadata_cache::ReplicasetSnapshot&,
+                      const metadata_cache::ReplicasetChanges &changes,
+                      const bool md_servers_reachable) noexcept override {
+    this->changes.push_back(changes);
+    reachable.push_back(md_servers_reachable);
+  }
+
+  int full_notifications{0};
+  std::vector<metadata_cache::ReplicasetChanges> changes;
+  std::vector<bool> reachable;
+};
+
+}  // namespace
+
+TEST(ReplicasetChangesTest, diff) {
+  using metadata_cache::ServerMode;
+  const std::vector<ManagedInstance> before{
+    member("uuid-1", ServerMode::ReadWrite, 3000),
+    member("uuid-2", ServerMode::ReadOnly, 3001),
+    member("uuid-3", ServerMode::ReadOnly, 3002),
+  };
+
+  EXPECT_TRUE(metadata_cache::ReplicasetChanges::diff(before, before).empty());
+
+  // uuid-2 got promoted, uuid-3 left and uuid-4 joined
+  const std::vector<ManagedInstance> after{
+    member("uuid-4", ServerMode::ReadOnly, 3003),
+    member("uuid-1", ServerMode::ReadOnly, 3000),
+    member("uuid-2", ServerMode::ReadWrite, 3001),
+  };
+  auto changes = metadata_cache::ReplicasetChanges::diff(before, after);
+  EXPECT_FALSE(changes.empty());
+  ASSERT_EQ(1U, changes.added.size());
+  EXPECT_EQ("uuid-4", changes.added[0].mysql_server_uuid);
+  ASSERT_EQ(1U, changes.removed.size());
+  EXPECT_EQ("uuid-3", changes.removed[0].mysql_server_uuid);
+  ASSERT_EQ(2U, changes.changed.size());
+  EXPECT_EQ("uuid-1", changes.changed[0].before.mysql_server_uuid);
+  EXPECT_EQ(ServerMode::ReadWrite, changes.changed[0].before.mode);
+  EXPECT_EQ(ServerMode::ReadOnly, changes.changed[0].after.mode);
+  EXPECT_EQ("uuid-2", changes.changed[1].after.mysql_server_uuid);
+  EXPECT_EQ(ServerMode::ReadWrite, changes.changed[1].after.mode);
+
+  // everything gone
+  changes = metadata_cache::ReplicasetChanges::diff(before, {});
+  EXPECT_EQ(3U, changes.removed.size());
+  EXPECT_TRUE(changes.added.empty());
+  EXPECT_TRUE(changes.changed.empty());
+}
+
+/**
+ * @test listeners are only told about refreshes that changed their
+ *       replicaset, with the members that changed
+ */
+TEST_F(MetadataCacheTest2, listeners_get_changes) {
+  MySQLSessionReplayer& m = *session;
+
+  expect_sql_metadata();
+  expect_sql_members();
+  MetadataCache mc(metadata_servers, cmeta, std::chrono::seconds(10), mysqlrouter::SSLOptions(), "cluster-1");
+
+  RecordingListener listener;
+  mc.add_listener("cluster-1", &listener);
+
+  // nothing changed
+  expect_sql_metadata();
+  expect_sql_members();
+  mc.refresh();
+  EXPECT_TRUE(listener.changes.empty());
+
+  // metadata unavailable, the routing table gets cleared
+  m.expect_connect("127.0.0.1", 3000, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3001, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3002, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  mc.refresh();
+  ASSERT_EQ(1U, listener.changes.size());
+  EXPECT_FALSE(listener.reachable[0]);
+  EXPECT_EQ(3U, listener.changes[0].removed.size());
+
+  // and back
+  expect_sql_metadata();
+  expect_sql_members();
+  mc.refresh();
+  ASSERT_EQ(2U, listener.changes.size());
+  EXPECT_TRUE(listener.reachable[1]);
+  EXPECT_EQ(3U, listener.changes[1].added.size());
+  EXPECT_TRUE(listener.changes[1].removed.empty());
+
+  EXPECT_EQ(0, listener.full_notifications);
+  mc.remove_listener("cluster-1", &listener);
+}
+
 TEST_F(MetadataCacheTest2, metadata_server_connection_failures) {
 
   // Here we test MC behaviour when metadata servers go down and back up again. ATM (2017.01.10, might be changed later)
@@ -215,6 +501,60 @@ TEST_F(MetadataCacheTest2, metadata_server_connection_failures) {
   expect_cluster_routable(mc); // lookup should see the cluster again
 }
 
+/**
+ * @test the topology is saved after a change and routable right away after a
+ *       restart without metadata servers, until one answers again
+ */
+TEST_F(MetadataCacheTest2, warm_start_from_saved_topology) {
+  MySQLSessionReplayer& m = *session;
+  const std::string tmp_dir = mysql_harness::get_tmp_dir("topology");
+  std::shared_ptr<void> exit_guard(nullptr, [&](void *) {
+    mysql_harness::delete_dir_recursive(tmp_dir);
+  });
+  const std::string path = mysql_harness::Path(tmp_dir).join("topology.json").str();
+
+  // no file yet, the first refresh writes it
+  expect_sql_metadata();
+  expect_sql_members();
+  {
+    MetadataCache mc(metadata_servers, cmeta, std::chrono::seconds(10), mysqlrouter::SSLOptions(),
+                     "cluster-1", mysql_harness::kDefaultStackSizeInKiloBytes, nullptr,
+                     metadata_cache::kDefaultEmergencyRefreshInterval, path);
+    EXPECT_FALSE(mc.topology_stale_);
+    expect_cluster_routable(mc);
+  }
+  ASSERT_TRUE(mysql_harness::Path(path).exists());
+
+  // restart: the constructor doesn't wait for the metadata servers, the
+  // refresh thread asks them
+  MetadataCache mc(metadata_servers, cmeta, std::chrono::seconds(10), mysqlrouter::SSLOptions(),
+                   "cluster-1", mysql_harness::kDefaultStackSizeInKiloBytes, nullptr,
+                   metadata_cache::kDefaultEmergencyRefreshInterval, path);
+  EXPECT_TRUE(mc.topology_stale_);
+  expect_cluster_routable(mc);
+
+  // still unreachable, the saved topology is kept
+  m.expect_connect("127.0.0.1", 3000, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3001, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3002, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  mc.refresh();
+  expect_cluster_routable(mc);
+
+  // a metadata server confirms it
+  expect_sql_metadata();
+  expect_sql_members();
+  mc.refresh();
+  EXPECT_FALSE(mc.topology_stale_);
+  expect_cluster_routable(mc);
+
+  // from now on, losing the metadata servers clears the routing table again
+  m.expect_connect("127.0.0.1", 3000, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3001, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  m.expect_connect("127.0.0.1", 3002, "admin", "admin", "").then_error("some fake bad connection message", 66);
+  mc.refresh();
+  expect_cluster_not_routable(mc);
+}
+
 int main(int argc, char *argv[]) {
   init_test_logger();
   ::testing::InitGoogleTest(&argc, argv);
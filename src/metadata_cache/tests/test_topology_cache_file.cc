@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/**
+ * Test the file the metadata cache saves the topology to.
+ */
+
+#include "topology_cache_file.h"
+#include "mysql/harness/filesystem.h"
+#include "test/helpers.h"
+
+#include <fstream>
+
+#include "gmock/gmock.h"
+
+using metadata_cache::ManagedInstance;
+using metadata_cache::ManagedReplicaSet;
+using metadata_cache::ServerMode;
+
+class TopologyCacheFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tmp_dir_ = mysql_harness::get_tmp_dir("topology");
+    path_ = mysql_harness::Path(tmp_dir_).join("topology.json").str();
+  }
+
+  void TearDown() override {
+    mysql_harness::delete_dir_recursive(tmp_dir_);
+  }
+
+  void write_file(const std::string &content) {
+    std::ofstream file(path_);
+    file << content;
+  }
+
+  static std::map<std::string, ManagedReplicaSet> topology() {
+    ManagedReplicaSet rs;
+    rs.name = "default";
+    rs.single_primary_mode = true;
+    rs.members.push_back({"default", "uuid-1", "HA", ServerMode::ReadWrite, 1.0f, 0,
+                          "", "host \"one\"", 3306, 33060});
+    rs.members.push_back({"default", "uuid-2", "HA", ServerMode::ReadOnly, 0.5f, 2,
+                          "rack 2", "host2", 3307, 33070});
+    rs.members.push_back({"default", "uuid-3", "HA", ServerMode::Unavailable, 1.0f, 0,
+                          "", "host3", 3308, 33080});
+    return {{"default", rs}};
+  }
+
+  std::string tmp_dir_;
+  std::string path_;
+};
+
+TEST_F(TopologyCacheFileTest, round_trip) {
+  const auto saved = topology();
+  metadata_cache::save_topology_cache_file(path_, "cluster-1", saved);
+
+  // the temporary file got renamed
+  EXPECT_TRUE(mysql_harness::Path(path_).exists());
+  EXPECT_FALSE(mysql_harness::Path(path_ + ".tmp").exists());
+
+  const auto loaded = metadata_cache::load_topology_cache_file(path_, "cluster-1");
+  ASSERT_EQ(1U, loaded.size());
+  const auto &rs = loaded.at("default");
+  EXPECT_EQ("default", rs.name);
+  EXPECT_TRUE(rs.single_primary_mode);
+  ASSERT_EQ(3U, rs.members.size());
+  for (size_t i = 0; i < rs.members.size(); ++i) {
+    EXPECT_TRUE(rs.members[i] == saved.at("default").members[i]) << i;
+  }
+
+  // overwriting an existing file
+  metadata_cache::save_topology_cache_file(path_, "cluster-1", {});
+  EXPECT_TRUE(metadata_cache::load_topology_cache_file(path_, "cluster-1").empty());
+}
+
+TEST_F(TopologyCacheFileTest, invalid_files) {
+  // missing
+  EXPECT_THROW(metadata_cache::load_topology_cache_file(path_, "cluster-1"),
+               std::runtime_error);
+
+  // another cluster
+  metadata_cache::save_topology_cache_file(path_, "cluster-1", topology());
+  EXPECT_THROW(metadata_cache::load_topology_cache_file(path_, "cluster-2"),
+               std::runtime_error);
+
+  // another version
+  write_file("{\"version\": 2, \"cluster\": \"cluster-1\", \"replicasets\": []}");
+  EXPECT_THROW(metadata_cache::load_topology_cache_file(path_, "cluster-1"),
+               std::runtime_error);
+
+  // truncated
+  write_file("{\"version\": 1, \"cluster\": \"cluster-1\", \"replicasets\": [");
+  EXPECT_THROW(metadata_cache::load_topology_cache_file(path_, "cluster-1"),
+               std::runtime_error);
+
+  // member without a port
+  write_file("{\"version\": 1, \"cluster\": \"cluster-1\", \"replicasets\": ["
+             "{\"name\": \"default\", \"single_primary_mode\": true, \"members\": ["
+             "{\"mysql_server_uuid\": \"uuid-1\", \"role\": \"HA\", \"mode\": \"ReadWrite\","
+             " \"weight\": 1, \"version_token\": 0, \"location\": \"\", \"host\": \"h\","
+             " \"xport\": 33060}]}]}");
+  EXPECT_THROW(metadata_cache::load_topology_cache_file(path_, "cluster-1"),
+               std::runtime_error);
+}
+
+int main(int argc, char *argv[]) {
+  init_test_logger();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
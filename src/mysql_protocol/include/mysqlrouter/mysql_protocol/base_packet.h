@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "harness_assert.h"
+#include "packet_view.h"
 
 // GCC 4.8.4 requires all classes to be forward-declared before being used with
 // "friend class <friendee>", if they're in a different namespace than the friender
@@ -387,23 +388,7 @@ class MYSQL_PROTOCOL_API Packet : public std::vector<uint8_t> {
    */
   template<typename Type, typename = std::enable_if<std::is_integral<Type>::value>>
   Type read_int_from(size_t position, size_t length = sizeof(Type)) const {
-
-    harness_assert((length >= 1 && length <= 4) || length == 8);
-    if (position + length > size())
-      throw std::range_error("start or end beyond EOF");
-
-    if (length == 1) {
-      return static_cast<Type>((*this)[position]);
-    }
-
-    uint64_t result = 0;
-    auto it = begin() + static_cast<long>(position + length);
-    while (length-- > 0) {
-      result <<= 8;
-      result |= *--it;
-    }
-
-    return static_cast<Type>(result);
+    return PacketView(*this).read_int_from<Type>(position, length);
   }
 
   /** @brief Gets a length encoded integer from given packet
@@ -29,6 +29,46 @@
 
 namespace mysql_protocol {
 
+/** @class ErrorPacketView
+ * @brief Parses a MySQL error packet in place
+ *
+ * Validates an error packet the same way ErrorPacket does, but without
+ * copying it: the SQL state and message are views into the parsed buffer.
+ *
+ */
+class MYSQL_PROTOCOL_API ErrorPacketView {
+ public:
+  /** @brief Constructor
+   *
+   * @param packet bytes of the error packet, header included
+   * @param capabilities Server/Client capability flags (default 0)
+   *
+   * @throws packet_error if the packet is incomplete or not an error packet
+   */
+  explicit ErrorPacketView(const PacketView &packet,
+                           Capabilities::Flags capabilities = Capabilities::ALL_ZEROS);
+
+  /** @brief Gets error code */
+  unsigned short get_code() const noexcept {
+    return code_;
+  }
+
+  /** @brief Gets error message */
+  PacketView get_message() const noexcept {
+    return message_;
+  }
+
+  /** @brief Gets SQL state (empty if the packet has none) */
+  PacketView get_sql_state() const noexcept {
+    return sql_state_;
+  }
+
+ private:
+  unsigned short code_;
+  PacketView message_;
+  PacketView sql_state_;
+};
+
 /** @class ErrorPacket
  * @brief Creates a MySQL error packet
  *
@@ -124,6 +124,18 @@ class MYSQL_PROTOCOL_API HandshakeResponsePacket final : public Packet {
                           unsigned char char_set = 8,
                           const std::string &auth_plugin = "mysql_native_password");
 
+  /** @brief Reads the client capability flags of a handshake response
+   *
+   * Reads the flags straight from the received bytes, without building
+   * (and copying the bytes into) a HandshakeResponsePacket.
+   *
+   * @param packet bytes of the handshake response, header included
+   * @return client capability flags (PROTOCOL_41 layout)
+   *
+   * @throws packet_error if the packet is too short to contain them
+   */
+  static Capabilities::Flags read_capabilities(const PacketView &packet);
+
   /** @brief Parses packet payload, results written to object's field
    *
    * @param server_capabilities Capabilities sent by the server in Handshake Packet, see note below
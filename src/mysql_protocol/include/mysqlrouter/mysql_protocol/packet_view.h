@@ -0,0 +1,216 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef MYSQLROUTER_MYSQL_PROTOCOL_PACKET_VIEW_INCLUDED
+#define MYSQLROUTER_MYSQL_PROTOCOL_PACKET_VIEW_INCLUDED
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "harness_assert.h"
+
+namespace mysql_protocol {
+
+/** @class PacketView
+ * @brief Read-only view of the bytes of a MySQL packet
+ *
+ * Unlike Packet, PacketView does not own or copy the bytes it looks at, so
+ * the buffer has to outlive it. It offers the same bounds-checked
+ * read_*_from() operations as Packet, returning views into the buffer
+ * where Packet would return copies, which lets packets be inspected right
+ * in the buffer they were received into.
+ */
+class MYSQL_PROTOCOL_API PacketView {
+ public:
+  /** @brief Constructor of an empty view */
+  PacketView() noexcept : data_(nullptr), size_(0) { }
+
+  /** @overload
+   *
+   * @param data first byte of the view
+   * @param size number of bytes in the view
+   */
+  PacketView(const uint8_t *data, size_t size) noexcept : data_(data), size_(size) { }
+
+  /** @overload
+   *
+   * @param buffer bytes of the view
+   */
+  explicit PacketView(const std::vector<uint8_t> &buffer) noexcept
+      : data_(buffer.data()), size_(buffer.size()) { }
+
+  const uint8_t *data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  const uint8_t *begin() const noexcept { return data_; }
+  const uint8_t *end() const noexcept { return data_ + size_; }
+
+  uint8_t operator[](size_t position) const noexcept { return data_[position]; }
+
+  /** @brief Whether the view holds a packet header and the whole payload */
+  bool is_complete() const noexcept {
+    return size_ >= kHeaderSize && size_ >= kHeaderSize + get_payload_size();
+  }
+
+  /** @brief Gets the payload size from the packet header
+   *
+   * @note the view must hold at least the 4-byte header
+   */
+  uint32_t get_payload_size() const noexcept {
+    return static_cast<uint32_t>(data_[0] | (data_[1] << 8) | (data_[2] << 16));
+  }
+
+  /** @brief Gets the sequence ID from the packet header
+   *
+   * @note the view must hold at least the 4-byte header
+   */
+  uint8_t get_sequence_id() const noexcept {
+    return data_[3];
+  }
+
+  /** @brief Gets an integral from the view
+   *
+   * @see Packet::read_int_from()
+   *
+   * @param position Position where to start reading
+   * @param length size of the integer to parse
+   * @return integer type
+   *
+   * @throws std::range_error (std::runtime_error) on start or end beyond EOF
+   */
+  template<typename Type, typename = std::enable_if<std::is_integral<Type>::value>>
+  Type read_int_from(size_t position, size_t length = sizeof(Type)) const {
+
+    harness_assert((length >= 1 && length <= 4) || length == 8);
+    if (position + length > size_)
+      throw std::range_error("start or end beyond EOF");
+
+    uint64_t result = 0;
+    const uint8_t *it = data_ + position + length;
+    while (length-- > 0) {
+      result <<= 8;
+      result |= *--it;
+    }
+
+    return static_cast<Type>(result);
+  }
+
+  /** @brief Gets a length encoded integer from the view
+   *
+   * @see Packet::read_lenenc_uint_from()
+   *
+   * @param position Position where to start reading
+   * @return the integer and the length of its token
+   *
+   * @throws std::range_error (std::runtime_error) on start or end beyond EOF,
+   *         std::runtime_error on bad first byte (which determines int length)
+   */
+  std::pair<uint64_t, size_t> read_lenenc_uint_from(size_t position) const;
+
+  /** @brief Gets raw bytes from the view
+   *
+   * @param position Position from which to start reading
+   * @param length Number of bytes to read
+   * @return view of the bytes
+   *
+   * @throws std::range_error (std::runtime_error) on start or end beyond EOF
+   */
+  PacketView read_bytes_from(size_t position, size_t length) const {
+    if (position + length > size_)
+      throw std::range_error("start or end beyond EOF");
+
+    return PacketView(data_ + position, length);
+  }
+
+  /** @brief Gets raw bytes from the view using length encoded size
+   *
+   * @param position Position from which to start reading
+   * @return view of the bytes and the length of the whole token
+   *
+   * @throws std::range_error (std::runtime_error) on start or end beyond EOF,
+   *         std::runtime_error on bad first byte (which determines int length)
+   */
+  std::pair<PacketView, size_t> read_lenenc_bytes_from(size_t position) const;
+
+  /** @brief Gets a zero-terminated string from the view
+   *
+   * @param position Position from which to start reading
+   * @return view of the string, without the zero-terminator
+   *
+   * @throws std::range_error (std::runtime_error) on start beyond EOF,
+   *         std::runtime_error on zero-terminator not found
+   */
+  PacketView read_string_nul_from(size_t position) const;
+
+  /** @brief Gets a string from the view
+   *
+   * @see Packet::read_string_from()
+   *
+   * @param position Position from which to start reading
+   * @param length Maximum length of the string to read
+   * @return view of the string, ending at the first zero byte if any
+   */
+  PacketView read_string_from(size_t position, size_t length = UINT_MAX) const noexcept;
+
+  /** @brief Gets raw bytes from the view from position until EOF
+   *
+   * @param position Position from which to start reading
+   * @return view of the bytes
+   *
+   * @throws std::range_error (std::runtime_error) on start beyond EOF
+   */
+  PacketView read_bytes_eof_from(size_t position) const {
+    if (position >= size_)
+      throw std::range_error("start beyond EOF");
+
+    return PacketView(data_ + position, size_ - position);
+  }
+
+  /** @brief Copies the bytes of the view into a string */
+  std::string to_string() const {
+    return std::string(reinterpret_cast<const char*>(data_), size_);
+  }
+
+  /** @brief Copies the bytes of the view into a vector */
+  std::vector<uint8_t> to_vector() const {
+    return std::vector<uint8_t>(data_, data_ + size_);
+  }
+
+ private:
+  static constexpr size_t kHeaderSize = 4;
+
+  const uint8_t *data_;
+  size_t size_;
+};
+
+} // namespace mysql_protocol
+
+#endif // MYSQLROUTER_MYSQL_PROTOCOL_PACKET_VIEW_INCLUDED
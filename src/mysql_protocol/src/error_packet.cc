@@ -51,6 +51,38 @@ ErrorPacket::ErrorPacket(const std::vector<uint8_t> &buffer,
 
 static constexpr uint8_t kHashChar = 0x23;  // 0x23 == '#'
 
+ErrorPacketView::ErrorPacketView(const PacketView &packet,
+                                 Capabilities::Flags capabilities) {
+  if (packet.size() >= Packet::kHeaderSize && !packet.is_complete()) {
+    throw packet_error("Incorrect payload size (was " +
+                       std::to_string(packet.size()) + "; should be at least " +
+                       std::to_string(packet.get_payload_size()) + ")");
+  }
+
+  bool prot41 = capabilities.test(Capabilities::PROTOCOL_41);
+  // Sanity checks
+  if (!(packet.size() > 6 && packet[4] == 0xff && packet[6])) {
+    throw packet_error("Error packet marker 0xff not found");
+  }
+  const bool has_sql_state = packet.size() > 7 && packet[7] == kHashChar;
+  // Check if SQLState is available when CLIENT_PROTOCOL_41 flag is set
+  if (prot41 && !has_sql_state) {
+    throw packet_error("Error packet does not contain SQL state");
+  }
+
+  size_t pos = 5;
+  code_ = packet.read_int_from<uint16_t>(pos);
+  pos += 2;
+  if (has_sql_state) {
+    // We get the SQLState even when CLIENT_PROTOCOL_41 flag was not set
+    // This is needed in cases when the server sends an
+    // error to the client instead of the handshake.
+    sql_state_ = packet.read_string_from(++pos, 5); // We skip kHashChar ('#')
+    pos += 5;
+  }
+  message_ = packet.read_string_from(pos);
+}
+
 void ErrorPacket::prepare_packet() {
   assert(sql_state_.size() == 5);
 
@@ -88,29 +120,11 @@ void ErrorPacket::prepare_packet() {
 }
 
 void ErrorPacket::parse_payload() {
-  bool prot41 = capability_flags_.test(Capabilities::PROTOCOL_41);
-  // Sanity checks
-  if (!((*this)[4] == 0xff && (*this)[6])) {
-    throw packet_error("Error packet marker 0xff not found");
-  }
-  // Check if SQLState is available when CLIENT_PROTOCOL_41 flag is set
-  if (prot41 && (*this)[7] != kHashChar) {
-    throw packet_error("Error packet does not contain SQL state");
-  }
+  ErrorPacketView view(PacketView(*this), capability_flags_);  // throws packet_error
 
-  unsigned long pos = 5;
-  code_ = read_int_from<uint16_t>(pos);
-  pos += 2;
-  if ((*this)[7] == kHashChar) {
-    // We get the SQLState even when CLIENT_PROTOCOL_41 flag was not set
-    // This is needed in cases when the server sends an
-    // error to the client instead of the handshake.
-    sql_state_ = read_string_from(++pos, 5); // We skip kHashChar ('#')
-    pos += 5;
-  } else {
-    sql_state_ = "";
-  }
-  message_ = read_string_from(pos);
+  code_ = view.get_code();
+  sql_state_ = view.get_sql_state().to_string();
+  message_ = view.get_message().to_string();
 }
 
 } // namespace mysql_protocol
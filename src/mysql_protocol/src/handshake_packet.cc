@@ -49,6 +49,15 @@ HandshakeResponsePacket::HandshakeResponsePacket(uint8_t sequence_id,
   prepare_packet();
 }
 
+/*static*/
+Capabilities::Flags HandshakeResponsePacket::read_capabilities(const PacketView &packet) {
+  constexpr size_t kFlagsOffset = 4;
+  if (packet.size() < kFlagsOffset + sizeof(Capabilities::AllFlags))
+    throw packet_error("Handshake response packet: tried reading capability flags past EOF");
+
+  return Capabilities::Flags(packet.read_int_from<Capabilities::AllFlags>(kFlagsOffset));
+}
+
 /** @fn HandshakeResponsePacket::prepare_packet()
  *
  * @devnote
@@ -0,0 +1,101 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysqlrouter/mysql_protocol.h"
+
+#include <algorithm>
+
+namespace mysql_protocol {
+
+// satisfy ODR
+constexpr size_t PacketView::kHeaderSize;
+
+std::pair<uint64_t, size_t> PacketView::read_lenenc_uint_from(size_t position) const {
+
+  if (position >= size_)
+    throw std::range_error("start beyond EOF");
+  if (data_[position] == 0xff ||  // 0xff is undefined in length encoded integers
+      data_[position] == 0xfb)    // 0xfb represents NULL and not used in length encoded integers
+    throw std::runtime_error("illegal value at first byte");
+
+  // single-byte uint
+  if (data_[position] < 0xfb) {
+    return std::make_pair(data_[position], 1);
+  }
+
+  // multi-byte uint
+  size_t length = 2;
+  switch (data_[position]) {
+    case 0xfc:
+      length = 2;
+      break;
+    case 0xfd:
+      length = 3;
+      break;
+    case 0xfe:  // NOTE: up to MySQL 3.22 0xfe was follwed by 4 bytes, not 8
+      length = 8;
+  }
+  if (position + length >= size_)
+    throw std::range_error("end beyond EOF");
+
+  return std::make_pair(read_int_from<uint64_t>(position + 1, length), length + 1);
+}
+
+std::pair<PacketView, size_t> PacketView::read_lenenc_bytes_from(size_t position) const {
+  auto pr = read_lenenc_uint_from(position); // throws runtime_error, range_error
+
+  uint64_t lenenc_uint_value = pr.first;
+  size_t lenenc_uint_token_len = pr.second;
+
+  size_t start = position + lenenc_uint_token_len;
+  if (lenenc_uint_value > size_ - start)
+    throw std::range_error("start or end beyond EOF");
+
+  size_t length = static_cast<size_t>(lenenc_uint_value);
+  return std::make_pair(PacketView(data_ + start, length),
+                        lenenc_uint_token_len + length);
+}
+
+PacketView PacketView::read_string_nul_from(size_t position) const {
+  if (position >= size_)
+    throw std::range_error("start beyond EOF");
+
+  const uint8_t *it = std::find(data_ + position, end(), 0);
+  if (it == end())
+    throw std::runtime_error("zero-terminator not found");
+
+  return PacketView(data_ + position, static_cast<size_t>(it - (data_ + position)));
+}
+
+PacketView PacketView::read_string_from(size_t position, size_t length) const noexcept {
+  if (position > size_)
+    return PacketView();
+
+  const uint8_t *start = data_ + position;
+  const uint8_t *finish = length > size_ - position ? end() : start + length;
+  return PacketView(start, static_cast<size_t>(std::find(start, finish, 0) - start));
+}
+
+} // namespace mysql_protocol
@@ -161,3 +161,20 @@ TEST_F(MySQLProtocolTest, ParsePayloadErrors) {
   }
 }
 
+
+TEST_F(MySQLProtocolTest, ParseInPlace) {
+  mysql_protocol::ErrorPacketView view(mysql_protocol::PacketView(case_w_sqlstate),
+                                       Capabilities::PROTOCOL_41);
+
+  ASSERT_EQ(3999, view.get_code());
+  ASSERT_EQ("XY123", view.get_sql_state().to_string());
+  ASSERT_EQ("This is a test error", view.get_message().to_string());
+
+  // the fields point into the parsed buffer
+  ASSERT_EQ(case_w_sqlstate.data() + 8, view.get_sql_state().data());
+  ASSERT_EQ(case_w_sqlstate.data() + 13, view.get_message().data());
+
+  // a truncated error packet is rejected, not read past its end
+  ASSERT_THROW(mysql_protocol::ErrorPacketView(mysql_protocol::PacketView(case_w_sqlstate.data(), 6)),
+               mysql_protocol::packet_error);
+}
@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include <gmock/gmock.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mysqlrouter/mysql_protocol.h"
+
+using mysql_protocol::PacketView;
+using ::testing::ElementsAre;
+
+class PacketViewTest : public ::testing::Test {
+ public:
+  std::vector<uint8_t> buffer = {
+      0x0c, 0x00, 0x00, 0x01,            // header
+      0xfc, 0x01, 0x02,                  // lenenc int: 0x0201
+      0x03, 'a', 'b', 'c',               // lenenc str
+      'h', 'a', 'm', 0x00,               // nul str
+      0x2a,                              // int<1>
+  };
+};
+
+TEST_F(PacketViewTest, Header) {
+  PacketView view(buffer);
+
+  EXPECT_EQ(12u, view.get_payload_size());
+  EXPECT_EQ(1u, view.get_sequence_id());
+  EXPECT_TRUE(view.is_complete());
+
+  EXPECT_FALSE(PacketView(buffer.data(), buffer.size() - 1).is_complete());
+  EXPECT_FALSE(PacketView(buffer.data(), 3).is_complete());
+  EXPECT_FALSE(PacketView().is_complete());
+}
+
+TEST_F(PacketViewTest, ReadsInPlace) {
+  PacketView view(buffer);
+
+  auto lenenc_int = view.read_lenenc_uint_from(4);
+  EXPECT_EQ(0x0201u, lenenc_int.first);
+  EXPECT_EQ(3u, lenenc_int.second);
+
+  auto lenenc_str = view.read_lenenc_bytes_from(7);
+  EXPECT_EQ(buffer.data() + 8, lenenc_str.first.data());
+  EXPECT_EQ("abc", lenenc_str.first.to_string());
+  EXPECT_EQ(4u, lenenc_str.second);
+
+  auto nul_str = view.read_string_nul_from(11);
+  EXPECT_EQ(buffer.data() + 11, nul_str.data());
+  EXPECT_EQ("ham", nul_str.to_string());
+
+  EXPECT_EQ(0x2a, view.read_int_from<uint8_t>(15));
+  EXPECT_THAT(view.read_bytes_from(8, 3).to_vector(), ElementsAre('a', 'b', 'c'));
+  EXPECT_EQ(1u, view.read_bytes_eof_from(15).size());
+  EXPECT_EQ("am", view.read_string_from(12, 2).to_string());
+  EXPECT_EQ("ham", view.read_string_from(11).to_string());
+  EXPECT_TRUE(view.read_string_from(100).empty());
+}
+
+TEST_F(PacketViewTest, BoundsChecked) {
+  PacketView view(buffer.data(), 10);  // cuts the lenenc str short
+
+  EXPECT_THROW(view.read_int_from<uint32_t>(8), std::range_error);
+  EXPECT_THROW(view.read_lenenc_bytes_from(7), std::range_error);
+  EXPECT_THROW(view.read_bytes_from(8, 3), std::range_error);
+  EXPECT_THROW(view.read_string_nul_from(8), std::runtime_error);
+  EXPECT_THROW(view.read_string_nul_from(10), std::range_error);
+  EXPECT_THROW(view.read_bytes_eof_from(10), std::range_error);
+  EXPECT_THROW(PacketView(buffer.data(), 5).read_lenenc_uint_from(4), std::range_error);
+}
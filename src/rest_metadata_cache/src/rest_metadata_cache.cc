@@ -0,0 +1,126 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/**
+ * REST API controlling the metadata cache.
+ *
+ * POST /api/v1/metadata/refresh   refreshes the cache right away, without
+ *                                 waiting for the TTL to expire
+ *
+ * The refresh itself runs in the refresh thread of the cache, the request
+ * is answered as soon as the thread is woken up.
+ *
+ * The endpoint is neither authenticated nor rate limited, see start().
+ */
+
+#include <stdexcept>
+#include <string>
+
+// Harness interface include files
+#include "mysql/harness/config_parser.h"
+#include "mysql/harness/logging/logging.h"
+#include "mysql/harness/plugin.h"
+
+#include "mysqlrouter/http_server_component.h"
+#include "mysqlrouter/metadata_cache.h"
+
+IMPORT_LOG_FUNCTIONS()
+
+static constexpr const char kRestMetadataRefreshUri[] { "^/api/v1/metadata/refresh/?$" };
+
+using mysql_harness::ARCHITECTURE_DESCRIPTOR;
+using mysql_harness::PluginFuncEnv;
+using mysql_harness::PLUGIN_ABI_VERSION;
+using mysql_harness::Plugin;
+
+class RestApiV1MetadataRefresh: public BaseRequestHandler {
+public:
+  // POST
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!(HttpMethod::Post & req.get_method())) {
+      req.get_output_headers().add("Allow", "POST");
+      req.send_reply(HttpStatusCode::MethodNotAllowed);
+      return;
+    }
+
+    try {
+      metadata_cache::MetadataCacheAPI::instance()->request_refresh();
+    } catch (const std::runtime_error &e) {
+      // the cache isn't running (yet)
+      log_debug("Refreshing the metadata cache failed: %s", e.what());
+      req.send_error(HttpStatusCode::ServiceUnavailable);
+      return;
+    }
+
+    log_info("Metadata cache refresh requested over the REST API");
+    req.send_reply(HttpStatusCode::Accepted);
+  }
+};
+
+static void start(PluginFuncEnv*) {
+  auto &srv = HttpServerComponent::getInstance();
+
+  // The route has no authentication and no rate limiting: anyone who can
+  // reach the http_server can trigger refreshes. Requests arriving while a
+  // refresh is pending are folded into it, but a steady stream of requests
+  // keeps the refresh thread querying the metadata servers back to back.
+  // Only bind the http_server to trusted interfaces.
+  srv.add_route(kRestMetadataRefreshUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1MetadataRefresh()));
+}
+
+static void stop(PluginFuncEnv*) {
+  auto &srv = HttpServerComponent::getInstance();
+
+  srv.remove_route(kRestMetadataRefreshUri);
+}
+
+
+#if defined(_MSC_VER) && defined(rest_metadata_cache_EXPORTS)
+/* We are building this library */
+#  define DLLEXPORT __declspec(dllexport)
+#else
+#  define DLLEXPORT
+#endif
+
+const char *plugin_requires[] = {
+  "http_server",
+  "metadata_cache",
+};
+
+extern "C" {
+Plugin DLLEXPORT harness_plugin_rest_metadata_cache = {
+  PLUGIN_ABI_VERSION,
+  ARCHITECTURE_DESCRIPTOR,
+  "REST_METADATA_CACHE",
+  VERSION_NUMBER(0, 0, 1),
+  sizeof(plugin_requires)/sizeof(plugin_requires[0]), plugin_requires,  // requires
+  0, nullptr,  // conflicts
+  nullptr,     // init
+  nullptr,     // deinit
+  start,       // start
+  stop,        // stop
+};
+}
@@ -0,0 +1,623 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+/**
+ * REST API exposing the state of the routes.
+ *
+ * GET /api/v1/routes/          lists the routes
+ * GET /api/v1/routes/<name>/   returns the state of a route
+ * GET /api/v1/routes/<name>/connections?sort=bytes|rate|age&limit=N
+ *                              returns the top-N open connections
+ * DELETE /api/v1/routes/<name>/connections/<id>
+ *                              closes a connection
+ * GET /api/v1/routes/<name>/queries?sort=count|total_latency|max_latency&limit=N
+ *                              returns the top-N query digests
+ * GET /api/v1/routes/<name>/blockedHosts
+ *                              returns the client hosts with connection errors
+ * DELETE /api/v1/routes/<name>/blockedHosts[/<ip>]
+ *                              unblocks a client host, all of them without ip
+ *
+ * Route handlers only read the snapshots the routes publish to
+ * MySQLRoutingComponent, polling never touches the locks of the routes.
+ * Connection handlers read the live counters of the connections, the
+ * query handler the digest table of the route, the blocked hosts handlers
+ * the connection error counters of the route.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+// Harness interface include files
+#include "mysql/harness/config_parser.h"
+#include "mysql/harness/logging/logging.h"
+#include "mysql/harness/plugin.h"
+
+#include "mysqlrouter/http_server_component.h"
+#include "mysqlrouter/routing_component.h"
+
+IMPORT_LOG_FUNCTIONS()
+
+static constexpr const char kRestRoutesUri[] { "^/api/v1/routes/?$" };
+static constexpr const char kRestRouteStatusUri[] { "^/api/v1/routes/[^/]+/?$" };
+static constexpr const char kRestRouteConnectionsUri[] { "^/api/v1/routes/[^/]+/connections/?$" };
+static constexpr const char kRestRouteConnectionUri[] { "^/api/v1/routes/[^/]+/connections/[0-9]+/?$" };
+static constexpr const char kRestRouteQueriesUri[] { "^/api/v1/routes/[^/]+/queries/?$" };
+static constexpr const char kRestRouteBlockedHostsUri[] { "^/api/v1/routes/[^/]+/blockedHosts/?$" };
+static constexpr const char kRestRouteBlockedHostUri[] { "^/api/v1/routes/[^/]+/blockedHosts/[^/]+/?$" };
+static constexpr const char kRestRoutesPrefix[] { "/api/v1/routes/" };
+static constexpr const char kConnectionsPathElement[] { "/connections" };
+static constexpr const char kQueriesPathElement[] { "/queries" };
+static constexpr const char kBlockedHostsPathElement[] { "/blockedHosts" };
+
+static constexpr size_t kDefaultLimit { 10 };
+
+using mysql_harness::ARCHITECTURE_DESCRIPTOR;
+using mysql_harness::PluginFuncEnv;
+using mysql_harness::PLUGIN_ABI_VERSION;
+using mysql_harness::Plugin;
+
+using JsonWriter = rapidjson::Writer<rapidjson::StringBuffer>;
+
+static void write_string(JsonWriter &writer, const char *key, const std::string &value) {
+  writer.Key(key);
+  writer.String(value.c_str(), static_cast<rapidjson::SizeType>(value.size()));
+}
+
+static void write_route_summary(JsonWriter &writer, const routing::RouteStatus &status) {
+  write_string(writer, "name", status.name);
+  writer.Key("activeConnections");
+  writer.Int64(status.active_connections);
+  writer.Key("totalConnections");
+  writer.Uint64(status.total_connections);
+  writer.Key("blockedHosts");
+  writer.Uint64(status.blocked_hosts.size());
+}
+
+static void write_route_status(JsonWriter &writer, const routing::RouteStatus &status) {
+  writer.StartObject();
+  write_route_summary(writer, status);
+  write_string(writer, "bindAddress", status.bind_address);
+  writer.Key("bindPort");
+  writer.Uint(status.bind_port);
+  write_string(writer, "socket", status.socket);
+  write_string(writer, "protocol", status.protocol);
+  write_string(writer, "routingStrategy", status.routing_strategy);
+  write_string(writer, "mode", status.mode);
+  writer.Key("maxConnections");
+  writer.Int64(status.max_connections);
+  writer.Key("timestamp");
+  writer.Int64(status.timestamp);
+
+  writer.Key("blockedHostList");
+  writer.StartArray();
+  for (const auto &host: status.blocked_hosts) {
+    writer.String(host.c_str(), static_cast<rapidjson::SizeType>(host.size()));
+  }
+  writer.EndArray();
+
+  writer.Key("destinations");
+  writer.StartArray();
+  for (const auto &dest: status.destinations) {
+    writer.StartObject();
+    write_string(writer, "address", dest.address);
+    writer.Key("activeConnections");
+    writer.Int64(dest.active_connections);
+    writer.Key("totalConnections");
+    writer.Uint64(dest.total_connections);
+    writer.Key("quarantined");
+    writer.Bool(dest.quarantined);
+    writer.EndObject();
+  }
+  writer.EndArray();
+  writer.EndObject();
+}
+
+static void send_json(HttpRequest &req, const rapidjson::StringBuffer &json_buf) {
+  auto chunk = req.get_output_buffer();
+  chunk.add(json_buf.GetString(), json_buf.GetSize());
+
+  auto out_hdrs = req.get_output_headers();
+  out_hdrs.add("Content-Type", "application/json");
+
+  req.send_reply(HttpStatusCode::Ok, "Ok", chunk);
+}
+
+static bool ensure_get(HttpRequest &req) {
+  if (!(HttpMethod::Get & req.get_method())) {
+    req.get_output_headers().add("Allow", "GET");
+    req.send_reply(HttpStatusCode::MethodNotAllowed);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * splits "/api/v1/routes/<name><element>/<id>" into name and the part
+ * after element, without a trailing slash.
+ */
+static void split_route_path(const std::string &uri, const std::string &element,
+                             std::string &name, std::string &rest) {
+  std::string path { HttpUri::parse(uri).get_path() };
+  if (!path.empty() && path.back() == '/') path.pop_back();
+
+  path.erase(0, sizeof(kRestRoutesPrefix) - 1);
+  const auto pos = path.find(element);
+  name = path.substr(0, pos);
+  rest = path.substr(pos + element.size());
+}
+
+/**
+ * returns the value of a key=value pair from the query part of a URI.
+ */
+static std::string get_query_value(const std::string &query, const std::string &key) {
+  size_t start = 0;
+  while (start <= query.size()) {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos) end = query.size();
+
+    const std::string pair = query.substr(start, end - start);
+    if (pair.compare(0, key.size() + 1, key + "=") == 0) {
+      return pair.substr(key.size() + 1);
+    }
+    start = end + 1;
+  }
+
+  return "";
+}
+
+/**
+ * reads the limit=N parameter of the query part of a URI.
+ *
+ * @return false if the value isn't a number
+ */
+static bool get_query_limit(const std::string &query, size_t &limit) {
+  const std::string limit_str { get_query_value(query, "limit") };
+  if (limit_str.empty()) return true;
+
+  char *end = nullptr;
+  const unsigned long long val = std::strtoull(limit_str.c_str(), &end, 10);
+  if (*end != '\0' || limit_str[0] == '-') return false;
+  limit = static_cast<size_t>(val);
+
+  return true;
+}
+
+static uint64_t bytes_per_second(const routing::ConnectionStatus &conn) {
+  const uint64_t bytes = conn.bytes_from_client + conn.bytes_from_server;
+  const uint64_t age_ms = conn.age_ms > 0 ? static_cast<uint64_t>(conn.age_ms) : 1;
+
+  return bytes * 1000 / age_ms;
+}
+
+static void write_connection(JsonWriter &writer, const routing::ConnectionStatus &conn) {
+  writer.StartObject();
+  writer.Key("id");
+  writer.Uint64(conn.id);
+  write_string(writer, "clientAddress", conn.client_address);
+  write_string(writer, "serverAddress", conn.server_address);
+  writer.Key("started");
+  writer.Int64(conn.started);
+  writer.Key("ageMs");
+  writer.Int64(conn.age_ms);
+  writer.Key("idleMs");
+  writer.Int64(conn.idle_ms);
+  writer.Key("bytesFromClient");
+  writer.Uint64(conn.bytes_from_client);
+  writer.Key("bytesFromServer");
+  writer.Uint64(conn.bytes_from_server);
+  writer.Key("readsFromClient");
+  writer.Uint64(conn.reads_from_client);
+  writer.Key("readsFromServer");
+  writer.Uint64(conn.reads_from_server);
+  writer.Key("bytesPerSecond");
+  writer.Uint64(bytes_per_second(conn));
+  writer.EndObject();
+}
+
+static void write_query_digest(JsonWriter &writer, const routing::QueryDigestStatus &digest) {
+  writer.StartObject();
+  write_string(writer, "digest", digest.digest);
+  writer.Key("count");
+  writer.Uint64(digest.count);
+  writer.Key("countError");
+  writer.Uint64(digest.count_error);
+  writer.Key("errors");
+  writer.Uint64(digest.errors);
+  writer.Key("totalLatencyUs");
+  writer.Uint64(digest.total_latency_us);
+  writer.Key("avgLatencyUs");
+  // the latencies only cover the statements after the digest entered the table
+  const uint64_t recorded = digest.count - digest.count_error;
+  writer.Uint64(recorded > 0 ? digest.total_latency_us / recorded : 0);
+  writer.Key("maxLatencyUs");
+  writer.Uint64(digest.max_latency_us);
+  writer.Key("rows");
+  writer.Uint64(digest.rows);
+  writer.Key("bytes");
+  writer.Uint64(digest.bytes);
+  writer.EndObject();
+}
+
+static void write_client_host(JsonWriter &writer, const routing::ClientHostStatus &host) {
+  writer.StartObject();
+  write_string(writer, "address", host.address);
+  writer.Key("connectErrors");
+  writer.Uint64(host.connect_errors);
+  writer.Key("blocked");
+  writer.Bool(host.blocked);
+  writer.EndObject();
+}
+
+static void send_unblock_result(HttpRequest &req, routing::UnblockHostResult result) {
+  switch (result) {
+    case routing::UnblockHostResult::kUnblocked:
+      req.send_reply(HttpStatusCode::NoContent);
+      return;
+    case routing::UnblockHostResult::kInvalidAddress:
+      req.send_error(HttpStatusCode::BadRequest);
+      return;
+    case routing::UnblockHostResult::kRouteNotFound:
+    case routing::UnblockHostResult::kHostNotFound:
+      req.send_error(HttpStatusCode::NotFound);
+      return;
+  }
+}
+
+class RestApiV1Routes: public BaseRequestHandler {
+public:
+  // GET
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!ensure_get(req)) return;
+
+    auto &component = MySQLRoutingComponent::getInstance();
+
+    rapidjson::StringBuffer json_buf;
+    {
+      JsonWriter writer(json_buf);
+
+      writer.StartObject();
+      writer.Key("items");
+      writer.StartArray();
+      for (const auto &name: component.get_route_names()) {
+        auto status = component.get_route_status(name);
+        if (!status) continue;  // not started yet
+
+        writer.StartObject();
+        write_route_summary(writer, *status);
+        writer.EndObject();
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+
+    send_json(req, json_buf);
+  }
+};
+
+class RestApiV1RouteStatus: public BaseRequestHandler {
+public:
+  // GET
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!ensure_get(req)) return;
+
+    std::string name { HttpUri::parse(req.get_uri()).get_path() };
+    name.erase(0, sizeof(kRestRoutesPrefix) - 1);
+    if (!name.empty() && name.back() == '/') name.pop_back();
+
+    auto status = MySQLRoutingComponent::getInstance().get_route_status(name);
+    if (!status) {
+      req.send_error(HttpStatusCode::NotFound);
+      return;
+    }
+
+    rapidjson::StringBuffer json_buf;
+    {
+      JsonWriter writer(json_buf);
+      write_route_status(writer, *status);
+    }
+
+    send_json(req, json_buf);
+  }
+};
+
+class RestApiV1RouteConnections: public BaseRequestHandler {
+public:
+  // GET
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!ensure_get(req)) return;
+
+    std::string name, rest;
+    split_route_path(req.get_uri(), kConnectionsPathElement, name, rest);
+
+    std::vector<routing::ConnectionStatus> connections;
+    if (!MySQLRoutingComponent::getInstance().get_route_connections(name, connections)) {
+      req.send_error(HttpStatusCode::NotFound);
+      return;
+    }
+
+    const std::string query { HttpUri::parse(req.get_uri()).get_query() };
+    const std::string sort { get_query_value(query, "sort") };
+
+    size_t limit = kDefaultLimit;
+    if (!get_query_limit(query, limit)) {
+      req.send_error(HttpStatusCode::BadRequest);
+      return;
+    }
+
+    if (sort.empty() || sort == "bytes") {
+      std::sort(connections.begin(), connections.end(),
+          [](const routing::ConnectionStatus &a, const routing::ConnectionStatus &b) {
+            return a.bytes_from_client + a.bytes_from_server >
+                   b.bytes_from_client + b.bytes_from_server;
+          });
+    } else if (sort == "rate") {
+      std::sort(connections.begin(), connections.end(),
+          [](const routing::ConnectionStatus &a, const routing::ConnectionStatus &b) {
+            return bytes_per_second(a) > bytes_per_second(b);
+          });
+    } else if (sort == "age") {
+      std::sort(connections.begin(), connections.end(),
+          [](const routing::ConnectionStatus &a, const routing::ConnectionStatus &b) {
+            return a.age_ms > b.age_ms;
+          });
+    } else {
+      req.send_error(HttpStatusCode::BadRequest);
+      return;
+    }
+
+    rapidjson::StringBuffer json_buf;
+    {
+      JsonWriter writer(json_buf);
+
+      writer.StartObject();
+      writer.Key("totalConnections");
+      writer.Uint64(connections.size());
+      writer.Key("items");
+      writer.StartArray();
+      for (size_t i = 0; i < connections.size() && i < limit; ++i) {
+        write_connection(writer, connections[i]);
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+
+    send_json(req, json_buf);
+  }
+};
+
+class RestApiV1RouteConnection: public BaseRequestHandler {
+public:
+  // DELETE
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!(HttpMethod::Delete & req.get_method())) {
+      req.get_output_headers().add("Allow", "DELETE");
+      req.send_reply(HttpStatusCode::MethodNotAllowed);
+      return;
+    }
+
+    std::string name, rest;
+    split_route_path(req.get_uri(), kConnectionsPathElement, name, rest);
+
+    // rest is "/<id>", the regex ensures it's a number
+    const uint64_t id = std::strtoull(rest.c_str() + 1, nullptr, 10);
+
+    switch (MySQLRoutingComponent::getInstance().close_route_connection(name, id)) {
+      case routing::CloseConnectionResult::kClosed:
+        req.send_reply(HttpStatusCode::NoContent);
+        return;
+      case routing::CloseConnectionResult::kRouteNotFound:
+      case routing::CloseConnectionResult::kConnectionNotFound:
+        req.send_error(HttpStatusCode::NotFound);
+        return;
+    }
+  }
+};
+
+class RestApiV1RouteQueries: public BaseRequestHandler {
+public:
+  // GET
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!ensure_get(req)) return;
+
+    std::string name, rest;
+    split_route_path(req.get_uri(), kQueriesPathElement, name, rest);
+
+    std::vector<routing::QueryDigestStatus> digests;
+    if (!MySQLRoutingComponent::getInstance().get_route_query_digests(name, digests)) {
+      req.send_error(HttpStatusCode::NotFound);
+      return;
+    }
+
+    const std::string query { HttpUri::parse(req.get_uri()).get_query() };
+    const std::string sort { get_query_value(query, "sort") };
+
+    size_t limit = kDefaultLimit;
+    if (!get_query_limit(query, limit)) {
+      req.send_error(HttpStatusCode::BadRequest);
+      return;
+    }
+
+    // digests come sorted by count
+    if (sort == "total_latency") {
+      std::sort(digests.begin(), digests.end(),
+          [](const routing::QueryDigestStatus &a, const routing::QueryDigestStatus &b) {
+            return a.total_latency_us > b.total_latency_us;
+          });
+    } else if (sort == "max_latency") {
+      std::sort(digests.begin(), digests.end(),
+          [](const routing::QueryDigestStatus &a, const routing::QueryDigestStatus &b) {
+            return a.max_latency_us > b.max_latency_us;
+          });
+    } else if (!sort.empty() && sort != "count") {
+      req.send_error(HttpStatusCode::BadRequest);
+      return;
+    }
+
+    rapidjson::StringBuffer json_buf;
+    {
+      JsonWriter writer(json_buf);
+
+      writer.StartObject();
+      writer.Key("totalDigests");
+      writer.Uint64(digests.size());
+      writer.Key("items");
+      writer.StartArray();
+      for (size_t i = 0; i < digests.size() && i < limit; ++i) {
+        write_query_digest(writer, digests[i]);
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+
+    send_json(req, json_buf);
+  }
+};
+
+class RestApiV1RouteBlockedHosts: public BaseRequestHandler {
+public:
+  // GET, DELETE
+  //
+  void handle_request(HttpRequest &req) override {
+    const bool is_delete = (HttpMethod::Delete & req.get_method()) != 0;
+    if (!is_delete && !(HttpMethod::Get & req.get_method())) {
+      req.get_output_headers().add("Allow", "GET, DELETE");
+      req.send_reply(HttpStatusCode::MethodNotAllowed);
+      return;
+    }
+
+    std::string name, rest;
+    split_route_path(req.get_uri(), kBlockedHostsPathElement, name, rest);
+
+    auto &component = MySQLRoutingComponent::getInstance();
+    if (is_delete) {
+      send_unblock_result(req, component.unblock_route_client_host(name, ""));
+      return;
+    }
+
+    std::vector<routing::ClientHostStatus> hosts;
+    if (!component.get_route_client_hosts(name, hosts)) {
+      req.send_error(HttpStatusCode::NotFound);
+      return;
+    }
+
+    rapidjson::StringBuffer json_buf;
+    {
+      JsonWriter writer(json_buf);
+
+      writer.StartObject();
+      writer.Key("items");
+      writer.StartArray();
+      for (const auto &host: hosts) {
+        write_client_host(writer, host);
+      }
+      writer.EndArray();
+      writer.EndObject();
+    }
+
+    send_json(req, json_buf);
+  }
+};
+
+class RestApiV1RouteBlockedHost: public BaseRequestHandler {
+public:
+  // DELETE
+  //
+  void handle_request(HttpRequest &req) override {
+    if (!(HttpMethod::Delete & req.get_method())) {
+      req.get_output_headers().add("Allow", "DELETE");
+      req.send_reply(HttpStatusCode::MethodNotAllowed);
+      return;
+    }
+
+    std::string name, rest;
+    split_route_path(req.get_uri(), kBlockedHostsPathElement, name, rest);
+
+    // rest is "/<ip>"
+    send_unblock_result(req,
+        MySQLRoutingComponent::getInstance().unblock_route_client_host(name, rest.substr(1)));
+  }
+};
+
+static void start(PluginFuncEnv*) {
+  auto &srv = HttpServerComponent::getInstance();
+
+  srv.add_route(kRestRoutesUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1Routes()));
+  srv.add_route(kRestRouteStatusUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteStatus()));
+  srv.add_route(kRestRouteConnectionsUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteConnections()));
+  srv.add_route(kRestRouteConnectionUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteConnection()));
+  srv.add_route(kRestRouteQueriesUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteQueries()));
+  srv.add_route(kRestRouteBlockedHostsUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteBlockedHosts()));
+  srv.add_route(kRestRouteBlockedHostUri, std::unique_ptr<BaseRequestHandler>(new RestApiV1RouteBlockedHost()));
+}
+
+static void stop(PluginFuncEnv*) {
+  auto &srv = HttpServerComponent::getInstance();
+
+  srv.remove_route(kRestRouteBlockedHostUri);
+  srv.remove_route(kRestRouteBlockedHostsUri);
+  srv.remove_route(kRestRouteQueriesUri);
+  srv.remove_route(kRestRouteConnectionUri);
+  srv.remove_route(kRestRouteConnectionsUri);
+  srv.remove_route(kRestRouteStatusUri);
+  srv.remove_route(kRestRoutesUri);
+}
+
+
+#if defined(_MSC_VER) && defined(rest_routing_EXPORTS)
+/* We are building this library */
+#  define DLLEXPORT __declspec(dllexport)
+#else
+#  define DLLEXPORT
+#endif
+
+const char *plugin_requires[] = {
+  "http_server",
+  "routing",
+};
+
+extern "C" {
+Plugin DLLEXPORT harness_plugin_rest_routing = {
+  PLUGIN_ABI_VERSION,
+  ARCHITECTURE_DESCRIPTOR,
+  "REST_ROUTING",
+  VERSION_NUMBER(0, 0, 1),
+  sizeof(plugin_requires)/sizeof(plugin_requires[0]), plugin_requires,  // requires
+  0, nullptr,  // conflicts
+  nullptr,     // init
+  nullptr,     // deinit
+  start,       // start
+  stop,        // stop
+};
+}
@@ -0,0 +1,61 @@
+/*
+  Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MYSQLROUTER_JSON_UTILS_INCLUDED
+#define MYSQLROUTER_JSON_UTILS_INCLUDED
+
+#include <stdexcept>
+#include <string>
+
+#include <rapidjson/document.h>
+
+namespace mysqlrouter {
+
+/** @brief Returns the member `name` of a JSON object
+ *
+ * @throws std::runtime_error if `object` is not an object or has no such
+ *         member
+ */
+inline const rapidjson::Value &get_json_member(const rapidjson::Value &object,
+                                               const char *name) {
+  if (!object.IsObject() || !object.HasMember(name))
+    throw std::runtime_error(std::string("'") + name + "' missing");
+  return object[name];
+}
+
+/** @brief Returns the string member `name` of a JSON object
+ *
+ * @throws std::runtime_error if the member is missing or not a string
+ */
+inline std::string get_json_string(const rapidjson::Value &object,
+                                   const char *name) {
+  const auto &value = get_json_member(object, name);
+  if (!value.IsString())
+    throw std::runtime_error(std::string("'") + name + "' is not a string");
+  return std::string(value.GetString(), value.GetStringLength());
+}
+
+}  // namespace mysqlrouter
+
+#endif  // MYSQLROUTER_JSON_UTILS_INCLUDED
@@ -315,6 +315,27 @@ void copy_file(const std::string &from, const std::string &to);
  */
 int rename_file(const std::string &from, const std::string &to);
 
+/** @brief Replaces the content of a file atomically
+ *
+ * The content is written to `path` + ".tmp", which is then renamed to
+ * `path`: a reader sees the old or the new content, never a partial one.
+ * Exception thrown if the file can't be written or renamed.
+ */
+void write_file_atomically(const std::string &path, const std::string &content);
+
+/** @brief Returns the file a cache plugin saves its topology to
+ *
+ * A file named after the plugin's configuration section in the data folder.
+ *
+ * @param data_folder the data folder of the router
+ * @param section_name name of the plugin's configuration section
+ * @param section_key key of the plugin's configuration section, may be empty
+ * @return the path, empty if `data_folder` is
+ */
+std::string get_topology_cache_file(const std::string &data_folder,
+                                    const std::string &section_name,
+                                    const std::string &section_key);
+
 /** @brief Returns whether the socket name passed as parameter is valid
  */
 bool is_valid_socket_name(const std::string &socket, std::string &err_msg);
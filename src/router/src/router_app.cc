@@ -373,6 +373,47 @@ std::map<std::string, std::string> MySQLRouter::get_default_paths() const {
   return params;
 }
 
+/*static*/
+mysql_harness::logging::AsyncOptions MySQLRouter::get_async_log_options(const mysql_harness::LoaderConfig& config) {
+  using mysql_harness::logging::OverflowPolicy;
+
+  constexpr const char kNone[] = "";
+  constexpr const char* kLogger = mysql_harness::logging::kConfigSectionLogger;
+
+  mysql_harness::logging::AsyncOptions options;
+  if (!config.has(kLogger)) return options;
+  const auto& section = config.get(kLogger, kNone);
+
+  if (section.has(mysql_harness::logging::kConfigOptionAsync)) {
+    const std::string value = section.get(mysql_harness::logging::kConfigOptionAsync);
+    if (value != "0" && value != "1")
+      throw std::invalid_argument("[logger] option 'async' needs value 0 or 1, was '" + value + "'");
+    options.enabled = value == "1";
+  }
+
+  if (section.has(mysql_harness::logging::kConfigOptionAsyncQueueSize)) {
+    const std::string value = section.get(mysql_harness::logging::kConfigOptionAsyncQueueSize);
+    char *end = nullptr;
+    const unsigned long long size = std::strtoull(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || value[0] == '-' || size == 0 || size > 1048576)
+      throw std::invalid_argument("[logger] option 'async_queue_size' needs value between 1 and 1048576 inclusive, was '" + value + "'");
+    options.queue_size = static_cast<size_t>(size);
+  }
+
+  if (section.has(mysql_harness::logging::kConfigOptionAsyncOverflow)) {
+    std::string value = section.get(mysql_harness::logging::kConfigOptionAsyncOverflow);
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    if (value == "drop")
+      options.overflow = OverflowPolicy::kDrop;
+    else if (value == "block")
+      options.overflow = OverflowPolicy::kBlock;
+    else
+      throw std::invalid_argument("[logger] option 'async_overflow' needs value drop or block, was '" + value + "'");
+  }
+
+  return options;
+}
+
 // throws mysql_harness::bad_section (std::runtime_error) on [logger:some_key] section
 static void set_default_log_level(mysql_harness::LoaderConfig& config, bool raw_mode /*= false*/) {
 
@@ -458,6 +499,10 @@ std::exception_ptr detect_and_fix_nonfatal_problems(mysql_harness::LoaderConfig&
 /*static*/
 void MySQLRouter::init_main_logger(mysql_harness::LoaderConfig& config, bool raw_mode /*= false*/) {
 
+  // read before set_default_log_level() erases the [logger] section
+  // (throws std::invalid_argument)
+  const mysql_harness::logging::AsyncOptions async_options = get_async_log_options(config);
+
   // set defaults if they're not defined
   set_default_log_level(config, raw_mode);  // throws std::runtime_error on [logger:some_key] section
   if (!config.has_default("logging_folder"))
@@ -489,7 +534,8 @@ void MySQLRouter::init_main_logger(mysql_harness::LoaderConfig& config, bool raw
 
     // attach all loggers to main handler (throws std::runtime_error)
     mysql_harness::logging::create_main_logfile_handler(*registry, kProgramName,
-                                                        logging_folder, !raw_mode);
+                                                        logging_folder, !raw_mode,
+                                                        async_options);
 
     // nothing threw - we're good. Now let's replace the new registry with the old one
     DIM::instance().set_LoggingRegistry([&registry](){ return registry.release(); },
@@ -35,6 +35,7 @@
 #include "router_config.h"
 #include "mysql/harness/loader.h"
 #include "mysql/harness/arg_handler.h"
+#include "mysql/harness/logging/handler.h"
 #include "mysqlrouter/utils.h"
 #include "mysqlrouter/keyring_info.h"
 
@@ -308,6 +309,15 @@ private:
    */
   std::vector<std::string> check_config_files();
 
+  /** @brief Reads the asynchronous logging options of the [logger] section
+   *
+   * @param config configuration holding the [logger] section
+   * @return the options, defaults for options that are not set
+   *
+   * @throws std::invalid_argument on invalid values
+   */
+  static mysql_harness::logging::AsyncOptions get_async_log_options(const mysql_harness::LoaderConfig& config);
+
   /** @brief Shows the help screen on the console
    *
    * Shows the help screen on the console including
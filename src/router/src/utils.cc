@@ -34,6 +34,8 @@
 #include <iostream>
 #include <fstream>
 #include <cctype>
+#include <cerrno>
+#include <cstdio>
 #include <climits>
 #include <stdexcept>
 #include <functional>
@@ -184,6 +186,39 @@ int rename_file(const std::string &from, const std::string &to)
 #endif
 }
 
+void write_file_atomically(const std::string &path, const std::string &content) {
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (file.fail())
+      throw std::runtime_error("Could not create file '" + tmp_path + "': " +
+                               mysql_harness::get_strerror(errno));
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    file.close();
+    if (file.fail()) {
+      std::remove(tmp_path.c_str());
+      throw std::runtime_error("Could not write file '" + tmp_path + "'");
+    }
+  }
+
+  if (rename_file(tmp_path, path) != 0) {
+    const std::string error = mysql_harness::get_strerror(errno);
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error("Could not rename '" + tmp_path + "' to '" + path + "': " + error);
+  }
+}
+
+std::string get_topology_cache_file(const std::string &data_folder,
+                                    const std::string &section_name,
+                                    const std::string &section_key) {
+  if (data_folder.empty()) return "";
+
+  std::string name = section_name;
+  if (!section_key.empty()) name += "_" + section_key;
+
+  return mysql_harness::Path(data_folder).join(name + "_topology.json").str();
+}
+
 int mkdir(const std::string& dir, perm_mode mode) {
 #ifndef _WIN32
   return ::mkdir(dir.c_str(), mode);
@@ -940,6 +940,50 @@ TEST_F(AppLoggerTest, TestLogger) {
   }
 }
 
+/**
+ * @test
+ *       Verify the asynchronous logging options of the [logger] section.
+ */
+TEST_F(AppTest, AsyncLogOptions) {
+  using mysql_harness::logging::AsyncOptions;
+  using mysql_harness::logging::OverflowPolicy;
+
+  {
+    // no [logger] section: synchronous
+    mysql_harness::LoaderConfig config(mysql_harness::Config::allow_keys);
+    AsyncOptions options = MySQLRouter::get_async_log_options(config);
+    EXPECT_FALSE(options.enabled);
+    EXPECT_EQ(mysql_harness::logging::kDefaultAsyncQueueSize, options.queue_size);
+  }
+
+  {
+    mysql_harness::LoaderConfig config(mysql_harness::Config::allow_keys);
+    auto& section = config.add("logger");
+    section.add("async", "1");
+    section.add("async_queue_size", "128");
+    section.add("async_overflow", "Drop");
+    AsyncOptions options = MySQLRouter::get_async_log_options(config);
+    EXPECT_TRUE(options.enabled);
+    EXPECT_EQ(128u, options.queue_size);
+    EXPECT_EQ(OverflowPolicy::kDrop, options.overflow);
+  }
+
+  const std::vector<std::pair<std::string, std::string>> invalid = {
+    {"async", "yes"},
+    {"async_queue_size", "0"},
+    {"async_queue_size", "-1"},
+    {"async_queue_size", "1048577"},
+    {"async_queue_size", "12k"},
+    {"async_overflow", "wait"},
+  };
+  for (const auto& option: invalid) {
+    mysql_harness::LoaderConfig config(mysql_harness::Config::allow_keys);
+    config.add("logger").add(option.first, option.second);
+    EXPECT_THROW_LIKE(MySQLRouter::get_async_log_options(config), std::invalid_argument,
+                      "[logger] option '" + option.first + "'");
+  }
+}
+
 TEST_F(AppTest, EmptyConfigPath) {
   vector<string> argv = {
       "--config", ""
@@ -2807,6 +2807,7 @@ class MockSocketOperations : public mysql_harness::SocketOperationsBase {
   MOCK_METHOD1(freeaddrinfo, void(addrinfo *ai));
   MOCK_METHOD4(getaddrinfo, int(const char*, const char*, const addrinfo*, addrinfo**));
   MOCK_METHOD3(bind, int(int, const struct sockaddr*, socklen_t));
+  MOCK_METHOD3(connect, int(int, const struct sockaddr*, socklen_t));
   MOCK_METHOD3(socket, int(int, int, int));
   MOCK_METHOD5(setsockopt, int(int, int, int, const void*, socklen_t));
   MOCK_METHOD2(listen, int(int fd, int n));
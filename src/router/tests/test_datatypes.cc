@@ -109,6 +109,27 @@ TEST_F(TCPAddressTest, IPv6ValidPort) {
   EXPECT_TRUE(a.is_family<TCPAddress::Family::IPV6>());
 }
 
+TEST_F(TCPAddressTest, UnixSocket) {
+  TCPAddress a = TCPAddress::make_unix_socket("/var/run/mysqld/mysqld.sock");
+  EXPECT_EQ("/var/run/mysqld/mysqld.sock", a.addr);
+  EXPECT_EQ(0, a.port);
+  EXPECT_TRUE(a.is_valid());
+  EXPECT_TRUE(a.is_unix_socket());
+  EXPECT_EQ(TCPAddress::Family::UNIX, a.get_family());
+  EXPECT_FALSE(a.is_family<TCPAddress::Family::IPV4>());
+  EXPECT_FALSE(a.is_family<TCPAddress::Family::IPV6>());
+  EXPECT_EQ("unix:/var/run/mysqld/mysqld.sock", a.str());
+}
+
+TEST_F(TCPAddressTest, UnixSocketNotEqualToHost) {
+  TCPAddress unix_sock = TCPAddress::make_unix_socket("mysqld.sock");
+  TCPAddress host("mysqld.sock", 0);
+  EXPECT_FALSE(unix_sock == host);
+  EXPECT_TRUE(host < unix_sock);
+  EXPECT_FALSE(unix_sock < host);
+  EXPECT_TRUE(unix_sock == TCPAddress::make_unix_socket("mysqld.sock"));
+}
+
 int main(int argc, char *argv[])
 {
   init_windows_sockets();
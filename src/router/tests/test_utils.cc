@@ -37,6 +37,8 @@
 #include "mysqlrouter/utils.h"
 #include "mysql/harness/filesystem.h"
 #include <fstream>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
 
 const std::string kIPv6AddrRange = "fd84:8829:117d:63d5";
@@ -247,6 +249,36 @@ TEST_F(UtilsTests, copy_file) {
   mysql_harness::delete_file("data.tf2");
 }
 
+TEST_F(UtilsTests, write_file_atomically) {
+  std::ofstream("atomic.tf") << "old content";
+
+  mysqlrouter::write_file_atomically("atomic.tf", "new content");
+
+  std::ifstream file("atomic.tf");
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  mysql_harness::delete_file("atomic.tf");
+
+  EXPECT_EQ("new content", content);
+  EXPECT_FALSE(mysql_harness::Path("atomic.tf.tmp").exists());
+}
+
+TEST_F(UtilsTests, write_file_atomically_fails) {
+  EXPECT_THROW(mysqlrouter::write_file_atomically(
+                   mysql_harness::Path("no-such-dir.tf").join("file.tf").str(), "content"),
+               std::runtime_error);
+}
+
+TEST_F(UtilsTests, get_topology_cache_file) {
+  using mysqlrouter::get_topology_cache_file;
+
+  EXPECT_EQ("", get_topology_cache_file("", "metadata_cache", "cluster"));
+  EXPECT_EQ(mysql_harness::Path("/var/lib/mysqlrouter").join("metadata_cache_topology.json").str(),
+            get_topology_cache_file("/var/lib/mysqlrouter", "metadata_cache", ""));
+  EXPECT_EQ(mysql_harness::Path("/var/lib/mysqlrouter").join("metadata_cache_cluster_topology.json").str(),
+            get_topology_cache_file("/var/lib/mysqlrouter", "metadata_cache", "cluster"));
+}
+
 template <typename FUNC>
 void test_int_conv_common(FUNC func) {
 
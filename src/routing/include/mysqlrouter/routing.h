@@ -29,6 +29,7 @@
 #include "tcp_address.h"
 #include "mysqlrouter/plugin_config.h"
 
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -61,6 +62,9 @@ extern const int kDefaultWaitTimeout;
 /** @brief Max number of active routes for this routing instance */
 extern const int kDefaultMaxConnections;
 
+/** @brief Upper limit for the max_connections option */
+extern const uint32_t kMaxConnectionsLimit;
+
 /** @brief Timeout connecting to destination (in seconds)
  *
  * Constant defining how long we wait to establish connection with the server before we give up.
@@ -85,6 +89,20 @@ extern const unsigned long long kDefaultMaxConnectErrors;
  */
 extern const unsigned long long kDefaultMaxConnectErrors;
 
+/** @brief Maximum number of client hosts tracked for connection errors
+ *
+ * When more client hosts have connection errors, the one which had its
+ * last error longest ago is forgotten.
+ */
+extern const size_t kDefaultHostCacheSize;
+
+/** @brief Time after which connection errors of a client host are forgotten
+ *
+ * A blocked host which had no connection error for this long is unblocked.
+ * Zero means connection errors are never forgotten.
+ */
+extern const std::chrono::seconds kDefaultConnectErrorsTimeout;
+
 /** @brief Default bind address
  *
  */
@@ -106,6 +124,12 @@ extern const unsigned int kDefaultNetBufferLength;
  */
 extern const std::chrono::seconds kDefaultClientConnectTimeout;
 
+/** @brief Default backlog of listening sockets
+ *
+ * Maximum length of the queue of pending connections passed to listen().
+ */
+extern const int kDefaultListenBacklog;
+
 #ifdef _WIN32
   const SOCKET kInvalidSocket = INVALID_SOCKET;// windows defines INVALID_SOCKET already
 #else
@@ -192,6 +216,66 @@ std::string get_routing_strategy_name(RoutingStrategy routing_strategy) noexcept
  */
 void set_socket_blocking(int sock, bool blocking);
 
+/** @brief Socket options of a route
+ *
+ * Options are applied to the listening socket, to the accepted client
+ * sockets and to the sockets connected to the MySQL servers. Zero (or
+ * false) keeps the default of the operating system.
+ */
+struct SocketOptions {
+  /** @brief SO_RCVBUF in bytes */
+  int receive_buffer_size{0};
+  /** @brief SO_SNDBUF in bytes */
+  int send_buffer_size{0};
+  /** @brief TCP_NOTSENT_LOWAT in bytes */
+  int notsent_lowat{0};
+  /** @brief TCP_DEFER_ACCEPT in seconds (listening socket only) */
+  int defer_accept{0};
+  /** @brief TCP_FASTOPEN queue length (listening socket only)
+   *
+   * Not used for connections to MySQL servers: the server sends the first
+   * packet, so there is no data to carry in the SYN.
+   */
+  int fastopen{0};
+  /** @brief Whether to set SO_KEEPALIVE */
+  bool keepalive{false};
+  /** @brief TCP_KEEPIDLE in seconds */
+  int keepalive_idle{0};
+  /** @brief TCP_KEEPINTVL in seconds */
+  int keepalive_interval{0};
+  /** @brief TCP_KEEPCNT */
+  int keepalive_count{0};
+  /** @brief TCP_USER_TIMEOUT in milliseconds */
+  unsigned int user_timeout{0};
+  /** @brief Backlog passed to listen() */
+  int listen_backlog{kDefaultListenBacklog};
+};
+
+/** @brief Applies socket options to a listening socket
+ *
+ * Sets the buffer sizes, which accepted sockets inherit, TCP_DEFER_ACCEPT
+ * and TCP_FASTOPEN. Must be called before listen().
+ *
+ * @param sock a socket file descriptor
+ * @param options socket options of the route
+ * @param error set to the description of the first failure
+ * @return false when any of the options could not be set
+ */
+bool set_listen_socket_options(int sock, const SocketOptions &options, std::string &error) noexcept;
+
+/** @brief Applies socket options to a connected TCP socket
+ *
+ * Sets the buffer sizes, TCP_NOTSENT_LOWAT, keepalive and
+ * TCP_USER_TIMEOUT. Options not available on the platform are reported
+ * as failure when they are set.
+ *
+ * @param sock a socket file descriptor
+ * @param options socket options of the route
+ * @param error set to the description of the first failure
+ * @return false when any of the options could not be set
+ */
+bool set_connection_socket_options(int sock, const SocketOptions &options, std::string &error) noexcept;
+
 
 /** @class RoutingSockOpsInterface
  * @brief Interface class to allow multiple RoutingSockOps implementations
@@ -200,7 +284,8 @@ void set_socket_blocking(int sock, bool blocking);
 class RoutingSockOpsInterface {
  public:
   virtual ~RoutingSockOpsInterface() = default;
-  virtual int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout_ms, bool log = true) noexcept = 0;
+  virtual int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout_ms, bool log = true,
+                               const SocketOptions *socket_options = nullptr) noexcept = 0;
   virtual mysql_harness::SocketOperationsBase* so() const = 0;
 };
 
@@ -225,12 +310,17 @@ class RoutingSockOps : public RoutingSockOpsInterface {
    *  -2 - if connection timeout has expired for at least one of the attempted paths
    *  -1 - in case of any other error
    *
+   * Unix socket destinations (see TCPAddress::make_unix_socket()) are
+   * connected to directly, without name resolution and TCP_NODELAY.
+   *
    * @param addr information of the server we connect with
    * @param connect_timeout timeout waiting for connection
    * @param log whether to log errors or not
+   * @param socket_options socket options applied to TCP connections (optional)
    * @return a socket descriptor
    */
-  int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout, bool log = true) noexcept override;
+  int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout, bool log = true,
+                       const SocketOptions *socket_options = nullptr) noexcept override;
 
   /** @brief Returns SocketOperations implementation used by this class */
   mysql_harness::SocketOperationsBase* so() const override { return so_; }
@@ -240,6 +330,16 @@ class RoutingSockOps : public RoutingSockOpsInterface {
   RoutingSockOps(const RoutingSockOps&) = delete;
   RoutingSockOps operator=(const RoutingSockOps&) = delete;
 
+  /** @brief Connects to a Unix socket destination
+   *
+   * @param addr address with Family::UNIX holding the socket path
+   * @param connect_timeout how long to wait for the server to accept
+   * @param log whether to log errors or not
+   * @return a socket descriptor, -1 on error or -2 on timeout
+   */
+  int get_mysql_unix_socket(const mysql_harness::TCPAddress &addr, std::chrono::milliseconds connect_timeout,
+                            bool log) noexcept;
+
   mysql_harness::SocketOperationsBase* so_;
 };
 
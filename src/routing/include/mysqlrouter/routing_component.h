@@ -0,0 +1,386 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef MYSQLROUTER_ROUTING_COMPONENT_INCLUDED
+#define MYSQLROUTER_ROUTING_COMPONENT_INCLUDED
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  ifdef routing_DEFINE_STATIC
+#    define ROUTING_EXPORT
+#  else
+#    ifdef routing_EXPORTS
+#      define ROUTING_EXPORT __declspec(dllexport)
+#    else
+#      define ROUTING_EXPORT __declspec(dllimport)
+#    endif
+#  endif
+#else
+#  define ROUTING_EXPORT
+#endif
+
+namespace routing {
+
+/** @brief State of a destination of a route */
+struct DestinationStatus {
+  /** @brief address of the MySQL Server as host:port */
+  std::string address;
+  /** @brief number of open connections to the destination */
+  int64_t active_connections{0};
+  /** @brief number of connections made to the destination */
+  uint64_t total_connections{0};
+  /** @brief whether the destination is quarantined */
+  bool quarantined{false};
+};
+
+/** @brief State of a client connection of a route */
+struct ConnectionStatus {
+  /** @brief id of the connection, unique within the route */
+  uint64_t id{0};
+  /** @brief address of the client */
+  std::string client_address;
+  /** @brief address of the MySQL Server */
+  std::string server_address;
+  /** @brief when the connection was accepted, seconds since the epoch */
+  int64_t started{0};
+  /** @brief milliseconds since the connection was accepted */
+  int64_t age_ms{0};
+  /** @brief milliseconds since data was forwarded the last time */
+  int64_t idle_ms{0};
+  /** @brief bytes forwarded from the client to the server */
+  uint64_t bytes_from_client{0};
+  /** @brief bytes forwarded from the server to the client */
+  uint64_t bytes_from_server{0};
+  /** @brief number of reads forwarded from the client to the server */
+  uint64_t reads_from_client{0};
+  /** @brief number of reads forwarded from the server to the client */
+  uint64_t reads_from_server{0};
+};
+
+/** @brief Statistics of a query digest of a route */
+struct QueryDigestStatus {
+  /** @brief normalized statement */
+  std::string digest;
+  /** @brief estimated number of sampled statements */
+  uint64_t count{0};
+  /** @brief how much count may overestimate, see QueryDigestTable */
+  uint64_t count_error{0};
+  /** @brief number of sampled statements that failed */
+  uint64_t errors{0};
+  /** @brief sum of the latencies of the sampled statements */
+  uint64_t total_latency_us{0};
+  /** @brief highest latency of the sampled statements */
+  uint64_t max_latency_us{0};
+  /** @brief rows returned by the sampled statements */
+  uint64_t rows{0};
+  /** @brief bytes returned by the sampled statements */
+  uint64_t bytes{0};
+};
+
+/** @brief Connection errors of a client host of a route */
+struct ClientHostStatus {
+  /** @brief address of the client host */
+  std::string address;
+  /** @brief connection errors counted for the host */
+  uint64_t connect_errors{0};
+  /** @brief whether the host reached max_connect_errors */
+  bool blocked{false};
+};
+
+/** @brief Result of MySQLRoutingComponent::unblock_route_client_host() */
+enum class UnblockHostResult {
+  kUnblocked,
+  kRouteNotFound,
+  kHostNotFound,
+  kInvalidAddress,
+};
+
+/** @brief Result of MySQLRoutingComponent::close_route_connection() */
+enum class CloseConnectionResult {
+  kClosed,
+  kRouteNotFound,
+  kConnectionNotFound,
+};
+
+/** @brief State of a route at the time the snapshot was taken */
+struct RouteStatus {
+  /** @brief name of the route, as in the configuration section */
+  std::string name;
+  /** @brief TCP address the route listens on, empty when not used */
+  std::string bind_address;
+  /** @brief TCP port the route listens on, 0 when not used */
+  uint16_t bind_port{0};
+  /** @brief named socket the route listens on, empty when not used */
+  std::string socket;
+  /** @brief name of the protocol: classic or x */
+  std::string protocol;
+  /** @brief name of the routing strategy */
+  std::string routing_strategy;
+  /** @brief name of the access mode, empty when not used */
+  std::string mode;
+  /** @brief max_connections of the route */
+  int64_t max_connections{0};
+  /** @brief number of open client connections */
+  int64_t active_connections{0};
+  /** @brief number of client connections handled since start */
+  uint64_t total_connections{0};
+  /** @brief addresses of the blocked client hosts */
+  std::vector<std::string> blocked_hosts;
+  /** @brief destinations of the route */
+  std::vector<DestinationStatus> destinations;
+  /** @brief time the snapshot was taken, seconds since epoch */
+  int64_t timestamp{0};
+};
+
+/** @class RouteStatusSlot
+ * @brief Holds the latest snapshot of a route
+ *
+ * The route replaces the snapshot as a whole; readers get a reference
+ * to an immutable snapshot and never block the route.
+ */
+class RouteStatusSlot {
+ public:
+  using ConnectionsGetter = std::function<std::vector<ConnectionStatus>()>;
+  using ConnectionCloser = std::function<bool(uint64_t)>;
+  using QueryDigestsGetter = std::function<std::vector<QueryDigestStatus>()>;
+  using ClientHostsGetter = std::function<std::vector<ClientHostStatus>()>;
+  using ClientHostUnblocker = std::function<UnblockHostResult(const std::string &)>;
+
+  void store(std::shared_ptr<const RouteStatus> status) {
+    std::atomic_store(&status_, std::move(status));
+  }
+
+  std::shared_ptr<const RouteStatus> load() const {
+    return std::atomic_load(&status_);
+  }
+
+  /** @brief Sets the functions giving access to the live connections
+   *
+   * Unlike the snapshots, connections are inspected while the route
+   * runs. The route has to clear the handlers before it goes away.
+   */
+  void set_connection_handlers(ConnectionsGetter getter, ConnectionCloser closer) {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_connections_ = std::move(getter);
+    close_connection_ = std::move(closer);
+  }
+
+  /** @brief Clears the handlers, waits for running calls to finish */
+  void clear_connection_handlers() {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_connections_ = nullptr;
+    close_connection_ = nullptr;
+  }
+
+  /** @brief Returns false if the route doesn't provide its connections */
+  bool get_connections(std::vector<ConnectionStatus> &connections) const {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    if (!get_connections_) return false;
+    connections = get_connections_();
+    return true;
+  }
+
+  /** @brief Returns false if there is no such connection */
+  bool close_connection(uint64_t id) const {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    return close_connection_ && close_connection_(id);
+  }
+
+  /** @brief Sets the function giving access to the query digests
+   *
+   * Like the connection handlers, it has to be cleared before the route
+   * goes away.
+   */
+  void set_query_digests_getter(QueryDigestsGetter getter) {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_query_digests_ = std::move(getter);
+  }
+
+  /** @brief Clears the getter, waits for running calls to finish */
+  void clear_query_digests_getter() {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_query_digests_ = nullptr;
+  }
+
+  /** @brief Returns false if the route doesn't provide query digests */
+  bool get_query_digests(std::vector<QueryDigestStatus> &digests) const {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    if (!get_query_digests_) return false;
+    digests = get_query_digests_();
+    return true;
+  }
+
+  /** @brief Sets the functions giving access to the client host errors
+   *
+   * Like the connection handlers, they have to be cleared before the
+   * route goes away.
+   */
+  void set_client_host_handlers(ClientHostsGetter getter, ClientHostUnblocker unblocker) {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_client_hosts_ = std::move(getter);
+    unblock_client_host_ = std::move(unblocker);
+  }
+
+  /** @brief Clears the handlers, waits for running calls to finish */
+  void clear_client_host_handlers() {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    get_client_hosts_ = nullptr;
+    unblock_client_host_ = nullptr;
+  }
+
+  /** @brief Returns false if the route doesn't provide its client hosts */
+  bool get_client_hosts(std::vector<ClientHostStatus> &hosts) const {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    if (!get_client_hosts_) return false;
+    hosts = get_client_hosts_();
+    return true;
+  }
+
+  /** @brief Unblocks a client host, all of them if address is empty */
+  UnblockHostResult unblock_client_host(const std::string &address) const {
+    std::lock_guard<std::mutex> lock(connection_handlers_mtx_);
+    if (!unblock_client_host_) return UnblockHostResult::kRouteNotFound;
+    return unblock_client_host_(address);
+  }
+
+ private:
+  std::shared_ptr<const RouteStatus> status_;
+
+  mutable std::mutex connection_handlers_mtx_;
+  ConnectionsGetter get_connections_;
+  ConnectionCloser close_connection_;
+  QueryDigestsGetter get_query_digests_;
+  ClientHostsGetter get_client_hosts_;
+  ClientHostUnblocker unblock_client_host_;
+};
+
+} // namespace routing
+
+/** @class MySQLRoutingComponent
+ * @brief Registry of the running routes
+ *
+ * Routes register a slot to which they publish snapshots of their state.
+ * Other plugins, like rest_routing, read the snapshots.
+ */
+class ROUTING_EXPORT MySQLRoutingComponent {
+ public:
+  static MySQLRoutingComponent& getInstance();
+
+  /** @brief Registers a route
+   *
+   * @param name name of the route
+   * @return slot the route publishes its snapshots to
+   */
+  std::shared_ptr<routing::RouteStatusSlot> register_route(const std::string &name);
+
+  /** @brief Unregisters a route
+   *
+   * @param name name of the route
+   */
+  void unregister_route(const std::string &name);
+
+  /** @brief Returns the names of the registered routes, sorted */
+  std::vector<std::string> get_route_names() const;
+
+  /** @brief Returns the latest snapshot of a route
+   *
+   * @param name name of the route
+   * @return snapshot, or nullptr when the route is unknown or did not
+   *         publish yet
+   */
+  std::shared_ptr<const routing::RouteStatus> get_route_status(const std::string &name) const;
+
+  /** @brief Returns the open connections of a route
+   *
+   * @param name name of the route
+   * @param[out] connections open connections of the route
+   * @return false when the route is unknown
+   */
+  bool get_route_connections(const std::string &name,
+                             std::vector<routing::ConnectionStatus> &connections) const;
+
+  /** @brief Closes a connection of a route
+   *
+   * The connection is marked to be closed, its thread closes it shortly
+   * after.
+   *
+   * @param name name of the route
+   * @param id id of the connection
+   */
+  routing::CloseConnectionResult close_route_connection(const std::string &name, uint64_t id);
+
+  /** @brief Returns the query digests of a route
+   *
+   * @param name name of the route
+   * @param[out] digests query digests of the route, empty when the route
+   *             doesn't sample statements
+   * @return false when the route is unknown
+   */
+  bool get_route_query_digests(const std::string &name,
+                               std::vector<routing::QueryDigestStatus> &digests) const;
+
+  /** @brief Returns the client hosts with connection errors of a route
+   *
+   * @param name name of the route
+   * @param[out] hosts client hosts with connection errors, sorted by
+   *             address
+   * @return false when the route is unknown
+   */
+  bool get_route_client_hosts(const std::string &name,
+                              std::vector<routing::ClientHostStatus> &hosts) const;
+
+  /** @brief Unblocks a client host of a route
+   *
+   * Resets the connection errors of the host, like FLUSH HOSTS does in
+   * MySQL Server.
+   *
+   * @param name name of the route
+   * @param address IP address of the client host, empty to unblock all
+   *        hosts of the route
+   */
+  routing::UnblockHostResult unblock_route_client_host(const std::string &name,
+                                                       const std::string &address);
+
+ private:
+  // disable copy, as we are a single-instance
+  MySQLRoutingComponent(MySQLRoutingComponent const &) = delete;
+  void operator=(MySQLRoutingComponent const &) = delete;
+
+  MySQLRoutingComponent() = default;
+
+  std::shared_ptr<routing::RouteStatusSlot> get_slot(const std::string &name) const;
+
+  mutable std::mutex routes_mtx_;
+  std::map<std::string, std::shared_ptr<routing::RouteStatusSlot>> routes_;
+};
+
+#endif // MYSQLROUTER_ROUTING_COMPONENT_INCLUDED
@@ -0,0 +1,165 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "client_error_table.h"
+
+#include <algorithm>
+
+size_t ClientIpArrayHash::operator()(const ClientIpArray &ip) const noexcept {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (const auto byte : ip) {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash);
+}
+
+ClientErrorTable::ClientErrorTable(size_t capacity,
+                                   std::chrono::milliseconds expiry,
+                                   size_t num_shards)
+    // a shard holds at least one host, more shards would exceed capacity
+    : shards_(std::max<size_t>(std::min(num_shards, capacity), 1)),
+      shard_capacity_(std::max<size_t>(capacity / shards_.size(), 1)),
+      expiry_(expiry) {}
+
+ClientErrorTable::Shard &ClientErrorTable::get_shard(const ClientIpArray &ip) {
+  return shards_[ClientIpArrayHash()(ip) % shards_.size()];
+}
+
+const ClientErrorTable::Shard &ClientErrorTable::get_shard(
+    const ClientIpArray &ip) const {
+  return shards_[ClientIpArrayHash()(ip) % shards_.size()];
+}
+
+bool ClientErrorTable::is_expired(const Node &node,
+                                  clock_type::time_point now) const {
+  return expiry_ > std::chrono::milliseconds::zero() &&
+         now - node.last_error >= expiry_;
+}
+
+void ClientErrorTable::purge_expired(Shard &shard, clock_type::time_point now) {
+  // the list is ordered by last error, expired nodes are at the tail
+  while (!shard.lru.empty() && is_expired(shard.lru.back(), now)) {
+    shard.index.erase(shard.lru.back().ip);
+    shard.lru.pop_back();
+  }
+}
+
+size_t ClientErrorTable::increment(const ClientIpArray &ip) {
+  const auto now = clock_type::now();
+  Shard &shard = get_shard(ip);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+
+  purge_expired(shard, now);
+
+  auto found = shard.index.find(ip);
+  if (found != shard.index.end()) {
+    auto node = found->second;
+    ++node->errors;
+    node->last_error = now;
+    shard.lru.splice(shard.lru.begin(), shard.lru, node);
+    return node->errors;
+  }
+
+  if (shard.lru.size() >= shard_capacity_) {
+    // evict the host which had its last error longest ago
+    shard.index.erase(shard.lru.back().ip);
+    shard.lru.pop_back();
+  }
+
+  shard.lru.push_front(Node{ip, 1, now});
+  shard.index.emplace(ip, shard.lru.begin());
+
+  return 1;
+}
+
+size_t ClientErrorTable::get(const ClientIpArray &ip) const {
+  const Shard &shard = get_shard(ip);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+
+  auto found = shard.index.find(ip);
+  if (found == shard.index.end() ||
+      is_expired(*found->second, clock_type::now())) {
+    return 0;
+  }
+
+  return found->second->errors;
+}
+
+bool ClientErrorTable::erase(const ClientIpArray &ip) {
+  Shard &shard = get_shard(ip);
+  std::lock_guard<std::mutex> lock(shard.mtx);
+
+  auto found = shard.index.find(ip);
+  if (found == shard.index.end()) {
+    return false;
+  }
+
+  shard.lru.erase(found->second);
+  shard.index.erase(found);
+
+  return true;
+}
+
+void ClientErrorTable::clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.index.clear();
+    shard.lru.clear();
+  }
+}
+
+std::vector<ClientErrorTable::Entry> ClientErrorTable::get_entries(
+    size_t min_errors) const {
+  const auto now = clock_type::now();
+  std::vector<Entry> result;
+
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    for (const auto &node : shard.lru) {
+      if (is_expired(node, now)) {
+        // the rest of the list is older
+        break;
+      }
+      if (node.errors >= min_errors) {
+        result.emplace_back(node.ip, node.errors);
+      }
+    }
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const Entry &a, const Entry &b) { return a.first < b.first; });
+
+  return result;
+}
+
+size_t ClientErrorTable::size() const {
+  size_t result = 0;
+  for (const auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    result += shard.lru.size();
+  }
+  return result;
+}
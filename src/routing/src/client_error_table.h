@@ -0,0 +1,154 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ROUTING_CLIENT_ERROR_TABLE_INCLUDED
+#define ROUTING_CLIENT_ERROR_TABLE_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * @brief Hash function for ClientIpArray (FNV-1a)
+ */
+struct ClientIpArrayHash {
+  size_t operator()(const ClientIpArray &ip) const noexcept;
+};
+
+/**
+ * @brief Table of connection errors per client host
+ *
+ * Counts the connection/handshake errors of client hosts, which is used to
+ * block hosts reaching max_connect_errors.
+ *
+ * The table is split in shards, each with its own mutex, so threads
+ * reporting errors for different hosts don't contend with each other and
+ * with the acceptor checking new connections. Lookups are hash lookups.
+ *
+ * The table is bounded: when a shard is full, the host which had its last
+ * error longest ago is evicted. Entries can also expire: when a host had
+ * no error for `expiry` its error counter is reset, which unblocks it.
+ */
+class ClientErrorTable {
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  /** @brief error counter of a client host */
+  using Entry = std::pair<ClientIpArray, size_t>;
+
+  static const size_t kDefaultNumShards = 16;
+
+  /**
+   * @param capacity maximum number of client hosts kept in the table
+   * @param expiry time without errors after which a host is forgotten,
+   *        zero means never
+   * @param num_shards number of shards the table is split in, at most
+   *        `capacity`
+   */
+  ClientErrorTable(size_t capacity, std::chrono::milliseconds expiry,
+                   size_t num_shards = kDefaultNumShards);
+
+  ClientErrorTable(const ClientErrorTable &) = delete;
+  ClientErrorTable &operator=(const ClientErrorTable &) = delete;
+
+  /**
+   * @brief Increments the error counter of the host.
+   *
+   * @return error counter after increment
+   */
+  size_t increment(const ClientIpArray &ip);
+
+  /**
+   * @brief Returns the error counter of the host.
+   *
+   * Unknown or expired hosts have 0 errors. Never inserts into the table.
+   */
+  size_t get(const ClientIpArray &ip) const;
+
+  /**
+   * @brief Removes the host from the table.
+   *
+   * @return true if the host was in the table
+   */
+  bool erase(const ClientIpArray &ip);
+
+  /** @brief Removes all hosts from the table */
+  void clear();
+
+  /**
+   * @brief Returns hosts having at least `min_errors` errors.
+   *
+   * Result is sorted by IP address.
+   */
+  std::vector<Entry> get_entries(size_t min_errors = 0) const;
+
+  /** @brief Number of hosts in the table, including expired ones not purged yet */
+  size_t size() const;
+
+  /**
+   * @brief Maximum number of hosts in the table
+   *
+   * `capacity` of the constructor rounded down to a multiple of the number
+   * of shards.
+   */
+  size_t get_capacity() const noexcept { return shard_capacity_ * shards_.size(); }
+
+  std::chrono::milliseconds get_expiry() const noexcept { return expiry_; }
+
+ private:
+  struct Node {
+    ClientIpArray ip;
+    size_t errors;
+    clock_type::time_point last_error;
+  };
+
+  /** most recent error at the front */
+  using LruList = std::list<Node>;
+
+  struct Shard {
+    mutable std::mutex mtx;
+    LruList lru;
+    std::unordered_map<ClientIpArray, LruList::iterator, ClientIpArrayHash> index;
+  };
+
+  Shard &get_shard(const ClientIpArray &ip);
+  const Shard &get_shard(const ClientIpArray &ip) const;
+
+  bool is_expired(const Node &node, clock_type::time_point now) const;
+
+  /** removes expired nodes from the tail of the LRU list, shard must be locked */
+  void purge_expired(Shard &shard, clock_type::time_point now);
+
+  std::vector<Shard> shards_;
+  size_t shard_capacity_;
+  std::chrono::milliseconds expiry_;
+};
+
+#endif  // ROUTING_CLIENT_ERROR_TABLE_INCLUDED
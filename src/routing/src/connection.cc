@@ -23,6 +23,7 @@
 */
 
 #include <cstring>
+#include <memory>
 #include <string>
 
 #include "common.h"
@@ -31,21 +32,48 @@
 #include "mysql_routing_common.h"
 #include "mysql/harness/loader.h"
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/tracing.h"
 #include "mysqlrouter/routing.h"
+#include "protocol/classic_query_tracker.h"
 #include "utils.h"
 IMPORT_LOG_FUNCTIONS()
 
-MySQLRoutingConnection ::MySQLRoutingConnection(MySQLRoutingContext& context, int client_socket,
+using clock_type = MySQLRoutingConnection::clock_type;
+
+static double seconds_since(clock_type::time_point start,
+                            clock_type::time_point end = clock_type::now()) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+MySQLRoutingConnection ::MySQLRoutingConnection(MySQLRoutingContext& context, uint64_t id, int client_socket,
     const sockaddr_storage& client_addr, int server_socket,
     const mysql_harness::TCPAddress& server_address,
+    const Timestamps& timestamps,
     std::function<void(MySQLRoutingConnection*)> remove_callback) :
   context_(context),
+  id_(id),
   remove_callback_(remove_callback),
   client_socket_(client_socket),
   client_addr_(client_addr),
   server_socket_(server_socket),
   server_address_(server_address),
+  timestamps_(timestamps),
+  // connections are created in the trace scope of the acceptor
+  trace_id_(mysql_harness::tracing::current_trace_id()),
   client_address_(make_client_address(client_socket, context)){
+  stats_.last_activity.store(timestamps_.connected.time_since_epoch().count(),
+                             std::memory_order_relaxed);
+}
+
+MySQLRoutingConnection::MySQLRoutingConnection(MySQLRoutingContext& context, uint64_t id,
+    int client_socket, const sockaddr_storage& client_addr,
+    ServerConnector connect_server,
+    clock_type::time_point accepted,
+    std::function<void(MySQLRoutingConnection*)> remove_callback) :
+  MySQLRoutingConnection(context, id, client_socket, client_addr,
+      routing::kInvalidSocket, mysql_harness::TCPAddress(),
+      Timestamps{accepted, accepted, accepted}, remove_callback) {
+  connect_server_ = std::move(connect_server);
 }
 
 void MySQLRoutingConnection::start(bool detached) {
@@ -58,6 +86,7 @@ void MySQLRoutingConnection::start(bool detached) {
                           "Router couldn't spawn a new thread to service new client connection",
                           "HY000", context_.get_name());
     context_.get_socket_operations()->close(client_socket_); // no shutdown() before close()
+    context_.get_rate_limiter().release(client_addr_);
 
     // we only want to log this message once, because in a low-resource situation, this would
     // lead do a DoS against ourselves (heavy I/O and disk full)
@@ -98,6 +127,7 @@ bool MySQLRoutingConnection::check_sockets() {
     if (server_socket_ != routing::kInvalidSocket) {
       context_.get_socket_operations()->close(server_socket_);
     }
+    context_.get_metrics().errors_connect.increment();
     return false;
   }
 
@@ -109,14 +139,18 @@ void MySQLRoutingConnection::run() {
 
   context_.increase_active_thread_counter();
   std::shared_ptr<void> thread_exit_guard(nullptr, [&](void *){
+    context_.get_rate_limiter().release(client_addr_);
     context_.decrease_active_thread_counter();
 
     // remove callback has to be executed as a last thing in connection
     remove_callback_(this);
   });
 
-  std::size_t bytes_down = 0;
-  std::size_t bytes_up = 0;
+  mysql_harness::tracing::TraceScope trace_scope(trace_id_);
+  mysql_harness::tracing::Span session_span("session");
+
+  if (connect_server_) connect_server();
+
   std::size_t bytes_read = 0;
   std::string extra_msg = "";
   RoutingProtocolBuffer buffer(context_.get_net_buffer_length());
@@ -148,6 +182,19 @@ void MySQLRoutingConnection::run() {
 
   context_.increase_info_active_routes();
   context_.increase_info_handled_routes();
+  auto destination_counters = context_.get_destination_stats().acquire(server_address_.str());
+
+  auto &latency = context_.get_metrics().connection_latency(server_address_.str());
+  latency.accept_to_connect.observe(seconds_since(timestamps_.accepted, timestamps_.connected));
+  latency.connect.observe(seconds_since(timestamps_.connect_started, timestamps_.connected));
+  bool greeting_received = false;
+  bool handshake_recorded = false;
+
+  std::unique_ptr<ClassicQueryTracker> query_tracker;
+  if (context_.get_query_digests().is_enabled() &&
+      context_.get_protocol().get_type() == BaseProtocol::Type::kClassicProtocol) {
+    query_tracker.reset(new ClassicQueryTracker(context_.get_query_digests()));
+  }
 
   int pktnr = 0;
 
@@ -208,8 +255,13 @@ void MySQLRoutingConnection::run() {
 
     // Handle traffic from Server to Client
     // Note: In classic protocol Server _always_ talks first
-    if (context_.get_protocol().copy_packets(server_socket_, client_socket_, server_is_readable,
-                                             buffer, &pktnr, handshake_done, &bytes_read, true) == -1) {
+    int copy_res;
+    {
+      mysql_harness::tracing::Span span("copy_packets server->client", server_is_readable);
+      copy_res = context_.get_protocol().copy_packets(server_socket_, client_socket_, server_is_readable,
+                                                      buffer, &pktnr, handshake_done, &bytes_read, true);
+    }
+    if (copy_res == -1) {
       const int last_errno = context_.get_socket_operations()->get_errno();
       if (last_errno > 0) {
         // if read() against closed socket, errno will be 0. Don't log that.
@@ -218,12 +270,24 @@ void MySQLRoutingConnection::run() {
 
       connection_is_ok = false;
     } else {
-      bytes_up += bytes_read;
+      if (bytes_read > 0) {
+        count_read(stats_.bytes_from_server, stats_.reads_from_server, bytes_read);
+        context_.get_metrics().bytes_server_to_client.add(bytes_read);
+        if (!greeting_received) {
+          greeting_received = true;
+          latency.greeting.observe(seconds_since(timestamps_.connected));
+        }
+        if (query_tracker) query_tracker->on_server_data(&buffer[0], bytes_read);
+      }
     }
 
     // Handle traffic from Client to Server
-    if (context_.get_protocol().copy_packets(client_socket_, server_socket_, client_is_readable,
-                                             buffer, &pktnr, handshake_done, &bytes_read, false) == -1) {
+    {
+      mysql_harness::tracing::Span span("copy_packets client->server", client_is_readable);
+      copy_res = context_.get_protocol().copy_packets(client_socket_, server_socket_, client_is_readable,
+                                                      buffer, &pktnr, handshake_done, &bytes_read, false);
+    }
+    if (copy_res == -1) {
       const int last_errno = context_.get_socket_operations()->get_errno();
       if (last_errno > 0) {
         extra_msg = std::string("Copy client->server failed: " + mysqlrouter::to_string(get_message_error(last_errno)));
@@ -233,12 +297,22 @@ void MySQLRoutingConnection::run() {
       // client close on us.
       connection_is_ok = false;
     } else {
-      bytes_down += bytes_read;
+      if (bytes_read > 0) {
+        count_read(stats_.bytes_from_client, stats_.reads_from_client, bytes_read);
+        context_.get_metrics().bytes_client_to_server.add(bytes_read);
+        if (query_tracker) query_tracker->on_client_data(&buffer[0], bytes_read);
+      }
+    }
+
+    if (handshake_done && !handshake_recorded) {
+      handshake_recorded = true;
+      latency.handshake.observe(seconds_since(timestamps_.accepted));
     }
 
   } // while (connection_is_ok && !disconnect_.load())
 
   if (!handshake_done) {
+    context_.get_metrics().errors_pre_auth.increment();
     log_info("[%s] fd=%d Pre-auth socket failure %s: %s",
         context_.get_name().c_str(),
         client_socket_,
@@ -254,22 +328,84 @@ void MySQLRoutingConnection::run() {
   context_.get_socket_operations()->close(server_socket_);
 
   context_.decrease_info_active_routes();
+  routing::DestinationStatsTable::release(destination_counters);
+  latency.session.observe(seconds_since(timestamps_.accepted));
 #ifndef _WIN32
   log_debug("[%s] fd=%d connection closed (up: %zub; down: %zub) %s",
       context_.get_name().c_str(),
-      client_socket_, bytes_up, bytes_down, extra_msg.c_str());
+      client_socket_,
+      static_cast<size_t>(stats_.bytes_from_server.load()),
+      static_cast<size_t>(stats_.bytes_from_client.load()), extra_msg.c_str());
 #else
   log_debug("[%s] fd=%d connection closed (up: %Iub; down: %Iub) %s",
       context_.get_name().c_str(),
-      client_socket_, bytes_up, bytes_down, extra_msg.c_str());
+      client_socket_,
+      static_cast<size_t>(stats_.bytes_from_server.load()),
+      static_cast<size_t>(stats_.bytes_from_client.load()), extra_msg.c_str());
 #endif
 }
 
+void MySQLRoutingConnection::connect_server() {
+  // may wait for a while, e.g. for a primary failover, which is why it's done
+  // here and not in the acceptor
+  timestamps_.connect_started = clock_type::now();
+  mysql_harness::TCPAddress server_address;
+  {
+    mysql_harness::tracing::Span span("get_server_socket", timestamps_.connect_started);
+    server_socket_ = connect_server_(&server_address);
+  }
+  timestamps_.connected = clock_type::now();
+  context_.get_metrics().connect_duration.observe(
+      seconds_since(timestamps_.connect_started, timestamps_.connected));
+  stats_.last_activity.store(timestamps_.connected.time_since_epoch().count(),
+                             std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(server_address_mtx_);
+  server_address_ = server_address;
+}
+
 void MySQLRoutingConnection::disconnect() noexcept {
   disconnect_ = true;
 }
 
-const mysql_harness::TCPAddress& MySQLRoutingConnection::get_server_address() const noexcept {
+void MySQLRoutingConnection::count_read(std::atomic<uint64_t> &bytes_counter,
+                                        std::atomic<uint64_t> &reads_counter,
+                                        size_t bytes) noexcept {
+  // only this connection's thread writes the counters
+  bytes_counter.store(bytes_counter.load(std::memory_order_relaxed) + bytes,
+                      std::memory_order_relaxed);
+  reads_counter.store(reads_counter.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+  stats_.last_activity.store(clock_type::now().time_since_epoch().count(),
+                             std::memory_order_relaxed);
+}
+
+routing::ConnectionStatus MySQLRoutingConnection::get_status() const {
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+
+  const auto now = clock_type::now();
+  const clock_type::time_point last_activity(
+      clock_type::duration(stats_.last_activity.load(std::memory_order_relaxed)));
+
+  routing::ConnectionStatus status;
+  status.id = id_;
+  status.client_address = client_address_;
+  status.server_address = get_server_address().str();
+  status.age_ms = duration_cast<milliseconds>(now - timestamps_.accepted).count();
+  status.idle_ms = duration_cast<milliseconds>(now - last_activity).count();
+  status.started = std::chrono::duration_cast<std::chrono::seconds>(
+      (std::chrono::system_clock::now() - milliseconds(status.age_ms)).time_since_epoch()).count();
+  status.bytes_from_client = stats_.bytes_from_client.load(std::memory_order_relaxed);
+  status.bytes_from_server = stats_.bytes_from_server.load(std::memory_order_relaxed);
+  status.reads_from_client = stats_.reads_from_client.load(std::memory_order_relaxed);
+  status.reads_from_server = stats_.reads_from_server.load(std::memory_order_relaxed);
+
+  return status;
+}
+
+mysql_harness::TCPAddress MySQLRoutingConnection::get_server_address() const {
+  std::lock_guard<std::mutex> lock(server_address_mtx_);
   return server_address_;
 }
 
@@ -28,10 +28,12 @@
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 
 #include "context.h"
 #include "mysql_router_thread.h"
+#include "mysqlrouter/routing_component.h"
 #include "protocol/base_protocol.h"
 #include "tcp_address.h"
 
@@ -53,6 +55,21 @@ namespace mysql_harness { class PluginFuncEnv; }
 class MySQLRoutingConnection {
 
 public:
+  using clock_type = std::chrono::steady_clock;
+
+  /** @brief connects to a server, returns the socket (or -1) and stores the
+   *         address of the server in the argument */
+  using ServerConnector = std::function<int(mysql_harness::TCPAddress *)>;
+
+  /** @brief points in time of connection setup done before run() */
+  struct Timestamps {
+    /** @brief client connection was accepted */
+    clock_type::time_point accepted;
+    /** @brief started connecting to the server */
+    clock_type::time_point connect_started;
+    /** @brief connecting to the server finished */
+    clock_type::time_point connected;
+  };
 
   /**
    * @brief Creates and initializes connection object. It doesn't create
@@ -60,19 +77,45 @@ public:
    *        execution call start().
    *
    * @param context wrapper for common data used by all connection threads
+   * @param id id of the connection, unique within the route
    * @param client_socket socket used to send/receive data to/from client
    * @param client_addr address of the socket used to send/receive data to/from client
    * @param server_socket socket used to send/receive data to/from server
    * @param server_address IP address and TCP port of MySQL Server
+   * @param timestamps when the client was accepted and the server connected
    * @param remove_callback called when thread finishes its execution to remove
    *        associated MySQLRoutingConnection from container. It must be called
    *        at the very end of thread execution
    */
   MySQLRoutingConnection(MySQLRoutingContext& context,
+      uint64_t id,
       int client_socket,
       const sockaddr_storage& client_addr,
       int server_socket,
       const mysql_harness::TCPAddress& server_address,
+      const Timestamps& timestamps,
+      std::function<void(MySQLRoutingConnection*)> remove_callback);
+
+  /**
+   * @brief Creates a connection object that connects to the server itself,
+   *        from its own thread, at the beginning of run().
+   *
+   * @param context wrapper for common data used by all connection threads
+   * @param id id of the connection, unique within the route
+   * @param client_socket socket used to send/receive data to/from client
+   * @param client_addr address of the socket used to send/receive data to/from client
+   * @param connect_server called by run() to connect to the server
+   * @param accepted when the client connection was accepted
+   * @param remove_callback called when thread finishes its execution to remove
+   *        associated MySQLRoutingConnection from container. It must be called
+   *        at the very end of thread execution
+   */
+  MySQLRoutingConnection(MySQLRoutingContext& context,
+      uint64_t id,
+      int client_socket,
+      const sockaddr_storage& client_addr,
+      ServerConnector connect_server,
+      clock_type::time_point accepted,
       std::function<void(MySQLRoutingConnection*)> remove_callback);
 
   /**
@@ -105,12 +148,25 @@ public:
    */
   void disconnect() noexcept;
 
+  /** @brief Returns the id of the connection */
+  uint64_t get_id() const noexcept { return id_; }
+
+  /**
+   * @brief Returns the current state of the connection.
+   *
+   * Reads the counters the connection thread updates while forwarding,
+   * safe to call from any thread.
+   */
+  routing::ConnectionStatus get_status() const;
+
   /**
    * @brief Returns address of server to which connection is established.
    *
+   * Empty while the connection is still connecting to the server.
+   *
    * @return address of server
    */
-  const mysql_harness::TCPAddress& get_server_address() const noexcept;
+  mysql_harness::TCPAddress get_server_address() const;
 
   /**
    * @brief Returns address of client which connected to router
@@ -121,17 +177,48 @@ public:
 
 private:
 
+  /** @brief counters updated by the connection thread, read by others */
+  struct Stats {
+    std::atomic<uint64_t> bytes_from_client{0};
+    std::atomic<uint64_t> bytes_from_server{0};
+    std::atomic<uint64_t> reads_from_client{0};
+    std::atomic<uint64_t> reads_from_server{0};
+    /** @brief time_since_epoch() of the last forwarded data */
+    std::atomic<clock_type::rep> last_activity{0};
+  };
+
+  /** @brief connects to the server using connect_server_ */
+  void connect_server();
+
+  /** @brief adds a forwarded read of `bytes` to the counters */
+  void count_read(std::atomic<uint64_t> &bytes_counter,
+                  std::atomic<uint64_t> &reads_counter, size_t bytes) noexcept;
+
   /** @brief wrapper for common data used by all routing threads */
   MySQLRoutingContext& context_;
+  /** @brief id of the connection */
+  const uint64_t id_;
   /** @brief callback that is called when thread of execution completes */
   std::function<void(MySQLRoutingConnection*)> remove_callback_;
   /** @brief socket used to communicate with client */
   int client_socket_;
   /** @brief client's address */
   const sockaddr_storage client_addr_;
+  /** @brief connects to the server from run(), empty if the server socket
+   *         was passed to the constructor */
+  ServerConnector connect_server_;
   /** @brief socket used to communicate with server */
   int server_socket_;
+  /** @brief guards server_address_, which run() may set */
+  mutable std::mutex server_address_mtx_;
   mysql_harness::TCPAddress server_address_;
+  /** @brief when the connection was accepted and connected, only changed
+   *         by run() before it reads them */
+  Timestamps timestamps_;
+  /** @brief traffic counters */
+  Stats stats_;
+  /** @brief trace the connection records its spans for, 0 if not traced */
+  const uint64_t trace_id_;
   /** @brief true if connection should be disconnected */
   std::atomic<bool> disconnect_{false};
   /** @brief address of the client */
@@ -38,8 +38,10 @@ void ConnectionContainer::disconnect(const AllowedNodes& nodes) {
   auto mark_to_diconnect_if_not_allowed =
       [&nodes, &number_of_disconnected_connections](std::pair<MySQLRoutingConnection* const,
                                                     std::unique_ptr<MySQLRoutingConnection>>& connection) {
-    const auto& server_address = connection.first->get_server_address();
+    const auto server_address = connection.first->get_server_address();
     const std::string& client_address = connection.first->get_client_address();
+    // still connecting, it picks its server from the new nodes
+    if (server_address.addr.empty()) return;
     if (std::find(nodes.begin(), nodes.end(), server_address) == nodes.end()) {
       log_info("Disconnecting client %s from server %s", client_address.c_str(), server_address.str().c_str());
       connection.first->disconnect();
@@ -52,6 +54,26 @@ void ConnectionContainer::disconnect(const AllowedNodes& nodes) {
     log_info("Disconnected %u connections", number_of_disconnected_connections);
 }
 
+void ConnectionContainer::disconnect_servers(const std::vector<mysql_harness::TCPAddress>& servers) {
+  unsigned number_of_disconnected_connections = 0;
+
+  auto mark_to_disconnect_if_disallowed =
+      [&servers, &number_of_disconnected_connections](std::pair<MySQLRoutingConnection* const,
+                                                      std::unique_ptr<MySQLRoutingConnection>>& connection) {
+    const auto server_address = connection.first->get_server_address();
+    if (std::find(servers.begin(), servers.end(), server_address) != servers.end()) {
+      log_info("Disconnecting client %s from server %s",
+               connection.first->get_client_address().c_str(), server_address.str().c_str());
+      connection.first->disconnect();
+      ++number_of_disconnected_connections;
+    }
+  };
+
+  connections_.for_each(mark_to_disconnect_if_disallowed);
+  if (number_of_disconnected_connections > 0)
+    log_info("Disconnected %u connections", number_of_disconnected_connections);
+}
+
 void ConnectionContainer::disconnect_all() {
   auto mark_to_disconnect =
       [](std::pair<MySQLRoutingConnection* const, std::unique_ptr<MySQLRoutingConnection>>& connection) {
@@ -61,6 +83,36 @@ void ConnectionContainer::disconnect_all() {
   connections_.for_each(mark_to_disconnect);
 }
 
+bool ConnectionContainer::disconnect(uint64_t id) {
+  bool found = false;
+  auto mark_to_disconnect_if_id_matches =
+      [id, &found](std::pair<MySQLRoutingConnection* const, std::unique_ptr<MySQLRoutingConnection>>& connection) {
+    if (connection.first->get_id() == id) {
+      log_info("Disconnecting client %s from server %s on request",
+               connection.first->get_client_address().c_str(),
+               connection.first->get_server_address().str().c_str());
+      connection.first->disconnect();
+      found = true;
+    }
+  };
+
+  connections_.for_each(mark_to_disconnect_if_id_matches);
+
+  return found;
+}
+
+std::vector<routing::ConnectionStatus> ConnectionContainer::get_connections() {
+  std::vector<routing::ConnectionStatus> result;
+  auto add_status =
+      [&result](std::pair<MySQLRoutingConnection* const, std::unique_ptr<MySQLRoutingConnection>>& connection) {
+    result.push_back(connection.first->get_status());
+  };
+
+  connections_.for_each(add_status);
+
+  return result;
+}
+
 void ConnectionContainer::remove_connection(
     MySQLRoutingConnection* connection) {
   connections_.erase(connection);
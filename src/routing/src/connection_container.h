@@ -176,11 +176,31 @@ public:
    */
   void disconnect(const AllowedNodes& nodes);
 
+  /**
+   * @brief Disconnects the connections to the given servers.
+   *
+   * @param servers Servers that are not allowed anymore.
+   */
+  void disconnect_servers(const std::vector<mysql_harness::TCPAddress>& servers);
+
   /**
    * @brief Disconnects all connection in the ConnectionContainer.
    */
   void disconnect_all();
 
+  /**
+   * @brief Marks the connection with the given id to be disconnected.
+   *
+   * @param id id of the connection
+   * @return false if there is no connection with that id
+   */
+  bool disconnect(uint64_t id);
+
+  /**
+   * @brief Returns the state of all connections in the container.
+   */
+  std::vector<routing::ConnectionStatus> get_connections();
+
   /**
    * @brief removes connection from container
    *
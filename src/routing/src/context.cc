@@ -43,7 +43,9 @@ MySQLRoutingContext ::MySQLRoutingContext(BaseProtocol* protocol,
     std::chrono::milliseconds client_connect_timeout,
     const mysql_harness::TCPAddress& bind_address,
     const mysql_harness::Path& bind_named_socket,
-    unsigned long long max_connect_errors, size_t thread_stack_size) :
+    unsigned long long max_connect_errors, size_t thread_stack_size,
+    size_t host_cache_size, std::chrono::milliseconds connect_errors_timeout) :
+  max_connect_errors_(max_connect_errors),
   protocol_(protocol),
   socket_operations_(socket_operations),
   name_(name),
@@ -53,24 +55,23 @@ MySQLRoutingContext ::MySQLRoutingContext(BaseProtocol* protocol,
   bind_address_(bind_address),
   bind_named_socket_(bind_named_socket),
   thread_stack_size_(thread_stack_size),
-  max_connect_errors_(max_connect_errors) {
+  conn_error_counters_(host_cache_size, connect_errors_timeout),
+  metrics_(name) {
 
 }
 
 bool MySQLRoutingContext::block_client_host(const ClientIpArray& client_ip_array,
     const std::string &client_ip_str, int server) {
   bool blocked = false;
-  {
-    std::lock_guard<std::mutex> lock(mutex_conn_errors_);
-
-    if (++conn_error_counters_[client_ip_array] >= max_connect_errors_) {
-      log_warning("[%s] blocking client host %s", name_.c_str(), client_ip_str.c_str());
-      blocked = true;
-    } else {
-      log_info("[%s] %lu connection errors for %s (max %llu)", name_.c_str(),
-               static_cast<unsigned long>(conn_error_counters_[client_ip_array]), // 32bit Linux requires cast
-               client_ip_str.c_str(), max_connect_errors_);
-    }
+  const size_t errors = conn_error_counters_.increment(client_ip_array);
+
+  if (errors >= max_connect_errors_) {
+    log_warning("[%s] blocking client host %s", name_.c_str(), client_ip_str.c_str());
+    blocked = true;
+  } else {
+    log_info("[%s] %lu connection errors for %s (max %llu)", name_.c_str(),
+             static_cast<unsigned long>(errors), // 32bit Linux requires cast
+             client_ip_str.c_str(), max_connect_errors_);
   }
 
   if (server >= 0) {
@@ -81,18 +82,30 @@ bool MySQLRoutingContext::block_client_host(const ClientIpArray& client_ip_array
 }
 
 const std::vector<ClientIpArray> MySQLRoutingContext::get_blocked_client_hosts() const {
-  std::lock_guard<std::mutex> lock(mutex_conn_errors_);
-
   std::vector<ClientIpArray> result;
-  for(const auto& client_ip: conn_error_counters_) {
-    if (client_ip.second >= max_connect_errors_) {
-      result.push_back(client_ip.first);
-    }
+  for(const auto& client_ip: conn_error_counters_.get_entries(max_connect_errors_)) {
+    result.push_back(client_ip.first);
   }
 
   return result;
 }
 
+bool MySQLRoutingContext::is_client_host_blocked(const ClientIpArray& client_ip_array) const {
+  return conn_error_counters_.get(client_ip_array) >= max_connect_errors_;
+}
+
+bool MySQLRoutingContext::unblock_client_host(const ClientIpArray& client_ip_array) {
+  return conn_error_counters_.erase(client_ip_array);
+}
+
+void MySQLRoutingContext::unblock_all_client_hosts() {
+  conn_error_counters_.clear();
+}
+
+std::vector<ClientErrorTable::Entry> MySQLRoutingContext::get_client_host_errors() const {
+  return conn_error_counters_.get_entries();
+}
+
 void MySQLRoutingContext::increase_active_thread_counter() {
   {
     std::lock_guard<std::mutex> lk(active_client_threads_cond_m_);
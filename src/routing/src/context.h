@@ -40,6 +40,12 @@
 #include "mysql_router_thread.h"
 #include "tcp_address.h"
 #include "mysql/harness/filesystem.h"
+#include "mysql/harness/sharded_counter.h"
+#include "client_error_table.h"
+#include "destination_stats.h"
+#include "rate_limiter.h"
+#include "route_metrics.h"
+#include "query_digest.h"
 #include "utils.h"
 
 class BaseProtocol;
@@ -61,7 +67,9 @@ public:
       std::chrono::milliseconds client_connect_timeout,
       const mysql_harness::TCPAddress& bind_address,
       const mysql_harness::Path& bind_named_socket,
-      unsigned long long max_connect_errors, size_t thread_stack_size);
+      unsigned long long max_connect_errors, size_t thread_stack_size,
+      size_t host_cache_size = routing::kDefaultHostCacheSize,
+      std::chrono::milliseconds connect_errors_timeout = routing::kDefaultConnectErrorsTimeout);
 
   /** @brief Checks and if needed, blocks a host from using this routing
    *
@@ -84,10 +92,39 @@ public:
 
   /** @brief Returns list of blocked client hosts
    *
-   * Returns list of the blocked client hosts.
+   * Returns list of the blocked client hosts, sorted by IP address.
    */
   const std::vector<ClientIpArray> get_blocked_client_hosts() const;
 
+  /** @brief Checks whether a client host is blocked
+   *
+   * Does not modify the list of client hosts, it is safe to call it for
+   * every accepted connection.
+   *
+   * @param client_ip_array IP address as array[16] of uint8_t
+   * @return true if the host reached max_connect_errors
+   */
+  bool is_client_host_blocked(const ClientIpArray& client_ip_array) const;
+
+  /** @brief Unblocks a client host
+   *
+   * Resets the connection error counter of the host.
+   *
+   * @param client_ip_array IP address as array[16] of uint8_t
+   * @return true if the host had connection errors
+   */
+  bool unblock_client_host(const ClientIpArray& client_ip_array);
+
+  /** @brief Unblocks all client hosts
+   *
+   * Resets the connection error counters of all hosts (similar to
+   * FLUSH HOSTS in MySQL Server).
+   */
+  void unblock_all_client_hosts();
+
+  /** @brief Returns connection error counters of all known client hosts */
+  std::vector<ClientErrorTable::Entry> get_client_host_errors() const;
+
   void increase_active_thread_counter();
   void decrease_active_thread_counter();
   void increase_info_active_routes();
@@ -130,6 +167,47 @@ public:
     return thread_stack_size_;
   }
 
+  routing::ConnectionRateLimiter& get_rate_limiter() {
+    return rate_limiter_;
+  }
+
+  routing::DestinationStatsTable& get_destination_stats() {
+    return destination_stats_;
+  }
+
+  routing::RouteMetrics& get_metrics() {
+    return metrics_;
+  }
+
+  routing::QueryDigestTable& get_query_digests() {
+    return query_digests_;
+  }
+
+  const routing::SocketOptions& get_socket_options() const {
+    return socket_options_;
+  }
+
+  void set_socket_options(const routing::SocketOptions& socket_options) {
+    socket_options_ = socket_options;
+  }
+
+  /** @brief Max connect errors blocking hosts when handshake not completed */
+  unsigned long long max_connect_errors_;
+
+  /** number of active client threads. */
+  uint64_t active_client_threads_ {0};
+  std::condition_variable active_client_threads_cond_;
+  std::mutex active_client_threads_cond_m_;
+
+  /** @brief Number of active routes
+   *
+   * Updated by every connection thread when it starts and finishes, hence
+   * sharded to keep the threads from contending on a single cache line.
+   */
+  mysql_harness::ShardedCounter<> info_active_routes_;
+  /** @brief Number of handled routes, not used at the moment */
+  std::atomic<uint64_t> info_handled_routes_{0};
+
 private:
   /** @brief object to handle protocol specific stuff */
   std::unique_ptr<BaseProtocol> protocol_;
@@ -164,23 +242,22 @@ private:
     /** @brief memory in kilobytes allocated for thread's stack */
   size_t thread_stack_size_ = mysql_harness::kDefaultStackSizeInKiloBytes;
 
-  mutable std::mutex mutex_conn_errors_;
-
-public:
   /** @brief Connection error counters for IPv4 or IPv6 hosts */
-  std::map<ClientIpArray, size_t> conn_error_counters_;
+  ClientErrorTable conn_error_counters_;
 
-  /** @brief Max connect errors blocking hosts when handshake not completed */
-  unsigned long long max_connect_errors_;
+  /** @brief Limits rate of new connections and connections per client */
+  routing::ConnectionRateLimiter rate_limiter_;
 
-  /** number of active client threads. */
-  uint64_t active_client_threads_ {0};
-  std::condition_variable active_client_threads_cond_;
-  std::mutex active_client_threads_cond_m_;
+  /** @brief Connection counters per destination */
+  routing::DestinationStatsTable destination_stats_;
 
-  /** @brief Number of active routes */
-  std::atomic<uint16_t> info_active_routes_{0};
-  /** @brief Number of handled routes, not used at the moment */
-  std::atomic<uint64_t> info_handled_routes_{0};
+  /** @brief Socket options of listening, client and server sockets */
+  routing::SocketOptions socket_options_;
+
+  /** @brief Metrics exported to the metrics registry */
+  routing::RouteMetrics metrics_;
+
+  /** @brief Statistics of sampled statements per digest */
+  routing::QueryDigestTable query_digests_;
 };
 #endif /* ROUTING_CONTEXT_INCLUDED */
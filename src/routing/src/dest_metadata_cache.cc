@@ -200,6 +200,12 @@ DestMetadataCacheGroup::DestMetadataCacheGroup(const std::string &metadata_cache
 
 DestMetadataCacheGroup::AvailableDestinations DestMetadataCacheGroup::get_available(const metadata_cache::LookupResult& managed_servers,
                                                                                     bool for_new_connections) {
+  return get_available(metadata_cache::ReplicasetSnapshot(managed_servers.instance_vector),
+                       for_new_connections);
+}
+
+DestMetadataCacheGroup::AvailableDestinations DestMetadataCacheGroup::get_available(const metadata_cache::ReplicasetSnapshot& snapshot,
+                                                                                    bool for_new_connections) {
   // TODO: this is a workaround. We should do it in the init() but currently
   // there is no way to check if metadata_cache is initialized so we postpone it to
   // first connection request
@@ -208,16 +214,9 @@ DestMetadataCacheGroup::AvailableDestinations DestMetadataCacheGroup::get_availa
   DestMetadataCacheGroup::AvailableDestinations result;
 
   bool primary_fallback{false};
-  const auto& managed_servers_vec = managed_servers.instance_vector;
   if (routing_strategy_ == routing::RoutingStrategy::kRoundRobinWithFallback) {
     // if there are no secondaries available we fall-back to primaries
-    auto secondary = std::find_if(managed_servers_vec.begin(), managed_servers_vec.end(),
-            [](const metadata_cache::ManagedInstance& i)
-            {
-              return i.mode == metadata_cache::ServerMode::ReadOnly;
-            });
-
-    primary_fallback = secondary == managed_servers_vec.end();
+    primary_fallback = snapshot.secondaries.empty();
   }
 
   // if we are gathering the nodes for the decision about keeping existing connections
@@ -227,37 +226,45 @@ DestMetadataCacheGroup::AvailableDestinations DestMetadataCacheGroup::get_availa
     primary_fallback = true;
   }
 
-  for (const auto &it: managed_servers_vec) {
-    if (!(it.role == "HA")) {
-      continue;
-    }
+  const std::vector<metadata_cache::ManagedInstance>* instances;
+  switch (server_role_) {
+    case ServerRole::PrimaryAndSecondary:
+      instances = &snapshot.available;
+      break;
+    case ServerRole::Secondary:
+      // the primaries keep their position among the secondaries
+      instances = primary_fallback ? &snapshot.available : &snapshot.secondaries;
+      break;
+    default:
+      instances = &snapshot.primaries;
+  }
+
+  result.address.reserve(instances->size());
+  result.id.reserve(instances->size());
+  for (const auto &it: *instances) {
     auto port = (protocol_ == Protocol::Type::kXProtocol) ? static_cast<uint16_t>(it.xport) : static_cast<uint16_t>(it.port);
 
-    // role=PRIMARY_AND_SECONDARY
-    if ((server_role_ == ServerRole::PrimaryAndSecondary) &&
-        (it.mode == metadata_cache::ServerMode::ReadWrite || it.mode == metadata_cache::ServerMode::ReadOnly)) {
-      result.address.push_back(mysql_harness::TCPAddress(it.host, port));
-      result.id.push_back(it.mysql_server_uuid);
-      continue;
-    }
+    result.address.push_back(mysql_harness::TCPAddress(it.host, port));
+    result.id.push_back(it.mysql_server_uuid);
+  }
 
-    // role=SECONDARY
-    if (server_role_ == ServerRole::Secondary && it.mode == metadata_cache::ServerMode::ReadOnly) {
-      result.address.push_back(mysql_harness::TCPAddress(it.host, port));
-      result.id.push_back(it.mysql_server_uuid);
-      continue;
-    }
+  return result;
+}
 
-    // role=PRIMARY
-    if ((server_role_ == ServerRole::Primary || primary_fallback)
-         && it.mode == metadata_cache::ServerMode::ReadWrite) {
-      result.address.push_back(mysql_harness::TCPAddress(it.host, port));
-      result.id.push_back(it.mysql_server_uuid);
-      continue;
-    }
+std::shared_ptr<const DestMetadataCacheGroup::CachedDestinations> DestMetadataCacheGroup::get_cached_available() {
+  auto snapshot = cache_api_->lookup_replicaset_snapshot(ha_replicaset_);
+  auto cached = std::atomic_load(&cached_destinations_);
+  if (cached && cached->snapshot == snapshot) {
+    return cached;
   }
 
-  return result;
+  // the snapshot changed (or this is the first lookup). Concurrent callers
+  // may both rebuild; they compute the same result so the last store wins.
+  cached = std::make_shared<const CachedDestinations>(
+      CachedDestinations{snapshot, get_available(*snapshot)});
+  std::atomic_store(&cached_destinations_, cached);
+
+  return cached;
 }
 
 void DestMetadataCacheGroup::init() {
@@ -378,7 +385,8 @@ int DestMetadataCacheGroup::get_server_socket(std::chrono::milliseconds connect_
                                               mysql_harness::TCPAddress *address) noexcept {
   while (true) {
     try {
-      auto available = get_available(cache_api_->lookup_replicaset(ha_replicaset_).instance_vector);
+      auto cached = get_cached_available();
+      const auto &available = cached->available;
       if (available.address.empty()) {
         log_warning("No available servers found for '%s' %s routing",
             ha_replicaset_.c_str(),
@@ -436,3 +444,36 @@ void DestMetadataCacheGroup::on_instances_change(const metadata_cache::LookupRes
 void DestMetadataCacheGroup::notify(const metadata_cache::LookupResult& instances, const bool md_servers_reachable) noexcept {
   on_instances_change(instances, md_servers_reachable);
 }
+
+void DestMetadataCacheGroup::notify_changes(const metadata_cache::ReplicasetSnapshot &before,
+                                            const metadata_cache::ReplicasetSnapshot &after,
+                                            const metadata_cache::ReplicasetChanges &changes,
+                                            const bool md_servers_reachable) noexcept {
+  // see on_instances_change()
+  if (!md_servers_reachable && !disconnect_on_metadata_unavailable_)
+    return;
+
+  log_debug("Replicaset '%s' changed: %zu added, %zu removed, %zu changed",
+            ha_replicaset_.c_str(), changes.added.size(), changes.removed.size(),
+            changes.changed.size());
+
+  const auto allowed_before = get_available(before, /*for_new_connections=*/ false);
+  const auto allowed_after = get_available(after, /*for_new_connections=*/ false);
+
+  std::vector<mysql_harness::TCPAddress> disallowed;
+  for (const auto &address: allowed_before.address) {
+    if (std::find(allowed_after.address.begin(), allowed_after.address.end(), address) ==
+        allowed_after.address.end()) {
+      disallowed.push_back(address);
+    }
+  }
+  // members joining or getting a new weight don't affect existing connections
+  if (disallowed.empty()) return;
+
+  const std::string reason = md_servers_reachable ? "metadata change" : "metadata unavailable";
+
+  std::lock_guard<std::mutex> lock(allowed_nodes_change_callbacks_mtx_);
+  for (auto& clb: disallowed_nodes_callbacks_) {
+    clb(disallowed, reason);
+  }
+}
@@ -30,6 +30,7 @@
 #include "mysqlrouter/uri.h"
 #include "mysqlrouter/metadata_cache.h"
 
+#include <memory>
 #include <thread>
 
 #include "mysqlrouter/datatypes.h"
@@ -69,6 +70,9 @@ public:
   int get_server_socket(std::chrono::milliseconds connect_timeout, int *error,
                         mysql_harness::TCPAddress *address = nullptr) noexcept override;
 
+  /** @brief Returns true: get_server_socket() waits for primary failovers */
+  bool connect_from_connection_thread() const noexcept override { return true; }
+
   ~DestMetadataCacheGroup();
 
   void add(const std::string &, uint16_t) override { }
@@ -145,6 +149,32 @@ private:
   AvailableDestinations get_available(const metadata_cache::LookupResult& managed_servers,
                                       bool for_new_connections = true);
 
+  /** @brief Gets available destinations from a replicaset snapshot
+   *
+   * Uses the members pre-filtered by the snapshot instead of walking the
+   * whole member list.
+   */
+  AvailableDestinations get_available(const metadata_cache::ReplicasetSnapshot& snapshot,
+                                      bool for_new_connections = true);
+
+  /** @brief Available destinations derived from one replicaset snapshot */
+  struct CachedDestinations {
+    std::shared_ptr<const metadata_cache::ReplicasetSnapshot> snapshot;
+    AvailableDestinations available;
+  };
+
+  /** @brief Gets available destinations for new connections
+   *
+   * Returns the destinations computed for the current replicaset snapshot,
+   * recomputing them only when the metadata cache published a new snapshot.
+   * The cache is swapped with std::atomic_store(), so the common case is two
+   * pointer loads without locks or allocations.
+   */
+  std::shared_ptr<const CachedDestinations> get_cached_available();
+
+  // Destinations for the last seen snapshot, see get_cached_available()
+  std::shared_ptr<const CachedDestinations> cached_destinations_;
+
   size_t get_next_server(const DestMetadataCacheGroup::AvailableDestinations& available);
 
   size_t current_pos_;
@@ -168,6 +198,17 @@ private:
   void subscribe_for_metadata_cache_changes();
 
   void notify(const metadata_cache::LookupResult& instances, const bool md_servers_reachable) noexcept override;
+
+  /** @brief Tells the registered callbacks which nodes are not allowed anymore
+   *
+   * The nodes allowed for existing connections are derived from the snapshots
+   * before and after the change (falling back to the primaries depends on the
+   * whole replicaset), the callbacks only get those that dropped out.
+   */
+  void notify_changes(const metadata_cache::ReplicasetSnapshot &before,
+                      const metadata_cache::ReplicasetSnapshot &after,
+                      const metadata_cache::ReplicasetChanges &changes,
+                      const bool md_servers_reachable) noexcept override;
 };
 
 
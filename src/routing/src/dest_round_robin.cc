@@ -187,6 +187,24 @@ void DestRoundRobin::quarantine_manager_thread() noexcept {
   }
 }
 
+RouteDestination::AddrVector DestRoundRobin::get_quarantined() {
+  AddrVector result;
+  std::vector<size_t> quarantined;
+  {
+    std::lock_guard<std::mutex> lock(mutex_quarantine_);
+    quarantined = quarantined_;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_update_);
+  for (auto index: quarantined) {
+    if (index < destinations_.size()) {
+      result.push_back(destinations_[index]);
+    }
+  }
+
+  return result;
+}
+
 size_t DestRoundRobin::size_quarantine() {
   std::lock_guard<std::mutex> lock(mutex_quarantine_);
   return quarantined_.size();
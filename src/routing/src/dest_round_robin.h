@@ -66,6 +66,8 @@ class DestRoundRobin : public RouteDestination {
    */
   size_t size_quarantine();
 
+  AddrVector get_quarantined() override;
+
  protected:
   /** @brief Returns whether destination is quarantined
    *
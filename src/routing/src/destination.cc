@@ -25,6 +25,7 @@
 #include "common.h"
 #include "destination.h"
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/tracing.h"
 #include "mysqlrouter/routing.h"
 #include "mysqlrouter/utils.h"
 #include "utils.h"
@@ -65,6 +66,19 @@ void DestinationNodesStateNotifier::unregister_allowed_nodes_change_callback(
   allowed_nodes_change_callbacks_.erase(it);
 }
 
+DisallowedNodesCallbacksListIterator
+  DestinationNodesStateNotifier::register_disallowed_nodes_callback(
+    const DisallowedNodesCallback& clb) {
+  std::lock_guard<std::mutex> lock(allowed_nodes_change_callbacks_mtx_);
+  return disallowed_nodes_callbacks_.insert(disallowed_nodes_callbacks_.end(), clb);
+}
+
+void DestinationNodesStateNotifier::unregister_disallowed_nodes_callback(
+    const DisallowedNodesCallbacksListIterator& it) {
+  std::lock_guard<std::mutex> lock(allowed_nodes_change_callbacks_mtx_);
+  disallowed_nodes_callbacks_.erase(it);
+}
+
 // class RouteDestination
 
 void RouteDestination::add(const TCPAddress dest) {
@@ -103,6 +117,11 @@ TCPAddress RouteDestination::get(const std::string &address, uint16_t port) {
   throw out_of_range("Destination " + needle.str() + " not found");
 }
 
+RouteDestination::AddrVector RouteDestination::get_destinations() {
+  std::lock_guard<std::mutex> lock(mutex_update_);
+  return destinations_;
+}
+
 size_t RouteDestination::size() noexcept {
   return destinations_.size();
 }
@@ -130,5 +149,7 @@ size_t RouteDestination::get_next_server() {
 }
 
 int RouteDestination::get_mysql_socket(const TCPAddress &addr, std::chrono::milliseconds connect_timeout, const bool log_errors) {
-  return routing_sock_ops_->get_mysql_socket(addr, connect_timeout, log_errors);
+  mysql_harness::tracing::Span span("get_mysql_socket");
+
+  return routing_sock_ops_->get_mysql_socket(addr, connect_timeout, log_errors, &socket_options_);
 }
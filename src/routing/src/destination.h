@@ -54,6 +54,12 @@ using AllowedNodesChangedCallback = std::function<void(const AllowedNodes&, cons
 using AllowedNodesChangeCallbacksList = std::list<AllowedNodesChangedCallback>;
 using AllowedNodesChangeCallbacksListIterator = AllowedNodesChangeCallbacksList::iterator;
 
+// first argument is the list of nodes that are not allowed anymore
+// second argument is the description of the condition that triggered the change
+using DisallowedNodesCallback = std::function<void(const std::vector<mysql_harness::TCPAddress>&, const std::string&)>;
+using DisallowedNodesCallbacksList = std::list<DisallowedNodesCallback>;
+using DisallowedNodesCallbacksListIterator = DisallowedNodesCallbacksList::iterator;
+
 /** @class DestinationNodesStateNotifier
  *
  * Allows the obervers to register for notifications on the change in the state
@@ -79,8 +85,30 @@ class DestinationNodesStateNotifier {
   void unregister_allowed_nodes_change_callback(
       const AllowedNodesChangeCallbacksListIterator& it);
 
+  /** @brief Registers the callback for notification on nodes that stopped
+   *         being allowed.
+   *
+   * Destinations that know what changed call these instead of passing the
+   * whole list of allowed nodes to the allowed nodes change callbacks.
+   *
+   * @param clb callback that should be called
+   * @return identifier of the inserted callback, can be used to unregister
+   *         the callback
+   */
+  DisallowedNodesCallbacksListIterator
+    register_disallowed_nodes_callback(const DisallowedNodesCallback& clb);
+
+  /** @brief Unregisters the callback registered with register_disallowed_nodes_callback().
+   *
+   * @param it  iterator returned by the call to register_disallowed_nodes_callback()
+   */
+  void unregister_disallowed_nodes_callback(
+      const DisallowedNodesCallbacksListIterator& it);
+
  protected:
   AllowedNodesChangeCallbacksList allowed_nodes_change_callbacks_;
+  DisallowedNodesCallbacksList disallowed_nodes_callbacks_;
+  // guards both callback lists
   std::mutex allowed_nodes_change_callbacks_mtx_;
 };
 
@@ -179,6 +207,17 @@ class RouteDestination: public DestinationNodesStateNotifier {
   virtual int get_server_socket(std::chrono::milliseconds connect_timeout, int *error,
                                 mysql_harness::TCPAddress *address = nullptr) noexcept = 0;
 
+  /** @brief Returns whether servers are connected from the connection threads
+   *
+   * Destinations whose get_server_socket() may block for long (like waiting
+   * for a primary failover) return true: the route then calls it from the
+   * thread of the new connection instead of the acceptor, so it must be safe
+   * to call concurrently.
+   */
+  virtual bool connect_from_connection_thread() const noexcept {
+    return false;
+  }
+
   /** @brief Gets the number of destinations
    *
    * Gets the number of destinations currently in the list.
@@ -200,6 +239,21 @@ class RouteDestination: public DestinationNodesStateNotifier {
    */
   virtual void start() {}
 
+  /** @brief Returns a copy of the destinations
+   *
+   * Unlike iterating with begin()/end(), this is safe while the list is
+   * being updated.
+   */
+  AddrVector get_destinations();
+
+  /** @brief Returns the quarantined destinations
+   *
+   * Destinations which do not quarantine servers return an empty list.
+   */
+  virtual AddrVector get_quarantined() {
+    return {};
+  }
+
   AddrVector::iterator begin() {
     return destinations_.begin();
   }
@@ -216,6 +270,16 @@ class RouteDestination: public DestinationNodesStateNotifier {
     return destinations_.end();
   }
 
+  /** @brief Sets the socket options used connecting to destinations
+   *
+   * Must be called before the destination is started.
+   *
+   * @param socket_options socket options of the route
+   */
+  void set_socket_options(const routing::SocketOptions &socket_options) {
+    socket_options_ = socket_options;
+  }
+
  protected:
   /** @brief Returns socket descriptor of connected MySQL server
    *
@@ -253,6 +317,9 @@ class RouteDestination: public DestinationNodesStateNotifier {
 
   /** @brief Protocol for the destination */
   Protocol::Type protocol_;
+
+  /** @brief Socket options applied to connections to destinations */
+  routing::SocketOptions socket_options_;
 };
 
 #endif // ROUTING_DESTINATION_INCLUDED
@@ -0,0 +1,62 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "destination_stats.h"
+
+namespace routing {
+
+std::shared_ptr<DestinationCounters> DestinationStatsTable::acquire(const std::string &address) {
+  std::shared_ptr<DestinationCounters> counters;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+
+    auto &slot = counters_[address];
+    if (!slot) {
+      slot = std::make_shared<DestinationCounters>();
+    }
+    counters = slot;
+  }
+
+  counters->active_connections.fetch_add(1, std::memory_order_relaxed);
+  counters->total_connections.fetch_add(1, std::memory_order_relaxed);
+
+  return counters;
+}
+
+std::vector<DestinationStatsTable::Entry> DestinationStatsTable::get_entries() const {
+  std::vector<Entry> result;
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  result.reserve(counters_.size());
+  for (const auto &it: counters_) {
+    result.push_back(Entry{it.first,
+                           it.second->active_connections.load(std::memory_order_relaxed),
+                           it.second->total_connections.load(std::memory_order_relaxed)});
+  }
+
+  return result;
+}
+
+} // namespace routing
@@ -0,0 +1,91 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef ROUTING_DESTINATION_STATS_INCLUDED
+#define ROUTING_DESTINATION_STATS_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace routing {
+
+/** @brief Connection counters of a single destination */
+struct DestinationCounters {
+  /** @brief number of open connections */
+  std::atomic<int64_t> active_connections{0};
+  /** @brief number of connections made */
+  std::atomic<uint64_t> total_connections{0};
+};
+
+/** @class DestinationStatsTable
+ * @brief Connection counters per destination address
+ *
+ * Connections look up the counters of their destination once when they
+ * start and update them with atomic operations afterwards.
+ */
+class DestinationStatsTable {
+ public:
+  /** @brief Entry returned by get_entries() */
+  struct Entry {
+    std::string address;
+    int64_t active_connections;
+    uint64_t total_connections;
+  };
+
+  /** @brief Registers a new connection to a destination
+   *
+   * Increments the active and total connection counters.
+   *
+   * @param address address of the destination
+   * @return counters of the destination, pass them to release()
+   */
+  std::shared_ptr<DestinationCounters> acquire(const std::string &address);
+
+  /** @brief Unregisters a connection
+   *
+   * @param counters counters returned by acquire()
+   */
+  static void release(const std::shared_ptr<DestinationCounters> &counters) noexcept {
+    if (counters) {
+      counters->active_connections.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
+  /** @brief Returns the counters of all destinations, sorted by address */
+  std::vector<Entry> get_entries() const;
+
+ private:
+  mutable std::mutex mtx_;
+  std::map<std::string, std::shared_ptr<DestinationCounters>> counters_;
+};
+
+} // namespace routing
+
+#endif // ROUTING_DESTINATION_STATS_INCLUDED
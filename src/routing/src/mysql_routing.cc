@@ -33,6 +33,8 @@
 #include "dest_metadata_cache.h"
 #include "dest_fabric_cache.h"
 #include "mysql/harness/logging/logging.h"
+#include "mysql/harness/metrics.h"
+#include "mysql/harness/tracing.h"
 #include "mysql_routing.h"
 #include "mysqlrouter/metadata_cache.h"
 #include "mysqlrouter/fabric_cache.h"
@@ -49,6 +51,7 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 #include <future>
@@ -92,10 +95,60 @@ using mysql_harness::TCPAddress;
 using mysqlrouter::is_valid_socket_name;
 IMPORT_LOG_FUNCTIONS()
 
-static int kListenQueueSize = 1024;
-
 static const char *kDefaultReplicaSetName = "default";
 static const std::chrono::milliseconds kAcceptorStopPollInterval_ms { 100 };
+static const std::chrono::seconds kStatusPublishInterval { 1 };
+
+static std::vector<routing::QueryDigestStatus> get_query_digest_status(const routing::QueryDigestTable &table) {
+  std::vector<routing::QueryDigestStatus> digests;
+  for (const auto &entry: table.get_entries()) {
+    routing::QueryDigestStatus digest;
+    digest.digest = entry.digest;
+    digest.count = entry.count;
+    digest.count_error = entry.count_error;
+    digest.errors = entry.errors;
+    digest.total_latency_us = static_cast<uint64_t>(entry.total_latency.count());
+    digest.max_latency_us = static_cast<uint64_t>(entry.max_latency.count());
+    digest.rows = entry.rows;
+    digest.bytes = entry.bytes;
+    digests.push_back(std::move(digest));
+  }
+
+  return digests;
+}
+
+static std::vector<routing::ClientHostStatus> get_client_host_status(const MySQLRoutingContext &context) {
+  std::vector<routing::ClientHostStatus> hosts;
+  for (const auto &entry: context.get_client_host_errors()) {
+    routing::ClientHostStatus host;
+    host.address = client_ip_array_to_string(entry.first);
+    host.connect_errors = entry.second;
+    host.blocked = entry.second >= context.max_connect_errors_;
+    hosts.push_back(std::move(host));
+  }
+
+  return hosts;
+}
+
+static routing::UnblockHostResult unblock_client_host(MySQLRoutingContext &context,
+                                                      const std::string &address) {
+  if (address.empty()) {
+    context.unblock_all_client_hosts();
+    log_info("[%s] unblocked all client hosts", context.get_name().c_str());
+    return routing::UnblockHostResult::kUnblocked;
+  }
+
+  ClientIpArray ip_array;
+  if (!client_ip_array_from_string(address, ip_array)) {
+    return routing::UnblockHostResult::kInvalidAddress;
+  }
+  if (!context.unblock_client_host(ip_array)) {
+    return routing::UnblockHostResult::kHostNotFound;
+  }
+
+  log_info("[%s] unblocked client host %s", context.get_name().c_str(), address.c_str());
+  return routing::UnblockHostResult::kUnblocked;
+}
 
 MySQLRouting::MySQLRouting(routing::RoutingStrategy routing_strategy, uint16_t port,
                            const Protocol::Type protocol,
@@ -103,17 +156,20 @@ MySQLRouting::MySQLRouting(routing::RoutingStrategy routing_strategy, uint16_t p
                            const string &bind_address,
                            const mysql_harness::Path& named_socket,
                            const string &route_name,
-                           int max_connections,
+                           int64_t max_connections,
                            std::chrono::milliseconds destination_connect_timeout,
                            unsigned long long max_connect_errors,
                            std::chrono::milliseconds client_connect_timeout,
                            unsigned int net_buffer_length,
                            routing::RoutingSockOpsInterface *routing_sock_ops,
-                           size_t thread_stack_size)
+                           size_t thread_stack_size,
+                           size_t host_cache_size,
+                           std::chrono::milliseconds connect_errors_timeout)
     : context_(Protocol::create(protocol, routing_sock_ops), routing_sock_ops->so(),
         route_name, net_buffer_length, destination_connect_timeout,
         client_connect_timeout, TCPAddress(bind_address, port),
-        named_socket, max_connect_errors, thread_stack_size
+        named_socket, max_connect_errors, thread_stack_size,
+        host_cache_size, connect_errors_timeout
       ),
       routing_sock_ops_(routing_sock_ops),
       routing_strategy_(routing_strategy),
@@ -228,10 +284,27 @@ static int unix_getpeercred(int sock, pid_t &peer_pid, uid_t &peer_uid) {
 void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
   mysql_harness::rename_thread(get_routing_thread_name(context_.get_name(), "RtA").c_str());  // "Rt Acceptor" would be too long :(
 
+  destination_->set_socket_options(context_.get_socket_options());
   destination_->start();
 
-  auto allowed_nodes_changed = [&](const AllowedNodes& nodes, const std::string& reason) {
-
+  status_slot_ = MySQLRoutingComponent::getInstance().register_route(context_.get_name());
+  status_slot_->store(get_status());
+  status_slot_->set_connection_handlers(
+      [this]() { return connection_container_.get_connections(); },
+      [this](uint64_t id) { return connection_container_.disconnect(id); });
+  status_slot_->set_query_digests_getter(
+      [this]() { return get_query_digest_status(context_.get_query_digests()); });
+  status_slot_->set_client_host_handlers(
+      [this]() { return get_client_host_status(context_); },
+      [this](const std::string &address) { return unblock_client_host(context_, address); });
+  auto next_status_publish = std::chrono::steady_clock::now() + kStatusPublishInterval;
+
+  mysql_harness::metrics::MetricsRegistry::instance().add_callback_gauge(
+      routing::kActiveConnectionsMetric, "open client connections",
+      {{"route", context_.get_name()}},
+      [this]() { return static_cast<double>(context_.info_active_routes_.load()); });
+
+  auto log_disconnect_request = [&](const std::string& reason) {
     std::ostringstream oss;
 
     if (!context_.get_bind_address().addr.empty()) {
@@ -245,16 +318,37 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
 
     log_info("Routing %s listening on %s got request to disconnect invalid connections: %s",
         context_.get_name().c_str(), oss.str().c_str(), reason.c_str());
+  };
+
+  auto allowed_nodes_changed = [&](const AllowedNodes& nodes, const std::string& reason) {
+    log_disconnect_request(reason);
 
     // handle allowed nodes changed
     connection_container_.disconnect(nodes);
   };
 
+  auto nodes_disallowed = [&](const std::vector<mysql_harness::TCPAddress>& nodes,
+                              const std::string& reason) {
+    log_disconnect_request(reason);
+
+    // only the connections to these nodes need to go
+    connection_container_.disconnect_servers(nodes);
+  };
+
   allowed_nodes_list_iterator_ =
       destination_->register_allowed_nodes_change_callback(allowed_nodes_changed);
+  disallowed_nodes_list_iterator_ =
+      destination_->register_disallowed_nodes_callback(nodes_disallowed);
 
   std::shared_ptr<void> exit_guard(nullptr, [&](void *){
     destination_->unregister_allowed_nodes_change_callback(allowed_nodes_list_iterator_);
+    destination_->unregister_disallowed_nodes_callback(disallowed_nodes_list_iterator_);
+    status_slot_->clear_connection_handlers();
+    status_slot_->clear_query_digests_getter();
+    status_slot_->clear_client_host_handlers();
+    MySQLRoutingComponent::getInstance().unregister_route(context_.get_name());
+    mysql_harness::metrics::MetricsRegistry::instance().remove_callback_gauge(
+        routing::kActiveConnectionsMetric, {{"route", context_.get_name()}});
   });
 
 
@@ -276,6 +370,14 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
   fds[kAcceptUnixSocketNdx].fd = service_named_socket_;
 
   while (is_running(env)) {
+    // snapshots are taken here so that readers never touch the locks
+    // used while routing connections
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= next_status_publish) {
+      status_slot_->store(get_status());
+      next_status_publish = now + kStatusPublishInterval;
+    }
+
     // wait for the accept() sockets to become readable (POLLIN)
     int ready_fdnum = context_.get_socket_operations()->poll(fds, sizeof(fds) / sizeof(fds[0]), kAcceptorStopPollInterval_ms);
     // < 0 - failure
@@ -312,6 +414,11 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
         log_error("[%s] Failed accepting connection: %s", context_.get_name().c_str(), get_message_error(context_.get_socket_operations()->get_errno()).c_str());
         continue;
       }
+      const auto accepted_at = std::chrono::steady_clock::now();
+
+      // a traced connection records its spans from here until it closes
+      mysql_harness::tracing::TraceScope trace_scope(sample_trace());
+      mysql_harness::tracing::Span accept_span("accept", accepted_at);
 
       bool is_tcp = (ndx == kAcceptTcpNdx);
 
@@ -338,20 +445,33 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
             context_.get_name().c_str(), sock_client, context_.get_bind_named_socket().str().c_str());
       }
 
-      if (context_.conn_error_counters_[in_addr_to_array(client_addr)] >= context_.max_connect_errors_) {
+      if (context_.is_client_host_blocked(in_addr_to_array(client_addr))) {
         std::stringstream os;
         os << "Too many connection errors from " << get_peer_name(sock_client).first;
         context_.get_protocol().send_error(sock_client, 1129, os.str(), "HY000", context_.get_name());
         log_info("%s", os.str().c_str());
         context_.get_socket_operations()->close(sock_client); // no shutdown() before close()
+        context_.get_metrics().rejected_blocked_host.increment();
         continue;
       }
 
-      if (context_.info_active_routes_.load(std::memory_order_relaxed) >= max_connections_) {
+      const int64_t active_routes = context_.info_active_routes_.load();
+      if (active_routes >= max_connections_) {
         context_.get_protocol().send_error(sock_client, 1040, "Too many connections to MySQL Router", "HY000", context_.get_name());
         context_.get_socket_operations()->close(sock_client); // no shutdown() before close()
-        log_warning("[%s] reached max active connections (%d max=%d)", context_.get_name().c_str(),
-                   context_.info_active_routes_.load(), max_connections_);
+        log_warning("[%s] reached max active connections (%lld max=%lld)", context_.get_name().c_str(),
+                   static_cast<long long>(active_routes), static_cast<long long>(max_connections_));
+        context_.get_metrics().rejected_max_connections.increment();
+        continue;
+      }
+
+      const auto rate_limit_result = context_.get_rate_limiter().acquire(client_addr);
+      if (rate_limit_result != routing::ConnectionRateLimiter::Result::kAllowed) {
+        const auto error = routing::get_rate_limit_error(rate_limit_result);
+        context_.get_protocol().send_error(sock_client, error.first, error.second, "HY000", context_.get_name());
+        context_.get_socket_operations()->close(sock_client); // no shutdown() before close()
+        log_debug("[%s] fd=%d connection throttled: %s", context_.get_name().c_str(), sock_client, error.second.c_str());
+        context_.get_metrics().rejected_rate_limit.increment();
         continue;
       }
 
@@ -362,12 +482,21 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
         // if it fails, it will be slower, but cause no harm
       }
 
+      if (is_tcp) {
+        std::string error;
+        if (!routing::set_connection_socket_options(sock_client, context_.get_socket_options(), error)) {
+          log_info("[%s] fd=%d client %s", context_.get_name().c_str(), sock_client, error.c_str());
+        }
+      }
+
       // On some OS'es the socket will be non-blocking as a result of accept()
       // on non-blocking socket. We need to make sure it's always blocking.
       routing::set_socket_blocking(sock_client, true);
 
+      context_.get_metrics().connections_accepted.increment();
+
       // launch client thread which will service this new connection
-      create_connection(sock_client, client_addr);
+      create_connection(sock_client, client_addr, accepted_at);
     }
   } // while (is_running(env))
 
@@ -383,24 +512,61 @@ void MySQLRouting::start_acceptor(mysql_harness::PluginFuncEnv* env) {
   log_info("[%s] stopped", context_.get_name().c_str());
 }
 
-void MySQLRouting::create_connection(int client_socket, const sockaddr_storage& client_addr) {
+void MySQLRouting::create_connection(int client_socket, const sockaddr_storage& client_addr,
+                                     std::chrono::steady_clock::time_point accepted_at) {
   auto remove_callback = [this](MySQLRoutingConnection* connection) {
     connection_container_.remove_connection(connection);
   };
+  mysql_harness::tracing::Span span("create_connection");
+
+  if (destination_->connect_from_connection_thread()) {
+    // get_server_socket() may wait for a failover, don't hold up the acceptor
+    auto connect_server = [this](mysql_harness::TCPAddress *server_address) {
+      int error = 0;
+      return destination_->get_server_socket(
+          context_.get_destination_connect_timeout(), &error, server_address);
+    };
+    std::unique_ptr<MySQLRoutingConnection> new_connection(
+        new MySQLRoutingConnection(context_, ++last_connection_id_, client_socket, client_addr,
+            connect_server, accepted_at, remove_callback));
+
+    new_connection->start();
+    connection_container_.add_connection(std::move(new_connection));
+    return;
+  }
 
   int error = 0;
   mysql_harness::TCPAddress server_address;
-  int server_socket = destination_->get_server_socket(
-      context_.get_destination_connect_timeout(), &error, &server_address);
+  MySQLRoutingConnection::Timestamps timestamps;
+  timestamps.accepted = accepted_at;
+  timestamps.connect_started = std::chrono::steady_clock::now();
+  int server_socket;
+  {
+    mysql_harness::tracing::Span get_server_socket_span("get_server_socket", timestamps.connect_started);
+    server_socket = destination_->get_server_socket(
+        context_.get_destination_connect_timeout(), &error, &server_address);
+  }
+  timestamps.connected = std::chrono::steady_clock::now();
+  context_.get_metrics().connect_duration.observe(
+      std::chrono::duration<double>(timestamps.connected - timestamps.connect_started).count());
 
   std::unique_ptr<MySQLRoutingConnection> new_connection(
-      new MySQLRoutingConnection(context_, client_socket, client_addr,
-          server_socket, server_address, remove_callback));
+      new MySQLRoutingConnection(context_, ++last_connection_id_, client_socket, client_addr,
+          server_socket, server_address, timestamps, remove_callback));
 
   new_connection->start();
   connection_container_.add_connection(std::move(new_connection));
 }
 
+uint64_t MySQLRouting::sample_trace() {
+  if (trace_sample_rate_ == 0 || ++connections_since_trace_ < trace_sample_rate_) {
+    return 0;
+  }
+  connections_since_trace_ = 0;
+
+  return mysql_harness::tracing::Tracer::instance().new_trace_id();
+}
+
 static int get_socket_errno() {
 #ifdef _WIN32
   return GetLastError();
@@ -470,6 +636,11 @@ void MySQLRouting::setup_tcp_service() {
     }
 #endif
 
+    if (!routing::set_listen_socket_options(service_tcp_, context_.get_socket_options(), error)) {
+      log_warning("[%s] setup_tcp_service() %s", context_.get_name().c_str(), error.c_str());
+      error.clear();
+    }
+
     if (context_.get_socket_operations()->bind(service_tcp_, info->ai_addr, info->ai_addrlen) == -1) {
       error = get_message_error(get_socket_errno());
       log_warning("[%s] setup_tcp_service() error from bind(): %s", context_.get_name().c_str(), error.c_str());
@@ -485,7 +656,7 @@ void MySQLRouting::setup_tcp_service() {
     throw runtime_error(string_format("[%s] Failed to setup service socket: %s", context_.get_name().c_str(), error.c_str()));
   }
 
-  if (context_.get_socket_operations()->listen(service_tcp_, kListenQueueSize) < 0) {
+  if (context_.get_socket_operations()->listen(service_tcp_, context_.get_socket_options().listen_backlog) < 0) {
     throw runtime_error(string_format("[%s] Failed to start listening for connections using TCP", context_.get_name().c_str()));
   }
 }
@@ -546,7 +717,7 @@ retry:
 
   set_unix_socket_permissions(socket_file.c_str()); // throws std::runtime_error
 
-  if (listen(service_named_socket_, kListenQueueSize) < 0) {
+  if (listen(service_named_socket_, context_.get_socket_options().listen_backlog) < 0) {
     throw runtime_error("Failed to start listening for connections using named socket");
   }
 }
@@ -635,6 +806,18 @@ void MySQLRouting::set_destinations_from_csv(const string &csv) {
 
   // Fall back to comma separated list of MySQL servers
   while (std::getline(ss, part, ',')) {
+    mysqlrouter::trim(part);
+    if (is_unix_socket_destination(part)) {
+#ifdef _WIN32
+      throw std::runtime_error("Unix socket destinations are not supported on Windows");
+#endif
+      const std::string path = part.substr(std::strlen(kUnixSocketDestinationPrefix));
+      if (path.empty()) {
+        throw std::runtime_error(string_format("Destination address '%s' is invalid", part.c_str()));
+      }
+      destination_->add(TCPAddress::make_unix_socket(path));
+      continue;
+    }
     info = mysqlrouter::split_addr_port(part);
     if (info.second == 0) {
       info.second = Protocol::get_default_port(context_.get_protocol().get_type());
@@ -666,10 +849,93 @@ void MySQLRouting::validate_destination_connect_timeout(std::chrono::millisecond
   }
 }
 
-int MySQLRouting::set_max_connections(int maximum) {
-  if (maximum <= 0 || maximum > UINT16_MAX) {
-    auto err = string_format("[%s] tried to set max_connections using invalid value, was '%d'", context_.get_name().c_str(),
-                             maximum);
+void MySQLRouting::set_connection_rate_limits(const routing::ConnectionRateLimits& limits) {
+  if (limits.client_ipv4_prefix_length > 32) {
+    throw std::invalid_argument(string_format("[%s] tried to set client_ipv4_prefix_length using invalid value, was '%u'",
+                                              context_.get_name().c_str(), static_cast<unsigned>(limits.client_ipv4_prefix_length)));
+  }
+  if (limits.client_ipv6_prefix_length > 128) {
+    throw std::invalid_argument(string_format("[%s] tried to set client_ipv6_prefix_length using invalid value, was '%u'",
+                                              context_.get_name().c_str(), static_cast<unsigned>(limits.client_ipv6_prefix_length)));
+  }
+  context_.get_rate_limiter().configure(limits);
+}
+
+std::shared_ptr<const routing::RouteStatus> MySQLRouting::get_status() {
+  auto status = std::make_shared<routing::RouteStatus>();
+
+  status->name = context_.get_name();
+  if (context_.get_bind_address().port > 0) {
+    status->bind_address = context_.get_bind_address().addr;
+    status->bind_port = context_.get_bind_address().port;
+  }
+  if (context_.get_bind_named_socket().is_set()) {
+    status->socket = context_.get_bind_named_socket().str();
+  }
+  status->protocol = context_.get_protocol().get_type() == Protocol::Type::kXProtocol ? "x" : "classic";
+  status->routing_strategy = routing::get_routing_strategy_name(routing_strategy_);
+  status->mode = routing::get_access_mode_name(access_mode_);
+  status->max_connections = max_connections_;
+  status->active_connections = context_.info_active_routes_.load();
+  status->total_connections = context_.info_handled_routes_.load();
+  status->timestamp = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count());
+
+  for (const auto &ip_array: context_.get_blocked_client_hosts()) {
+    status->blocked_hosts.push_back(client_ip_array_to_string(ip_array));
+  }
+
+  // configured destinations first, then the ones only known by their
+  // connections (metadata-cache and fabric-cache destinations)
+  std::map<std::string, routing::DestinationStatus> destinations;
+  if (destination_) {
+    for (const auto &addr: destination_->get_destinations()) {
+      destinations[addr.str()].address = addr.str();
+    }
+    for (const auto &addr: destination_->get_quarantined()) {
+      destinations[addr.str()].quarantined = true;
+    }
+  }
+  for (const auto &entry: context_.get_destination_stats().get_entries()) {
+    auto &dest = destinations[entry.address];
+    dest.address = entry.address;
+    dest.active_connections = entry.active_connections;
+    dest.total_connections = entry.total_connections;
+  }
+  for (auto &it: destinations) {
+    status->destinations.push_back(std::move(it.second));
+  }
+
+  return status;
+}
+
+void MySQLRouting::set_socket_options(const routing::SocketOptions& socket_options) {
+  if (socket_options.listen_backlog <= 0) {
+    throw std::invalid_argument(string_format("[%s] tried to set listen_backlog using invalid value, was '%d'",
+                                              context_.get_name().c_str(), socket_options.listen_backlog));
+  }
+  if (socket_options.receive_buffer_size < 0 || socket_options.send_buffer_size < 0 ||
+      socket_options.notsent_lowat < 0 || socket_options.defer_accept < 0 || socket_options.fastopen < 0 ||
+      socket_options.keepalive_idle < 0 || socket_options.keepalive_interval < 0 ||
+      socket_options.keepalive_count < 0) {
+    throw std::invalid_argument(string_format("[%s] tried to set socket options using negative values",
+                                              context_.get_name().c_str()));
+  }
+  context_.set_socket_options(socket_options);
+}
+
+void MySQLRouting::set_query_digest(size_t size, uint32_t sample_rate) {
+  if (size == 0) {
+    throw std::invalid_argument(string_format("[%s] tried to set query_digest_size using invalid value, was '0'",
+                                              context_.get_name().c_str()));
+  }
+  context_.get_query_digests().configure(size, sample_rate);
+}
+
+int64_t MySQLRouting::set_max_connections(int64_t maximum) {
+  if (maximum <= 0 || maximum > routing::kMaxConnectionsLimit) {
+    auto err = string_format("[%s] tried to set max_connections using invalid value, was '%lld'", context_.get_name().c_str(),
+                             static_cast<long long>(maximum));
     throw std::invalid_argument(err);
   }
   max_connections_ = maximum;
@@ -41,6 +41,7 @@
 #include "plugin_config.h"
 #include "utils.h"
 #include "mysqlrouter/routing.h"
+#include "mysqlrouter/routing_component.h"
 #include "mysql_router_thread.h"
 #include "tcp_address.h"
 #include "connection.h"
@@ -135,6 +136,8 @@ public:
    * @param net_buffer_length send/receive buffer size
    * @param routing_sock_ops object handling the operations on network sockets
    * @param thread_stack_size memory in kilobytes allocated for thread's stack
+   * @param host_cache_size maximum number of client hosts tracked for connection errors
+   * @param connect_errors_timeout time after which connection errors of a host are forgotten
    */
   MySQLRouting(routing::RoutingStrategy routing_strategy,
                uint16_t port,
@@ -143,14 +146,16 @@ public:
                const string &bind_address = string{"0.0.0.0"},
                const mysql_harness::Path& named_socket = mysql_harness::Path(),
                const string &route_name = string{},
-               int max_connections = routing::kDefaultMaxConnections,
+               int64_t max_connections = routing::kDefaultMaxConnections,
                std::chrono::milliseconds destination_connect_timeout = routing::kDefaultDestinationConnectionTimeout,
                unsigned long long max_connect_errors = routing::kDefaultMaxConnectErrors,
                std::chrono::milliseconds connect_timeout = routing::kDefaultClientConnectTimeout,
                unsigned int net_buffer_length = routing::kDefaultNetBufferLength,
                routing::RoutingSockOpsInterface *routing_sock_ops =
                    routing::RoutingSockOps::instance(mysql_harness::SocketOperations::instance()),
-               size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes);
+               size_t thread_stack_size = mysql_harness::kDefaultStackSizeInKiloBytes,
+               size_t host_cache_size = routing::kDefaultHostCacheSize,
+               std::chrono::milliseconds connect_errors_timeout = routing::kDefaultConnectErrorsTimeout);
 
   ~MySQLRouting();
 
@@ -202,23 +207,65 @@ public:
   /** @brief Sets maximum active connections
    *
    * Sets maximum of active connections. Maximum must be between 1 and
-   * 65535.
+   * routing::kMaxConnectionsLimit.
    *
    * @throw std::invalid_argument when an invalid value was provided.
    *
    * @param maximum Max number of connections allowed
-   * @return New value as int
+   * @return New value as int64_t
    */
-  int set_max_connections(int maximum);
+  int64_t set_max_connections(int64_t maximum);
 
   /** @brief Returns maximum active connections
    *
-   * @return Maximum as int
+   * @return Maximum as int64_t
    */
-  int get_max_connections() const noexcept {
+  int64_t get_max_connections() const noexcept {
     return max_connections_;
   }
 
+  /** @brief Sets connection rate limits
+   *
+   * Must be called before start().
+   *
+   * @throw std::invalid_argument when an invalid value was provided.
+   *
+   * @param limits rate limits, 0 disables a limit
+   */
+  void set_connection_rate_limits(const routing::ConnectionRateLimits& limits);
+
+  /** @brief Sets socket options of the route
+   *
+   * Must be called before start().
+   *
+   * @throw std::invalid_argument when an invalid value was provided.
+   *
+   * @param socket_options socket options, 0 keeps the operating system default
+   */
+  void set_socket_options(const routing::SocketOptions& socket_options);
+
+  /** @brief Sets up statistics of sampled statements
+   *
+   * Must be called before start().
+   *
+   * @param size max number of query digests kept
+   * @param sample_rate sample 1 out of sample_rate statements, 0 disables
+   *                    the statistics
+   */
+  void set_query_digest(size_t size, uint32_t sample_rate);
+
+  /** @brief Sets how many connections are traced
+   *
+   * Traced connections record spans from accept() until they close, see
+   * mysql_harness::tracing::Tracer. Must be called before start().
+   *
+   * @param sample_rate trace 1 out of sample_rate connections, 0 disables
+   *                    tracing
+   */
+  void set_trace_sample_rate(uint32_t sample_rate) {
+    trace_sample_rate_ = sample_rate;
+  }
+
   /**
    * @brief create new connection to MySQL Server than can handle client's traffic
    *        and adds it to connection container. Every connection runs in it's own
@@ -226,8 +273,19 @@ public:
    *
    * @param client_socket socket used to send/receive data to/from client
    * @param client_addr address of client
+   * @param accepted_at when the client connection was accepted
    */
-  void create_connection(int client_socket, const sockaddr_storage& client_addr);
+  void create_connection(int client_socket, const sockaddr_storage& client_addr,
+                         std::chrono::steady_clock::time_point accepted_at);
+
+  /** @brief Takes a snapshot of the state of the route
+   *
+   * While running, the route publishes the snapshot to
+   * MySQLRoutingComponent every kStatusPublishInterval.
+   *
+   * @return snapshot of the route
+   */
+  std::shared_ptr<const routing::RouteStatus> get_status();
 
 private:
   /** @brief Sets up the TCP service
@@ -264,6 +322,9 @@ private:
 
   void start_acceptor(mysql_harness::PluginFuncEnv* env);
 
+  /** @brief returns a trace id if the next connection is traced, 0 otherwise */
+  uint64_t sample_trace();
+
   /** @brief wrapper for data used by all connections */
   MySQLRoutingContext context_;
 
@@ -285,7 +346,7 @@ private:
    * by this MySQLRouter instances. There is no maximum for outgoing
    * connections since it is one-to-one with incoming.
    */
-  int max_connections_;
+  int64_t max_connections_;
 
   /** @brief Socket descriptor of the TCP service */
   int service_tcp_;
@@ -295,9 +356,24 @@ private:
   /** @brief used to unregister from subscription on allowed nodes changes */
   AllowedNodesChangeCallbacksListIterator allowed_nodes_list_iterator_;
 
+  /** @brief used to unregister from subscription on disallowed nodes */
+  DisallowedNodesCallbacksListIterator disallowed_nodes_list_iterator_;
+
   /** @brief container for connections */
   ConnectionContainer connection_container_;
 
+  /** @brief id of the last accepted connection, only used by the acceptor */
+  uint64_t last_connection_id_{0};
+
+  /** @brief trace 1 out of trace_sample_rate_ connections, 0 disables tracing */
+  uint32_t trace_sample_rate_{0};
+
+  /** @brief connections accepted since the last traced one, only used by the acceptor */
+  uint32_t connections_since_trace_{0};
+
+  /** @brief slot the snapshots of the route are published to */
+  std::shared_ptr<routing::RouteStatusSlot> status_slot_;
+
 #ifdef FRIEND_TEST
   FRIEND_TEST(RoutingTests, bug_24841281);
   FRIEND_TEST(RoutingTests, get_routing_thread_name);
@@ -28,6 +28,7 @@
 #include "mysqlrouter/metadata_cache.h"
 
 #include <algorithm>
+#include <cstring>
 #include <exception>
 #include <vector>
 
@@ -56,11 +57,32 @@ RoutingPluginConfig::RoutingPluginConfig(const mysql_harness::ConfigSection *sec
       connect_timeout(get_uint_option<uint16_t>(section, "connect_timeout", 1)),
       mode(get_option_mode(section, "mode")),
       routing_strategy(get_option_routing_strategy(section, "routing_strategy")),
-      max_connections(get_uint_option<uint16_t>(section, "max_connections", 1)),
+      max_connections(get_uint_option<uint32_t>(section, "max_connections", 1, routing::kMaxConnectionsLimit)),
       max_connect_errors(get_uint_option<uint32_t>(section, "max_connect_errors", 1, UINT32_MAX)),
       client_connect_timeout(get_uint_option<uint32_t>(section, "client_connect_timeout", 2, 31536000)),
       net_buffer_length(get_uint_option<uint32_t>(section, "net_buffer_length", 1024, 1048576)),
-      thread_stack_size(get_uint_option<uint32_t>(section, "thread_stack_size", 1, 65535)){
+      thread_stack_size(get_uint_option<uint32_t>(section, "thread_stack_size", 1, 65535)),
+      host_cache_size(get_uint_option<uint32_t>(section, "host_cache_size", 1, 1000000)),
+      connect_errors_timeout(get_uint_option<uint32_t>(section, "connect_errors_timeout", 0, 31536000)),
+      max_connections_per_second(get_uint_option<uint32_t>(section, "max_connections_per_second", 0, 1000000)),
+      max_client_connections_per_second(get_uint_option<uint32_t>(section, "max_client_connections_per_second", 0, 1000000)),
+      max_client_connections(get_uint_option<uint32_t>(section, "max_client_connections", 0)),
+      client_ipv4_prefix_length(get_uint_option<uint16_t>(section, "client_ipv4_prefix_length", 0, 32)),
+      client_ipv6_prefix_length(get_uint_option<uint16_t>(section, "client_ipv6_prefix_length", 0, 128)),
+      listen_backlog(get_uint_option<uint32_t>(section, "listen_backlog", 1, 65535)),
+      socket_receive_buffer_size(get_uint_option<uint32_t>(section, "socket_receive_buffer_size", 0, 67108864)),
+      socket_send_buffer_size(get_uint_option<uint32_t>(section, "socket_send_buffer_size", 0, 67108864)),
+      tcp_notsent_lowat(get_uint_option<uint32_t>(section, "tcp_notsent_lowat", 0, 67108864)),
+      tcp_defer_accept(get_uint_option<uint32_t>(section, "tcp_defer_accept", 0, 3600)),
+      tcp_fastopen(get_uint_option<uint32_t>(section, "tcp_fastopen", 0, 65535)),
+      tcp_keepalive(get_uint_option<uint16_t>(section, "tcp_keepalive", 0, 1)),
+      tcp_keepalive_idle(get_uint_option<uint32_t>(section, "tcp_keepalive_idle", 0, 32767)),
+      tcp_keepalive_interval(get_uint_option<uint32_t>(section, "tcp_keepalive_interval", 0, 32767)),
+      tcp_keepalive_count(get_uint_option<uint32_t>(section, "tcp_keepalive_count", 0, 127)),
+      tcp_user_timeout(get_uint_option<uint32_t>(section, "tcp_user_timeout", 0, 86400000)),
+      query_digest_sample_rate(get_uint_option<uint32_t>(section, "query_digest_sample_rate", 0, 1000000)),
+      query_digest_size(get_uint_option<uint32_t>(section, "query_digest_size", 1, 100000)),
+      trace_sample_rate(get_uint_option<uint32_t>(section, "trace_sample_rate", 0, 1000000)){
 
   // either bind_address or socket needs to be set, or both
   if (!bind_address.port && !named_socket.is_set()) {
@@ -79,6 +101,27 @@ string RoutingPluginConfig::get_default(const string &option) const {
       {"client_connect_timeout", to_string(std::chrono::duration_cast<std::chrono::seconds>(routing::kDefaultClientConnectTimeout).count())},
       {"net_buffer_length", to_string(routing::kDefaultNetBufferLength)},
       {"thread_stack_size", to_string(mysql_harness::kDefaultStackSizeInKiloBytes)},
+      {"host_cache_size", to_string(routing::kDefaultHostCacheSize)},
+      {"connect_errors_timeout", to_string(routing::kDefaultConnectErrorsTimeout.count())},
+      {"max_connections_per_second", "0"},
+      {"max_client_connections_per_second", "0"},
+      {"max_client_connections", "0"},
+      {"client_ipv4_prefix_length", "32"},
+      {"client_ipv6_prefix_length", "128"},
+      {"listen_backlog", to_string(routing::kDefaultListenBacklog)},
+      {"socket_receive_buffer_size", "0"},
+      {"socket_send_buffer_size", "0"},
+      {"tcp_notsent_lowat", "0"},
+      {"tcp_defer_accept", "0"},
+      {"tcp_fastopen", "0"},
+      {"tcp_keepalive", "0"},
+      {"tcp_keepalive_idle", "0"},
+      {"tcp_keepalive_interval", "0"},
+      {"tcp_keepalive_count", "0"},
+      {"tcp_user_timeout", "0"},
+      {"query_digest_sample_rate", "0"},
+      {"query_digest_size", "100"},
+      {"trace_sample_rate", "0"},
   };
 
   auto it = defaults.find(option);
@@ -188,27 +231,34 @@ string RoutingPluginConfig::get_option_destinations(const mysql_harness::ConfigS
     value = get_default(option);
   }
 
-  try {
-    // disable root-less paths like mailto:foo@example.org to stay
-    // backward compatible with
-    //
-    //   localhost:1234,localhost:1235
-    //
-    // which parse into:
-    //
-    //   scheme: localhost
-    //   path: 1234,localhost:1235
-    auto uri = URI(value, // raises URIError when URI is invalid
-        false  // allow_path_rootless
-        );
-    if (uri.scheme == "metadata-cache" || uri.scheme == "fabric+cache") {
-      metadata_cache_ = true;
-    } else {
-      throw invalid_argument(
-        get_log_prefix(option) + " has an invalid URI scheme '" + uri.scheme + "' for URI " + value);
+  // unix:/path/to/mysqld.sock is a valid URI, but a list of destinations
+  if (!is_unix_socket_destination(value)) {
+    try {
+      // disable root-less paths like mailto:foo@example.org to stay
+      // backward compatible with
+      //
+      //   localhost:1234,localhost:1235
+      //
+      // which parse into:
+      //
+      //   scheme: localhost
+      //   path: 1234,localhost:1235
+      auto uri = URI(value, // raises URIError when URI is invalid
+          false  // allow_path_rootless
+          );
+      if (uri.scheme == "metadata-cache" || uri.scheme == "fabric+cache") {
+        metadata_cache_ = true;
+      } else {
+        throw invalid_argument(
+          get_log_prefix(option) + " has an invalid URI scheme '" + uri.scheme + "' for URI " + value);
+      }
+      return value;
+    } catch (URIError &) {
+      // not a URI, comma separated list of destinations
     }
-    return value;
-  } catch (URIError &) {
+  }
+
+  {
     char delimiter = ',';
 
     mysqlrouter::trim(value);
@@ -226,6 +276,22 @@ string RoutingPluginConfig::get_option_destinations(const mysql_harness::ConfigS
         throw invalid_argument(get_log_prefix(option) +
                                    ": empty address found in destination list (was '" + value + "')");
       }
+      if (is_unix_socket_destination(part)) {
+        const std::string path = part.substr(std::strlen(kUnixSocketDestinationPrefix));
+        std::string error_msg;
+#ifdef _WIN32
+        throw invalid_argument(get_log_prefix(option) +
+                                   ": Unix socket destinations are not supported on Windows (was '" + part + "')");
+#endif
+        if (path.empty() || path.front() != '/') {
+          throw invalid_argument(get_log_prefix(option) +
+                                     ": Unix socket destination needs an absolute path (was '" + part + "')");
+        }
+        if (!mysqlrouter::is_valid_socket_name(path, error_msg)) {
+          throw invalid_argument(get_log_prefix(option) + ": " + error_msg);
+        }
+        continue;
+      }
       try {
         info = mysqlrouter::split_addr_port(part);
       } catch (const std::runtime_error &e) {
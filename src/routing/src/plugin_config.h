@@ -85,7 +85,7 @@ public:
   /** @brief `routing_strategy` option read from configuration section */
   routing::RoutingStrategy routing_strategy;
   /** @brief `max_connections` option read from configuration section */
-  const int max_connections;
+  const uint32_t max_connections;
   /** @brief `max_connect_errors` option read from configuration section */
   const unsigned long long max_connect_errors;
   /** @brief `client_connect_timeout` option read from configuration section */
@@ -94,6 +94,48 @@ public:
   const unsigned int net_buffer_length;
   /** @brief memory in kilobytes allocated for thread's stack */
   const unsigned int thread_stack_size;
+  /** @brief `host_cache_size` option read from configuration section */
+  const unsigned int host_cache_size;
+  /** @brief `connect_errors_timeout` option read from configuration section */
+  const unsigned int connect_errors_timeout;
+  /** @brief `max_connections_per_second` option read from configuration section */
+  const unsigned int max_connections_per_second;
+  /** @brief `max_client_connections_per_second` option read from configuration section */
+  const unsigned int max_client_connections_per_second;
+  /** @brief `max_client_connections` option read from configuration section */
+  const unsigned int max_client_connections;
+  /** @brief `client_ipv4_prefix_length` option read from configuration section */
+  const uint16_t client_ipv4_prefix_length;
+  /** @brief `client_ipv6_prefix_length` option read from configuration section */
+  const uint16_t client_ipv6_prefix_length;
+  /** @brief `listen_backlog` option read from configuration section */
+  const unsigned int listen_backlog;
+  /** @brief `socket_receive_buffer_size` option read from configuration section */
+  const unsigned int socket_receive_buffer_size;
+  /** @brief `socket_send_buffer_size` option read from configuration section */
+  const unsigned int socket_send_buffer_size;
+  /** @brief `tcp_notsent_lowat` option read from configuration section */
+  const unsigned int tcp_notsent_lowat;
+  /** @brief `tcp_defer_accept` option read from configuration section */
+  const unsigned int tcp_defer_accept;
+  /** @brief `tcp_fastopen` option read from configuration section */
+  const unsigned int tcp_fastopen;
+  /** @brief `tcp_keepalive` option read from configuration section */
+  const uint16_t tcp_keepalive;
+  /** @brief `tcp_keepalive_idle` option read from configuration section */
+  const unsigned int tcp_keepalive_idle;
+  /** @brief `tcp_keepalive_interval` option read from configuration section */
+  const unsigned int tcp_keepalive_interval;
+  /** @brief `tcp_keepalive_count` option read from configuration section */
+  const unsigned int tcp_keepalive_count;
+  /** @brief `tcp_user_timeout` option read from configuration section */
+  const unsigned int tcp_user_timeout;
+  /** @brief `query_digest_sample_rate` option read from configuration section */
+  const unsigned int query_digest_sample_rate;
+  /** @brief `query_digest_size` option read from configuration section */
+  const unsigned int query_digest_size;
+  /** @brief `trace_sample_rate` option read from configuration section */
+  const unsigned int trace_sample_rate;
 protected:
 
 private:
@@ -99,12 +99,15 @@ int ClassicProtocol::copy_packets(int sender, int receiver, bool sender_is_reada
         // We got error from MySQL Server while handshaking
         // We do not consider this a failed handshake
 
-        // copy part of the buffer containing serialized error
-        RoutingProtocolBuffer buffer_err(buffer.begin(), buffer.begin() +
-                                         static_cast<RoutingProtocolBuffer::iterator::difference_type>(bytes_read));
-
-        auto server_error = mysql_protocol::ErrorPacket(buffer_err);
-        if (so->write_all(receiver, server_error.data(), server_error.size()) < 0) {
+        // validate the serialized error in place and pass it on as is
+        try {
+          mysql_protocol::ErrorPacketView server_error(
+              mysql_protocol::PacketView(buffer.data(), bytes_read));
+        } catch (const mysql_protocol::packet_error &exc) {
+          log_debug("%s", exc.what());
+          return -1;
+        }
+        if (so->write_all(receiver, buffer.data(), bytes_read) < 0) {
           log_debug("fd=%d write error: %s",
               receiver, get_message_error(so->get_errno()).c_str());
         }
@@ -119,8 +122,8 @@ int ClassicProtocol::copy_packets(int sender, int receiver, bool sender_is_reada
         // if client is switching to SSL, we are not continuing any checks
         mysql_protocol::Capabilities::Flags capabilities;
         try {
-          auto pkt = mysql_protocol::Packet(buffer);
-          capabilities = mysql_protocol::Capabilities::Flags(pkt.read_int_from<uint32_t>(4));
+          capabilities = mysql_protocol::HandshakeResponsePacket::read_capabilities(
+              mysql_protocol::PacketView(buffer.data(), bytes_read));
         } catch (const mysql_protocol::packet_error &exc) {
           log_debug("%s", exc.what());
           return -1;
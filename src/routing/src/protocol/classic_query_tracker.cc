@@ -0,0 +1,286 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "classic_query_tracker.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "../query_digest.h"
+#include "mysqlrouter/mysql_protocol.h"
+
+namespace Capabilities = mysql_protocol::Capabilities;
+
+static const uint8_t kComQuery = 0x03;
+static const size_t kMaxPayloadLength = 0xffffff;
+static const uint16_t kServerMoreResultsExist = 0x0008;
+/** @brief CLIENT_QUERY_ATTRIBUTES, not known by mysql_protocol yet */
+static const uint32_t kQueryAttributes = 1U << 27;
+
+static size_t read_int3(const uint8_t *data) {
+  return static_cast<size_t>(data[0]) | static_cast<size_t>(data[1]) << 8 |
+         static_cast<size_t>(data[2]) << 16;
+}
+
+/**
+ * reads a length-encoded integer at data[pos], advances pos.
+ *
+ * @return false if it doesn't fit into the first `available` bytes
+ */
+static bool read_lenenc(const uint8_t *data, size_t available, size_t &pos,
+                        uint64_t &value) {
+  if (pos >= available) return false;
+
+  const uint8_t first = data[pos];
+  size_t size = 0;
+  if (first < 0xfb) {
+    value = first;
+    ++pos;
+    return true;
+  } else if (first == 0xfc) {
+    size = 2;
+  } else if (first == 0xfd) {
+    size = 3;
+  } else if (first == 0xfe) {
+    size = 8;
+  } else {
+    return false;  // NULL or invalid
+  }
+  if (pos + 1 + size > available) return false;
+
+  value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value |= static_cast<uint64_t>(data[pos + 1 + i]) << (8 * i);
+  }
+  pos += 1 + size;
+
+  return true;
+}
+
+void ClassicQueryTracker::on_client_data(const uint8_t *data, size_t length) {
+  size_t pos = 0;
+  while (pos < length && state_ != State::kDisabled) {
+    if (client_skip_ > 0) {
+      const size_t n = std::min(client_skip_, length - pos);
+      pos += n;
+      client_skip_ -= n;
+      continue;
+    }
+
+    if (length - pos < mysql_protocol::Packet::kHeaderSize) {
+      // the header is split over two reads, we lost the packet boundaries
+      state_ = State::kDisabled;
+      return;
+    }
+
+    const size_t payload_length = read_int3(data + pos);
+    const uint8_t seq = data[pos + 3];
+    pos += mysql_protocol::Packet::kHeaderSize;
+
+    on_client_packet(data + pos, std::min(payload_length, length - pos),
+                     payload_length, seq);
+    client_skip_ = payload_length;
+  }
+}
+
+void ClassicQueryTracker::on_client_packet(const uint8_t *payload, size_t available,
+                                           size_t /* payload_length */, uint8_t seq) {
+  if (state_ == State::kHandshake) {
+    // the first packet of the client is its handshake response
+    if (available < 4) {
+      state_ = State::kDisabled;
+      return;
+    }
+    capabilities_ = static_cast<uint32_t>(payload[0]) | static_cast<uint32_t>(payload[1]) << 8 |
+                    static_cast<uint32_t>(payload[2]) << 16 | static_cast<uint32_t>(payload[3]) << 24;
+
+    const uint32_t unsupported = (Capabilities::SSL | Capabilities::COMPRESS |
+                                  Capabilities::OPTIONAL_RESULTSET_METADATA).bits();
+    if (!(capabilities_ & Capabilities::PROTOCOL_41.bits()) || (capabilities_ & unsupported)) {
+      state_ = State::kDisabled;
+    } else {
+      state_ = State::kIdle;
+    }
+    return;
+  }
+
+  // packets with seq > 0 belong to the authentication or to a command
+  // already sent (e.g. LOAD DATA LOCAL), only seq 0 starts a command
+  if (seq != 0) return;
+
+  // a new command while we still wait for a result: statements were
+  // pipelined or we misread the result, don't record anything
+  if (is_tracking()) state_ = State::kIdle;
+
+  if (available < 1 || payload[0] != kComQuery || !table_.should_sample()) return;
+
+  const uint8_t *query = payload + 1;
+  size_t query_length = available - 1;
+  if (capabilities_ & kQueryAttributes) {
+    // parameter_count and parameter_set_count, only sample statements
+    // without query attributes
+    if (query_length < 2 || query[0] != 0) return;
+    query += 2;
+    query_length -= 2;
+  }
+
+  digest_ = routing::normalize_query(reinterpret_cast<const char *>(query), query_length);
+  sent_ = clock_type::now();
+  got_response_ = false;
+  rows_ = 0;
+  bytes_ = 0;
+  header_have_ = 0;
+  continuation_ = false;
+  state_ = State::kResultHeader;
+}
+
+void ClassicQueryTracker::on_server_data(const uint8_t *data, size_t length) {
+  if (!is_tracking() || length == 0) return;
+
+  if (!got_response_) {
+    got_response_ = true;
+    first_response_ = clock_type::now();
+  }
+
+  size_t pos = 0;
+  while (pos < length && is_tracking()) {
+    if (header_have_ < sizeof(header_)) {
+      const size_t n = std::min(sizeof(header_) - header_have_, length - pos);
+      std::memcpy(header_ + header_have_, data + pos, n);
+      header_have_ += n;
+      pos += n;
+      bytes_ += n;
+      if (header_have_ < sizeof(header_)) break;
+
+      payload_length_ = read_int3(header_);
+      payload_left_ = payload_length_;
+      prefix_have_ = 0;
+    }
+
+    const size_t n = std::min(payload_left_, length - pos);
+    const size_t to_prefix = std::min(n, kPrefixSize - prefix_have_);
+    std::memcpy(prefix_ + prefix_have_, data + pos, to_prefix);
+    prefix_have_ += to_prefix;
+    pos += n;
+    bytes_ += n;
+    payload_left_ -= n;
+
+    if (payload_left_ == 0) {
+      // packet complete
+      header_have_ = 0;
+      const bool continued = continuation_;
+      continuation_ = (payload_length_ == kMaxPayloadLength);
+      if (!continued) on_server_packet();
+    }
+  }
+}
+
+void ClassicQueryTracker::on_server_packet() {
+  const uint8_t first = prefix_have_ > 0 ? prefix_[0] : 0;
+  const bool deprecate_eof = (capabilities_ & Capabilities::DEPRECATE_EOF.bits()) != 0;
+
+  switch (state_) {
+    case State::kResultHeader:
+      if (prefix_have_ == 0 || first == 0xff) {
+        finish(true);
+      } else if (first == 0x00) {
+        // OK, no result set
+        if (!has_more_results(1)) finish(false);
+      } else if (first == 0xfb) {
+        // LOCAL INFILE request, the client sends the file next
+        finish(false);
+      } else {
+        size_t pos = 0;
+        if (!read_lenenc(prefix_, prefix_have_, pos, columns_left_) || columns_left_ == 0) {
+          finish(true);
+        } else {
+          state_ = State::kColumnDefs;
+        }
+      }
+      break;
+    case State::kColumnDefs:
+      if (--columns_left_ == 0) {
+        state_ = deprecate_eof ? State::kRows : State::kColumnsEof;
+      }
+      break;
+    case State::kColumnsEof:
+      // EOF after the column definitions
+      state_ = State::kRows;
+      break;
+    case State::kRows:
+      if (first == 0xff) {
+        finish(true);
+      } else if (first == 0xfe && payload_length_ < kMaxPayloadLength) {
+        // EOF, or OK with a 0xfe header if DEPRECATE_EOF is used. Rows
+        // can't start with 0xfe unless they are larger than a packet.
+        if (deprecate_eof ? has_more_results(1) : has_more_results(0)) {
+          state_ = State::kResultHeader;
+        } else {
+          finish(false);
+        }
+      } else {
+        ++rows_;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * checks SERVER_MORE_RESULTS_EXISTS in the status of an EOF or OK packet
+ * in prefix_.
+ *
+ * @param ok_header_size 0 for an EOF packet; the size of the header byte
+ *        (1) for an OK packet whose status follows two length-encoded
+ *        integers
+ */
+bool ClassicQueryTracker::has_more_results(size_t ok_header_size) const {
+  size_t pos;
+  if (ok_header_size == 0) {
+    // 0xfe, warnings (2), status (2)
+    pos = 3;
+  } else {
+    // header, affected rows, last insert id, status (2)
+    pos = ok_header_size;
+    uint64_t ignored;
+    if (!read_lenenc(prefix_, prefix_have_, pos, ignored) ||
+        !read_lenenc(prefix_, prefix_have_, pos, ignored)) {
+      return false;
+    }
+  }
+  if (pos + 2 > prefix_have_) return false;
+
+  const uint16_t status = static_cast<uint16_t>(prefix_[pos] | prefix_[pos + 1] << 8);
+
+  return (status & kServerMoreResultsExist) != 0;
+}
+
+void ClassicQueryTracker::finish(bool error) {
+  table_.record(digest_,
+                std::chrono::duration_cast<std::chrono::microseconds>(first_response_ - sent_),
+                rows_, bytes_, error);
+  state_ = State::kIdle;
+}
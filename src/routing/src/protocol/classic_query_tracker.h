@@ -0,0 +1,114 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef ROUTING_CLASSIC_QUERY_TRACKER_INCLUDED
+#define ROUTING_CLASSIC_QUERY_TRACKER_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace routing { class QueryDigestTable; }
+
+/** @class ClassicQueryTracker
+ * @brief Follows the classic protocol of a connection to time statements
+ *
+ * The tracker is fed with the data the connection forwards. It frames the
+ * client's packets, samples COM_QUERY statements (see
+ * routing::QueryDigestTable::should_sample()) and, for a sampled
+ * statement, frames the server's response to count the rows and bytes
+ * returned until the result is complete. The result is added to the
+ * digest table.
+ *
+ * Connections using SSL or compression can't be followed and are
+ * ignored. When the tracker loses track of the packet boundaries it
+ * stops for the rest of the connection.
+ */
+class ClassicQueryTracker {
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  explicit ClassicQueryTracker(routing::QueryDigestTable &table)
+      : table_(table) {}
+
+  /** @brief data forwarded from the client to the server */
+  void on_client_data(const uint8_t *data, size_t length);
+
+  /** @brief data forwarded from the server to the client */
+  void on_server_data(const uint8_t *data, size_t length);
+
+  /** @brief whether the tracker waits for the result of a statement */
+  bool is_tracking() const noexcept {
+    return state_ == State::kResultHeader || state_ == State::kColumnDefs ||
+           state_ == State::kColumnsEof || state_ == State::kRows;
+  }
+
+ private:
+  enum class State {
+    kHandshake,
+    kIdle,
+    kDisabled,
+    kResultHeader,
+    kColumnDefs,
+    kColumnsEof,
+    kRows,
+  };
+
+  void on_client_packet(const uint8_t *payload, size_t available,
+                        size_t payload_length, uint8_t seq);
+  void on_server_packet();
+  bool has_more_results(size_t ok_header_size) const;
+  void finish(bool error);
+
+  routing::QueryDigestTable &table_;
+  State state_{State::kHandshake};
+  uint32_t capabilities_{0};
+
+  /** @brief bytes of the current client packet not seen yet */
+  size_t client_skip_{0};
+
+  // statement being tracked
+  std::string digest_;
+  clock_type::time_point sent_;
+  clock_type::time_point first_response_;
+  bool got_response_{false};
+  uint64_t rows_{0};
+  uint64_t bytes_{0};
+  uint64_t columns_left_{0};
+
+  // framing of the server's packets
+  static const size_t kPrefixSize = 32;
+  uint8_t header_[4];
+  size_t header_have_{0};
+  size_t payload_length_{0};
+  size_t payload_left_{0};
+  uint8_t prefix_[kPrefixSize];
+  size_t prefix_have_{0};
+  /** @brief current packet continues a packet of max size */
+  bool continuation_{false};
+};
+
+#endif // ROUTING_CLASSIC_QUERY_TRACKER_INCLUDED
@@ -38,6 +38,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "mysqlx_session.pb.h"
 #include "mysqlx_connection.pb.h"
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
 #endif
@@ -82,8 +83,200 @@ static bool send_message(const std::string &log_prefix,
   return true;
 }
 
+// Handshake messages are validated straight from the wire format instead of
+// being parsed into (heap allocated) protobuf messages: the validator walks
+// the tags and lengths and checks that the required fields the messages
+// and their nested messages declare are present, which is what
+// ParseFromArray() checks too. (Unlike the protobuf parser it doesn't merge
+// repeated occurrences of a non-repeated nested message before checking
+// them, which no client sends anyway.)
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+
+namespace {
+
+struct XMessageSchema;
+
+/** what the validator needs to know about a field of a message */
+struct XFieldSchema {
+  uint32_t number;
+  WireFormatLite::WireType wire_type;
+  bool required;
+  /** schema of the nested message; nullptr if the field is no message */
+  const XMessageSchema *message;
+  /** if not 0, the field is an enum with values 1..enum_values */
+  uint32_t enum_values;
+};
+
+struct XMessageSchema {
+  const XFieldSchema *fields;
+  size_t num_fields;
+};
+
+constexpr WireFormatLite::WireType kVarint = WireFormatLite::WIRETYPE_VARINT;
+constexpr WireFormatLite::WireType kFixed64 = WireFormatLite::WIRETYPE_FIXED64;
+constexpr WireFormatLite::WireType kFixed32 = WireFormatLite::WIRETYPE_FIXED32;
+constexpr WireFormatLite::WireType kLengthDelimited = WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+
+// same limit as the default of google::protobuf::io::CodedInputStream
+constexpr int kMaxRecursionDepth = 100;
+
+// mysqlx_datatypes.proto
+extern const XMessageSchema kAnySchema;
+
+const XFieldSchema kScalarStringFields[] = {
+  {1, kLengthDelimited, true, nullptr, 0},   // value
+  {2, kVarint, false, nullptr, 0},           // collation
+};
+const XMessageSchema kScalarStringSchema{kScalarStringFields, 2};
+
+const XFieldSchema kScalarOctetsFields[] = {
+  {1, kLengthDelimited, true, nullptr, 0},   // value
+  {2, kVarint, false, nullptr, 0},           // content_type
+};
+const XMessageSchema kScalarOctetsSchema{kScalarOctetsFields, 2};
+
+const XFieldSchema kScalarFields[] = {
+  {1, kVarint, true, nullptr, 8},            // type
+  {2, kVarint, false, nullptr, 0},           // v_signed_int
+  {3, kVarint, false, nullptr, 0},           // v_unsigned_int
+  {5, kLengthDelimited, false, &kScalarOctetsSchema, 0},  // v_octets
+  {6, kFixed64, false, nullptr, 0},          // v_double
+  {7, kFixed32, false, nullptr, 0},          // v_float
+  {8, kVarint, false, nullptr, 0},           // v_bool
+  {9, kLengthDelimited, false, &kScalarStringSchema, 0},  // v_string
+};
+const XMessageSchema kScalarSchema{kScalarFields, 8};
+
+const XFieldSchema kObjectFieldFields[] = {
+  {1, kLengthDelimited, true, nullptr, 0},   // key
+  {2, kLengthDelimited, true, &kAnySchema, 0},  // value
+};
+const XMessageSchema kObjectFieldSchema{kObjectFieldFields, 2};
+
+const XFieldSchema kObjectFields[] = {
+  {1, kLengthDelimited, false, &kObjectFieldSchema, 0},  // fld
+};
+const XMessageSchema kObjectSchema{kObjectFields, 1};
+
+const XFieldSchema kArrayFields[] = {
+  {1, kLengthDelimited, false, &kAnySchema, 0},  // value
+};
+const XMessageSchema kArraySchema{kArrayFields, 1};
+
+const XFieldSchema kAnyFields[] = {
+  {1, kVarint, true, nullptr, 3},            // type
+  {2, kLengthDelimited, false, &kScalarSchema, 0},  // scalar
+  {3, kLengthDelimited, false, &kObjectSchema, 0},  // obj
+  {4, kLengthDelimited, false, &kArraySchema, 0},   // array
+};
+const XMessageSchema kAnySchema{kAnyFields, 4};
+
+// mysqlx_connection.proto
+const XFieldSchema kCapabilityFields[] = {
+  {1, kLengthDelimited, true, nullptr, 0},   // name
+  {2, kLengthDelimited, true, &kAnySchema, 0},  // value
+};
+const XMessageSchema kCapabilitySchema{kCapabilityFields, 2};
+
+const XFieldSchema kCapabilitiesFields[] = {
+  {1, kLengthDelimited, false, &kCapabilitySchema, 0},  // capabilities
+};
+const XMessageSchema kCapabilitiesSchema{kCapabilitiesFields, 1};
+
+const XFieldSchema kCapabilitiesSetFields[] = {
+  {1, kLengthDelimited, true, &kCapabilitiesSchema, 0},  // capabilities
+};
+const XMessageSchema kCapabilitiesSetSchema{kCapabilitiesSetFields, 1};
+
+const XMessageSchema kCapabilitiesGetSchema{nullptr, 0};
+const XMessageSchema kCloseSchema{nullptr, 0};
+
+// mysqlx_session.proto
+const XFieldSchema kAuthenticateStartFields[] = {
+  {1, kLengthDelimited, true, nullptr, 0},   // mech_name
+  {2, kLengthDelimited, false, nullptr, 0},  // auth_data
+  {3, kLengthDelimited, false, nullptr, 0},  // initial_response
+};
+const XMessageSchema kAuthenticateStartSchema{kAuthenticateStartFields, 3};
+
+}  // namespace
+
+static bool validate_message(CodedInputStream &input, const XMessageSchema &schema, int depth);
+
+static bool validate_field(CodedInputStream &input, const XFieldSchema &field, int depth,
+                           bool &is_set) {
+  switch (field.wire_type) {
+  case WireFormatLite::WIRETYPE_VARINT:
+    if (field.enum_values) {
+      // unknown enum values are no value at all (see proto2 enums)
+      uint32_t value;
+      if (!input.ReadVarint32(&value)) return false;
+      is_set = value >= 1 && value <= field.enum_values;
+    } else {
+      uint64_t value;
+      if (!input.ReadVarint64(&value)) return false;
+      is_set = true;
+    }
+    return true;
+  case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+    uint32_t length;
+    if (!input.ReadVarint32(&length)) return false;
+    if (field.message == nullptr) {
+      is_set = true;
+      return input.Skip(static_cast<int>(length));
+    }
+    // a nested message must not claim more bytes than its parent has left
+    if (length > static_cast<uint32_t>(input.BytesUntilLimit()) || depth >= kMaxRecursionDepth)
+      return false;
+
+    const CodedInputStream::Limit limit = input.PushLimit(static_cast<int>(length));
+    if (!validate_message(input, *field.message, depth + 1) || !input.ConsumedEntireMessage())
+      return false;
+    input.PopLimit(limit);
+    is_set = true;
+    return true;
+  }
+  default:
+    is_set = true;
+    return WireFormatLite::SkipField(&input, WireFormatLite::MakeTag(
+        static_cast<int>(field.number), field.wire_type));
+  }
+}
+
+static bool validate_message(CodedInputStream &input, const XMessageSchema &schema, int depth) {
+  uint32_t required_missing = 0;
+  for (size_t i = 0; i < schema.num_fields; ++i) {
+    if (schema.fields[i].required) required_missing |= 1u << i;
+  }
+
+  uint32_t tag;
+  while ((tag = input.ReadTag()) != 0) {
+    if (WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_END_GROUP)
+      return false;
+
+    const uint32_t number = static_cast<uint32_t>(WireFormatLite::GetTagFieldNumber(tag));
+    const XFieldSchema *field = std::find_if(schema.fields, schema.fields + schema.num_fields,
+        [number](const XFieldSchema &f) { return f.number == number; });
+
+    if (field == schema.fields + schema.num_fields ||
+        field->wire_type != WireFormatLite::GetTagWireType(tag)) {
+      // unknown fields are skipped, like the protobuf parser does
+      if (!WireFormatLite::SkipField(&input, tag)) return false;
+      continue;
+    }
+
+    bool is_set = false;
+    if (!validate_field(input, *field, depth, is_set)) return false;
+    if (is_set) required_missing &= ~(1u << (field - schema.fields));
+  }
+
+  return required_missing == 0;
+}
+
 static bool message_valid(const void* message_buffer, const int8_t message_type, const uint32_t message_size) {
-  std::unique_ptr<google::protobuf::Message> msg;
+  const XMessageSchema *schema;
 
   assert(message_type == Mysqlx::ClientMessages::SESS_AUTHENTICATE_START
          || message_type == Mysqlx::ClientMessages::CON_CAPABILITIES_GET
@@ -92,26 +285,22 @@ static bool message_valid(const void* message_buffer, const int8_t message_type,
 
   switch (message_type) {
   case Mysqlx::ClientMessages::SESS_AUTHENTICATE_START:
-    msg.reset(new Mysqlx::Session::AuthenticateStart());
+    schema = &kAuthenticateStartSchema;
     break;
   case Mysqlx::ClientMessages::CON_CAPABILITIES_GET:
-    msg.reset(new Mysqlx::Connection::CapabilitiesGet());
+    schema = &kCapabilitiesGetSchema;
     break;
   case Mysqlx::ClientMessages::CON_CAPABILITIES_SET:
-    msg.reset(new Mysqlx::Connection::CapabilitiesSet());
+    schema = &kCapabilitiesSetSchema;
     break;
   default: /* Mysqlx::ClientMessages::CON_CLOSE */
-    msg.reset(new Mysqlx::Connection::Close());
-  }
-
-  assert(msg.get() != nullptr);
-
-  // sanity check deserializing the message
-  if (!msg->ParseFromArray(message_buffer, static_cast<int>(message_size))) {
-    return false;
+    schema = &kCloseSchema;
   }
 
-  return true;
+  // sanity check the wire format of the message
+  CodedInputStream input(static_cast<const uint8_t*>(message_buffer), static_cast<int>(message_size));
+  input.PushLimit(static_cast<int>(message_size));
+  return validate_message(input, *schema, 0) && input.ConsumedEntireMessage();
 }
 
 static bool get_next_message(int sender,
@@ -0,0 +1,331 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "query_digest.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+namespace routing {
+
+static bool is_word_char(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+static bool is_operator_char(char c) {
+  return c != '\0' && std::strchr("<>=!|&:", c) != nullptr;
+}
+
+static bool is_space(char c) {
+  return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+/**
+ * skips a quoted string starting at query[pos], returns the position
+ * after the closing quote.
+ */
+static size_t skip_quoted(const char *query, size_t length, size_t pos) {
+  const char quote = query[pos++];
+  while (pos < length) {
+    const char c = query[pos++];
+    if (c == '\\') {
+      ++pos;
+    } else if (c == quote) {
+      if (pos < length && query[pos] == quote) {
+        ++pos;  // doubled quote
+      } else {
+        break;
+      }
+    }
+  }
+
+  return std::min(pos, length);
+}
+
+/**
+ * collapses a parenthesized list of only placeholders into "(...)" and
+ * merges it with a directly preceding "(...), ".
+ *
+ * Called right before the closing parenthesis is appended.
+ */
+static void close_paren(std::string &out) {
+  const auto open = out.rfind('(');
+  if (open == std::string::npos) {
+    out += ')';
+    return;
+  }
+
+  const auto inner = out.substr(open + 1);
+  const bool only_placeholders =
+      !inner.empty() && inner.find('?') != std::string::npos &&
+      inner.find_first_not_of("?, ") == std::string::npos;
+  if (!only_placeholders) {
+    out += ')';
+    return;
+  }
+
+  out.erase(open);
+  static const std::string kPrevGroup { "(...), " };
+  if (out.size() >= kPrevGroup.size() &&
+      out.compare(out.size() - kPrevGroup.size(), kPrevGroup.size(), kPrevGroup) == 0) {
+    // VALUES (...), (...) -> VALUES (...)
+    out.erase(out.size() - 2);
+  } else {
+    out += "(...)";
+  }
+}
+
+std::string normalize_query(const char *query, size_t length) {
+  std::string out;
+  out.reserve(std::min(length, kMaxQueryDigestLength));
+
+  bool pending_space = false;
+  // appends a token, separated from the previous one by a single space
+  auto append = [&out, &pending_space](const char *token, size_t token_len) {
+    const char first = token[0];
+    const char last = out.empty() ? '\0' : out.back();
+    const bool no_space_before = first == ',' || first == ')' || first == ';' ||
+                                 first == '.' || (first == '(' && !pending_space && last != ',') ||
+                                 (is_operator_char(first) && is_operator_char(last) &&
+                                  !pending_space);
+    const bool no_space_after = last == '(' || last == '.' || last == '\0';
+    if (!no_space_before && !no_space_after) out += ' ';
+    pending_space = false;
+
+    if (token_len == 1 && first == ')') {
+      close_paren(out);
+    } else {
+      out.append(token, token_len);
+    }
+  };
+
+  size_t pos = 0;
+  while (pos < length && out.size() < kMaxQueryDigestLength) {
+    const char c = query[pos];
+
+    if (is_space(c)) {
+      pending_space = true;
+      ++pos;
+    } else if (c == '#' || (c == '-' && pos + 2 < length && query[pos + 1] == '-' &&
+                            is_space(query[pos + 2]))) {
+      // comment until end of line
+      while (pos < length && query[pos] != '\n') ++pos;
+      pending_space = true;
+    } else if (c == '/' && pos + 1 < length && query[pos + 1] == '*') {
+      const char *end = std::search(query + pos + 2, query + length, "*/", "*/" + 2);
+      pos = std::min(static_cast<size_t>(end - query) + 2, length);
+      pending_space = true;
+    } else if (c == '\'' || c == '"') {
+      pos = skip_quoted(query, length, pos);
+      append("?", 1);
+    } else if (c == '`') {
+      const size_t start = pos;
+      pos = skip_quoted(query, length, pos);
+      append(query + start, pos - start);
+    } else if ((c == '-' || c == '+') && pos + 1 < length &&
+               std::isdigit(static_cast<unsigned char>(query[pos + 1])) &&
+               (out.empty() || out.back() == '(' || out.back() == ',' ||
+                is_operator_char(out.back()))) {
+      // sign of a number: id = -1
+      ++pos;
+    } else if (std::isdigit(static_cast<unsigned char>(c)) ||
+               (c == '.' && pos + 1 < length &&
+                std::isdigit(static_cast<unsigned char>(query[pos + 1])) &&
+                (out.empty() || !is_word_char(out.back())))) {
+      // number: 12, 1.5, .5, 1e-3, 0x1F, 0b101
+      ++pos;
+      while (pos < length) {
+        const char n = query[pos];
+        if (is_word_char(n) || n == '.') {
+          ++pos;
+        } else if ((n == '-' || n == '+') && (query[pos - 1] == 'e' || query[pos - 1] == 'E')) {
+          ++pos;
+        } else {
+          break;
+        }
+      }
+      append("?", 1);
+    } else if (is_word_char(c)) {
+      const size_t start = pos;
+      while (pos < length && is_word_char(query[pos])) ++pos;
+
+      // X'1F', B'101', N'text' and _utf8mb4'text' are literals
+      const size_t word_len = pos - start;
+      if (pos < length && query[pos] == '\'' &&
+          ((word_len == 1 && std::strchr("xXbBnN", query[start]) != nullptr) ||
+           query[start] == '_')) {
+        pos = skip_quoted(query, length, pos);
+        append("?", 1);
+      } else {
+        append(query + start, word_len);
+      }
+    } else {
+      append(query + pos, 1);
+      ++pos;
+    }
+  }
+
+  if (out.size() > kMaxQueryDigestLength) out.resize(kMaxQueryDigestLength);
+
+  return out;
+}
+
+void QueryDigestTable::configure(size_t capacity, uint32_t sample_rate) {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  capacity_ = capacity;
+  sample_rate_.store(sample_rate, std::memory_order_relaxed);
+  while (entries_.size() > capacity_) {
+    evict_one();
+  }
+}
+
+bool QueryDigestTable::should_sample() const noexcept {
+  const uint32_t rate = sample_rate_.load(std::memory_order_relaxed);
+  if (rate <= 1) return rate == 1;
+
+  // xorshift32, seeded per thread
+  static thread_local uint32_t state =
+      static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+
+  return state % rate == 0;
+}
+
+void QueryDigestTable::record(const std::string &digest, std::chrono::microseconds latency,
+                              uint64_t rows, uint64_t bytes, bool error) {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  if (capacity_ == 0) return;
+
+  Node *node;
+  auto it = entries_.find(digest);
+  if (it != entries_.end()) {
+    node = it->second.get();
+  } else if (entries_.size() < capacity_) {
+    std::unique_ptr<Node> new_node(new Node());
+    new_node->entry.digest = digest;
+    new_node->heap_pos = heap_.size();
+    node = new_node.get();
+    heap_.push_back(node);
+    entries_.emplace(digest, std::move(new_node));
+    sift_up(node->heap_pos);
+  } else {
+    // Space-Saving: replace the least frequent digest and inherit its count
+    auto least = entries_.find(heap_.front()->entry.digest);
+    std::unique_ptr<Node> new_node(std::move(least->second));
+    entries_.erase(least);
+
+    const uint64_t inherited = new_node->entry.count;
+    new_node->entry = Entry();
+    new_node->entry.digest = digest;
+    new_node->entry.count = inherited;
+    new_node->entry.count_error = inherited;
+    node = new_node.get();
+    entries_.emplace(digest, std::move(new_node));
+  }
+
+  Entry &entry = node->entry;
+  ++entry.count;
+  if (error) ++entry.errors;
+  entry.total_latency += latency;
+  entry.max_latency = std::max(entry.max_latency, latency);
+  entry.rows += rows;
+  entry.bytes += bytes;
+
+  sift_down(node->heap_pos);
+}
+
+void QueryDigestTable::evict_one() {
+  if (heap_.empty()) return;
+
+  Node *least = heap_.front();
+  swap_nodes(0, heap_.size() - 1);
+  heap_.pop_back();
+  sift_down(0);
+
+  entries_.erase(least->entry.digest);
+}
+
+void QueryDigestTable::swap_nodes(size_t a, size_t b) noexcept {
+  std::swap(heap_[a], heap_[b]);
+  heap_[a]->heap_pos = a;
+  heap_[b]->heap_pos = b;
+}
+
+void QueryDigestTable::sift_down(size_t pos) noexcept {
+  const size_t size = heap_.size();
+  for (;;) {
+    size_t least = pos;
+    const size_t left = 2 * pos + 1;
+    const size_t right = left + 1;
+    if (left < size && heap_[left]->entry.count < heap_[least]->entry.count) least = left;
+    if (right < size && heap_[right]->entry.count < heap_[least]->entry.count) least = right;
+    if (least == pos) return;
+
+    swap_nodes(pos, least);
+    pos = least;
+  }
+}
+
+void QueryDigestTable::sift_up(size_t pos) noexcept {
+  while (pos > 0) {
+    const size_t parent = (pos - 1) / 2;
+    if (!(heap_[pos]->entry.count < heap_[parent]->entry.count)) return;
+
+    swap_nodes(pos, parent);
+    pos = parent;
+  }
+}
+
+std::vector<QueryDigestTable::Entry> QueryDigestTable::get_entries() const {
+  std::vector<Entry> result;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    result.reserve(heap_.size());
+    for (const Node *node: heap_) {
+      result.push_back(node->entry);
+    }
+  }
+
+  std::sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) {
+    return a.count > b.count || (a.count == b.count && a.digest < b.digest);
+  });
+
+  return result;
+}
+
+void QueryDigestTable::clear() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  heap_.clear();
+  entries_.clear();
+}
+
+} // namespace routing
@@ -0,0 +1,156 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef ROUTING_QUERY_DIGEST_INCLUDED
+#define ROUTING_QUERY_DIGEST_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace routing {
+
+/** @brief max length of a normalized statement, longer ones are cut */
+static const size_t kMaxQueryDigestLength = 1024;
+
+/** @brief Normalizes a statement into its digest text
+ *
+ * Literals (strings, numbers, hex and bit values) are replaced by `?`,
+ * lists of literals like `IN (1, 2, 3)` or the rows of a multi-row
+ * INSERT collapse into a single `(...)`, comments are removed and
+ * whitespace is normalized. Statements that only differ in their literals
+ * get the same digest.
+ *
+ * It's a single pass over the statement, cheap enough to run for sampled
+ * statements while forwarding.
+ *
+ * @param query statement as sent by the client, may be cut off
+ * @param length length of query
+ * @return digest text, at most kMaxQueryDigestLength bytes
+ */
+std::string normalize_query(const char *query, size_t length);
+
+/** @class QueryDigestTable
+ * @brief Bounded table of statistics per query digest
+ *
+ * Holds at most `capacity` digests, counted with the Space-Saving
+ * algorithm: when a new digest arrives while the table is full, it
+ * replaces the digest with the lowest count and inherits that count.
+ * Entry::count may therefore overestimate a digest by up to
+ * Entry::count_error, but any digest seen more often than
+ * total/capacity times is guaranteed to be in the table.
+ *
+ * The digests are kept in a min-heap on their count, so finding the
+ * digest to replace and updating a count are O(log capacity).
+ */
+class QueryDigestTable {
+ public:
+  /** @brief Statistics of a digest */
+  struct Entry {
+    std::string digest;
+    /** @brief estimated count, including the inherited count_error */
+    uint64_t count{0};
+    /** @brief count inherited from the evicted digest, an upper bound of
+     * the overestimation. The other statistics cover the last
+     * count - count_error statements only. */
+    uint64_t count_error{0};
+    uint64_t errors{0};
+    std::chrono::microseconds total_latency{0};
+    std::chrono::microseconds max_latency{0};
+    uint64_t rows{0};
+    uint64_t bytes{0};
+  };
+
+  /** @brief Sets how many digests are kept and how often to sample
+   *
+   * @param capacity max number of digests, evicts digests if lowered
+   * @param sample_rate sample 1 out of sample_rate statements, 0 disables
+   *                    sampling
+   */
+  void configure(size_t capacity, uint32_t sample_rate);
+
+  /** @brief Whether statements are sampled at all */
+  bool is_enabled() const noexcept {
+    return sample_rate_.load(std::memory_order_relaxed) != 0;
+  }
+
+  /** @brief Decides whether to sample the next statement
+   *
+   * Uses a per-thread random generator, doesn't touch shared state.
+   */
+  bool should_sample() const noexcept;
+
+  /** @brief Adds the result of a sampled statement
+   *
+   * @param digest digest text, see normalize_query()
+   * @param latency time from sending the statement until the first
+   *                response packet
+   * @param rows rows returned
+   * @param bytes bytes returned
+   * @param error whether the statement failed
+   */
+  void record(const std::string &digest, std::chrono::microseconds latency,
+              uint64_t rows, uint64_t bytes, bool error);
+
+  /** @brief Returns all digests, the most frequent first */
+  std::vector<Entry> get_entries() const;
+
+  /** @brief Removes all digests */
+  void clear();
+
+ private:
+  struct Node {
+    Entry entry;
+    /** @brief position in heap_ */
+    size_t heap_pos;
+  };
+
+  /** @brief removes the least frequent digest, mtx_ must be held */
+  void evict_one();
+
+  /** @brief restores the heap order below `pos` after its count grew */
+  void sift_down(size_t pos) noexcept;
+
+  /** @brief restores the heap order above `pos` */
+  void sift_up(size_t pos) noexcept;
+
+  void swap_nodes(size_t a, size_t b) noexcept;
+
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, std::unique_ptr<Node>> entries_;
+  /** @brief min-heap of the entries on their count */
+  std::vector<Node *> heap_;
+  size_t capacity_{100};
+  std::atomic<uint32_t> sample_rate_{0};
+};
+
+} // namespace routing
+
+#endif // ROUTING_QUERY_DIGEST_INCLUDED
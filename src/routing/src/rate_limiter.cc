@@ -0,0 +1,408 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "rate_limiter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#  include <sys/socket.h>
+#endif
+
+namespace routing {
+
+static const int64_t kNanosecondsPerSecond = 1000000000;
+
+static int64_t now_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             TokenBucket::clock_type::now().time_since_epoch())
+      .count();
+}
+
+// class TokenBucket
+
+void TokenBucket::configure(uint32_t rate, uint32_t burst) {
+  if (rate == 0) {
+    interval_ns_ = 0;
+    tolerance_ns_ = 0;
+  } else {
+    interval_ns_ = std::max<int64_t>(kNanosecondsPerSecond / rate, 1);
+    // the first request is always allowed, burst - 1 more can follow it
+    tolerance_ns_ = interval_ns_ * (std::max<uint32_t>(burst, 1) - 1);
+  }
+  tat_.store(0, std::memory_order_relaxed);
+}
+
+bool TokenBucket::try_acquire(int64_t now) noexcept {
+  if (interval_ns_ == 0) return true;
+
+  int64_t tat = tat_.load(std::memory_order_relaxed);
+  for (;;) {
+    const int64_t start = std::max(tat, now);
+    if (start - now > tolerance_ns_) {
+      return false;
+    }
+    if (tat_.compare_exchange_weak(tat, start + interval_ns_,
+                                   std::memory_order_relaxed)) {
+      return true;
+    }
+    // tat got reloaded by compare_exchange_weak(), retry
+  }
+}
+
+// class ConnectionRateLimiter
+
+// Slot::state is generation << 34 | kind << 32 | users
+static const uint64_t kSlotFree = 0;
+static const uint64_t kSlotClaimed = 1;
+static const uint64_t kSlotReady = 2;
+static const uint64_t kSlotDeleted = 3;
+
+static uint64_t slot_state(uint64_t generation, uint64_t kind,
+                           uint64_t users) noexcept {
+  return generation << 34 | kind << 32 | users;
+}
+
+static uint64_t slot_generation(uint64_t state) noexcept { return state >> 34; }
+
+static uint64_t slot_kind(uint64_t state) noexcept { return (state >> 32) & 3; }
+
+static uint64_t slot_users(uint64_t state) noexcept {
+  return state & 0xffffffff;
+}
+
+static void split_source(const ClientIpArray &source, uint64_t key[2]) noexcept {
+  std::memcpy(key, source.data(), source.size());
+}
+
+const size_t ConnectionRateLimiter::kMaxProbes;
+
+ConnectionRateLimiter::ConnectionRateLimiter(size_t capacity)
+    : num_slots_(std::max<size_t>(capacity, 1)),
+      slots_(new Slot[num_slots_]()) {}
+
+void ConnectionRateLimiter::configure(const ConnectionRateLimits &limits) {
+  limits_ = limits;
+  limits_.client_ipv4_prefix_length =
+      std::min<uint8_t>(limits_.client_ipv4_prefix_length, 32);
+  limits_.client_ipv6_prefix_length =
+      std::min<uint8_t>(limits_.client_ipv6_prefix_length, 128);
+
+  route_bucket_.configure(limits_.max_connections_per_second,
+                          limits_.max_connections_per_second);
+  // sources get a bucket with the new limits when seen next
+  for (size_t ndx = 0; ndx < num_slots_; ++ndx) {
+    slots_[ndx].state.store(slot_state(0, kSlotFree, 0),
+                            std::memory_order_relaxed);
+    slots_[ndx].connections.store(0, std::memory_order_relaxed);
+  }
+}
+
+bool ConnectionRateLimiter::has_source(
+    const sockaddr_storage &client_addr) noexcept {
+  // Unix socket clients have no address to limit on
+  return client_addr.ss_family == AF_INET || client_addr.ss_family == AF_INET6;
+}
+
+ClientIpArray ConnectionRateLimiter::get_source(
+    const sockaddr_storage &client_addr) const noexcept {
+  ClientIpArray result = in_addr_to_array(client_addr);
+
+  const size_t prefix_length = client_addr.ss_family == AF_INET6
+                                   ? limits_.client_ipv6_prefix_length
+                                   : limits_.client_ipv4_prefix_length;
+  for (size_t bit = prefix_length; bit < result.size() * 8; ++bit) {
+    result[bit / 8] = static_cast<uint8_t>(result[bit / 8] &
+                                           ~(0x80u >> (bit % 8)));
+  }
+
+  return result;
+}
+
+bool ConnectionRateLimiter::try_use(Slot &slot,
+                                    const ClientIpArray &source) noexcept {
+  uint64_t key[2];
+  split_source(source, key);
+
+  uint64_t state = slot.state.load(std::memory_order_acquire);
+  while (slot_kind(state) == kSlotReady) {
+    if (slot.key[0].load(std::memory_order_relaxed) != key[0] ||
+        slot.key[1].load(std::memory_order_relaxed) != key[1]) {
+      return false;
+    }
+    // fails if the slot got claimed for another source meanwhile, as that
+    // changes the generation
+    if (slot.state.compare_exchange_weak(state, state + 1,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ConnectionRateLimiter::unuse(Slot &slot) noexcept {
+  slot.state.fetch_sub(1, std::memory_order_release);
+}
+
+bool ConnectionRateLimiter::try_claim(Slot &slot, int64_t now) noexcept {
+  uint64_t state = slot.state.load(std::memory_order_acquire);
+  const uint64_t kind = slot_kind(state);
+  if (kind == kSlotClaimed || slot_users(state) > 0) return false;
+
+  const auto is_idle = [&slot, now]() {
+    return slot.connections.load(std::memory_order_relaxed) == 0 &&
+           slot.bucket.is_full(now);
+  };
+  if (kind == kSlotReady && !is_idle()) return false;
+
+  if (!slot.state.compare_exchange_strong(
+          state, slot_state(slot_generation(state), kSlotClaimed, 0),
+          std::memory_order_acq_rel)) {
+    return false;
+  }
+
+  // the source may have connected between the check and the claim
+  if (kind == kSlotReady && !is_idle()) {
+    slot.state.store(state, std::memory_order_release);
+    return false;
+  }
+
+  return true;
+}
+
+void ConnectionRateLimiter::try_free(Slot &slot, int64_t now) noexcept {
+  uint64_t state = slot.state.load(std::memory_order_relaxed);
+  const auto is_idle = [&slot, now]() {
+    return slot.connections.load(std::memory_order_relaxed) == 0 &&
+           slot.bucket.is_full(now);
+  };
+
+  if (slot_users(state) == 1 && is_idle()) {
+    const uint64_t generation = slot_generation(state);
+    if (slot.state.compare_exchange_strong(
+            state, slot_state(generation, kSlotClaimed, 0),
+            std::memory_order_acq_rel)) {
+      // another thread may have used the slot between the checks
+      slot.state.store(
+          slot_state(generation, is_idle() ? kSlotDeleted : kSlotReady, 0),
+          std::memory_order_release);
+      return;
+    }
+  }
+
+  unuse(slot);
+}
+
+ConnectionRateLimiter::Slot *ConnectionRateLimiter::use_slot(
+    const ClientIpArray &source, int64_t now) noexcept {
+  const size_t home = ClientIpArrayHash()(source) % num_slots_;
+  const size_t probes = std::min(kMaxProbes, num_slots_);
+
+  uint64_t key[2];
+  split_source(source, key);
+
+  for (;;) {
+    for (size_t probe = 0; probe < probes; ++probe) {
+      Slot &slot = get_slot(home, probe);
+      if (try_use(slot, source)) return &slot;
+      // slots are claimed in probe order and never become free again
+      if (slot_kind(slot.state.load(std::memory_order_acquire)) ==
+          kSlotFree) {
+        break;
+      }
+    }
+
+    // threads adding the same source all stop at the first slot that can
+    // be claimed: one claims it, the others wait and use it
+    Slot *claimed = nullptr;
+    size_t probe = 0;
+    while (probe < probes) {
+      Slot &slot = get_slot(home, probe);
+      if (try_use(slot, source)) return &slot;
+      if (try_claim(slot, now)) {
+        claimed = &slot;
+        break;
+      }
+      if (slot_kind(slot.state.load(std::memory_order_acquire)) ==
+          kSlotClaimed) {
+        std::this_thread::yield();
+      } else {
+        ++probe;
+      }
+    }
+    if (claimed == nullptr) return nullptr;
+
+    const uint64_t generation =
+        slot_generation(claimed->state.load(std::memory_order_relaxed));
+    claimed->key[0].store(key[0], std::memory_order_relaxed);
+    claimed->key[1].store(key[1], std::memory_order_relaxed);
+    claimed->bucket.configure(limits_.max_client_connections_per_second,
+                              limits_.max_client_connections_per_second);
+    claimed->connections.store(0, std::memory_order_relaxed);
+    const uint64_t ready = slot_state(generation + 1, kSlotReady, 1);
+    // sequentially consistent, so that of two threads which added the
+    // source in different slots at once at least one sees the other's
+    claimed->state.store(ready, std::memory_order_seq_cst);
+
+    bool is_duplicate = false;
+    for (probe = 0; probe < probes && !is_duplicate; ++probe) {
+      const Slot &slot = get_slot(home, probe);
+      const uint64_t state = slot.state.load(std::memory_order_seq_cst);
+      if (slot_kind(state) == kSlotFree) break;
+
+      is_duplicate = &slot != claimed && slot_kind(state) == kSlotReady &&
+                     slot.key[0].load(std::memory_order_relaxed) == key[0] &&
+                     slot.key[1].load(std::memory_order_relaxed) == key[1];
+    }
+
+    // give the slot back and use the other one, unless another thread
+    // uses this one already
+    uint64_t expected = ready;
+    if (!is_duplicate ||
+        !claimed->state.compare_exchange_strong(
+            expected, slot_state(generation + 1, kSlotDeleted, 0),
+            std::memory_order_acq_rel)) {
+      return claimed;
+    }
+  }
+}
+
+ConnectionRateLimiter::Result ConnectionRateLimiter::acquire(
+    const sockaddr_storage &client_addr) noexcept {
+  const int64_t now = now_ns();
+
+  if (!has_source(client_addr) || !has_client_limits()) {
+    return route_bucket_.try_acquire(now) ? Result::kAllowed
+                                          : Result::kRouteRateExceeded;
+  }
+
+  Slot *slot = use_slot(get_source(client_addr), now);
+  if (slot == nullptr) {
+    // all slots the source may use are taken by busy sources
+    return route_bucket_.try_acquire(now) ? Result::kAllowed
+                                          : Result::kRouteRateExceeded;
+  }
+
+  // the connection is counted first, so that a source at its limit can't
+  // use up the tokens of the others
+  const uint32_t max_connections = limits_.max_client_connections;
+  uint32_t connections = slot->connections.load(std::memory_order_relaxed);
+  do {
+    if (max_connections > 0 && connections >= max_connections) {
+      unuse(*slot);
+      return Result::kClientConnectionsExceeded;
+    }
+  } while (!slot->connections.compare_exchange_weak(
+      connections, connections + 1, std::memory_order_relaxed));
+
+  if (!slot->bucket.try_acquire(now)) {
+    slot->connections.fetch_sub(1, std::memory_order_relaxed);
+    unuse(*slot);
+    return Result::kClientRateExceeded;
+  }
+
+  if (!route_bucket_.try_acquire(now)) {
+    slot->bucket.refund();
+    slot->connections.fetch_sub(1, std::memory_order_relaxed);
+    try_free(*slot, now);
+    return Result::kRouteRateExceeded;
+  }
+
+  unuse(*slot);
+  return Result::kAllowed;
+}
+
+void ConnectionRateLimiter::release(
+    const sockaddr_storage &client_addr) noexcept {
+  if (!has_source(client_addr) || !has_client_limits()) {
+    return;
+  }
+
+  const ClientIpArray source = get_source(client_addr);
+  const size_t home = ClientIpArrayHash()(source) % num_slots_;
+  const size_t probes = std::min(kMaxProbes, num_slots_);
+
+  // a source may have two slots for a short time (see use_slot()), take
+  // the last one with connections
+  Slot *found = nullptr;
+  for (size_t probe = 0; probe < probes; ++probe) {
+    Slot &slot = get_slot(home, probe);
+    if (try_use(slot, source)) {
+      if (slot.connections.load(std::memory_order_relaxed) > 0) {
+        if (found != nullptr) unuse(*found);
+        found = &slot;
+      } else {
+        unuse(slot);
+      }
+    } else if (slot_kind(slot.state.load(std::memory_order_acquire)) ==
+               kSlotFree) {
+      break;
+    }
+  }
+
+  // may be gone if the limits got reconfigured meanwhile
+  if (found == nullptr) return;
+
+  uint32_t connections = found->connections.load(std::memory_order_relaxed);
+  while (connections > 0 &&
+         !found->connections.compare_exchange_weak(
+             connections, connections - 1, std::memory_order_relaxed)) {
+  }
+  try_free(*found, now_ns());
+}
+
+size_t ConnectionRateLimiter::size() const {
+  size_t result = 0;
+  for (size_t ndx = 0; ndx < num_slots_; ++ndx) {
+    if (slot_kind(slots_[ndx].state.load(std::memory_order_relaxed)) ==
+        kSlotReady) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+std::pair<unsigned short, std::string> get_rate_limit_error(
+    ConnectionRateLimiter::Result result) {
+  switch (result) {
+    case ConnectionRateLimiter::Result::kRouteRateExceeded:
+      return {1040, "Too many connections per second to MySQL Router"};
+    case ConnectionRateLimiter::Result::kClientRateExceeded:
+      // ER_USER_LIMIT_REACHED
+      return {1226, "Client host has exceeded the 'max_client_connections_per_second' resource"};
+    case ConnectionRateLimiter::Result::kClientConnectionsExceeded:
+      // ER_TOO_MANY_USER_CONNECTIONS
+      return {1203, "Client host already has more than 'max_client_connections' active connections"};
+    case ConnectionRateLimiter::Result::kAllowed:
+      break;
+  }
+
+  return {0, ""};
+}
+
+}  // namespace routing
@@ -0,0 +1,257 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ROUTING_RATE_LIMITER_INCLUDED
+#define ROUTING_RATE_LIMITER_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "client_error_table.h"
+#include "utils.h"
+
+namespace routing {
+
+/**
+ * @brief Lock-free token bucket
+ *
+ * Implemented as Generic Cell Rate Algorithm: instead of tokens, the
+ * theoretical arrival time (TAT) of the next request is kept in a single
+ * atomic and updated with compare-and-swap. Allowing `rate` requests per
+ * second with a burst of `burst` requests is equivalent to a token bucket
+ * refilled with `rate` tokens per second and holding at most `burst`
+ * tokens.
+ */
+class TokenBucket {
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  TokenBucket() = default;
+
+  TokenBucket(const TokenBucket &) = delete;
+  TokenBucket &operator=(const TokenBucket &) = delete;
+
+  /**
+   * @brief (Re)configures the bucket, not thread-safe.
+   *
+   * @param rate allowed requests per second, 0 disables the limit
+   * @param burst requests allowed at once, at least 1
+   */
+  void configure(uint32_t rate, uint32_t burst);
+
+  /**
+   * @brief Takes a token out of the bucket.
+   *
+   * @param now current time in nanoseconds of clock_type
+   * @return false if the bucket is empty (the request is throttled)
+   */
+  bool try_acquire(int64_t now) noexcept;
+
+  /**
+   * @brief Puts back a token taken by try_acquire() for a request that got
+   * rejected by a later check.
+   */
+  void refund() noexcept {
+    if (interval_ns_ > 0) {
+      tat_.fetch_sub(interval_ns_, std::memory_order_relaxed);
+    }
+  }
+
+  bool is_enabled() const noexcept { return interval_ns_ > 0; }
+
+  /**
+   * @brief true if the bucket is full, as it is right after configure()
+   *
+   * @param now current time in nanoseconds of clock_type
+   */
+  bool is_full(int64_t now) const noexcept {
+    return tat_.load(std::memory_order_relaxed) <= now;
+  }
+
+ private:
+  /** time between two requests */
+  int64_t interval_ns_{0};
+  /** how far the TAT may be ahead of now */
+  int64_t tolerance_ns_{0};
+  std::atomic<int64_t> tat_{0};
+};
+
+/** @brief limits of ConnectionRateLimiter, 0 disables a limit */
+struct ConnectionRateLimits {
+  /** @brief new connections per second for the whole route */
+  uint32_t max_connections_per_second{0};
+  /** @brief new connections per second per client source */
+  uint32_t max_client_connections_per_second{0};
+  /** @brief concurrent connections per client source */
+  uint32_t max_client_connections{0};
+  /** @brief IPv4 clients in the same network of this prefix are one source */
+  uint8_t client_ipv4_prefix_length{32};
+  /** @brief IPv6 clients in the same network of this prefix are one source */
+  uint8_t client_ipv6_prefix_length{128};
+};
+
+/**
+ * @brief Limits the rate of new connections and the concurrent connections
+ * per client source
+ *
+ * A client source is the client's IP address masked with the configured
+ * prefix length, so that a whole network can share a limit.
+ *
+ * All checks are lock-free. The route-wide limit is a token bucket, the
+ * per-source token buckets and connection counters live in a fixed-size
+ * open addressing table keyed by the source: a source claims a slot with
+ * compare-and-swap and sources whose hashes collide probe the next slots,
+ * they never share one. A source is tracked while it has connections or
+ * its bucket isn't full; afterwards its slot can be taken by another one.
+ * If all kMaxProbes slots a source may use are taken by busy sources, only
+ * the route-wide limit applies to it.
+ *
+ * The concurrent connections are checked first, so that a source at its
+ * limit doesn't use up tokens, and tokens taken for a connection that a
+ * later check rejects are put back.
+ */
+class ConnectionRateLimiter {
+ public:
+  enum class Result {
+    kAllowed,
+    /** route-wide connection rate exceeded */
+    kRouteRateExceeded,
+    /** connection rate of the client source exceeded */
+    kClientRateExceeded,
+    /** concurrent connections of the client source exceeded */
+    kClientConnectionsExceeded,
+  };
+
+  /** number of client sources that can be tracked at once */
+  static const size_t kDefaultCapacity = 4096;
+
+  /** number of slots a source may use, starting at the one of its hash */
+  static const size_t kMaxProbes = 32;
+
+  explicit ConnectionRateLimiter(size_t capacity = kDefaultCapacity);
+
+  ConnectionRateLimiter(const ConnectionRateLimiter &) = delete;
+  ConnectionRateLimiter &operator=(const ConnectionRateLimiter &) = delete;
+
+  /** @brief Applies new limits, not thread-safe */
+  void configure(const ConnectionRateLimits &limits);
+
+  const ConnectionRateLimits &get_limits() const noexcept { return limits_; }
+
+  /**
+   * @brief Checks a new connection and, if allowed, counts it.
+   *
+   * A successful call must be paired with release() once the connection
+   * is closed.
+   *
+   * @param client_addr address of the client
+   */
+  Result acquire(const sockaddr_storage &client_addr) noexcept;
+
+  /**
+   * @brief Releases a connection counted by acquire().
+   *
+   * @param client_addr address of the client
+   */
+  void release(const sockaddr_storage &client_addr) noexcept;
+
+  /**
+   * @brief Returns the source key of a client: its IP address masked with
+   * the configured prefix length.
+   */
+  ClientIpArray get_source(const sockaddr_storage &client_addr) const noexcept;
+
+  /** @brief number of client sources tracked */
+  size_t size() const;
+
+ private:
+  /** @brief true if per-source limits apply to the client's address family */
+  static bool has_source(const sockaddr_storage &client_addr) noexcept;
+
+  /** @brief true if per-source limits are configured */
+  bool has_client_limits() const noexcept {
+    return limits_.max_client_connections_per_second > 0 ||
+           limits_.max_client_connections > 0;
+  }
+
+  /**
+   * @brief A slot of the source table
+   *
+   * `state` packs the generation of the slot (bumped whenever it gets a
+   * new source), its kind (free, claimed, in use or deleted) and the number
+   * of threads using it. Only the thread that claimed the slot, which
+   * requires that no thread uses it, may change the source and its bucket.
+   */
+  struct Slot {
+    std::atomic<uint64_t> state{0};
+    std::atomic<uint64_t> key[2];
+    TokenBucket bucket;
+    std::atomic<uint32_t> connections{0};
+  };
+
+  /**
+   * @brief Returns the slot of the source, claiming one if it has none
+   *
+   * The slot is returned in use, see unuse().
+   *
+   * @return the slot, nullptr if all slots the source may use are busy
+   */
+  Slot *use_slot(const ClientIpArray &source, int64_t now) noexcept;
+
+  /** @brief Ends the use of a slot returned by use_slot() */
+  static void unuse(Slot &slot) noexcept;
+
+  /** @brief Uses the slot if it holds the source */
+  static bool try_use(Slot &slot, const ClientIpArray &source) noexcept;
+
+  /** @brief Claims the slot if it is free or its source is idle */
+  static bool try_claim(Slot &slot, int64_t now) noexcept;
+
+  /** @brief Frees the slot (used by the caller only) if its source is idle */
+  static void try_free(Slot &slot, int64_t now) noexcept;
+
+  Slot &get_slot(size_t home, size_t probe) noexcept {
+    return slots_[(home + probe) % num_slots_];
+  }
+
+  ConnectionRateLimits limits_;
+
+  TokenBucket route_bucket_;
+  size_t num_slots_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+/**
+ * @brief Returns MySQL error code and message sent to a throttled client.
+ */
+std::pair<unsigned short, std::string> get_rate_limit_error(
+    ConnectionRateLimiter::Result result);
+
+}  // namespace routing
+
+#endif  // ROUTING_RATE_LIMITER_INCLUDED
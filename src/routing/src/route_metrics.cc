@@ -0,0 +1,112 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "route_metrics.h"
+
+namespace routing {
+
+using mysql_harness::metrics::MetricsRegistry;
+
+const char *const kActiveConnectionsMetric =
+    "mysqlrouter_routing_active_connections";
+
+static const char *const kRejectedHelp = "client connections rejected";
+static const char *const kErrorsHelp = "client connections that failed";
+static const char *const kBytesHelp =
+    "bytes forwarded between clients and servers";
+
+static mysql_harness::metrics::Histogram &latency_histogram(
+    const char *name, const char *help, const std::string &route_name,
+    const std::string &destination) {
+  return MetricsRegistry::instance().histogram(
+      name, help, {{"route", route_name}, {"destination", destination}},
+      mysql_harness::metrics::hdr_latency_buckets());
+}
+
+ConnectionLatency::ConnectionLatency(const std::string &route_name,
+                                     const std::string &destination)
+    : accept_to_connect(latency_histogram(
+          "mysqlrouter_routing_accept_to_connect_seconds",
+          "time from accepting a client until connected to its server",
+          route_name, destination)),
+      connect(latency_histogram(
+          "mysqlrouter_routing_server_connect_seconds",
+          "time to connect to the server, including failed attempts",
+          route_name, destination)),
+      greeting(latency_histogram(
+          "mysqlrouter_routing_server_greeting_seconds",
+          "time from connecting to the server until its first packet",
+          route_name, destination)),
+      handshake(latency_histogram(
+          "mysqlrouter_routing_handshake_seconds",
+          "time from accepting a client until the handshake is done",
+          route_name, destination)),
+      session(latency_histogram(
+          "mysqlrouter_routing_session_duration_seconds",
+          "time from accepting a client until the connection is closed",
+          route_name, destination)) {}
+
+RouteMetrics::RouteMetrics(const std::string &route_name)
+    : connections_accepted(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connections_accepted_total",
+          "client connections accepted", {{"route", route_name}})),
+      rejected_blocked_host(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connections_rejected_total", kRejectedHelp,
+          {{"route", route_name}, {"reason", "blocked_host"}})),
+      rejected_max_connections(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connections_rejected_total", kRejectedHelp,
+          {{"route", route_name}, {"reason", "max_connections"}})),
+      rejected_rate_limit(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connections_rejected_total", kRejectedHelp,
+          {{"route", route_name}, {"reason", "rate_limit"}})),
+      errors_connect(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connection_errors_total", kErrorsHelp,
+          {{"route", route_name}, {"reason", "connect"}})),
+      errors_pre_auth(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_connection_errors_total", kErrorsHelp,
+          {{"route", route_name}, {"reason", "pre_auth"}})),
+      bytes_server_to_client(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_bytes_total", kBytesHelp,
+          {{"route", route_name}, {"direction", "server_to_client"}})),
+      bytes_client_to_server(MetricsRegistry::instance().counter(
+          "mysqlrouter_routing_bytes_total", kBytesHelp,
+          {{"route", route_name}, {"direction", "client_to_server"}})),
+      connect_duration(MetricsRegistry::instance().histogram(
+          "mysqlrouter_routing_connect_duration_seconds",
+          "time to connect to a destination, including failed attempts",
+          {{"route", route_name}})),
+      route_name_(route_name) {}
+
+ConnectionLatency &RouteMetrics::connection_latency(
+    const std::string &destination) {
+  std::lock_guard<std::mutex> lk(latency_mtx_);
+
+  auto &slot = latency_[destination];
+  if (!slot) slot.reset(new ConnectionLatency(route_name_, destination));
+
+  return *slot;
+}
+
+}  // namespace routing
@@ -0,0 +1,110 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#ifndef ROUTING_ROUTE_METRICS_INCLUDED
+#define ROUTING_ROUTE_METRICS_INCLUDED
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "mysql/harness/metrics.h"
+
+namespace routing {
+
+/** @struct ConnectionLatency
+ * @brief Latency histograms of the phases of client connections
+ *
+ * One set exists per route and destination. All durations are in
+ * seconds and use HDR-style buckets (see
+ * mysql_harness::metrics::hdr_latency_buckets()).
+ */
+struct ConnectionLatency {
+  using Histogram = mysql_harness::metrics::Histogram;
+
+  ConnectionLatency(const std::string &route_name,
+                    const std::string &destination);
+
+  /** @brief from accept() until the server connection is established */
+  Histogram &accept_to_connect;
+  /** @brief time spent connecting to the server, including failover */
+  Histogram &connect;
+  /** @brief from server connection until the first packet of the server */
+  Histogram &greeting;
+  /** @brief from accept() until the handshake is done */
+  Histogram &handshake;
+  /** @brief from accept() until the connection is closed */
+  Histogram &session;
+};
+
+/** @class RouteMetrics
+ * @brief Metrics of a route exported via the harness metrics registry
+ *
+ * All metrics carry a `route` label. They are looked up once when the
+ * route is created; updating them doesn't take any lock.
+ */
+class RouteMetrics {
+ public:
+  using Counter = mysql_harness::metrics::Counter;
+  using Histogram = mysql_harness::metrics::Histogram;
+
+  explicit RouteMetrics(const std::string &route_name);
+
+  /** @brief Returns the latency histograms of a destination
+   *
+   * Created on first use; call it once per connection and keep the
+   * reference.
+   *
+   * @param destination address of the destination
+   */
+  ConnectionLatency &connection_latency(const std::string &destination);
+
+  Counter &connections_accepted;
+  Counter &rejected_blocked_host;
+  Counter &rejected_max_connections;
+  Counter &rejected_rate_limit;
+  /** @brief no destination could be connected to */
+  Counter &errors_connect;
+  /** @brief connection failed before the handshake was done */
+  Counter &errors_pre_auth;
+  Counter &bytes_server_to_client;
+  Counter &bytes_client_to_server;
+  /** @brief time to get a connected server socket, including failover */
+  Histogram &connect_duration;
+
+ private:
+  const std::string route_name_;
+
+  std::mutex latency_mtx_;
+  std::map<std::string, std::unique_ptr<ConnectionLatency>> latency_;
+};
+
+/** @brief name of the gauge of active connections of a route */
+extern const char *const kActiveConnectionsMetric;
+
+}  // namespace routing
+
+#endif  // ROUTING_ROUTE_METRICS_INCLUDED
@@ -29,14 +29,20 @@
 #include "common.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <climits>
+#include <cstdint>
+#include <thread>
 
 #ifndef _WIN32
 # include <fcntl.h>
 # include <netdb.h>
 # include <netinet/tcp.h>
 # include <sys/socket.h>
+# include <sys/un.h>
 # include <poll.h>
 #else
 # define WIN32_LEAN_AND_MEAN
@@ -54,10 +60,14 @@ namespace routing {
 
 const int kDefaultWaitTimeout = 0; // 0 = no timeout used
 const int kDefaultMaxConnections = 512;
+const uint32_t kMaxConnectionsLimit = UINT32_MAX;
 const std::chrono::seconds kDefaultDestinationConnectionTimeout { 1 };
 const std::string kDefaultBindAddress = "127.0.0.1";
+const int kDefaultListenBacklog = 1024;
 const unsigned int kDefaultNetBufferLength = 16384;  // Default defined in latest MySQL Server
 const unsigned long long kDefaultMaxConnectErrors = 100;  // Similar to MySQL Server
+const size_t kDefaultHostCacheSize = 10000;
+const std::chrono::seconds kDefaultConnectErrorsTimeout { 0 }; // never forget, similar to MySQL Server
 const std::chrono::seconds kDefaultClientConnectTimeout { 9 }; // Default connect_timeout MySQL Server minus 1
 
 // unused constant
@@ -135,12 +145,214 @@ void set_socket_blocking(int sock, bool blocking) {
 #endif
 }
 
+static int get_socket_errno() noexcept {
+#ifdef _WIN32
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+static bool set_int_socket_option(int sock, int level, int option_name, const char *option_str,
+                                  int value, std::string &error) noexcept {
+  if (setsockopt(sock, level, option_name,
+                 reinterpret_cast<const char*>(&value), // cast keeps Windows happy (const void* on Unix)
+                 static_cast<socklen_t>(sizeof(int))) == -1) {
+    if (error.empty()) {
+      error = string_format("setsockopt(%s) failed: %s", option_str, get_message_error(get_socket_errno()).c_str());
+    }
+    return false;
+  }
+  return true;
+}
+
+static inline bool unsupported_socket_option(const char *option_str, std::string &error) noexcept {
+  if (error.empty()) {
+    error = string_format("%s is not supported on this platform", option_str);
+  }
+  return false;
+}
+
+static bool set_buffer_socket_options(int sock, const SocketOptions &options, std::string &error) noexcept {
+  bool ok = true;
+  if (options.receive_buffer_size > 0) {
+    ok = set_int_socket_option(sock, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", options.receive_buffer_size, error) && ok;
+  }
+  if (options.send_buffer_size > 0) {
+    ok = set_int_socket_option(sock, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", options.send_buffer_size, error) && ok;
+  }
+  return ok;
+}
+
+bool set_listen_socket_options(int sock, const SocketOptions &options, std::string &error) noexcept {
+  bool ok = set_buffer_socket_options(sock, options, error);
+  if (options.defer_accept > 0) {
+#ifdef TCP_DEFER_ACCEPT
+    ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, "TCP_DEFER_ACCEPT", options.defer_accept, error) && ok;
+#else
+    ok = unsupported_socket_option("TCP_DEFER_ACCEPT", error) && ok;
+#endif
+  }
+  if (options.fastopen > 0) {
+#ifdef TCP_FASTOPEN
+    ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_FASTOPEN, "TCP_FASTOPEN", options.fastopen, error) && ok;
+#else
+    ok = unsupported_socket_option("TCP_FASTOPEN", error) && ok;
+#endif
+  }
+  return ok;
+}
+
+bool set_connection_socket_options(int sock, const SocketOptions &options, std::string &error) noexcept {
+  bool ok = set_buffer_socket_options(sock, options, error);
+  if (options.notsent_lowat > 0) {
+#ifdef TCP_NOTSENT_LOWAT
+    ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_NOTSENT_LOWAT, "TCP_NOTSENT_LOWAT", options.notsent_lowat, error) && ok;
+#else
+    ok = unsupported_socket_option("TCP_NOTSENT_LOWAT", error) && ok;
+#endif
+  }
+  if (options.keepalive) {
+    ok = set_int_socket_option(sock, SOL_SOCKET, SO_KEEPALIVE, "SO_KEEPALIVE", 1, error) && ok;
+    if (options.keepalive_idle > 0) {
+#if defined(TCP_KEEPIDLE)
+      ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_KEEPIDLE, "TCP_KEEPIDLE", options.keepalive_idle, error) && ok;
+#elif defined(TCP_KEEPALIVE)
+      ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_KEEPALIVE, "TCP_KEEPALIVE", options.keepalive_idle, error) && ok;
+#else
+      ok = unsupported_socket_option("TCP_KEEPIDLE", error) && ok;
+#endif
+    }
+    if (options.keepalive_interval > 0) {
+#ifdef TCP_KEEPINTVL
+      ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_KEEPINTVL, "TCP_KEEPINTVL", options.keepalive_interval, error) && ok;
+#else
+      ok = unsupported_socket_option("TCP_KEEPINTVL", error) && ok;
+#endif
+    }
+    if (options.keepalive_count > 0) {
+#ifdef TCP_KEEPCNT
+      ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_KEEPCNT, "TCP_KEEPCNT", options.keepalive_count, error) && ok;
+#else
+      ok = unsupported_socket_option("TCP_KEEPCNT", error) && ok;
+#endif
+    }
+  }
+  if (options.user_timeout > 0) {
+#ifdef TCP_USER_TIMEOUT
+    ok = set_int_socket_option(sock, IPPROTO_TCP, TCP_USER_TIMEOUT, "TCP_USER_TIMEOUT",
+                                static_cast<int>(options.user_timeout), error) && ok;
+#else
+    ok = unsupported_socket_option("TCP_USER_TIMEOUT", error) && ok;
+#endif
+  }
+  return ok;
+}
+
 RoutingSockOps* RoutingSockOps::instance(mysql_harness::SocketOperationsBase* sock_ops) {
   static RoutingSockOps routing_sock_ops(sock_ops);
   return &routing_sock_ops;
 }
 
-int RoutingSockOps::get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout_ms, bool log) noexcept {
+int RoutingSockOps::get_mysql_unix_socket(const mysql_harness::TCPAddress &addr,
+                                          std::chrono::milliseconds connect_timeout, bool log) noexcept {
+#ifndef _WIN32
+  struct sockaddr_un sock_unix;
+  memset(&sock_unix, 0, sizeof sock_unix);
+
+  if (addr.addr.size() >= sizeof(sock_unix.sun_path)) {
+    if (log) {
+      log_error("Socket file path too long for '%s'", addr.str().c_str());
+    }
+    return -1;
+  }
+  sock_unix.sun_family = AF_UNIX;
+  std::strncpy(sock_unix.sun_path, addr.addr.c_str(), sizeof(sock_unix.sun_path) - 1);
+
+  int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock == -1) {
+    if (log) {
+      log_error("Failed opening socket: %s", get_message_error(so_->get_errno()).c_str());
+    }
+    return -1;
+  }
+
+  // connect() on a Unix socket blocks while the server's accept backlog is
+  // full (it never reports EINPROGRESS for that). Connect non-blocking and
+  // retry in short slices so that a stalled server is bounded by the
+  // destination's connect_timeout like a TCP destination.
+  set_socket_blocking(sock, false);
+
+  const auto deadline = std::chrono::steady_clock::now() + connect_timeout;
+  const std::chrono::milliseconds kRetrySlice{10};
+  while (::connect(sock, reinterpret_cast<struct sockaddr*>(&sock_unix), static_cast<socklen_t>(sizeof sock_unix)) < 0) {
+    const int err = so_->get_errno();
+    if (err == EINTR) {
+      continue;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (err == EINPROGRESS) {
+      int so_error = 0;
+      if (0 != so_->connect_non_blocking_wait(sock, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now))) {
+        const bool timed_out = (so_->get_errno() == ETIMEDOUT);
+        if (log) {
+          log_warning("Timeout reached trying to connect to MySQL Server %s: %s", addr.str().c_str(),
+                      get_message_error(so_->get_errno()).c_str());
+        }
+        so_->close(sock);
+        return timed_out ? -2 : -1;
+      }
+      if (0 != so_->connect_non_blocking_status(sock, so_error)) {
+        if (log) {
+          log_debug("Failed connect() to %s: %s", addr.str().c_str(), get_message_error(so_error).c_str());
+        }
+        so_->close(sock);
+        return -1;
+      }
+      break;
+    }
+
+    if (err == EAGAIN || err == EWOULDBLOCK) {
+      // the server's accept backlog is full
+      if (now >= deadline) {
+        if (log) {
+          log_warning("Timeout reached trying to connect to MySQL Server %s", addr.str().c_str());
+        }
+        so_->close(sock);
+        return -2;
+      }
+      std::this_thread::sleep_for(
+          std::min(kRetrySlice, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                                    std::chrono::milliseconds(1)));
+      continue;
+    }
+
+    if (log) {
+      log_debug("Failed connect() to %s: %s", addr.str().c_str(), get_message_error(err).c_str());
+    }
+    so_->close(sock);
+    return -1;
+  }
+
+  set_socket_blocking(sock, true);
+
+  return sock;
+#else
+  (void)connect_timeout;
+  if (log) {
+    log_error("Unix socket destinations are not supported on Windows: %s", addr.str().c_str());
+  }
+  return -1;
+#endif
+}
+
+int RoutingSockOps::get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds connect_timeout_ms, bool log,
+                                     const SocketOptions *socket_options) noexcept {
+  if (addr.is_unix_socket()) {
+    return get_mysql_unix_socket(addr, connect_timeout_ms, log);
+  }
+
   struct addrinfo *servinfo, *info, hints;
 
   memset(&hints, 0, sizeof hints);
@@ -173,6 +385,14 @@ int RoutingSockOps::get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono
 
       set_socket_blocking(sock, false);
 
+      if (socket_options) {
+        // before connect() so that the buffer sizes are used for the window scaling
+        std::string error;
+        if (!set_connection_socket_options(sock, *socket_options, error)) {
+          log_warning("Failed setting socket options for %s: %s", addr.str().c_str(), error.c_str());
+        }
+      }
+
       if (::connect(sock, info->ai_addr, info->ai_addrlen) < 0) {
         switch (so_->get_errno()) {
 #ifdef _WIN32
@@ -0,0 +1,120 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "mysqlrouter/routing_component.h"
+
+MySQLRoutingComponent& MySQLRoutingComponent::getInstance() {
+  static MySQLRoutingComponent instance;
+
+  return instance;
+}
+
+std::shared_ptr<routing::RouteStatusSlot> MySQLRoutingComponent::register_route(const std::string &name) {
+  std::lock_guard<std::mutex> lock(routes_mtx_);
+
+  auto slot = std::make_shared<routing::RouteStatusSlot>();
+  routes_[name] = slot;
+
+  return slot;
+}
+
+void MySQLRoutingComponent::unregister_route(const std::string &name) {
+  std::lock_guard<std::mutex> lock(routes_mtx_);
+
+  routes_.erase(name);
+}
+
+std::vector<std::string> MySQLRoutingComponent::get_route_names() const {
+  std::lock_guard<std::mutex> lock(routes_mtx_);
+
+  std::vector<std::string> names;
+  names.reserve(routes_.size());
+  for (const auto &route: routes_) {
+    names.push_back(route.first);
+  }
+
+  return names;
+}
+
+std::shared_ptr<routing::RouteStatusSlot> MySQLRoutingComponent::get_slot(const std::string &name) const {
+  std::lock_guard<std::mutex> lock(routes_mtx_);
+
+  auto it = routes_.find(name);
+  if (it == routes_.end()) {
+    return nullptr;
+  }
+
+  return it->second;
+}
+
+std::shared_ptr<const routing::RouteStatus> MySQLRoutingComponent::get_route_status(const std::string &name) const {
+  auto slot = get_slot(name);
+  if (!slot) {
+    return nullptr;
+  }
+
+  return slot->load();
+}
+
+bool MySQLRoutingComponent::get_route_connections(const std::string &name,
+    std::vector<routing::ConnectionStatus> &connections) const {
+  auto slot = get_slot(name);
+
+  return slot && slot->get_connections(connections);
+}
+
+bool MySQLRoutingComponent::get_route_query_digests(const std::string &name,
+    std::vector<routing::QueryDigestStatus> &digests) const {
+  auto slot = get_slot(name);
+
+  return slot && slot->get_query_digests(digests);
+}
+
+bool MySQLRoutingComponent::get_route_client_hosts(const std::string &name,
+    std::vector<routing::ClientHostStatus> &hosts) const {
+  auto slot = get_slot(name);
+
+  return slot && slot->get_client_hosts(hosts);
+}
+
+routing::UnblockHostResult MySQLRoutingComponent::unblock_route_client_host(
+    const std::string &name, const std::string &address) {
+  auto slot = get_slot(name);
+  if (!slot) {
+    return routing::UnblockHostResult::kRouteNotFound;
+  }
+
+  return slot->unblock_client_host(address);
+}
+
+routing::CloseConnectionResult MySQLRoutingComponent::close_route_connection(const std::string &name, uint64_t id) {
+  auto slot = get_slot(name);
+  if (!slot) {
+    return routing::CloseConnectionResult::kRouteNotFound;
+  }
+
+  return slot->close_connection(id) ? routing::CloseConnectionResult::kClosed
+                                    : routing::CloseConnectionResult::kConnectionNotFound;
+}
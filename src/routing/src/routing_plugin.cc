@@ -198,6 +198,7 @@ static void start(mysql_harness::PluginFuncEnv* env) {
     //
     std::chrono::milliseconds destination_connect_timeout(config.connect_timeout * 1000);
     std::chrono::milliseconds client_connect_timeout(config.client_connect_timeout * 1000);
+    std::chrono::milliseconds connect_errors_timeout(static_cast<int64_t>(config.connect_errors_timeout) * 1000);
 
     MySQLRouting r(config.routing_strategy,
                    config.bind_address.port,
@@ -212,13 +213,44 @@ static void start(mysql_harness::PluginFuncEnv* env) {
                    client_connect_timeout,
                    routing::kDefaultNetBufferLength,
                    routing::RoutingSockOps::instance(mysql_harness::SocketOperations::instance()),
-                   config.thread_stack_size);
-
-    try {
-      // don't allow rootless URIs as we did already in the get_option_destinations()
-      r.set_destinations_from_uri(URI(config.destinations, false));
-    } catch (URIError&) {
+                   config.thread_stack_size,
+                   config.host_cache_size,
+                   connect_errors_timeout);
+
+    routing::ConnectionRateLimits rate_limits;
+    rate_limits.max_connections_per_second = config.max_connections_per_second;
+    rate_limits.max_client_connections_per_second = config.max_client_connections_per_second;
+    rate_limits.max_client_connections = config.max_client_connections;
+    rate_limits.client_ipv4_prefix_length = static_cast<uint8_t>(config.client_ipv4_prefix_length);
+    rate_limits.client_ipv6_prefix_length = static_cast<uint8_t>(config.client_ipv6_prefix_length);
+    r.set_connection_rate_limits(rate_limits);
+
+    routing::SocketOptions socket_options;
+    socket_options.listen_backlog = static_cast<int>(config.listen_backlog);
+    socket_options.receive_buffer_size = static_cast<int>(config.socket_receive_buffer_size);
+    socket_options.send_buffer_size = static_cast<int>(config.socket_send_buffer_size);
+    socket_options.notsent_lowat = static_cast<int>(config.tcp_notsent_lowat);
+    socket_options.defer_accept = static_cast<int>(config.tcp_defer_accept);
+    socket_options.fastopen = static_cast<int>(config.tcp_fastopen);
+    socket_options.keepalive = config.tcp_keepalive != 0;
+    socket_options.keepalive_idle = static_cast<int>(config.tcp_keepalive_idle);
+    socket_options.keepalive_interval = static_cast<int>(config.tcp_keepalive_interval);
+    socket_options.keepalive_count = static_cast<int>(config.tcp_keepalive_count);
+    socket_options.user_timeout = config.tcp_user_timeout;
+    r.set_socket_options(socket_options);
+    r.set_query_digest(config.query_digest_size, config.query_digest_sample_rate);
+    r.set_trace_sample_rate(config.trace_sample_rate);
+
+    if (is_unix_socket_destination(config.destinations)) {
+      // unix:/path is a valid URI, but not a metadata URI
       r.set_destinations_from_csv(config.destinations);
+    } else {
+      try {
+        // don't allow rootless URIs as we did already in the get_option_destinations()
+        r.set_destinations_from_uri(URI(config.destinations, false));
+      } catch (URIError&) {
+        r.set_destinations_from_csv(config.destinations);
+      }
     }
     r.start(env);
   } catch (const std::invalid_argument &exc) {
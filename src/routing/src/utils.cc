@@ -107,6 +107,13 @@ std::vector<std::string> split_string(const std::string& data, const char delimi
   return split_string(data, delimiter, true);
 }
 
+const char *const kUnixSocketDestinationPrefix = "unix:";
+
+bool is_unix_socket_destination(const std::string &destination) {
+  return destination.compare(0, std::strlen(kUnixSocketDestinationPrefix),
+                             kUnixSocketDestinationPrefix) == 0;
+}
+
 ClientIpArray in_addr_to_array(const sockaddr_storage &addr) {
   ClientIpArray result{{0}};
 
@@ -128,6 +135,42 @@ ClientIpArray in_addr_to_array(const sockaddr_storage &addr) {
 }
 
 
+std::string client_ip_array_to_string(const ClientIpArray &ip_array) {
+  char buf[INET6_ADDRSTRLEN];
+
+  const bool is_ipv4 = std::all_of(ip_array.begin() + 4, ip_array.end(),
+                                   [](uint8_t b) { return b == 0; });
+  if (is_ipv4) {
+    struct in_addr addr;
+    std::memcpy(&addr, ip_array.data(), sizeof(addr));
+    if (inet_ntop(AF_INET, &addr, buf, sizeof(buf)) == nullptr) return "";
+  } else {
+    struct in6_addr addr;
+    std::memcpy(&addr, ip_array.data(), sizeof(addr));
+    if (inet_ntop(AF_INET6, &addr, buf, sizeof(buf)) == nullptr) return "";
+  }
+
+  return buf;
+}
+
+bool client_ip_array_from_string(const std::string &address, ClientIpArray &ip_array) {
+  ip_array.fill(0);
+
+  struct in_addr addr;
+  if (inet_pton(AF_INET, address.c_str(), &addr) == 1) {
+    std::memcpy(ip_array.data(), &addr, sizeof(addr));
+    return true;
+  }
+
+  struct in6_addr addr6;
+  if (inet_pton(AF_INET6, address.c_str(), &addr6) == 1) {
+    std::memcpy(ip_array.data(), &addr6, sizeof(addr6));
+    return true;
+  }
+
+  return false;
+}
+
 std::string get_message_error(int errcode)
 {
 #ifndef _WIN32
@@ -86,6 +86,37 @@ std::vector<std::string> split_string(const std::string& data, const char delimi
  */
 ClientIpArray in_addr_to_array(const sockaddr_storage& addr);
 
+/** @brief Converts IP address stored by in_addr_to_array() to string
+ *
+ * IPv4 addresses are stored in the first 4 bytes, hence an array of which
+ * the last 12 bytes are zero is taken as IPv4 address.
+ *
+ * @param ip_array IP address as returned by in_addr_to_array()
+ * @return IP address in text form
+ */
+std::string client_ip_array_to_string(const ClientIpArray& ip_array);
+
+/** @brief Converts IP address in text form like in_addr_to_array() does
+ *
+ * @param address IPv4 or IPv6 address in text form
+ * @param[out] ip_array IP address as stored by in_addr_to_array()
+ * @return false if address isn't a valid IP address
+ */
+bool client_ip_array_from_string(const std::string& address, ClientIpArray& ip_array);
+
 std::string get_message_error(int errcode);
 
+/** @brief Prefix of Unix socket destinations
+ *
+ * Example: unix:/var/run/mysqld/mysqld.sock
+ */
+extern const char *const kUnixSocketDestinationPrefix;
+
+/** @brief Returns whether a destination is a Unix socket
+ *
+ * @param destination destination as given in the configuration
+ * @return true if destination starts with kUnixSocketDestinationPrefix
+ */
+bool is_unix_socket_destination(const std::string &destination);
+
 #endif // UTILS_ROUTING_INCLUDED
@@ -90,6 +90,10 @@ TEST_F(Bug21771595, GetterSetterMaxConnections) {
   auto expected = routing::kDefaultMaxConnections + 1;
   ASSERT_EQ(r.set_max_connections(expected), expected);
   ASSERT_EQ(r.get_max_connections(), expected);
+
+  // more than 65535 connections are allowed per route
+  ASSERT_EQ(r.set_max_connections(100000), 100000);
+  ASSERT_EQ(r.get_max_connections(), 100000);
 }
 
 TEST_F(Bug21771595, InvalidDestinationConnectTimeout) {
@@ -115,7 +119,7 @@ TEST_F(Bug21771595, InvalidMaxConnections) {
                  7001, Protocol::Type::kClassicProtocol, routing::AccessMode::kReadWrite,
                  "127.0.0.1", mysql_harness::Path(), "test");
   ASSERT_THROW(r.set_max_connections(-1), std::invalid_argument);
-  ASSERT_THROW(r.set_max_connections(UINT16_MAX+1), std::invalid_argument);
+  ASSERT_THROW(r.set_max_connections(static_cast<int64_t>(routing::kMaxConnectionsLimit) + 1), std::invalid_argument);
   try {
     r.set_max_connections(0);
   } catch (const std::invalid_argument &exc) {
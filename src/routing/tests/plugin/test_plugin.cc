@@ -465,6 +465,33 @@ TEST_F(RoutingPluginTests, EmptyUnixSocket) {
   }
 }
 
+TEST_F(RoutingPluginTests, UnixSocketDestination) {
+  mysql_harness::Config         cfg;
+  mysql_harness::ConfigSection& section = cfg.add("routing", "test_route");
+  section.add("destinations", "unix:/tmp/mysqld.sock,localhost:1234");
+  section.add("mode", "read-only");
+  section.add("bind_address", "127.0.0.1:15508");
+
+  EXPECT_NO_THROW(RoutingPluginConfig config(&section));
+}
+
+TEST_F(RoutingPluginTests, UnixSocketDestinationRelativePath) {
+  mysql_harness::Config         cfg;
+  mysql_harness::ConfigSection& section = cfg.add("routing", "test_route");
+  section.add("destinations", "unix:mysqld.sock");
+  section.add("mode", "read-only");
+  section.add("bind_address", "127.0.0.1:15508");
+
+  try {
+    RoutingPluginConfig config(&section);
+    FAIL() << "Expected std::invalid_argument to be thrown";
+  } catch (const std::invalid_argument& e) {
+    EXPECT_THAT(e.what(), HasSubstr("Unix socket destination needs an absolute path (was 'unix:mysqld.sock')"));
+  } catch (...) {
+    FAIL() << "Expected std::invalid_argument to be thrown";
+  }
+}
+
 TEST_F(RoutingPluginTests, StartBadUnixSocket) {
   socket = "/this/path/does/not/exist/socket";
   reset_config();
@@ -57,6 +57,7 @@ class MockSocketOperations : public mysql_harness::SocketOperationsBase {
   MOCK_METHOD1(freeaddrinfo, void(addrinfo *ai));
   MOCK_METHOD4(getaddrinfo, int(const char*, const char*, const addrinfo*, addrinfo**));
   MOCK_METHOD3(bind, int(int, const struct sockaddr*, socklen_t));
+  MOCK_METHOD3(connect, int(int, const struct sockaddr*, socklen_t));
   MOCK_METHOD3(socket, int(int, int, int));
   MOCK_METHOD5(setsockopt, int(int, int, int, const void*, socklen_t));
   MOCK_METHOD2(listen, int(int fd, int n));
@@ -91,7 +92,8 @@ class MockRoutingSockOps : public routing::RoutingSockOpsInterface {
 
   MockSocketOperations* so() const override { return so_.get(); }
 
-  int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds, bool = true) noexcept override {
+  int get_mysql_socket(mysql_harness::TCPAddress addr, std::chrono::milliseconds, bool = true,
+                       const routing::SocketOptions* = nullptr) noexcept override {
     get_mysql_socket_call_cnt_++;
     if (get_mysql_socket_fails_todo_) {
       so()->set_errno(ECONNREFUSED);
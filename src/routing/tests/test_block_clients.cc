@@ -111,6 +111,38 @@ TEST_F(TestBlockClients, BlockClientHost) {
   ASSERT_THAT(blocked_hosts[1], ContainerEq(client_ip_array2));
 }
 
+TEST_F(TestBlockClients, UnblockClientHost) {
+  unsigned long long max_connect_errors = 1;
+  std::chrono::seconds client_connect_timeout(2);
+  union {
+    sockaddr_in6 client_addr1;
+    sockaddr_storage client_addr1_storage;
+  };
+  client_addr1.sin6_family = AF_INET6;
+  memset(&client_addr1.sin6_addr, 0x0, sizeof(client_addr1.sin6_addr));
+  unsigned char* p = reinterpret_cast<unsigned char*>(&client_addr1.sin6_addr);
+  p[15] = 1;
+  auto client_ip_array1 = in_addr_to_array(client_addr1_storage);
+
+  MySQLRouting r(routing::RoutingStrategy::kNextAvailable,
+                 7001, Protocol::Type::kClassicProtocol,
+                 routing::AccessMode::kReadWrite,
+                 "127.0.0.1", mysql_harness::Path(), "routing:connect_erros",
+                 1, std::chrono::seconds(1), max_connect_errors, client_connect_timeout);
+
+  ASSERT_FALSE(r.get_context().is_client_host_blocked(client_ip_array1));
+  ASSERT_TRUE(r.get_context().block_client_host(client_ip_array1, string("::1")));
+  ASSERT_TRUE(r.get_context().is_client_host_blocked(client_ip_array1));
+
+  ASSERT_TRUE(r.get_context().unblock_client_host(client_ip_array1));
+  ASSERT_FALSE(r.get_context().is_client_host_blocked(client_ip_array1));
+  ASSERT_TRUE(r.get_context().get_blocked_client_hosts().empty());
+
+  ASSERT_TRUE(r.get_context().block_client_host(client_ip_array1, string("::1")));
+  r.get_context().unblock_all_client_hosts();
+  ASSERT_FALSE(r.get_context().is_client_host_blocked(client_ip_array1));
+}
+
 TEST_F(TestBlockClients, BlockClientHostWithFakeResponse) {
   unsigned long long max_connect_errors = 2;
   std::chrono::seconds client_connect_timeout(2);
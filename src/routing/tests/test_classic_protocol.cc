@@ -296,8 +296,9 @@ TEST_F(ClassicProtocolRoutingTest, NoValidDestinations) {
   routing.set_destinations_from_csv("127.0.0.1:7004");
   mysql_harness::TCPAddress server_address("127.0.0.1", 7004);
 
-  MySQLRoutingConnection connection(routing.get_context(), client_socket,
-      client_addr_storage, server_socket, server_address, [](MySQLRoutingConnection*) {});
+  MySQLRoutingConnection connection(routing.get_context(), 1, client_socket,
+      client_addr_storage, server_socket, server_address, MySQLRoutingConnection::Timestamps(),
+      [](MySQLRoutingConnection*) {});
   connection.run();
 
 }
@@ -0,0 +1,176 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "gmock/gmock.h"
+#include "client_error_table.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+ClientIpArray make_ip(uint8_t a, uint8_t b = 0) {
+  ClientIpArray ip{};
+  ip[14] = b;
+  ip[15] = a;
+  return ip;
+}
+
+}  // namespace
+
+class TestClientErrorTable : public testing::Test {
+};
+
+/**
+ * @test
+ *       Verify that unknown hosts have no errors and lookups don't insert.
+ */
+TEST_F(TestClientErrorTable, UnknownHostHasNoErrors) {
+  ClientErrorTable table(100, std::chrono::milliseconds(0));
+
+  ASSERT_THAT(table.get(make_ip(1)), testing::Eq(0u));
+  ASSERT_THAT(table.size(), testing::Eq(0u));
+}
+
+/**
+ * @test
+ *       Verify that errors are counted per host.
+ */
+TEST_F(TestClientErrorTable, IncrementCountsPerHost) {
+  ClientErrorTable table(100, std::chrono::milliseconds(0));
+
+  ASSERT_THAT(table.increment(make_ip(1)), testing::Eq(1u));
+  ASSERT_THAT(table.increment(make_ip(1)), testing::Eq(2u));
+  ASSERT_THAT(table.increment(make_ip(2)), testing::Eq(1u));
+
+  ASSERT_THAT(table.get(make_ip(1)), testing::Eq(2u));
+  ASSERT_THAT(table.get(make_ip(2)), testing::Eq(1u));
+  ASSERT_THAT(table.size(), testing::Eq(2u));
+
+  auto entries = table.get_entries(2);
+  ASSERT_THAT(entries.size(), testing::Eq(1u));
+  ASSERT_THAT(entries[0].first, testing::ContainerEq(make_ip(1)));
+}
+
+/**
+ * @test
+ *       Verify that erase() and clear() reset the error counters.
+ */
+TEST_F(TestClientErrorTable, EraseAndClear) {
+  ClientErrorTable table(100, std::chrono::milliseconds(0));
+
+  table.increment(make_ip(1));
+  table.increment(make_ip(2));
+
+  ASSERT_TRUE(table.erase(make_ip(1)));
+  ASSERT_FALSE(table.erase(make_ip(1)));
+  ASSERT_THAT(table.get(make_ip(1)), testing::Eq(0u));
+
+  table.clear();
+  ASSERT_THAT(table.size(), testing::Eq(0u));
+}
+
+/**
+ * @test
+ *       Verify that the table doesn't grow beyond its capacity and evicts
+ *       the least recent host.
+ */
+TEST_F(TestClientErrorTable, IsBounded) {
+  ClientErrorTable table(10, std::chrono::milliseconds(0), 1);
+
+  for (uint8_t i = 0; i < 100; ++i) {
+    table.increment(make_ip(i));
+  }
+
+  ASSERT_THAT(table.size(), testing::Eq(10u));
+  // oldest hosts are evicted, most recent ones are kept
+  ASSERT_THAT(table.get(make_ip(0)), testing::Eq(0u));
+  ASSERT_THAT(table.get(make_ip(99)), testing::Eq(1u));
+}
+
+/**
+ * @test
+ *       Verify that a capacity smaller than the number of shards is kept.
+ */
+TEST_F(TestClientErrorTable, CapacityBelowShards) {
+  ClientErrorTable table(5, std::chrono::milliseconds(0), 16);
+  ASSERT_THAT(table.get_capacity(), testing::Eq(5u));
+
+  for (uint8_t i = 0; i < 100; ++i) {
+    table.increment(make_ip(i));
+  }
+  ASSERT_THAT(table.size(), testing::Le(5u));
+
+  ASSERT_THAT(ClientErrorTable(100, std::chrono::milliseconds(0), 16).get_capacity(),
+              testing::Le(100u));
+}
+
+/**
+ * @test
+ *       Verify that errors are forgotten after the expiry time.
+ */
+TEST_F(TestClientErrorTable, Expires) {
+  ClientErrorTable table(100, std::chrono::milliseconds(50));
+
+  table.increment(make_ip(1));
+  table.increment(make_ip(1));
+  ASSERT_THAT(table.get(make_ip(1)), testing::Eq(2u));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  ASSERT_THAT(table.get(make_ip(1)), testing::Eq(0u));
+  ASSERT_TRUE(table.get_entries().empty());
+  // counting starts again
+  ASSERT_THAT(table.increment(make_ip(1)), testing::Eq(1u));
+}
+
+/**
+ * @test
+ *       Verify that concurrent updates are all counted.
+ */
+TEST_F(TestClientErrorTable, ConcurrentIncrement) {
+  ClientErrorTable table(100000, std::chrono::milliseconds(0));
+
+  std::vector<std::thread> threads;
+  for (uint8_t t = 0; t < 8; ++t) {
+    threads.emplace_back([&table, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        table.increment(make_ip(static_cast<uint8_t>(i % 100), t));
+        table.get(make_ip(static_cast<uint8_t>(i % 100), t));
+      }
+    });
+  }
+  for (auto &thr : threads) thr.join();
+
+  ASSERT_THAT(table.size(), testing::Eq(800u));
+  for (uint8_t t = 0; t < 8; ++t) {
+    ASSERT_THAT(table.get(make_ip(0, t)), testing::Eq(10u));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
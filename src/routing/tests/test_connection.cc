@@ -109,10 +109,12 @@ TEST_F(TestRoutingConnection, IsCallbackCalledAtRunExit) {
   bool is_called = false;
 
   MySQLRoutingConnection connection(context,
+      1,
       client_socket_,
       client_addr_,
       server_socket_,
       server_address_,
+      MySQLRoutingConnection::Timestamps(),
       [&is_called](MySQLRoutingConnection* /* connection */) {
         is_called = true;
   });
@@ -152,10 +154,12 @@ TEST_F(TestRoutingConnection, IsCallbackCalledAtThreadExit) {
   bool is_called = false;
 
   MySQLRoutingConnection connection(context,
+      1,
       client_socket_,
       client_addr_,
       server_socket_,
       server_address_,
+      MySQLRoutingConnection::Timestamps(),
       [&is_called](MySQLRoutingConnection* /* connection */) {
         is_called = true;
   });
@@ -211,10 +215,12 @@ TEST_F(TestRoutingConnection, IsConnectionThreadStopOnDisconnect) {
   bool is_called = false;
 
   MySQLRoutingConnection connection(context,
+      1,
       client_socket_,
       client_addr_,
       server_socket_,
       server_address_,
+      MySQLRoutingConnection::Timestamps(),
       [&is_called](MySQLRoutingConnection* /* connection */) {
         is_called = true;
   });
@@ -234,6 +240,55 @@ TEST_F(TestRoutingConnection, IsConnectionThreadStopOnDisconnect) {
   ASSERT_TRUE(is_called);
 }
 
+/**
+ * @test
+ *       Verify that a connection created without a server socket connects
+ *       to the server from run().
+ */
+TEST_F(TestRoutingConnection, ConnectsToServerInRun) {
+  EXPECT_CALL(socket_operations_, shutdown(testing::_)).Times(2);
+  EXPECT_CALL(socket_operations_, close(testing::_)).Times(2);
+
+  EXPECT_CALL(*protocol_, on_block_client_host(testing::_, testing::_))
+      .Times(testing::AtLeast(0)).WillRepeatedly(testing::Return(false));
+
+  MySQLRoutingContext context(protocol_.release(),
+      &socket_operations_,
+      name_,
+      net_buffer_length_,
+      destination_connect_timeout_,
+      client_connect_timeout_,
+      bind_address_,
+      bind_named_socket_,
+      max_connect_errors_,
+      thread_stack_size_);
+
+  int connect_calls = 0;
+  const int server_socket = server_socket_;
+
+  MySQLRoutingConnection connection(context,
+      1,
+      client_socket_,
+      client_addr_,
+      [&connect_calls, server_socket](mysql_harness::TCPAddress *address) {
+        ++connect_calls;
+        *address = mysql_harness::TCPAddress("127.0.0.1", 3306);
+        return server_socket;
+      },
+      MySQLRoutingConnection::clock_type::now(),
+      [](MySQLRoutingConnection* /* connection */) {});
+
+  // not connected before run()
+  EXPECT_EQ(0, connect_calls);
+  EXPECT_EQ("", connection.get_server_address().addr);
+
+  connection.disconnect();
+  connection.run();
+
+  EXPECT_EQ(1, connect_calls);
+  EXPECT_EQ(mysql_harness::TCPAddress("127.0.0.1", 3306), connection.get_server_address());
+}
+
 int main(int argc, char *argv[]) {
   init_test_logger();
   ::testing::InitGoogleTest(&argc, argv);
@@ -66,9 +66,13 @@ class MetadataCacheAPIStub: public metadata_cache::MetadataCacheAPIBase {
 
   MOCK_METHOD2(mark_instance_reachability, void(const std::string&, InstanceStatus));
   MOCK_METHOD2(wait_primary_failover, bool(const std::string&, int));
-  MOCK_METHOD9(cache_init, void(const std::vector<mysql_harness::TCPAddress>&, const std::string&,
-                                const std::string&, std::chrono::milliseconds, const mysqlrouter::SSLOptions&,
-                                const std::string&, int, int, size_t));
+  MOCK_METHOD0(request_refresh, void());
+
+  // gmock can't mock methods with more than 10 arguments
+  void cache_init(const std::vector<mysql_harness::TCPAddress>&, const std::string&,
+                  const std::string&, std::chrono::milliseconds, const mysqlrouter::SSLOptions&,
+                  const std::string&, int, int, size_t, bool, std::chrono::milliseconds,
+                  const std::string&, std::chrono::milliseconds) override {}
 
   void cache_stop() noexcept override {} // no easy way to mock noexcept method
 
@@ -82,6 +86,17 @@ class MetadataCacheAPIStub: public metadata_cache::MetadataCacheAPIBase {
     instances_change_listener_->notify(instance_vector_, md_servers_reachable);
   }
 
+  // tells the listener what changed since the instances in before
+  void trigger_instances_changes_callback(const InstanceVector& before,
+                                          const bool md_servers_reachable = true) {
+    if (!instances_change_listener_) return;
+    instances_change_listener_->notify_changes(
+        metadata_cache::ReplicasetSnapshot(before),
+        metadata_cache::ReplicasetSnapshot(instance_vector_),
+        metadata_cache::ReplicasetChanges::diff(before, instance_vector_),
+        md_servers_reachable);
+  }
+
   std::vector<metadata_cache::ManagedInstance> instance_vector_;
   metadata_cache::ReplicasetStateListenerInterface* instances_change_listener_{nullptr};
 
@@ -677,6 +692,93 @@ TEST_F(DestMetadataCacheTest, AllowedNodes2Primaries) {
   ASSERT_TRUE(callback_called);
 }
 
+/**
+ * @test verifies that on a switchover only the old primary is reported as
+ *       disallowed to a read-write destination
+ */
+TEST_F(DestMetadataCacheTest, DisallowedNodesSwitchover) {
+
+  DestMetadataCacheGroup dest_mc_group("cache-name", kReplicasetName,
+                         routing::RoutingStrategy::kUndefined,
+                         mysqlrouter::URI("metadata-cache://cache-name/default?role=PRIMARY").query,
+                         BaseProtocol::Type::kClassicProtocol,
+                         routing::AccessMode::kReadWrite,
+                         &metadata_cache_api_, &routing_sock_ops_);
+
+  const InstanceVector before{
+     {kReplicasetName, "uuid1", "HA", metadata_cache::ServerMode::ReadWrite, 1.0, 1, "location", "3306", 3306, 33060},
+     {kReplicasetName, "uuid2", "HA", metadata_cache::ServerMode::ReadOnly, 1.0, 1, "location", "3307", 3307, 33070},
+  };
+  fill_instance_vector(before);
+  // need at least one connection to force dest to register for md changes
+  ASSERT_EQ(dest_mc_group.get_server_socket(std::chrono::milliseconds(0), &err_), 3306);
+
+  // uuid2 is the new primary
+  fill_instance_vector({
+     {kReplicasetName, "uuid1", "HA", metadata_cache::ServerMode::ReadOnly, 1.0, 1, "location", "3306", 3306, 33060},
+     {kReplicasetName, "uuid2", "HA", metadata_cache::ServerMode::ReadWrite, 1.0, 1, "location", "3307", 3307, 33070},
+  });
+
+  bool callback_called{false};
+  auto check_nodes = [&](const std::vector<mysql_harness::TCPAddress>& nodes, const std::string& reason) -> void {
+    ASSERT_EQ(1u, nodes.size());
+    ASSERT_EQ(3306u, nodes[0].port);
+    ASSERT_STREQ("metadata change", reason.c_str());
+    callback_called = true;
+  };
+  auto full_list = [&](const AllowedNodes&, const std::string&) -> void {
+    FAIL() << "the whole list of allowed nodes is not expected";
+  };
+  dest_mc_group.register_disallowed_nodes_callback(check_nodes);
+  dest_mc_group.register_allowed_nodes_change_callback(full_list);
+  metadata_cache_api_.trigger_instances_changes_callback(before);
+
+  ASSERT_TRUE(callback_called);
+}
+
+/**
+ * @test verifies that changes that keep all the existing connections valid
+ *       (a member joining, metadata unavailable with
+ *       disconnect_on_metadata_unavailable=no) don't call the callbacks
+ */
+TEST_F(DestMetadataCacheTest, DisallowedNodesNothingToDisconnect) {
+
+  DestMetadataCacheGroup dest_mc_group("cache-name", kReplicasetName,
+                         routing::RoutingStrategy::kUndefined,
+                         mysqlrouter::URI("metadata-cache://cache-name/default?role=SECONDARY").query,
+                         BaseProtocol::Type::kClassicProtocol,
+                         routing::AccessMode::kReadOnly,
+                         &metadata_cache_api_, &routing_sock_ops_);
+
+  const InstanceVector before{
+     {kReplicasetName, "uuid1", "HA", metadata_cache::ServerMode::ReadWrite, 1.0, 1, "location", "3306", 3306, 33060},
+     {kReplicasetName, "uuid2", "HA", metadata_cache::ServerMode::ReadOnly, 1.0, 1, "location", "3307", 3307, 33070},
+  };
+  fill_instance_vector(before);
+  // need at least one connection to force dest to register for md changes
+  ASSERT_EQ(dest_mc_group.get_server_socket(std::chrono::milliseconds(0), &err_), 3307);
+
+  bool callback_called{false};
+  auto check_nodes = [&](const std::vector<mysql_harness::TCPAddress>&, const std::string&) -> void {
+    callback_called = true;
+  };
+  dest_mc_group.register_disallowed_nodes_callback(check_nodes);
+
+  // uuid3 joins
+  fill_instance_vector({
+     {kReplicasetName, "uuid1", "HA", metadata_cache::ServerMode::ReadWrite, 1.0, 1, "location", "3306", 3306, 33060},
+     {kReplicasetName, "uuid2", "HA", metadata_cache::ServerMode::ReadOnly, 1.0, 1, "location", "3307", 3307, 33070},
+     {kReplicasetName, "uuid3", "HA", metadata_cache::ServerMode::ReadOnly, 1.0, 1, "location", "3308", 3308, 33080},
+  });
+  metadata_cache_api_.trigger_instances_changes_callback(before);
+  EXPECT_FALSE(callback_called);
+
+  // metadata unavailable
+  fill_instance_vector({});
+  metadata_cache_api_.trigger_instances_changes_callback(before, false);
+  EXPECT_FALSE(callback_called);
+}
+
 /**
  * @test verifies that when the metadata changes and there is only single r/w node,
  *       then allowed_nodes that gets passed to read-only destination observer has this node
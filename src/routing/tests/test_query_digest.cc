@@ -0,0 +1,304 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+
+#include "gmock/gmock.h"
+#include "protocol/classic_query_tracker.h"
+#include "query_digest.h"
+#include "mysqlrouter/mysql_protocol.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using routing::QueryDigestTable;
+using routing::normalize_query;
+using std::chrono::microseconds;
+
+static std::string normalize(const std::string &query) {
+  return normalize_query(query.data(), query.size());
+}
+
+/**
+ * builds a classic protocol packet from a payload.
+ */
+static std::vector<uint8_t> make_packet(const std::vector<uint8_t> &payload, uint8_t seq) {
+  std::vector<uint8_t> packet {
+    static_cast<uint8_t>(payload.size()),
+    static_cast<uint8_t>(payload.size() >> 8),
+    static_cast<uint8_t>(payload.size() >> 16),
+    seq,
+  };
+  packet.insert(packet.end(), payload.begin(), payload.end());
+
+  return packet;
+}
+
+static std::vector<uint8_t> make_com_query(const std::string &query) {
+  std::vector<uint8_t> payload { 0x03 };
+  payload.insert(payload.end(), query.begin(), query.end());
+
+  return make_packet(payload, 0);
+}
+
+static std::vector<uint8_t> make_handshake_response(uint32_t capabilities) {
+  std::vector<uint8_t> payload {
+    static_cast<uint8_t>(capabilities), static_cast<uint8_t>(capabilities >> 8),
+    static_cast<uint8_t>(capabilities >> 16), static_cast<uint8_t>(capabilities >> 24),
+  };
+  payload.resize(32, 0);
+  payload.insert(payload.end(), { 'u', 0, 0 });
+
+  return make_packet(payload, 1);
+}
+
+static void append(std::vector<uint8_t> &data, const std::vector<uint8_t> &packet) {
+  data.insert(data.end(), packet.begin(), packet.end());
+}
+
+class TestQueryDigest : public testing::Test {
+};
+
+/**
+ * @test
+ *       Verify that literals, lists of literals and comments are removed
+ *       from statements.
+ */
+TEST_F(TestQueryDigest, Normalize) {
+  EXPECT_EQ("SELECT * FROM t WHERE id = ?", normalize("SELECT * FROM t WHERE id = 42"));
+  EXPECT_EQ("SELECT * FROM t WHERE id = ?", normalize("SELECT  *\n FROM t WHERE id=-7"));
+  EXPECT_EQ("select a, b from t where x = ? and y = ?",
+            normalize("select a,b from t where x='abc' and y=\"d\\\"e\""));
+  EXPECT_EQ("SELECT ?, ?, ?, ?, ?", normalize("SELECT 1.5e3, -2, 0x1F, X'AB', b'01'"));
+  EXPECT_EQ("INSERT INTO t VALUES (...)",
+            normalize("INSERT INTO t VALUES (1,'a'),(2,'b'), (3, 'c')"));
+  EXPECT_EQ("SELECT * FROM t WHERE id IN (...)", normalize("SELECT * FROM t WHERE id IN (1, 2, 3)"));
+  EXPECT_EQ("SELECT a FROM t WHERE b = ?",
+            normalize("SELECT /* hint */ a  FROM\n t -- comment\n WHERE b = 1"));
+  EXPECT_EQ("SELECT `col1` FROM t1 WHERE x >= ?", normalize("SELECT `col1` FROM t1 WHERE x>=10"));
+  EXPECT_EQ("SELECT f(?, a)", normalize("SELECT f(1, a)"));
+  EXPECT_EQ("SELECT * FROM t WHERE id IN (SELECT id FROM u WHERE v = ?)",
+            normalize("SELECT * FROM t WHERE id IN (SELECT id FROM u WHERE v = 1)"));
+}
+
+/**
+ * @test
+ *       Verify that long statements are cut off.
+ */
+TEST_F(TestQueryDigest, NormalizeLong) {
+  std::string query("SELECT ");
+  while (query.size() < 4 * routing::kMaxQueryDigestLength) query += "column_name, ";
+
+  EXPECT_EQ(routing::kMaxQueryDigestLength, normalize(query).size());
+}
+
+/**
+ * @test
+ *       Verify that the table adds up the statistics of a digest and
+ *       replaces the least frequent digest when full, the newcomer
+ *       inheriting its count.
+ */
+TEST_F(TestQueryDigest, TableEvictsLeastFrequent) {
+  QueryDigestTable table;
+  table.configure(2, 1);
+
+  table.record("a", microseconds(10), 1, 100, false);
+  table.record("a", microseconds(30), 2, 200, true);
+  table.record("b", microseconds(5), 0, 0, false);
+  table.record("c", microseconds(5), 0, 0, false);
+
+  auto entries = table.get_entries();
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ("a", entries[0].digest);
+  EXPECT_EQ(2u, entries[0].count);
+  EXPECT_EQ(1u, entries[0].errors);
+  EXPECT_EQ(microseconds(40), entries[0].total_latency);
+  EXPECT_EQ(microseconds(30), entries[0].max_latency);
+  EXPECT_EQ(3u, entries[0].rows);
+  EXPECT_EQ(300u, entries[0].bytes);
+  EXPECT_EQ(0u, entries[0].count_error);
+  EXPECT_EQ("c", entries[1].digest);
+  EXPECT_EQ(2u, entries[1].count);
+  EXPECT_EQ(1u, entries[1].count_error);
+  EXPECT_EQ(microseconds(5), entries[1].total_latency);
+
+  table.configure(1, 1);
+  EXPECT_EQ(1u, table.get_entries().size());
+
+  table.clear();
+  EXPECT_TRUE(table.get_entries().empty());
+}
+
+/**
+ * @test
+ *       Verify that frequent digests survive a stream of rare ones and
+ *       that the counts add up to the number of recorded statements.
+ */
+TEST_F(TestQueryDigest, TableKeepsFrequentDigests) {
+  QueryDigestTable table;
+  table.configure(8, 1);
+
+  uint64_t total = 0;
+  for (int i = 0; i < 1000; ++i) {
+    table.record("hot" + std::to_string(i % 3), microseconds(1), 0, 0, false);
+    table.record("rare" + std::to_string(i), microseconds(1), 0, 0, false);
+    total += 2;
+  }
+
+  auto entries = table.get_entries();
+  ASSERT_EQ(8u, entries.size());
+
+  uint64_t sum = 0;
+  for (const auto &entry: entries) {
+    sum += entry.count;
+    EXPECT_LE(entry.count_error, entry.count);
+  }
+  EXPECT_EQ(total, sum);
+
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(0u, entries[i].digest.find("hot")) << entries[i].digest;
+    EXPECT_GE(entries[i].count - entries[i].count_error, 333u);
+  }
+
+  table.configure(2, 1);
+  entries = table.get_entries();
+  ASSERT_EQ(2u, entries.size());
+  EXPECT_EQ(0u, entries[0].digest.find("hot"));
+  EXPECT_EQ(0u, entries[1].digest.find("hot"));
+}
+
+/**
+ * @test
+ *       Verify the sampling rate of the table.
+ */
+TEST_F(TestQueryDigest, Sampling) {
+  QueryDigestTable table;
+
+  EXPECT_FALSE(table.is_enabled());
+  EXPECT_FALSE(table.should_sample());
+
+  table.configure(10, 1);
+  EXPECT_TRUE(table.is_enabled());
+  EXPECT_TRUE(table.should_sample());
+
+  table.configure(10, 4);
+  int sampled = 0;
+  for (int i = 0; i < 4000; ++i) {
+    if (table.should_sample()) ++sampled;
+  }
+  EXPECT_GT(sampled, 500);
+  EXPECT_LT(sampled, 1500);
+}
+
+/**
+ * @test
+ *       Verify that the tracker counts the rows of a result set, also
+ *       when the response arrives in pieces.
+ */
+TEST_F(TestQueryDigest, TrackerResultSet) {
+  namespace Capabilities = mysql_protocol::Capabilities;
+
+  QueryDigestTable table;
+  table.configure(10, 1);
+  ClassicQueryTracker tracker(table);
+
+  auto handshake = make_handshake_response(Capabilities::PROTOCOL_41.bits());
+  tracker.on_client_data(handshake.data(), handshake.size());
+
+  auto query = make_com_query("SELECT a, b FROM t WHERE id > 10");
+  tracker.on_client_data(query.data(), query.size());
+  EXPECT_TRUE(tracker.is_tracking());
+
+  std::vector<uint8_t> response;
+  uint8_t seq = 1;
+  append(response, make_packet({ 0x02 }, seq++));                   // column count
+  append(response, make_packet(std::vector<uint8_t>(20, 'c'), seq++));  // column a
+  append(response, make_packet(std::vector<uint8_t>(20, 'c'), seq++));  // column b
+  append(response, make_packet({ 0xfe, 0, 0, 0x02, 0 }, seq++));    // EOF
+  append(response, make_packet({ 0x01, '1', 0x01, '2' }, seq++));   // row
+  append(response, make_packet({ 0x01, '3', 0x01, '4' }, seq++));   // row
+  append(response, make_packet({ 0x01, '5', 0x01, '6' }, seq++));   // row
+  append(response, make_packet({ 0xfe, 0, 0, 0x02, 0 }, seq++));    // EOF
+
+  // feed the response in pieces that split headers and payloads
+  for (size_t pos = 0; pos < response.size(); pos += 3) {
+    tracker.on_server_data(response.data() + pos, std::min<size_t>(3, response.size() - pos));
+  }
+  EXPECT_FALSE(tracker.is_tracking());
+
+  auto entries = table.get_entries();
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ("SELECT a, b FROM t WHERE id > ?", entries[0].digest);
+  EXPECT_EQ(1u, entries[0].count);
+  EXPECT_EQ(0u, entries[0].errors);
+  EXPECT_EQ(3u, entries[0].rows);
+  EXPECT_EQ(response.size(), entries[0].bytes);
+}
+
+/**
+ * @test
+ *       Verify that errors are counted and connections using SSL are
+ *       ignored.
+ */
+TEST_F(TestQueryDigest, TrackerErrorAndSsl) {
+  namespace Capabilities = mysql_protocol::Capabilities;
+
+  QueryDigestTable table;
+  table.configure(10, 1);
+
+  {
+    ClassicQueryTracker tracker(table);
+    auto handshake = make_handshake_response(Capabilities::PROTOCOL_41.bits());
+    tracker.on_client_data(handshake.data(), handshake.size());
+
+    auto query = make_com_query("SELECT * FROM missing");
+    tracker.on_client_data(query.data(), query.size());
+
+    auto error = make_packet({ 0xff, 0x7a, 0x04, '#', '4', '2', 'S', '0', '2' }, 1);
+    tracker.on_server_data(error.data(), error.size());
+    EXPECT_FALSE(tracker.is_tracking());
+  }
+
+  auto entries = table.get_entries();
+  ASSERT_EQ(1u, entries.size());
+  EXPECT_EQ(1u, entries[0].errors);
+
+  {
+    ClassicQueryTracker tracker(table);
+    auto handshake = make_handshake_response((Capabilities::PROTOCOL_41 | Capabilities::SSL).bits());
+    tracker.on_client_data(handshake.data(), handshake.size());
+
+    auto query = make_com_query("SELECT 1");
+    tracker.on_client_data(query.data(), query.size());
+    EXPECT_FALSE(tracker.is_tracking());
+  }
+
+  EXPECT_EQ(1u, table.get_entries().size());
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
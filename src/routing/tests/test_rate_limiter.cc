@@ -0,0 +1,326 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "gmock/gmock.h"
+#include "rate_limiter.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+# include <arpa/inet.h>
+# include <netinet/in.h>
+#else
+# include <WinSock2.h>
+# include <ws2tcpip.h>
+#endif
+
+using routing::ConnectionRateLimiter;
+using routing::ConnectionRateLimits;
+using routing::TokenBucket;
+
+namespace {
+
+sockaddr_storage make_ipv4_addr(const char *ip) {
+  sockaddr_storage storage;
+  std::memset(&storage, 0, sizeof(storage));
+  sockaddr_in *addr = reinterpret_cast<sockaddr_in*>(&storage);
+  addr->sin_family = AF_INET;
+  inet_pton(AF_INET, ip, &addr->sin_addr);
+  return storage;
+}
+
+const int64_t kSecond = 1000000000;
+
+}  // namespace
+
+class TestRateLimiter : public testing::Test {
+};
+
+/**
+ * @test
+ *       Verify that a disabled token bucket lets everything through.
+ */
+TEST_F(TestRateLimiter, DisabledBucket) {
+  TokenBucket bucket;
+  bucket.configure(0, 0);
+
+  ASSERT_FALSE(bucket.is_enabled());
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(bucket.try_acquire(0));
+  }
+}
+
+/**
+ * @test
+ *       Verify that the token bucket allows a burst and refills over time.
+ */
+TEST_F(TestRateLimiter, BucketBurstAndRefill) {
+  TokenBucket bucket;
+  bucket.configure(10, 5);
+
+  const int64_t now = 100 * kSecond;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(bucket.try_acquire(now)) << i;
+  }
+  ASSERT_FALSE(bucket.try_acquire(now));
+
+  // one token every 100ms
+  ASSERT_TRUE(bucket.try_acquire(now + kSecond / 10));
+  ASSERT_FALSE(bucket.try_acquire(now + kSecond / 10));
+
+  // after a long pause, at most a burst is allowed
+  const int64_t later = now + 10 * kSecond;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(bucket.try_acquire(later)) << i;
+  }
+  ASSERT_FALSE(bucket.try_acquire(later));
+}
+
+/**
+ * @test
+ *       Verify that concurrent acquires don't hand out more than the burst.
+ */
+TEST_F(TestRateLimiter, BucketConcurrentAcquire) {
+  TokenBucket bucket;
+  bucket.configure(1, 100);
+
+  std::atomic<int> acquired{0};
+  const int64_t now = 100 * kSecond;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 100; ++i) {
+        if (bucket.try_acquire(now)) ++acquired;
+      }
+    });
+  }
+  for (auto &thr : threads) thr.join();
+
+  ASSERT_THAT(acquired.load(), testing::Eq(100));
+}
+
+/**
+ * @test
+ *       Verify that a refunded token can be taken again.
+ */
+TEST_F(TestRateLimiter, BucketRefund) {
+  TokenBucket bucket;
+  bucket.configure(1, 1);
+
+  const int64_t now = 100 * kSecond;
+  ASSERT_TRUE(bucket.try_acquire(now));
+  ASSERT_FALSE(bucket.try_acquire(now));
+
+  bucket.refund();
+  ASSERT_TRUE(bucket.is_full(now));
+  ASSERT_TRUE(bucket.try_acquire(now));
+}
+
+/**
+ * @test
+ *       Verify that client sources are masked with the prefix length.
+ */
+TEST_F(TestRateLimiter, SourcePrefix) {
+  ConnectionRateLimiter limiter(16);
+  ConnectionRateLimits limits;
+  limits.client_ipv4_prefix_length = 24;
+  limiter.configure(limits);
+
+  ASSERT_THAT(limiter.get_source(make_ipv4_addr("10.1.2.3")),
+              testing::ContainerEq(limiter.get_source(make_ipv4_addr("10.1.2.200"))));
+  ASSERT_THAT(limiter.get_source(make_ipv4_addr("10.1.2.3")),
+              testing::Ne(limiter.get_source(make_ipv4_addr("10.1.3.3"))));
+}
+
+/**
+ * @test
+ *       Verify concurrent connections per client source are limited and
+ *       released.
+ */
+TEST_F(TestRateLimiter, MaxClientConnections) {
+  ConnectionRateLimiter limiter;
+  ConnectionRateLimits limits;
+  limits.max_client_connections = 2;
+  limiter.configure(limits);
+
+  const auto client = make_ipv4_addr("10.0.0.1");
+  const auto other_client = make_ipv4_addr("10.0.0.2");
+
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kClientConnectionsExceeded));
+  ASSERT_THAT(limiter.acquire(other_client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+
+  limiter.release(client);
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+}
+
+/**
+ * @test
+ *       Verify that sources don't share their limits, however many there
+ *       are, and that they are forgotten once they have no connections.
+ */
+TEST_F(TestRateLimiter, SourcesAreDistinct) {
+  // as many slots as sources: colliding sources have to probe
+  ConnectionRateLimiter limiter(16);
+  ConnectionRateLimits limits;
+  limits.max_client_connections = 1;
+  limiter.configure(limits);
+
+  std::vector<sockaddr_storage> clients;
+  for (int i = 1; i <= 16; ++i) {
+    clients.push_back(make_ipv4_addr(("10.0.0." + std::to_string(i)).c_str()));
+  }
+  for (const auto &client : clients) {
+    ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  }
+  for (const auto &client : clients) {
+    ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kClientConnectionsExceeded));
+  }
+  ASSERT_THAT(limiter.size(), testing::Eq(clients.size()));
+
+  // no slot left for another source: only the route-wide limit applies
+  const auto other_client = make_ipv4_addr("10.0.1.1");
+  ASSERT_THAT(limiter.acquire(other_client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(other_client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  limiter.release(other_client);
+  limiter.release(other_client);
+
+  for (const auto &client : clients) {
+    limiter.release(client);
+  }
+  ASSERT_THAT(limiter.size(), testing::Eq(0u));
+
+  // the slots of idle sources are reused
+  ASSERT_THAT(limiter.acquire(other_client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(other_client), testing::Eq(ConnectionRateLimiter::Result::kClientConnectionsExceeded));
+  ASSERT_THAT(limiter.size(), testing::Eq(1u));
+}
+
+/**
+ * @test
+ *       Verify that concurrent acquires of one source don't exceed its
+ *       connection limit.
+ */
+TEST_F(TestRateLimiter, MaxClientConnectionsConcurrent) {
+  ConnectionRateLimiter limiter(4);
+  ConnectionRateLimits limits;
+  limits.max_client_connections = 3;
+  limiter.configure(limits);
+
+  const auto client = make_ipv4_addr("10.0.0.1");
+  std::atomic<int> connections{0};
+  std::atomic<int> max_connections{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 1000; ++i) {
+        if (limiter.acquire(client) != ConnectionRateLimiter::Result::kAllowed) continue;
+        const int current = ++connections;
+        int max = max_connections.load();
+        while (current > max && !max_connections.compare_exchange_weak(max, current)) {
+        }
+        --connections;
+        limiter.release(client);
+      }
+    });
+  }
+  for (auto &thr : threads) thr.join();
+
+  ASSERT_THAT(max_connections.load(), testing::Le(3));
+  ASSERT_THAT(limiter.size(), testing::Eq(0u));
+}
+
+/**
+ * @test
+ *       Verify that connections rejected because the source is at its
+ *       connection limit don't use up the tokens of the route.
+ */
+TEST_F(TestRateLimiter, MaxClientConnectionsKeepsRouteTokens) {
+  ConnectionRateLimiter limiter;
+  ConnectionRateLimits limits;
+  limits.max_client_connections = 1;
+  limits.max_connections_per_second = 2;
+  limiter.configure(limits);
+
+  const auto client = make_ipv4_addr("10.0.0.1");
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kClientConnectionsExceeded));
+  }
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.2")), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+}
+
+/**
+ * @test
+ *       Verify that a connection rejected by the route-wide rate doesn't
+ *       use up the tokens of the source.
+ */
+TEST_F(TestRateLimiter, RouteRateKeepsClientTokens) {
+  ConnectionRateLimiter limiter;
+  ConnectionRateLimits limits;
+  limits.max_client_connections_per_second = 1;
+  limits.max_connections_per_second = 1;
+  limiter.configure(limits);
+
+  const auto client = make_ipv4_addr("10.0.0.2");
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.1")), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(client), testing::Eq(ConnectionRateLimiter::Result::kRouteRateExceeded));
+  // the source got its token back, its slot is free again
+  ASSERT_THAT(limiter.size(), testing::Eq(1u));
+}
+
+/**
+ * @test
+ *       Verify that the client and route connection rates are limited.
+ */
+TEST_F(TestRateLimiter, ConnectionRates) {
+  ConnectionRateLimiter limiter;
+  ConnectionRateLimits limits;
+  limits.max_client_connections_per_second = 1;
+  limits.max_connections_per_second = 2;
+  limiter.configure(limits);
+
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.1")), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.1")), testing::Eq(ConnectionRateLimiter::Result::kClientRateExceeded));
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.2")), testing::Eq(ConnectionRateLimiter::Result::kAllowed));
+  ASSERT_THAT(limiter.acquire(make_ipv4_addr("10.0.0.3")), testing::Eq(ConnectionRateLimiter::Result::kRouteRateExceeded));
+}
+
+/**
+ * @test
+ *       Verify that throttled clients get an error code.
+ */
+TEST_F(TestRateLimiter, ErrorCodes) {
+  ASSERT_THAT(routing::get_rate_limit_error(ConnectionRateLimiter::Result::kRouteRateExceeded).first, testing::Eq(1040));
+  ASSERT_THAT(routing::get_rate_limit_error(ConnectionRateLimiter::Result::kClientRateExceeded).first, testing::Eq(1226));
+  ASSERT_THAT(routing::get_rate_limit_error(ConnectionRateLimiter::Result::kClientConnectionsExceeded).first, testing::Eq(1203));
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
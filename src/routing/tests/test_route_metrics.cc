@@ -0,0 +1,79 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+
+#include "gmock/gmock.h"
+#include "route_metrics.h"
+
+#include <string>
+
+using mysql_harness::metrics::MetricsRegistry;
+using routing::RouteMetrics;
+using ::testing::HasSubstr;
+
+class TestRouteMetrics : public testing::Test {
+};
+
+/**
+ * @test
+ *       Verify that latency histograms are created once per destination
+ *       and carry the route and destination labels.
+ */
+TEST_F(TestRouteMetrics, ConnectionLatencyPerDestination) {
+  RouteMetrics metrics("test_latency");
+
+  auto &l1 = metrics.connection_latency("127.0.0.1:3306");
+  auto &l2 = metrics.connection_latency("127.0.0.1:3306");
+  auto &l3 = metrics.connection_latency("127.0.0.1:3307");
+
+  EXPECT_EQ(&l1, &l2);
+  EXPECT_NE(&l1, &l3);
+  EXPECT_NE(&l1.session, &l3.session);
+
+  l1.handshake.observe(0.0025);
+  EXPECT_EQ(1u, l2.handshake.snapshot().count);
+  EXPECT_EQ(0u, l3.handshake.snapshot().count);
+
+  EXPECT_THAT(MetricsRegistry::instance().serialize(),
+              HasSubstr("mysqlrouter_routing_handshake_seconds_count{"
+                        "route=\"test_latency\",destination=\"127.0.0.1:3306\"} 1\n"));
+}
+
+/**
+ * @test
+ *       Verify that two routes with the same name share their counters.
+ */
+TEST_F(TestRouteMetrics, SameRouteSharesCounters) {
+  RouteMetrics m1("test_shared");
+  RouteMetrics m2("test_shared");
+
+  m1.connections_accepted.increment();
+  EXPECT_EQ(&m1.connections_accepted, &m2.connections_accepted);
+  EXPECT_EQ(1u, m2.connections_accepted.value());
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,282 @@
+/*
+  Copyright (c) 2020, GMO Media, Inc. All rights reserved.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License, version 2.0,
+  as published by the Free Software Foundation.
+
+  This program is also distributed with certain software (including
+  but not limited to OpenSSL) that is licensed under separate terms,
+  as designated in a particular file or component or in included license
+  documentation.  The authors of MySQL hereby grant you an additional
+  permission to link the program and your derivative works with the
+  separately licensed software that they have included with MySQL.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "gmock/gmock.h"
+#include "destination_stats.h"
+#include "mysqlrouter/routing_component.h"
+#include "utils.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+#ifndef _WIN32
+# include <arpa/inet.h>
+# include <netinet/in.h>
+#else
+# include <WinSock2.h>
+# include <ws2tcpip.h>
+#endif
+
+using routing::DestinationStatsTable;
+using routing::RouteStatus;
+
+class TestRouteStatus : public testing::Test {
+};
+
+/**
+ * @test
+ *       Verify that connections are counted per destination and that
+ *       released connections are no longer active.
+ */
+TEST_F(TestRouteStatus, DestinationCounters) {
+  DestinationStatsTable table;
+
+  auto c1 = table.acquire("127.0.0.1:3306");
+  auto c2 = table.acquire("127.0.0.1:3306");
+  auto c3 = table.acquire("127.0.0.1:3307");
+  DestinationStatsTable::release(c2);
+
+  auto entries = table.get_entries();
+  ASSERT_THAT(entries.size(), testing::Eq(2u));
+  EXPECT_THAT(entries[0].address, testing::Eq("127.0.0.1:3306"));
+  EXPECT_THAT(entries[0].active_connections, testing::Eq(1));
+  EXPECT_THAT(entries[0].total_connections, testing::Eq(2u));
+  EXPECT_THAT(entries[1].address, testing::Eq("127.0.0.1:3307"));
+  EXPECT_THAT(entries[1].active_connections, testing::Eq(1));
+  EXPECT_THAT(entries[1].total_connections, testing::Eq(1u));
+}
+
+/**
+ * @test
+ *       Verify counters stay exact with concurrent connections.
+ */
+TEST_F(TestRouteStatus, DestinationCountersConcurrent) {
+  DestinationStatsTable table;
+  const int kThreads = 4;
+  const int kConnections = 1000;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&table]() {
+      for (int i = 0; i < kConnections; ++i) {
+        DestinationStatsTable::release(table.acquire("127.0.0.1:3306"));
+      }
+    });
+  }
+  for (auto &thr: threads) thr.join();
+
+  auto entries = table.get_entries();
+  ASSERT_THAT(entries.size(), testing::Eq(1u));
+  EXPECT_THAT(entries[0].active_connections, testing::Eq(0));
+  EXPECT_THAT(entries[0].total_connections, testing::Eq(static_cast<uint64_t>(kThreads * kConnections)));
+}
+
+/**
+ * @test
+ *       Verify that routes publish snapshots through the component.
+ */
+TEST_F(TestRouteStatus, Component) {
+  auto &component = MySQLRoutingComponent::getInstance();
+
+  auto slot = component.register_route("routing:test_component");
+  EXPECT_THAT(component.get_route_status("routing:test_component"), testing::IsNull());
+
+  auto status = std::make_shared<RouteStatus>();
+  status->name = "routing:test_component";
+  status->active_connections = 3;
+  slot->store(status);
+
+  auto names = component.get_route_names();
+  EXPECT_THAT(names, testing::Contains("routing:test_component"));
+
+  auto loaded = component.get_route_status("routing:test_component");
+  ASSERT_THAT(loaded, testing::NotNull());
+  EXPECT_THAT(loaded->active_connections, testing::Eq(3));
+
+  component.unregister_route("routing:test_component");
+  EXPECT_THAT(component.get_route_status("routing:test_component"), testing::IsNull());
+  EXPECT_THAT(component.get_route_status("routing:unknown"), testing::IsNull());
+}
+
+/**
+ * @test
+ *       Verify that connections are listed and closed through the
+ *       handlers a route sets on its slot.
+ */
+TEST_F(TestRouteStatus, ComponentConnections) {
+  using routing::CloseConnectionResult;
+  using routing::ConnectionStatus;
+
+  auto &component = MySQLRoutingComponent::getInstance();
+  std::vector<ConnectionStatus> connections;
+
+  EXPECT_FALSE(component.get_route_connections("routing:test_conns", connections));
+  EXPECT_EQ(CloseConnectionResult::kRouteNotFound,
+            component.close_route_connection("routing:test_conns", 1));
+
+  auto slot = component.register_route("routing:test_conns");
+  // handlers not set yet
+  EXPECT_FALSE(component.get_route_connections("routing:test_conns", connections));
+
+  std::vector<uint64_t> closed;
+  slot->set_connection_handlers(
+      []() {
+        ConnectionStatus conn;
+        conn.id = 7;
+        conn.bytes_from_client = 100;
+        return std::vector<ConnectionStatus>{conn};
+      },
+      [&closed](uint64_t id) {
+        if (id != 7) return false;
+        closed.push_back(id);
+        return true;
+      });
+
+  ASSERT_TRUE(component.get_route_connections("routing:test_conns", connections));
+  ASSERT_THAT(connections, testing::SizeIs(1));
+  EXPECT_THAT(connections[0].bytes_from_client, testing::Eq(100u));
+
+  EXPECT_EQ(CloseConnectionResult::kConnectionNotFound,
+            component.close_route_connection("routing:test_conns", 8));
+  EXPECT_EQ(CloseConnectionResult::kClosed,
+            component.close_route_connection("routing:test_conns", 7));
+  EXPECT_THAT(closed, testing::ElementsAre(7u));
+
+  slot->clear_connection_handlers();
+  EXPECT_FALSE(component.get_route_connections("routing:test_conns", connections));
+  EXPECT_EQ(CloseConnectionResult::kConnectionNotFound,
+            component.close_route_connection("routing:test_conns", 7));
+
+  component.unregister_route("routing:test_conns");
+}
+
+/**
+ * @test
+ *       Verify that client hosts are listed and unblocked through the
+ *       handlers a route sets on its slot.
+ */
+TEST_F(TestRouteStatus, ComponentClientHosts) {
+  using routing::ClientHostStatus;
+  using routing::UnblockHostResult;
+
+  auto &component = MySQLRoutingComponent::getInstance();
+  std::vector<ClientHostStatus> hosts;
+
+  EXPECT_FALSE(component.get_route_client_hosts("routing:test_hosts", hosts));
+  EXPECT_EQ(UnblockHostResult::kRouteNotFound,
+            component.unblock_route_client_host("routing:test_hosts", "10.0.0.1"));
+
+  auto slot = component.register_route("routing:test_hosts");
+  // handlers not set yet
+  EXPECT_FALSE(component.get_route_client_hosts("routing:test_hosts", hosts));
+
+  std::vector<std::string> unblocked;
+  slot->set_client_host_handlers(
+      []() {
+        ClientHostStatus host;
+        host.address = "10.0.0.1";
+        host.connect_errors = 100;
+        host.blocked = true;
+        return std::vector<ClientHostStatus>{host};
+      },
+      [&unblocked](const std::string &address) {
+        if (!address.empty() && address != "10.0.0.1") {
+          return UnblockHostResult::kHostNotFound;
+        }
+        unblocked.push_back(address);
+        return UnblockHostResult::kUnblocked;
+      });
+
+  ASSERT_TRUE(component.get_route_client_hosts("routing:test_hosts", hosts));
+  ASSERT_THAT(hosts, testing::SizeIs(1));
+  EXPECT_THAT(hosts[0].address, testing::Eq("10.0.0.1"));
+  EXPECT_TRUE(hosts[0].blocked);
+
+  EXPECT_EQ(UnblockHostResult::kHostNotFound,
+            component.unblock_route_client_host("routing:test_hosts", "10.0.0.2"));
+  EXPECT_EQ(UnblockHostResult::kUnblocked,
+            component.unblock_route_client_host("routing:test_hosts", "10.0.0.1"));
+  EXPECT_EQ(UnblockHostResult::kUnblocked,
+            component.unblock_route_client_host("routing:test_hosts", ""));
+  EXPECT_THAT(unblocked, testing::ElementsAre("10.0.0.1", ""));
+
+  slot->clear_client_host_handlers();
+  EXPECT_FALSE(component.get_route_client_hosts("routing:test_hosts", hosts));
+  EXPECT_EQ(UnblockHostResult::kRouteNotFound,
+            component.unblock_route_client_host("routing:test_hosts", "10.0.0.1"));
+
+  component.unregister_route("routing:test_hosts");
+}
+
+/**
+ * @test
+ *       Verify that client addresses in text form are stored like the ones
+ *       of accepted connections.
+ */
+TEST_F(TestRouteStatus, ClientIpArrayFromString) {
+  sockaddr_storage storage;
+  ClientIpArray ip_array;
+
+  std::memset(&storage, 0, sizeof(storage));
+  sockaddr_in *addr4 = reinterpret_cast<sockaddr_in*>(&storage);
+  addr4->sin_family = AF_INET;
+  inet_pton(AF_INET, "192.168.1.20", &addr4->sin_addr);
+  ASSERT_TRUE(client_ip_array_from_string("192.168.1.20", ip_array));
+  EXPECT_THAT(ip_array, testing::ContainerEq(in_addr_to_array(storage)));
+
+  std::memset(&storage, 0, sizeof(storage));
+  sockaddr_in6 *addr6 = reinterpret_cast<sockaddr_in6*>(&storage);
+  addr6->sin6_family = AF_INET6;
+  inet_pton(AF_INET6, "fe80::1", &addr6->sin6_addr);
+  ASSERT_TRUE(client_ip_array_from_string("fe80::1", ip_array));
+  EXPECT_THAT(ip_array, testing::ContainerEq(in_addr_to_array(storage)));
+
+  EXPECT_FALSE(client_ip_array_from_string("", ip_array));
+  EXPECT_FALSE(client_ip_array_from_string("10.0.0", ip_array));
+  EXPECT_FALSE(client_ip_array_from_string("example.com", ip_array));
+}
+
+/**
+ * @test
+ *       Verify the conversion of stored client addresses to text.
+ */
+TEST_F(TestRouteStatus, ClientIpArrayToString) {
+  sockaddr_storage storage;
+
+  std::memset(&storage, 0, sizeof(storage));
+  sockaddr_in *addr4 = reinterpret_cast<sockaddr_in*>(&storage);
+  addr4->sin_family = AF_INET;
+  inet_pton(AF_INET, "192.168.1.20", &addr4->sin_addr);
+  EXPECT_THAT(client_ip_array_to_string(in_addr_to_array(storage)), testing::Eq("192.168.1.20"));
+
+  std::memset(&storage, 0, sizeof(storage));
+  sockaddr_in6 *addr6 = reinterpret_cast<sockaddr_in6*>(&storage);
+  addr6->sin6_family = AF_INET6;
+  inet_pton(AF_INET6, "fe80::1", &addr6->sin6_addr);
+  EXPECT_THAT(client_ip_array_to_string(in_addr_to_array(storage)), testing::Eq("fe80::1"));
+}
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -115,8 +115,51 @@ TEST_F(RoutingTests, SetSocketBlocking) {
   ASSERT_EQ(fcntl(s, F_GETFL, nullptr) & O_NONBLOCK, O_NONBLOCK);
   ASSERT_EQ(fcntl(s, F_GETFL, nullptr) & O_RDONLY, O_RDONLY);
 }
+
+TEST_F(RoutingTests, SetConnectionSocketOptions) {
+  int s = socket(PF_INET, SOCK_STREAM, 6);
+  ASSERT_GE(s, 0);
+
+  routing::SocketOptions options;
+  std::string error;
+
+  // defaults leave the socket untouched
+  EXPECT_TRUE(routing::set_connection_socket_options(s, options, error));
+  EXPECT_TRUE(error.empty());
+
+  options.keepalive = true;
+  options.send_buffer_size = 65536;
+  EXPECT_TRUE(routing::set_connection_socket_options(s, options, error)) << error;
+
+  int value = 0;
+  socklen_t len = static_cast<socklen_t>(sizeof(value));
+  ASSERT_EQ(getsockopt(s, SOL_SOCKET, SO_KEEPALIVE, &value, &len), 0);
+  EXPECT_NE(value, 0);
+
+  value = 0;
+  len = static_cast<socklen_t>(sizeof(value));
+  ASSERT_EQ(getsockopt(s, SOL_SOCKET, SO_SNDBUF, &value, &len), 0);
+  EXPECT_GE(value, 65536);
+
+  close(s);
+}
 #endif
 
+TEST_F(RoutingTests, SetSocketOptions) {
+  MySQLRouting routing(routing::RoutingStrategy::kNextAvailable, 7001, Protocol::Type::kClassicProtocol);
+
+  routing::SocketOptions options;
+  EXPECT_EQ(options.listen_backlog, routing::kDefaultListenBacklog);
+  EXPECT_NO_THROW(routing.set_socket_options(options));
+
+  options.listen_backlog = 0;
+  EXPECT_THROW(routing.set_socket_options(options), std::invalid_argument);
+
+  options.listen_backlog = 128;
+  options.receive_buffer_size = -1;
+  EXPECT_THROW(routing.set_socket_options(options), std::invalid_argument);
+}
+
 TEST_F(RoutingTests, CopyPacketsSingleWrite) {
   int sender_socket = 1, receiver_socket = 2;
   RoutingProtocolBuffer buffer(500);
@@ -546,6 +589,73 @@ TEST_F(RoutingTests, set_destinations_from_cvs) {
     EXPECT_THROW(routing_x.set_destinations_from_csv("127.0.0.1:33060"), std::runtime_error);
     EXPECT_NO_THROW(routing_x.set_destinations_from_csv("127.0.0.1:3306"));
   }
+
+  // unix socket destinations
+  {
+    EXPECT_NO_THROW(routing.set_destinations_from_csv("unix:/tmp/mysqld.sock"));
+    EXPECT_NO_THROW(routing.set_destinations_from_csv("unix:/tmp/mysqld.sock,127.0.0.1:2002"));
+    EXPECT_THROW(routing.set_destinations_from_csv("unix:"), std::runtime_error);
+    EXPECT_THROW(routing.set_destinations_from_csv("127.0.0.1:2002,unix:"), std::runtime_error);
+  }
+}
+
+static int listen_unix_socket(const std::string &path, int backlog) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    throw std::runtime_error(mysql_harness::get_strerror(errno));
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+
+  if (bind(fd, (struct sockaddr*)&addr, static_cast<socklen_t>(sizeof(addr))) == -1 ||
+      listen(fd, backlog) == -1) {
+    int err = errno;
+    close(fd);
+    throw std::runtime_error(mysql_harness::get_strerror(err));
+  }
+
+  return fd;
+}
+
+TEST_F(RoutingTests, ConnectToUnixSocketDestination) {
+  auto sock_ops = routing::RoutingSockOps::instance(mysql_harness::SocketOperations::instance());
+  TmpDir tmp_dir;
+  const std::string sock_path = tmp_dir() + "/mysqld.sock";
+  const std::chrono::milliseconds timeout{100};
+
+  // nobody listening
+  EXPECT_EQ(-1, sock_ops->get_mysql_socket(TCPAddress::make_unix_socket(sock_path), timeout, false));
+
+  int server = listen_unix_socket(sock_path, 0);
+  std::vector<int> clients;
+
+  int sock = sock_ops->get_mysql_socket(TCPAddress::make_unix_socket(sock_path), timeout, false);
+  EXPECT_THAT(sock, Gt(0));
+  clients.push_back(sock);
+
+  // the server never accepts: once its backlog is full, connecting must give up
+  // after the connect timeout instead of blocking
+  for (int i = 0; i < 16 && sock > 0; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    sock = sock_ops->get_mysql_socket(TCPAddress::make_unix_socket(sock_path), timeout, false);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    if (sock > 0) {
+      clients.push_back(sock);
+    } else {
+      EXPECT_EQ(-2, sock);
+      EXPECT_GE(elapsed, timeout);
+      EXPECT_LT(elapsed, std::chrono::seconds(5));
+    }
+  }
+  EXPECT_EQ(-2, sock);
+
+  for (int fd : clients) {
+    close(fd);
+  }
+  close(server);
 }
 
 #endif // #ifndef _WIN32 [_HERE_]
@@ -25,6 +25,7 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "mysql/harness/logging/logging.h"
@@ -356,6 +357,54 @@ TEST_F(XProtocolTest, CopyPacketsHandshakeClientSendsBrokenMessage)
   ASSERT_EQ(-1, result);
 }
 
+TEST_F(XProtocolTest, CopyPacketsHandshakeClientSendsMessageMissingRequiredField)
+{
+  size_t report_bytes_read = 0xff;
+
+  // CapabilitiesSet with a capability whose value (Any) has no type
+  const std::vector<uint8_t> msg = {
+    0x0e, 0x00, 0x00, 0x00, Mysqlx::ClientMessages::CON_CAPABILITIES_SET,
+    0x0a, 0x0b, 0x0a, 0x09, 0x0a, 0x03, 't', 'l', 's', 0x12, 0x02, 0x1a, 0x00,
+  };
+  std::copy(msg.begin(), msg.end(), network_buffer_.begin());
+  network_buffer_offset_ += msg.size();
+
+  EXPECT_CALL(*mock_socket_operations_, read(sender_socket_, &network_buffer_[0], network_buffer_.size())).
+                                                     WillOnce(Return(network_buffer_offset_));
+
+  int result = x_protocol_->copy_packets(sender_socket_, receiver_socket_, true, network_buffer_, &curr_pktnr_,
+                                         handshake_done_, &report_bytes_read, false);
+
+  ASSERT_FALSE(handshake_done_);
+  ASSERT_EQ(-1, result);
+}
+
+TEST_F(XProtocolTest, CopyPacketsHandshakeClientSendsUnknownField)
+{
+  size_t report_bytes_read = 0xff;
+  auto auth_msg = create_authenticate_start_msg();
+
+  serialize_protobuf_msg_to_buffer(network_buffer_, network_buffer_offset_, auth_msg,
+                                   Mysqlx::ClientMessages::SESS_AUTHENTICATE_START);
+
+  // append field 15 (varint) which AuthenticateStart does not know
+  network_buffer_[network_buffer_offset_++] = 0x78;
+  network_buffer_[network_buffer_offset_++] = 0x01;
+  google::protobuf::io::CodedOutputStream::WriteLittleEndian32ToArray(
+      static_cast<uint32_t>(network_buffer_offset_ - 4), &network_buffer_[0]);
+
+  EXPECT_CALL(*mock_socket_operations_, read(sender_socket_, &network_buffer_[0], network_buffer_.size())).
+                                                     WillOnce(Return(network_buffer_offset_));
+  EXPECT_CALL(*mock_socket_operations_, write(receiver_socket_, &network_buffer_[0], network_buffer_offset_)).
+                                                     WillOnce(Return(network_buffer_offset_));
+
+  int result = x_protocol_->copy_packets(sender_socket_, receiver_socket_, true, network_buffer_, &curr_pktnr_,
+                                         handshake_done_, &report_bytes_read, false);
+
+  ASSERT_TRUE(handshake_done_);
+  ASSERT_EQ(0, result);
+}
+
 TEST_F(XProtocolTest, CopyPacketsHandshakeServerSendsError)
 {
   size_t report_bytes_read = 0xff;